@@ -0,0 +1,124 @@
+/*
+ * dtmfdetect.h
+ *
+ * In-band DTMF tone detection
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_CODEC_DTMFDETECT_H
+#define OPAL_CODEC_DTMFDETECT_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#if OPAL_DTMF_DETECT
+
+#include <rtp/rtp.h>
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**Detector for DTMF tones in 8kHz 16 bit linear PCM audio.
+   This is a drop in replacement for PDTMFDecoder, intended for running on
+   every audio frame of a very large number of calls. All eight Goertzel
+   filters of the DTMF bank are evaluated together as SIMD lanes, on blocks
+   of BlockSize samples, so the per sample cost is a couple of vector
+   operations. Blocks whose energy is too low to contain a valid tone, or
+   frames flagged as silent via their RFC 6464 audio level, skip the filter
+   bank entirely.
+
+   A digit is reported when two consecutive blocks (about 25ms) agree, and
+   is not reported again until two consecutive blocks have no digit. Each
+   tone must also be within 2.5% of its nominal frequency, so tones 1.5%
+   off are accepted and those 3.5% off are rejected, as per ITU-T Q.24.
+  */
+class OpalDTMFDetector : public PObject
+{
+    PCLASSINFO(OpalDTMFDetector, PObject);
+  public:
+    enum {
+      SampleRate = 8000,
+      BlockSize  = 102,   ///< Samples per detection block, 12.75ms at 8kHz
+      NumFilters = 8,     ///< Four row and four column frequencies
+      DetectTime = 2*BlockSize*1000/SampleRate ///< Milliseconds of tone before it is reported
+    };
+
+    OpalDTMFDetector();
+
+    /**Reset the detector, discarding any partial block and current tone.
+      */
+    void Reset();
+
+    /**Decode DTMF tones from the audio samples.
+       The \p mult and \p div values scale the audio before detection, to
+       compensate for a low or high line level.
+
+       @return string of newly detected tones, usually empty.
+      */
+    PString Decode(
+      const short * samples,  ///< 8kHz 16 bit PCM audio
+      PINDEX count,           ///< Number of samples
+      unsigned mult = 1,      ///< Amplitude multiplier
+      unsigned div = 1        ///< Amplitude divisor
+    );
+
+    /**Decode DTMF tones from the audio in an RTP frame.
+       If the frame carries an audio level (see RTP_DataFrame::GetAudioLevel())
+       quieter than GetSilenceLevel(), the audio is not examined at all, and
+       the frame is treated as a gap between tones.
+      */
+    PString Decode(
+      const RTP_DataFrame & frame,  ///< Frame of 8kHz 16 bit PCM audio
+      unsigned mult = 1,            ///< Amplitude multiplier
+      unsigned div = 1              ///< Amplitude divisor
+    );
+
+    /**Get the audio level, in -dBov, quieter than which a frame is skipped.
+      */
+    unsigned GetSilenceLevel() const { return m_silenceLevel; }
+
+    /**Set the audio level, in -dBov, quieter than which a frame is skipped.
+       Zero disables skipping frames, the default is 50.
+      */
+    void SetSilenceLevel(unsigned level) { m_silenceLevel = level; }
+
+  protected:
+    char DetectBlock(float scale);
+    void OnBlockResult(char hit, PString & tones);
+
+    unsigned m_silenceLevel;
+    short    m_block[BlockSize];
+    PINDEX   m_blockCount;
+    char     m_lastHit;
+    char     m_currentTone;
+};
+
+
+#endif // OPAL_DTMF_DETECT
+
+#endif // OPAL_CODEC_DTMFDETECT_H
+
+
+// End of File ///////////////////////////////////////////////////////////////
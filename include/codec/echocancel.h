@@ -35,7 +35,6 @@
 #if OPAL_AEC
 
 #include <rtp/rtp.h>
-#include <ptclib/qchannel.h>
 
 #ifndef SPEEX_ECHO_H
 struct SpeexEchoState;
@@ -88,28 +87,61 @@ public:
     void SetClockRate(
       const int clockRate     ///> Clock Rate for the preprocessor
     );
+  //@}
+
+  /**@@name Processing */
+  //@{
+    /**Add played (speaker) audio as the echo reference.
+       This is called by the send handler, and never blocks.
+      */
+    void AddEchoReference(
+      const short * samples,  ///< Audio played
+      PINDEX count            ///< Number of samples
+    );
+
+    /**Cancel echo from captured (microphone) audio.
+       This is called by the receive handler, the audio is modified in place.
+      */
+    void CancelEcho(
+      short * samples,  ///< Audio captured
+      PINDEX count      ///< Number of samples
+    );
+  //@}
 
 protected:
   PDECLARE_NOTIFIER(RTP_DataFrame, OpalEchoCanceler, ReceivedPacket);
   PDECLARE_NOTIFIER(RTP_DataFrame, OpalEchoCanceler, SentPacket);
 
+  bool InternalInitState(unsigned blockSize);
+  void InternalDestroyState();
+  void InternalRemoveDC(const short * input, short * output, PINDEX count);
+
   PNotifier receiveHandler;
   PNotifier sendHandler;
 
   Params param;
-
-  double mean;
   int clockRate;
-  PQueueChannel *echo_chan;
+
   PDECLARE_MUTEX(stateMutex);
   SpeexEchoState *echoState;
   SpeexPreprocessState *preprocessState;
 
-  // the following types are all void * to avoid including Speex header files
-  void * ref_buf;
-  void * echo_buf;
-  void * e_buf;
-  void * noise;
+  /* Reference audio ring buffer, single producer (SentPacket) and single
+     consumer (ReceivedPacket), so needs no lock. Indexes are free running
+     and masked on access. */
+  enum { EchoRingSize = 16384 }; // Power of two, about 340ms at 48kHz
+  std::vector<short> m_echoRing;
+  atomic<unsigned>   m_echoRingWrite;
+  atomic<unsigned>   m_echoRingRead;
+
+  // Working buffers, allocated when state created, not per frame
+  unsigned             m_blockSize;   // Samples per speex operation, frames are a multiple
+  std::vector<short>   m_captureBlock;
+  std::vector<short>   m_echoBlock;
+  std::vector<int32_t> m_noise;       // spx_int32_t or float, to avoid including speex headers
+
+  int32_t m_dcMean;    // DC offset estimate, Q8 fixed point
+  int32_t m_dcAlpha;   // Per block smoothing factor, Q15 fixed point
 };
 
 
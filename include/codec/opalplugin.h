@@ -227,6 +227,7 @@ struct PluginCodec_Definition;
 #define PLUGINCODEC_CONTROL_SET_LOG_FUNCTION      "set_log_function"
 #define PLUGINCODEC_CONTROL_GET_STATISTICS        "get_statistics"
 #define PLUGINCODEC_CONTROL_TERMINATE_CODEC       "terminate_codec"
+#define PLUGINCODEC_CONTROL_RESET_CODEC           "reset_codec"  // Returns non-zero if context may be re-used
 
 
 /* Log function, plug in gets a pointer to this function which allows
@@ -326,6 +327,8 @@ struct PluginCodec_Option {
 #define PLUGINCODEC_OPTION_MAX_RX_FRAME_HEIGHT        "Max Rx Frame Height"
 #define PLUGINCODEC_OPTION_TEMPORAL_SPATIAL_TRADE_OFF "Temporal Spatial Trade Off"
 #define PLUGINCODEC_OPTION_TX_KEY_FRAME_PERIOD        "Tx Key Frame Period"
+#define PLUGINCODEC_OPTION_ENCODER_THREADS            "Encoder Threads"      /* Zero is automatic, based on resolution */
+#define PLUGINCODEC_OPTION_ENCODER_SLICES             "Encoder Slices"       /* Zero is one slice per encoder thread */
 #define PLUGINCODEC_OPTION_VOICE_ACTIVITY_DETECT      "VAD"
 #define PLUGINCODEC_OPTION_DYNAMIC_PACKET_LOSS        "Dynamic Packet Loss"
 
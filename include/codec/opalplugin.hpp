@@ -666,6 +666,17 @@ class PluginCodec : public PluginCodec_Utilities
     }
 
 
+    /** Reset the plug in codec so the instance may be re-used for another
+        call. All state from the previous call must be discarded, options
+        will be set again afterwards. Return false if not supported, and
+        the instance will be destroyed as usual.
+      */
+    virtual bool Reset()
+    {
+      return false;
+    }
+
+
     /// Convert from one media format to another.
     virtual bool Transcode(const void * fromPtr,
                              unsigned & fromLen,
@@ -978,6 +989,12 @@ class PluginCodec : public PluginCodec_Utilities
       return codec != NULL && codec->Terminate();
     }
 
+    static int Reset_s(const PluginCodec_Definition *, void * context, const char *, void *, unsigned *)
+    {
+      PluginCodec * codec = (PluginCodec *)context;
+      return codec != NULL && codec->Reset();
+    }
+
     static struct PluginCodec_ControlDefn * GetControls()
     {
       static PluginCodec_ControlDefn ControlsTable[] = {
@@ -992,6 +1009,7 @@ class PluginCodec : public PluginCodec_Utilities
         { PLUGINCODEC_CONTROL_SET_INSTANCE_ID,       PluginCodec::SetInstanceID_s },
         { PLUGINCODEC_CONTROL_GET_STATISTICS,        PluginCodec::GetStatistics_s },
         { PLUGINCODEC_CONTROL_TERMINATE_CODEC,       PluginCodec::Terminate_s },
+        { PLUGINCODEC_CONTROL_RESET_CODEC,           PluginCodec::Reset_s },
         PLUGINCODEC_CONTROL_LOG_FUNCTION_INC
         { NULL }
       };
@@ -1067,6 +1085,8 @@ class PluginVideoEncoder : public PluginVideoCodec<NAME>
     unsigned m_maxRTPSize;
     unsigned m_tsto;
     unsigned m_keyFramePeriod;
+    unsigned m_encoderThreads;
+    unsigned m_encoderSlices;
 
   public:
     PluginVideoEncoder(const PluginCodec_Definition * defn)
@@ -1074,6 +1094,8 @@ class PluginVideoEncoder : public PluginVideoCodec<NAME>
       , m_maxRTPSize(PluginCodec_RTP_MaxPacketSize)
       , m_tsto(31)
       , m_keyFramePeriod(0) // Indicates auto/default
+      , m_encoderThreads(0) // Indicates auto/default
+      , m_encoderSlices(0)  // Indicates auto/default
     {
     }
 
@@ -1101,11 +1123,41 @@ class PluginVideoEncoder : public PluginVideoCodec<NAME>
       if (strcasecmp(optionName, PLUGINCODEC_OPTION_TX_KEY_FRAME_PERIOD) == 0)
         return this->SetOptionUnsigned(this->m_keyFramePeriod, optionValue, 0);
 
+      if (strcasecmp(optionName, PLUGINCODEC_OPTION_ENCODER_THREADS) == 0)
+        return this->SetOptionUnsigned(this->m_encoderThreads, optionValue, 0, 64);
+
+      if (strcasecmp(optionName, PLUGINCODEC_OPTION_ENCODER_SLICES) == 0)
+        return this->SetOptionUnsigned(this->m_encoderSlices, optionValue, 0, 64);
+
       // Base class sets bit rate and frame time
       return BaseClass::SetOption(optionName, optionValue);
     }
 
 
+    /** Get the number of threads the encoder library should use. If not set
+        explicitly, small pictures stay on one core, and larger ones get more.
+      */
+    unsigned GetEncoderThreads() const
+    {
+      if (this->m_encoderThreads != 0)
+        return this->m_encoderThreads;
+
+      unsigned macroBlocks = this->GetMacroBlocks(this->m_width, this->m_height);
+      if (macroBlocks <= 1200) // VGA
+        return 1;
+      if (macroBlocks <= 3600) // 720p
+        return 2;
+      return 4;
+    }
+
+
+    /// Get the number of slices (or partitions) per frame, for parallel encoding.
+    unsigned GetEncoderSlices() const
+    {
+      return this->m_encoderSlices != 0 ? this->m_encoderSlices : GetEncoderThreads();
+    }
+
+
     /// Get options that are "active" and may be different from the last SetOptions() call.
     virtual bool GetActiveOptions(PluginCodec_OptionMap & options)
     {
@@ -221,6 +221,7 @@ class OpalPluginTranscoder
 
   protected:
     bool CreateContext();
+    bool ResetContext();
     bool SetCodecOption(const PString & optionName, const PString & optionValue);
 
     const PluginCodec_Definition * codecDef;
@@ -233,6 +234,7 @@ class OpalPluginTranscoder
     OpalPluginControl freeOptionsControl;
     OpalPluginControl getOutputDataSizeControl;
     OpalPluginControl getCodecStatistics;
+    OpalPluginControl resetCodecControl;
 #if PTRACING
     bool m_firstLoggedUpdateOptions[2];
 #endif
@@ -272,6 +274,7 @@ class OpalPluginFramedAudioTranscoder : public OpalFramedTranscoder, public Opal
     PBoolean ConvertFrame(const BYTE * input, PINDEX & consumed, BYTE * output, PINDEX & created);
     virtual PBoolean ConvertSilentFrame(BYTE * buffer, PINDEX & created);
     virtual bool AcceptComfortNoise() const { return comfortNoise; }
+    virtual bool Reset() { return ResetContext(); }
   protected:
     virtual bool OnCreated(const OpalMediaFormat & srcFormat,
                            const OpalMediaFormat & destFormat,
@@ -289,6 +292,7 @@ class OpalPluginStreamedAudioTranscoder : public OpalStreamedTranscoder, public
     PBoolean ExecuteCommand(const OpalMediaCommand & command);
     virtual bool AcceptComfortNoise() const { return comfortNoise; }
     virtual int ConvertOne(int from) const;
+    virtual bool Reset() { return ResetContext(); }
   protected:
     virtual bool OnCreated(const OpalMediaFormat & srcFormat,
                            const OpalMediaFormat & destFormat,
@@ -331,11 +335,15 @@ class OpalPluginVideoTranscoder : public OpalVideoTranscoder, public OpalPluginT
     PBoolean ConvertFrames(const RTP_DataFrame & src, RTP_DataFrameList & dstList);
     bool UpdateMediaFormats(const OpalMediaFormat & input, const OpalMediaFormat & output);
     PBoolean ExecuteCommand(const OpalMediaCommand & command);
+    virtual bool Reset() { return ResetContext(); }
 
   protected:
     virtual bool OnCreated(const OpalMediaFormat & srcFormat,
                            const OpalMediaFormat & destFormat,
                            const BYTE * instance, unsigned instanceLen);
+    virtual bool OnReused(const OpalMediaFormat & srcFormat,
+                          const OpalMediaFormat & destFormat,
+                          const BYTE * instance, unsigned instanceLen);
     bool EncodeFrames(const RTP_DataFrame & src, RTP_DataFrameList & dstList);
     bool DecodeFrames(const RTP_DataFrame & src, RTP_DataFrameList & dstList);
     bool DecodeFrame(const RTP_DataFrame & src, RTP_DataFrameList & dstList);
@@ -0,0 +1,163 @@
+/*
+ * resampler.h
+ *
+ * Polyphase sample rate conversion for linear PCM audio
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_CODEC_RESAMPLER_H
+#define OPAL_CODEC_RESAMPLER_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#include <opal/transcoders.h>
+
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**Sample rate converter between mono 16 bit linear PCM formats.
+   This is a rational polyphase FIR resampler: the input is conceptually
+   interpolated by L, low pass filtered and decimated by M, where L/M is the
+   ratio of the output to input rates reduced to lowest terms. Only the
+   filter phase needed for each output sample is evaluated, using a Kaiser
+   windowed sinc prototype stored as Q14 coefficients, so the cost is a
+   fixed number of multiply/accumulates per output sample whatever the
+   ratio.
+
+   Filter history is carried between frames so the output is continuous
+   across packets. For 10ms multiples between any of 8, 16, 32 and 48kHz
+   the number of output samples is exact for every frame.
+  */
+class OpalPCMResampler : public OpalTranscoder
+{
+    PCLASSINFO(OpalPCMResampler, OpalTranscoder);
+  public:
+    enum {
+      TapsPerPhase = 32   ///< Filter taps per output sample, scaled up for decimation
+    };
+
+    OpalPCMResampler(
+      unsigned inputRate,   ///< Sample rate of input PCM-16
+      unsigned outputRate   ///< Sample rate of output PCM-16
+    );
+
+    /**Get the optimal size for data frames to be converted.
+       This is one "frame" of the PCM-16 format, scaled to frames per packet
+       as for OpalStreamedTranscoder.
+      */
+    virtual PINDEX GetOptimalDataFrameSize(
+      PBoolean input      ///<  Flag for input or output data size
+    ) const;
+
+    /**Convert the data from one sample rate to the other.
+      */
+    virtual PBoolean Convert(
+      const RTP_DataFrame & input,  ///<  Input data
+      RTP_DataFrame & output        ///<  Output data
+    );
+
+    /**Discard the filter history so may be re-used for another stream.
+      */
+    virtual bool Reset();
+
+    /**Resample a block of samples.
+       The \p output must have room for GetMaxOutputSamples(\p count)
+       samples.
+
+       @return number of samples written to \p output.
+      */
+    PINDEX Resample(
+      const short * input,  ///< Input samples
+      PINDEX count,         ///< Number of input samples
+      short * output        ///< Output samples
+    );
+
+    /**Get the maximum number of output samples produced from \p count input
+       samples.
+      */
+    PINDEX GetMaxOutputSamples(PINDEX count) const { return (count*m_interpolation)/m_decimation + 1; }
+
+    /**Get the input sample rate.
+      */
+    unsigned GetInputRate() const { return m_inputRate; }
+
+    /**Get the output sample rate.
+      */
+    unsigned GetOutputRate() const { return m_outputRate; }
+
+  protected:
+    unsigned m_inputRate;
+    unsigned m_outputRate;
+    unsigned m_interpolation;   // L
+    unsigned m_decimation;      // M
+    unsigned m_taps;            // Taps per phase, multiple of 8
+    unsigned m_phase;           // Position of next output in 1/L input samples, from start of m_history
+
+    std::vector<short> m_coefficients;  // m_interpolation phases of m_taps, each time reversed
+    std::vector<short> m_history;       // Last m_taps-1 input samples, then working space
+};
+
+
+#define OPAL_DECLARE_PCM_RESAMPLER(inKHz, outKHz) \
+  class Opal_PCM16_##inKHz##kHz_##outKHz##kHz : public OpalPCMResampler { \
+    public: Opal_PCM16_##inKHz##kHz_##outKHz##kHz() : OpalPCMResampler(inKHz*1000, outKHz*1000) { } \
+  }
+
+OPAL_DECLARE_PCM_RESAMPLER( 8, 16);
+OPAL_DECLARE_PCM_RESAMPLER( 8, 32);
+OPAL_DECLARE_PCM_RESAMPLER( 8, 48);
+OPAL_DECLARE_PCM_RESAMPLER(16,  8);
+OPAL_DECLARE_PCM_RESAMPLER(16, 32);
+OPAL_DECLARE_PCM_RESAMPLER(16, 48);
+OPAL_DECLARE_PCM_RESAMPLER(32,  8);
+OPAL_DECLARE_PCM_RESAMPLER(32, 16);
+OPAL_DECLARE_PCM_RESAMPLER(32, 48);
+OPAL_DECLARE_PCM_RESAMPLER(48,  8);
+OPAL_DECLARE_PCM_RESAMPLER(48, 16);
+OPAL_DECLARE_PCM_RESAMPLER(48, 32);
+
+
+#define OPAL_REGISTER_PCM_RESAMPLERS() \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_8kHz_16kHz,  OPAL_PCM16_8KHZ,  OPAL_PCM16_16KHZ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_8kHz_32kHz,  OPAL_PCM16_8KHZ,  OPAL_PCM16_32KHZ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_8kHz_48kHz,  OPAL_PCM16_8KHZ,  OPAL_PCM16_48KHZ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_16kHz_8kHz,  OPAL_PCM16_16KHZ, OPAL_PCM16_8KHZ ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_16kHz_32kHz, OPAL_PCM16_16KHZ, OPAL_PCM16_32KHZ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_16kHz_48kHz, OPAL_PCM16_16KHZ, OPAL_PCM16_48KHZ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_32kHz_8kHz,  OPAL_PCM16_32KHZ, OPAL_PCM16_8KHZ ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_32kHz_16kHz, OPAL_PCM16_32KHZ, OPAL_PCM16_16KHZ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_32kHz_48kHz, OPAL_PCM16_32KHZ, OPAL_PCM16_48KHZ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_48kHz_8kHz,  OPAL_PCM16_48KHZ, OPAL_PCM16_8KHZ ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_48kHz_16kHz, OPAL_PCM16_48KHZ, OPAL_PCM16_16KHZ); \
+OPAL_REGISTER_TRANSCODER(Opal_PCM16_48kHz_32kHz, OPAL_PCM16_48KHZ, OPAL_PCM16_32KHZ)
+
+
+#endif // OPAL_CODEC_RESAMPLER_H
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -88,11 +88,17 @@ class OpalRFC4175Encoder : public OpalRFC4175Transcoder
       const OpalMediaFormat & outputMediaFormat  ///<  Output media format
     );
 
+    /**Packetise a raw video frame.
+       Frames already in \p output are re-used for the packets, so passing
+       the same list each time avoids any allocation per packet. Each packet
+       is filled completely, scan line table then pixel data, before moving
+       to the next, so the source is only read once.
+      */
     bool ConvertFrames(const RTP_DataFrame & input, RTP_DataFrameList & output);
 
   protected:
     virtual void StartEncoding(const RTP_DataFrame & input);
-    virtual void EndEncoding() = 0;
+    virtual void EncodeScanLines(const ScanLineHeader * table, PINDEX count, BYTE * data) = 0;
 
     void EncodeFullFrame();
     void EncodeScanLineSegment(PINDEX y, PINDEX offs, PINDEX width);
@@ -107,7 +113,9 @@ class OpalRFC4175Encoder : public OpalRFC4175Transcoder
     DWORD m_srcTimestamp;
 
     RTP_DataFrameList * m_dstFrames;
-    std::vector<PINDEX> m_dstScanlineCounts;
+    RTP_DataFrameList::iterator m_dstIterator;
+    RTP_DataFrame * m_dstFrame;
+    PINDEX m_dstFrameCount;
     PINDEX m_dstScanLineCount;
     PINDEX m_dstPacketSize;
     ScanLineHeader * m_dstScanLineTable;
@@ -128,15 +136,37 @@ class OpalRFC4175Decoder : public OpalRFC4175Transcoder
     virtual PINDEX PixelsToBytes(PINDEX pixels) const = 0;
     virtual PINDEX BytesToPixels(PINDEX pixels) const = 0;
 
+    /**Depacketise RFC4175 packets.
+       The pixel data of each packet is written straight into the output
+       video frame as it arrives, which is emitted in \p output when the
+       marker bit is seen.
+      */
     bool ConvertFrames(const RTP_DataFrame & input, RTP_DataFrameList & output);
 
+    /**Update the input and output media formats.
+       The negotiated frame size is used for the first output frame, so it
+       does not need to be grown as the first scan lines arrive.
+      */
+    virtual bool UpdateMediaFormats(
+      const OpalMediaFormat & inputMediaFormat,  ///<  Input media format
+      const OpalMediaFormat & outputMediaFormat  ///<  Output media format
+    );
+
   protected:
-    void DecodeFramesAndSetFrameSize(RTP_DataFrameList & output);
-    virtual bool DecodeFrames(RTP_DataFrameList & output) = 0;
+    void SetNegotiatedFrameSize();
+    bool PrepareOutputFrame(PINDEX width, PINDEX height);
+    void FinishOutputFrame(RTP_DataFrameList & output);
+    virtual void DecodeScanLines(const ScanLineHeader * table, PINDEX count, const BYTE * data) = 0;
+    virtual void CopyPicture(const BYTE * src, PINDEX srcWidth, PINDEX srcHeight,
+                             BYTE * dst, PINDEX dstWidth, PINDEX dstHeight) const = 0;
 
-    RTP_DataFrameList m_inputFrames;
-    std::vector<PINDEX> m_scanlineCounts;
     PINDEX m_frameWidth, m_frameHeight;
+    PINDEX m_negotiatedWidth, m_negotiatedHeight;
+
+    RTP_DataFrame * m_outputFrame;    // Frame being assembled
+    PINDEX          m_outputWidth;
+    PINDEX          m_outputHeight;
+    BYTE          * m_outputPicture;
 
     bool    m_first;
     bool    m_missingPackets;
@@ -164,7 +194,10 @@ class Opal_RFC4175YCbCr420_to_YUV420P : public OpalRFC4175Decoder
     PINDEX PixelsToBytes(PINDEX pixels) const { return pixels*12/8; }
     PINDEX BytesToPixels(PINDEX bytes) const  { return bytes*8/12; }
 
-    bool DecodeFrames(RTP_DataFrameList & output);
+  protected:
+    void DecodeScanLines(const ScanLineHeader * table, PINDEX count, const BYTE * data);
+    void CopyPicture(const BYTE * src, PINDEX srcWidth, PINDEX srcHeight,
+                     BYTE * dst, PINDEX dstWidth, PINDEX dstHeight) const;
 };
 
 class Opal_YUV420P_to_RFC4175YCbCr420 : public OpalRFC4175Encoder
@@ -179,10 +212,10 @@ class Opal_YUV420P_to_RFC4175YCbCr420 : public OpalRFC4175Encoder
     PINDEX PixelsToBytes(PINDEX pixels) const { return pixels * 12 / 8; }
     PINDEX BytesToPixels(PINDEX bytes) const  { return bytes * 8 / 12; }
 
+  protected:
     void StartEncoding(const RTP_DataFrame & input);
-    void EndEncoding();
+    void EncodeScanLines(const ScanLineHeader * table, PINDEX count, BYTE * data);
 
-  protected:
     BYTE * m_srcYPlane;
     BYTE * m_srcCbPlane;
     BYTE * m_srcCrPlane;
@@ -202,7 +235,10 @@ class Opal_RFC4175RGB_to_RGB24 : public OpalRFC4175Decoder
     PINDEX PixelsToBytes(PINDEX pixels) const { return pixels * 3; }
     PINDEX BytesToPixels(PINDEX bytes) const  { return bytes / 3; }
 
-    bool DecodeFrames(RTP_DataFrameList & output);
+  protected:
+    void DecodeScanLines(const ScanLineHeader * table, PINDEX count, const BYTE * data);
+    void CopyPicture(const BYTE * src, PINDEX srcWidth, PINDEX srcHeight,
+                     BYTE * dst, PINDEX dstWidth, PINDEX dstHeight) const;
 };
 
 class Opal_RGB24_to_RFC4175RGB : public OpalRFC4175Encoder
@@ -217,10 +253,10 @@ class Opal_RGB24_to_RFC4175RGB : public OpalRFC4175Encoder
     PINDEX PixelsToBytes(PINDEX pixels) const { return pixels * 3; }
     PINDEX BytesToPixels(PINDEX bytes) const  { return bytes / 3; }
 
+  protected:
     void StartEncoding(const RTP_DataFrame & input);
-    void EndEncoding();
+    void EncodeScanLines(const ScanLineHeader * table, PINDEX count, BYTE * data);
 
-  protected:
     BYTE * m_rgbBase;
 };
 
@@ -47,7 +47,8 @@ class OpalSilenceDetector : public PObject
     P_DECLARE_STREAMABLE_ENUM(Modes,
       NoSilenceDetection,
       FixedSilenceDetection,
-      AdaptiveSilenceDetection
+      AdaptiveSilenceDetection,
+      SubBandSilenceDetection
     );
     typedef Modes Mode; // Backward compatibility
 
@@ -142,6 +143,9 @@ class OpalSilenceDetector : public PObject
     ) const;
 
     /**Detemine (in context) if audio stream is currently silent.
+       The audio level, as per RFC 6464, is also measured, even if no
+       silence detection is being done. This is available via
+       GetAudioLevel().
       */
     Result Detect(
       const BYTE * audioPtr,
@@ -149,6 +153,12 @@ class OpalSilenceDetector : public PObject
       unsigned timestamp
     );
 
+    /**Get the audio level of the last frame passed to Detect().
+       This is in -dBov as per RFC 6464, 0 is loudest and 127 is silent, or
+       -1 if the level cannot be determined.
+      */
+    int GetAudioLevel() const { return m_lastAudioLevel; }
+
     /**Get the average signal level in the stream.
        This is called from within the silence detection algorithm to
        calculate the average signal level of the last data frame read from
@@ -176,6 +186,24 @@ class OpalSilenceDetector : public PObject
       bool asPercentage     ///<  Return as percentage on logarithmic scale
     );
 
+    /**Detect voice using the energy in frequency sub-bands.
+       This is called from within the silence detection algorithm when in
+       SubBandSilenceDetection mode. Tracking the noise floor of each band
+       separately means low level speech, e.g. fricatives, is not mistaken
+       for background noise, and loud low frequency hum is not mistaken for
+       speech, which the single average level cannot distinguish.
+
+       Returns 1 if voice is present, 0 if not, and -1 if sub-band analysis
+       is not possible for the stream, in which case the adaptive algorithm
+       is used.
+
+       The default behaviour returns -1.
+      */
+    virtual int DetectSubBandVoice(
+      const BYTE * buffer,  ///<  RTP payload being detected
+      PINDEX size           ///<  Size of payload buffer
+    );
+
   private:
     /**Reset the adaptive filter
      */
@@ -200,6 +228,7 @@ class OpalSilenceDetector : public PObject
     unsigned m_signalReceivedTime;    // Duration of signal received
     unsigned m_silenceReceivedTime;   // Duration of silence received
     unsigned m_lastSignalLevel;       // Energy level from last data frame
+    int      m_lastAudioLevel;        // RFC 6464 -dBov level from last data frame, -1 if unknown
     Result   m_lastResult;            // What it says
     PDECLARE_MUTEX(m_inUse);          // Protects values to allow change while running
 };
@@ -213,7 +242,7 @@ class OpalPCM16SilenceDetector : public OpalSilenceDetector
       */
     OpalPCM16SilenceDetector(
       const Params & newParam ///<  New parameters for silence detector
-    ) : OpalSilenceDetector(newParam) { }
+    );
 
   /**@name Overrides from OpalSilenceDetector */
   //@{
@@ -221,7 +250,22 @@ class OpalPCM16SilenceDetector : public OpalSilenceDetector
       const BYTE * buffer,  ///<  RTP payload being detected
       PINDEX size           ///<  Size of payload buffer
     );
+
+    /**Detect voice using the energy in frequency sub-bands.
+       The frame is split into three bands, 0 to fs/8, fs/8 to fs/4 and
+       fs/4 to fs/2, with a two level Haar decomposition. A band has signal
+       when its energy is well above its noise floor, which follows the
+       minimum quickly and rises slowly.
+      */
+    virtual int DetectSubBandVoice(
+      const BYTE * buffer,  ///<  RTP payload being detected
+      PINDEX size           ///<  Size of payload buffer
+    );
     //@}
+
+  protected:
+    enum { NumSubBands = 3 };
+    unsigned m_subBandNoise[NumSubBands]; // Noise floor of each band, zero if not yet known
 };
 
 
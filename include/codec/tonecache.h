@@ -0,0 +1,198 @@
+/*
+ * tonecache.h
+ *
+ * Shared cache of rendered and encoded call progress tones
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_CODEC_TONECACHE_H
+#define OPAL_CODEC_TONECACHE_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#if OPAL_PTLIB_DTMF
+
+#include <opal/mediafmt.h>
+
+#include <list>
+#include <map>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**Shared cache of call progress tones, e.g. ringback or busy.
+   A tone, as specified for PTones, is rendered once for each sample rate
+   and encoded once for each media format, then shared by every call
+   playing it, rather than generated and encoded again by every call.
+
+   One cadence cycle of the tone is kept, padded with silence to a whole
+   number of packets, so it may be repeated indefinitely. The encoded form
+   is a sequence of complete packet payloads, so codecs with variable size
+   frames, e.g. Opus, may be cached. See OpalToneMediaStream for playing
+   them, each call providing its own RTP header.
+
+   Entries are keyed by tone specification and sample rate, or media
+   format with all of its options. The least recently used entries are
+   discarded when either the byte or entry limit is exceeded.
+ */
+class OpalToneCache : public PObject
+{
+    PCLASSINFO(OpalToneCache, PObject);
+  public:
+    /**Create a new tone cache.
+     */
+    OpalToneCache(
+      PINDEX maxBytes = 8*1024*1024, ///< Maximum total bytes of cached data
+      PINDEX maxEntries = 200        ///< Maximum number of cached tones
+    );
+
+    /**Get the global tone cache.
+      */
+    static OpalToneCache & GetInstance();
+
+    /**One cycle of an encoded tone. Copies share the same data.
+      */
+    struct Encoded
+    {
+      Encoded() : m_packetTime(0) { }
+
+      /// Get number of packets in the cycle
+      PINDEX GetCount() const { return m_offsets.empty() ? 0 : (PINDEX)m_offsets.size()-1; }
+
+      /// Get pointer to payload of packet
+      const BYTE * GetPayload(PINDEX index) const { return (const BYTE *)m_data + m_offsets[index]; }
+
+      /// Get size of payload of packet
+      PINDEX GetPayloadSize(PINDEX index) const { return m_offsets[index+1]-m_offsets[index]; }
+
+      PBYTEArray          m_data;       ///< All payloads, concatenated
+      std::vector<PINDEX> m_offsets;    ///< Start of each payload in m_data, then end
+      unsigned            m_packetTime; ///< Timestamp units for each packet
+    };
+
+    /**Get the tone as 16 bit mono PCM at the sample rate.
+       If not already in the cache the tone is rendered via RenderTone() and
+       added.
+
+       Returns false if the tone specification is illegal.
+      */
+    bool GetRenderedTone(
+      const PString & toneSpec, ///< Tone specification, as for PTones
+      unsigned sampleRate,      ///< Sample rate for PCM
+      PShortArray & samples     ///< Rendered samples
+    );
+
+    /**Get the tone encoded as packets for the media format.
+       If not already in the cache the tone is encoded via EncodeTone() and
+       added.
+
+       Returns false if the tone specification is illegal, or the tone could
+       not be encoded for the media format.
+      */
+    bool GetEncodedTone(
+      const PString & toneSpec,            ///< Tone specification, as for PTones
+      const OpalMediaFormat & mediaFormat, ///< Media format to encode to
+      Encoded & tone                       ///< Encoded tone
+    );
+
+    /**Set the limits on the cache size.
+       A zero value means there is no limit. Entries are discarded immediately
+       if the cache is now over the new limits.
+      */
+    void SetLimits(
+      PINDEX maxBytes,  ///< Maximum total bytes of cached data
+      PINDEX maxEntries ///< Maximum number of cached tones
+    );
+
+    /// Get maximum total bytes of cached data
+    PINDEX GetMaxBytes() const { return m_maxBytes; }
+
+    /// Get maximum number of cached tones
+    PINDEX GetMaxEntries() const { return m_maxEntries; }
+
+    /// Get current total bytes of cached data
+    PINDEX GetCurrentBytes() const { return m_currentBytes; }
+
+    /// Get current number of cached tones
+    PINDEX GetCurrentEntries() const;
+
+    /// Discard all cached tones
+    void Clear();
+
+  protected:
+    /**Render one cycle of the tone at the sample rate.
+       The default behaviour uses PTones.
+      */
+    virtual bool RenderTone(
+      const PString & toneSpec, ///< Tone specification, as for PTones
+      unsigned sampleRate,      ///< Sample rate for PCM
+      PShortArray & samples     ///< Rendered samples
+    );
+
+    /**Encode one cycle of the tone into the media format.
+       The default behaviour renders the tone at the media format clock rate,
+       pads it to a whole number of packets, as set by the
+       OpalAudioFormat::TxFramesPerPacketOption(), then converts it with an
+       OpalTranscoder one packet at a time. The cycle is encoded twice, and
+       the second kept, so it loops seamlessly for codecs with state. Fails
+       if the media format is not mono, or has no frame time.
+      */
+    virtual bool EncodeTone(
+      const PString & toneSpec,            ///< Tone specification, as for PTones
+      const OpalMediaFormat & mediaFormat, ///< Media format to encode to
+      Encoded & tone                       ///< Encoded tone
+    );
+
+    typedef std::list<PString> LRUList;
+    struct Entry
+    {
+      PShortArray       m_samples;
+      Encoded           m_encoded;
+      PINDEX            m_size;
+      LRUList::iterator m_position;
+    };
+    typedef std::map<PString, Entry> EntryMap;
+
+    Entry * InternalFind(const PString & key);
+    void InternalAdd(const PString & key, const Entry & entry);
+    void InternalEvict();
+
+    EntryMap m_entries;
+    LRUList  m_lru;
+    PINDEX   m_maxBytes;
+    PINDEX   m_maxEntries;
+    PINDEX   m_currentBytes;
+    PDECLARE_MUTEX(m_mutex);
+};
+
+
+#endif // OPAL_PTLIB_DTMF
+
+#endif // OPAL_CODEC_TONECACHE_H
+
+
+// End of File ///////////////////////////////////////////////////////////////
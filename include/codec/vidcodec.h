@@ -243,6 +243,13 @@ class OpalVideoTranscoder : public OpalTranscoder
   //@}
 
   protected:
+    virtual bool OnReused(
+      const OpalMediaFormat & srcFormat,
+      const OpalMediaFormat & destFormat,
+      const BYTE * instance,
+      unsigned instanceLen
+    );
+
     PINDEX m_inDataSize;
     PINDEX m_outDataSize;
     bool   m_errorConcealment;
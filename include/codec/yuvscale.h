@@ -0,0 +1,146 @@
+/*
+ * yuvscale.h
+ *
+ * YUV420P video frame scaling
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_CODEC_YUVSCALE_H
+#define OPAL_CODEC_YUVSCALE_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#if OPAL_VIDEO
+
+#include <map>
+#include <vector>
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**Scaler for YUV420P video frames.
+   This is a separable filter: each source row is filtered horizontally into
+   a 16 bit intermediate, then output rows are formed from a weighted sum of
+   intermediate rows. Enlarging an axis uses bilinear interpolation, reducing
+   it uses area averaging, so every source pixel contributes and there is no
+   aliasing however large the reduction, e.g. a 1080p input to a small tile
+   in a grid.
+
+   Weights are Q14 fixed point, computed once for each combination of source
+   and destination size and kept, so a stream of frames at a constant size,
+   as is usual, does no setup at all. The vertical passes, which are most of
+   the work, use SSE2 or NEON where available. Both give results identical
+   to the scalar code.
+
+   An instance is not thread safe, use one per thread, e.g. one per mixer
+   input stream.
+  */
+class OpalYUV420PScaler : public PObject
+{
+    PCLASSINFO(OpalYUV420PScaler, PObject);
+  public:
+    enum {
+      MaxCachedTables = 16  ///< Size combinations kept before discarding all
+    };
+
+    OpalYUV420PScaler(
+      bool simd = true  ///< Use SSE2/NEON, false is for comparing against the scalar code
+    );
+
+    /**Scale a whole source frame into a region of a destination frame.
+       Sizes should be even, as is usual for YUV420P, the region must be
+       entirely within the destination frame.
+
+       @return false if a size is zero or the region is out of bounds.
+      */
+    bool Scale(
+      unsigned srcWidth,        ///< Width of source frame
+      unsigned srcHeight,       ///< Height of source frame
+      const BYTE * src,         ///< Source YUV420P frame
+      unsigned dstX,            ///< Left of region in destination frame
+      unsigned dstY,            ///< Top of region in destination frame
+      unsigned dstWidth,        ///< Width of region in destination frame
+      unsigned dstHeight,       ///< Height of region in destination frame
+      unsigned dstFrameWidth,   ///< Width of destination frame
+      unsigned dstFrameHeight,  ///< Height of destination frame
+      BYTE * dst                ///< Destination YUV420P frame
+    );
+
+    /**Scale a whole source frame to a whole destination frame.
+      */
+    bool Scale(
+      unsigned srcWidth,        ///< Width of source frame
+      unsigned srcHeight,       ///< Height of source frame
+      const BYTE * src,         ///< Source YUV420P frame
+      unsigned dstWidth,        ///< Width of destination frame
+      unsigned dstHeight,       ///< Height of destination frame
+      BYTE * dst                ///< Destination YUV420P frame
+    ) { return Scale(srcWidth, srcHeight, src, 0, 0, dstWidth, dstHeight, dstWidth, dstHeight, dst); }
+
+  protected:
+    // Filter for one axis of one plane, m_taps weights for each output pixel
+    struct AxisFilter
+    {
+      void Build(unsigned srcSize, unsigned dstSize);
+
+      unsigned              m_taps;
+      std::vector<unsigned> m_start;    // First source pixel for each output
+      std::vector<short>    m_weights;  // Q14, m_taps for each output
+    };
+
+    struct PlaneFilter
+    {
+      AxisFilter m_horizontal;
+      AxisFilter m_vertical;
+    };
+
+    struct Filters
+    {
+      PlaneFilter m_luma;
+      PlaneFilter m_chroma;
+    };
+
+    const Filters & GetFilters(unsigned srcWidth, unsigned srcHeight, unsigned dstWidth, unsigned dstHeight);
+
+    void ScalePlane(
+      const PlaneFilter & filter,
+      unsigned srcWidth, unsigned srcHeight, const BYTE * src,
+      unsigned dstWidth, unsigned dstHeight, BYTE * dst, unsigned dstStride
+    );
+
+    typedef std::map<PUInt64, Filters> FilterCache;
+    bool               m_simd;
+    FilterCache        m_filters;
+    std::vector<short> m_intermediate;  // Horizontally filtered source rows
+};
+
+
+#endif // OPAL_VIDEO
+
+#endif // OPAL_CODEC_YUVSCALE_H
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -48,6 +48,100 @@ class OpalIVRConnection;
 #define OPAL_OPT_IVR_NATIVE_CODEC "IVR-Native-Codec"
 
 
+/**Cache of prompt files already encoded to a native codec.
+   When an IVR connection uses a native codec (OPAL_OPT_IVR_NATIVE_CODEC),
+   prompts are played directly into the RTP stream with no transcoder in the
+   media patch. This cache holds the encoded form of each prompt file for
+   each media format, so a prompt is encoded once and then shared by every
+   call playing it, rather than encoded again by every call.
+
+   Entries are keyed by file name, its size and modification time, and the
+   media format with all of its options, so an edited file or a differently
+   configured codec produces a new entry. The least recently used entries
+   are discarded when either the byte or entry limit is exceeded.
+
+   Only codecs with a fixed encoded frame size may be cached, as the data
+   is played back as a simple byte stream.
+ */
+class OpalIVRPromptCache : public PObject
+{
+    PCLASSINFO(OpalIVRPromptCache, PObject);
+  public:
+    /**Create a new prompt cache.
+     */
+    OpalIVRPromptCache(
+      PINDEX maxBytes = 32*1024*1024, ///< Maximum total bytes of encoded data
+      PINDEX maxEntries = 1000        ///< Maximum number of encoded prompts
+    );
+
+    /**Get the encoded prompt for the file and media format.
+       If not already in the cache the file is encoded via EncodePrompt() and
+       added.
+
+       Returns false if the file could not be read or encoded, in which case
+       the caller should play the file in the normal way.
+      */
+    virtual bool GetEncodedPrompt(
+      const PFilePath & filename,          ///< Prompt file (WAV) to get
+      const OpalMediaFormat & mediaFormat, ///< Media format to encode to
+      PBYTEArray & data                    ///< Encoded data
+    );
+
+    /**Set the limits on the cache size.
+       A zero value means there is no limit. Entries are discarded immediately
+       if the cache is now over the new limits.
+      */
+    void SetLimits(
+      PINDEX maxBytes,  ///< Maximum total bytes of encoded data
+      PINDEX maxEntries ///< Maximum number of encoded prompts
+    );
+
+    /// Get maximum total bytes of encoded data
+    PINDEX GetMaxBytes() const { return m_maxBytes; }
+
+    /// Get maximum number of encoded prompts
+    PINDEX GetMaxEntries() const { return m_maxEntries; }
+
+    /// Get current total bytes of encoded data
+    PINDEX GetCurrentBytes() const { return m_currentBytes; }
+
+    /// Get current number of encoded prompts
+    PINDEX GetCurrentEntries() const;
+
+    /// Discard all cached prompts
+    void Clear();
+
+  protected:
+    /**Encode the prompt file into the media format.
+       The default behaviour reads the WAV file as PCM-16 and converts it with
+       an OpalTranscoder, one frame at a time. Fails if the file is not mono,
+       or any encoded frame is not a multiple of the media formats frame size.
+      */
+    virtual bool EncodePrompt(
+      const PFilePath & filename,          ///< Prompt file (WAV) to encode
+      const OpalMediaFormat & mediaFormat, ///< Media format to encode to
+      PBYTEArray & data                    ///< Encoded data
+    );
+
+    void InternalEvict();
+
+    typedef std::list<PString> LRUList;
+    struct Entry
+    {
+      PBYTEArray        m_data;
+      LRUList::iterator m_position;
+    };
+    typedef std::map<PString, Entry> EntryMap;
+
+    EntryMap m_entries;
+    LRUList  m_lru;
+    PINDEX   m_maxBytes;
+    PINDEX   m_maxEntries;
+    PINDEX   m_currentBytes;
+    PDECLARE_MUTEX(m_mutex);
+};
+
+
 /**Interactive Voice Response endpoint.
  */
 class OpalIVREndPoint : public OpalLocalEndPoint
@@ -195,12 +289,18 @@ class OpalIVREndPoint : public OpalLocalEndPoint
     // Allow users to override cache algorithm
     virtual PVXMLCache & GetTextToSpeechCache() { return m_ttsCache; }
 
+    /**Get the cache of prompts pre-encoded to native codecs.
+       Used when OPAL_OPT_IVR_NATIVE_CODEC is in effect.
+      */
+    virtual OpalIVRPromptCache & GetPromptCache() { return m_promptCache; }
+
   protected:
-    PString        m_defaultVXML;
-    PString        m_defaultTTS;
+    PString            m_defaultVXML;
+    PString            m_defaultTTS;
     PDECLARE_MUTEX(m_defaultsMutex);
-    PVXMLCache     m_ttsCache;
-    PDirectory     m_recordDirectory;
+    PVXMLCache         m_ttsCache;
+    OpalIVRPromptCache m_promptCache;
+    PDirectory         m_recordDirectory;
 
   private:
     P_REMOVE_VIRTUAL(OpalIVRConnection *, CreateConnection(OpalCall &,const PString &,void *,const PString &,OpalConnection::StringOptions *),0);
@@ -323,6 +423,17 @@ class OpalIVRConnection : public OpalLocalConnection
       */
     virtual void OnEndDialog();
 
+    /**Get a prompt file pre-encoded to the native codec in use.
+       Returns false if the IVR is not operating in a native codec, or the
+       file could not be encoded, so it should be played normally.
+
+       Default action uses OpalIVREndPoint::GetPromptCache().
+      */
+    virtual bool GetEncodedPrompt(
+      const PFilePath & filename, ///< Prompt file to get
+      PBYTEArray & data           ///< Encoded data
+    );
+
     void SetVXML(const PString & vxml);
     const PString & GetVXML() const { return m_vxmlScript; }
     const OpalVXMLSession & GetVXMLSession() const { return m_vxmlSession; }
@@ -55,6 +55,17 @@ class OpalFarEndCameraControl;
 */
 #define OPAL_OPT_EXPLICIT_ALERTING "Explicit-Alerting"
 
+/**Play a tone as the audio sent by the local connection.
+   The value is a tone specification as per PTones, e.g. a ringback or
+   announcement cadence. Instead of the usual audio source, an
+   OpalToneMediaStream is used, which replays the tone from the shared
+   OpalToneCache, so many calls playing the same tone share a single
+   rendering, and encoding if the media format is not raw PCM.
+
+   Defaults to empty, no tone.
+*/
+#define OPAL_OPT_LOCAL_TONE "Local-Tone"
+
 
 /** Local EndPoint.
     This class represents an endpoint on the local machine that can receive
@@ -586,6 +597,18 @@ class OpalLocalConnection : public OpalConnection
       bool placeOnHold  ///< Flag for setting on or off hold
     );
 
+    /**Get the data formats this connection is capable of operating.
+       This provides a list of media data format names that an
+       OpalMediaStream may be created in within this connection.
+
+       The default behaviour returns the endpoint formats, plus, if the
+       OPAL_OPT_LOCAL_TONE string option is set, all transportable formats,
+       so the tone is sent pre-encoded in the remote's codec without any
+       transcoding. Note that this means received audio may then also be
+       in an encoded format.
+      */
+    virtual OpalMediaFormatList GetMediaFormats() const;
+
     /**Open a new media stream.
        This will create a media stream of an appropriate subclass as required
        by the underlying connection protocol. For instance H.323 would create
@@ -39,14 +39,18 @@
 #if OPAL_HAS_MIXER
 
 #include <queue>
+#include <vector>
 
 #include <ep/localep.h>
 #include <codec/vidcodec.h>
+#include <codec/yuvscale.h>
+#include <ptclib/threadpool.h>
 
 
 class RTP_DataFrame;
 class OpalJitterBuffer;
 class OpalMixerConnection;
+class OpalPCMResampler;
 
 
 //#define OPAL_MIXER_AUDIO_DEBUG 1
@@ -230,15 +234,35 @@ class OpalAudioMixer : public OpalBaseMixer
     unsigned GetSampleRate() const { return m_sampleRate; }
 
     /**Set sample rate for audio data.
-       Note that all streams must have the same sample rate.
+       If \p resampleStreams is false, all streams must have the same sample
+       rate, and this returns false if attempts to set sample rate to
+       something different to existing streams.
 
-       Returns false if attempts to set sample rate to something different to
-       existing streams.
+       If \p resampleStreams is true, existing streams are kept and are
+       converted from their own rate, see SetStreamSampleRate(). Any audio
+       already resampled to the old rate is discarded, audio still in a
+       jitter buffer is kept.
       */
     bool SetSampleRate(
-      unsigned rate   ///< New rate
+      unsigned rate,                ///< New rate
+      bool resampleStreams = false  ///< Resample existing streams
     );
 
+    /**Set the sample rate of the audio written to a stream.
+       If different to the mixer sample rate, audio written to the stream is
+       converted with an OpalPCMResampler as it is taken for mixing, after
+       any jitter buffer, which therefore uses this rate for its timestamps.
+      */
+    bool SetStreamSampleRate(
+      const Key_T & key,  ///< key for mixer stream
+      unsigned rate       ///< Sample rate of stream
+    );
+
+    /**Get the highest sample rate of all the input streams.
+       Returns zero if there are no streams.
+      */
+    unsigned GetHighestStreamSampleRate() const;
+
     /**Sets the size of the jitter buffer to be used by the specified stream
        in this mixer. A mixer defaults to not having any jitter buffer enabled.
 
@@ -257,13 +281,18 @@ class OpalAudioMixer : public OpalBaseMixer
       ~AudioStream();
 
       virtual void QueuePacket(const RTP_DataFrame & rtp);
+      void QueueResampled(const RTP_DataFrame & rtp);
       const short * GetAudioDataPtr();
+      void SetSampleRate(unsigned rate);
+      void OnMixerSampleRateChanged();
 
       OpalAudioMixer   & m_mixer;
       OpalJitterBuffer * m_jitter;
       unsigned           m_nextTimestamp;
       PShortArray        m_cacheSamples;
       size_t             m_samplesUsed;
+      unsigned           m_sampleRate;
+      OpalPCMResampler * m_resampler;
     };
 
     virtual Stream * CreateStream();
@@ -328,7 +357,7 @@ class OpalVideoMixer : public OpalBaseMixer
       bool pushThread = true  ///< A push thread is to be created
     );
 
-    ~OpalVideoMixer() { StopPushThread(); }
+    ~OpalVideoMixer();
 
     /**Get output video frame width.
       */
@@ -357,15 +386,58 @@ class OpalVideoMixer : public OpalBaseMixer
       unsigned height   ///< new height
     );
 
+    /**Set the number of threads used to composite the output frame.
+       Each input is scaled into its own region of the output frame, so the
+       tiles may be done concurrently. A value of zero or one does all
+       compositing on the mixer thread.
+       May be dynamically changed at any time.
+      */
+    void SetCompositingThreads(
+      unsigned threads  ///< Number of threads
+    );
+
+    /**Get the number of threads used to composite the output frame.
+      */
+    unsigned GetCompositingThreads() const { return m_compositingThreads; }
+
+    /**Indicate the last mixed frame is identical to the one before it.
+       Only tiles whose input has a new frame, or whose position in the
+       output has changed, are composited. If there were none, then the
+       previous output is reused and this returns true, so an encoder may
+       treat it as a repeat frame.
+      */
+    bool IsRepeatFrame() const { return m_repeatFrame; }
+
   protected:
     struct VideoStream : public Stream
     {
       VideoStream(OpalVideoMixer & mixer);
       virtual void QueuePacket(const RTP_DataFrame & rtp);
+      void LatchFrame();
+      bool HasFrame() const;
+      bool IsTileDirty(unsigned x, unsigned y, unsigned w, unsigned h) const;
       void InsertVideoFrame(unsigned x, unsigned y, unsigned w, unsigned h);
 
       OpalVideoMixer & m_mixer;
+      RTP_DataFrame    m_lastFrame;      // Latest frame taken from queue, kept for redraw
+      unsigned         m_frameSerial;    // Incremented for each new frame taken from queue
+      unsigned         m_drawnSerial;    // Value of m_frameSerial when composited
+      unsigned         m_lastX, m_lastY, m_lastW, m_lastH;
+      unsigned         m_lastGeneration; // Frame store generation when composited
+      OpalYUV420PScaler m_scaler;        // Only used by one compositing thread at a time
+    };
+
+    struct TileJob
+    {
+      TileJob(VideoStream * stream, unsigned x, unsigned y, unsigned w, unsigned h, PSemaphore * done = NULL);
+      void Work();
+
+      VideoStream * m_stream;
+      unsigned      m_x, m_y, m_w, m_h;
+      PSemaphore  * m_done;
     };
+    typedef std::vector<TileJob> TileList;
+    typedef PQueuedThreadPool<TileJob> TilePool;
 
     friend struct VideoStream;
 
@@ -377,6 +449,7 @@ class OpalVideoMixer : public OpalBaseMixer
     virtual bool StartMix(unsigned & x, unsigned & y, unsigned & w, unsigned & h, unsigned & left);
     virtual bool NextMix(unsigned & x, unsigned & y, unsigned & w, unsigned & h, unsigned & left);
     void InsertVideoFrame(const StreamMap_T::iterator & it, unsigned x, unsigned y, unsigned w, unsigned h);
+    void CompositeTiles(TileList & tiles);
 
   protected:
     Styles     m_style;
@@ -385,6 +458,16 @@ class OpalVideoMixer : public OpalBaseMixer
 
     PBYTEArray m_frameStore;
     size_t     m_lastStreamCount;
+
+    unsigned   m_frameStoreGeneration; // Incremented when whole frame store is redrawn
+    unsigned   m_lastMixGeneration;
+    bool       m_repeatFrame;
+
+    unsigned   m_compositingThreads;
+    TilePool * m_tilePool;
+    PSemaphore m_tilesDone;
+    TileList   m_tiles;
+    PTRACE_THROTTLE(m_throttleMixTime, 2, 60000);
 };
 
 #endif // OPAL_VIDEO
@@ -404,14 +487,19 @@ struct OpalMixerNodeInfo
     , m_closeOnEmpty(false)
     , m_listenOnly(false)
     , m_sampleRate(OpalMediaFormat::AudioClockRate)
+    , m_maxSampleRate(48000)
 #if OPAL_VIDEO
     , m_audioOnly(false)
     , m_style(OpalVideoMixer::eGrid)
     , m_width(PVideoFrameInfo::CIFWidth)
     , m_height(PVideoFrameInfo::CIFHeight)
     , m_rate(15)
+    , m_compositingThreads(4)
+    , m_encodingThreads(4)
 #endif
     , m_mediaPassThru(false)
+    , m_audioLevelTopN(0)
+    , m_audioLevelSilence(127)
   { }
 
   virtual ~OpalMixerNodeInfo() { }
@@ -421,16 +509,25 @@ struct OpalMixerNodeInfo
   PString  m_name;                ///< Name for mixer node.
   bool     m_closeOnEmpty;        ///< Mixer node is removed when last participant exits
   bool     m_listenOnly;          ///< Mixer only transmits data to "listeners"
-  unsigned m_sampleRate;          ///< Audio sample rate, usually 8000
+  unsigned m_sampleRate;          ///< Lowest audio sample rate, usually 8000
+  unsigned m_maxSampleRate;       /**< Highest audio sample rate, the mixer runs at the rate
+                                       of the widest band participant up to this limit. */
 #if OPAL_VIDEO
   bool     m_audioOnly;           ///< No video is to be allowed.
   OpalVideoMixer::Styles m_style; ///< Method for mixing video
   unsigned m_width;               ///< Width of mixed video
   unsigned m_height;              ///< Height of mixed video
   unsigned m_rate;                ///< Frame rate of mixed video
+  unsigned m_compositingThreads;  ///< Threads used to composite mixed video
+  unsigned m_encodingThreads;     ///< Threads used to encode mixed video
 #endif
   bool     m_mediaPassThru;       /**< Enable media pass through to optimise mixer node
                                        with precisely two attached connections. */
+  unsigned m_audioLevelTopN;      /**< Only decode audio from the N loudest participants,
+                                       as indicated by the RFC 6464 audio level, zero
+                                       decodes all participants. */
+  unsigned m_audioLevelSilence;   /**< Do not decode audio with an RFC 6464 audio level
+                                       quieter than this -dBov value, 127 disables. */
 
   PString m_displayText;          ///< Human readable text for conference name
   PString m_subject;              ///< Subject for conference
@@ -881,6 +978,12 @@ class OpalMixerConnection : public OpalLocalConnection
       OpalMediaPatch & patch    ///< Patch being started
     );
 
+    /**Call back when media stream patch thread stops.
+      */
+    virtual void OnStopMediaPatch(
+      OpalMediaPatch & patch    ///< Patch being stopped
+    );
+
     /// Call back for connection to act on changed string options
     virtual void OnApplyStringOptions();
 
@@ -950,9 +1053,12 @@ class OpalMixerConnection : public OpalLocalConnection
   //@}
 
   protected:
+    PDECLARE_NOTIFIER(RTP_DataFrame, OpalMixerConnection, OnAudioLevelFilter);
+
     OpalMixerEndPoint     & m_endpoint;
     PSafePtr<OpalMixerNode> m_node;
     bool                    m_listenOnly;
+    PNotifier               m_audioLevelFilter;
 };
 
 
@@ -1073,8 +1179,12 @@ class OpalAudioStreamMixer : public OpalAudioMixer, public OpalMediaStreamMixer
         Collecting, Collected, Completed
       } m_state;
       RTP_DataFrame    m_raw;
+      RTP_DataFrame    m_resampled;
       RTP_DataFrame    m_encoded;
+      OpalTranscoder * m_resampler;
       OpalTranscoder * m_transcoder;
+      unsigned         m_sampleRate;
+      unsigned         m_encodedTimestamp;
     };
     std::map<PString, CachedAudio> m_cache;
 
@@ -1108,9 +1218,167 @@ class OpalVideoStreamMixer : public OpalVideoMixer, public OpalMediaStreamMixer
     virtual bool SetFrameRate(unsigned rate);
     virtual bool OnMixed(RTP_DataFrame * & output);
 
+    /// Layout of the mixed video for an individual receiver.
+    P_DECLARE_TRACED_ENUM(Layouts,
+      eCommonLayout,  ///< Same composite as everyone else, using the mixer style
+      eExcludeSelf,   ///< Grid of all inputs other than the receivers own
+      eSpeakerFocus,  ///< Focus input large, others in a strip along the bottom
+      eCustomLayout   ///< Tiles as set by SetCustomLayout()
+    );
+
+    /// Position of an input in a custom layout
+    struct LayoutTile
+    {
+      LayoutTile(
+        const PString & key = PString::Empty(),
+        unsigned x = 0,
+        unsigned y = 0,
+        unsigned width = 0,
+        unsigned height = 0
+      );
+
+      PString  m_key;     ///< Identifier of input stream
+      unsigned m_x;       ///< Left of tile in output frame
+      unsigned m_y;       ///< Top of tile in output frame
+      unsigned m_width;   ///< Width of tile
+      unsigned m_height;  ///< Height of tile
+    };
+    typedef std::vector<LayoutTile> LayoutTiles;
+
+    /**Set the layout of the video sent to a receiver.
+       The \p outputId is the identifier of the receivers media stream, which
+       is the same as that of the input stream from that participant. Note
+       each distinct layout is a separate composite and a separate encoder,
+       though receivers with identical layouts share them.
+      */
+    void SetLayout(
+      const PString & outputId, ///< Identifier of output stream
+      Layouts layout            ///< Layout to use
+    );
+
+    /**Set a custom layout of the video sent to a receiver.
+       Tile positions and sizes are in the mixers output frame.
+      */
+    void SetCustomLayout(
+      const PString & outputId, ///< Identifier of output stream
+      const LayoutTiles & tiles ///< Tiles to composite
+    );
+
+    /**Get the layout of the video sent to a receiver.
+      */
+    Layouts GetLayout(
+      const PString & outputId  ///< Identifier of output stream
+    ) const;
+
+    /**Set the input stream that is the focus, e.g. the active speaker.
+      */
+    void SetFocus(
+      const PString & inputId   ///< Identifier of input stream
+    );
+
+    /**Get the input stream that is the focus.
+      */
+    PString GetFocus() const;
+
+    /**Set the number of threads used to encode the output streams.
+       Each distinct combination of media format, frame size and layout is
+       encoded once per mix, and these may be done concurrently. A value of
+       zero or one does all encoding on the mixer thread.
+       May be dynamically changed at any time.
+      */
+    void SetEncodingThreads(
+      unsigned threads  ///< Number of threads
+    );
+
+    /**Get the number of threads used to encode the output streams.
+      */
+    unsigned GetEncodingThreads() const { return m_encodingThreads; }
+
   protected:
+    struct InputFrame
+    {
+      InputFrame();
+      RTP_DataFrame m_frame;
+      unsigned      m_serial;
+    };
+    typedef std::map<PString, InputFrame> InputFrameMap;
+
+    struct ScaledTile
+    {
+      ScaledTile();
+      PBYTEArray m_data;
+      unsigned   m_serial;
+      unsigned   m_lastUsed;
+    };
+    typedef std::map<PString, ScaledTile> ScaledTileCache;
+
+    struct LayoutFrame
+    {
+      LayoutFrame();
+      RTP_DataFrame         m_frame;
+      std::vector<unsigned> m_serials;
+      unsigned              m_lastUsed;
+      bool                  m_repeat;
+    };
+    typedef std::map<PString, LayoutFrame> LayoutFrameCache;
+
+    struct ReceiverLayout
+    {
+      ReceiverLayout() : m_layout(eCommonLayout) { }
+      Layouts     m_layout;
+      LayoutTiles m_tiles;
+    };
+    typedef std::map<PString, ReceiverLayout> ReceiverLayoutMap;
+
+    bool HasReceiverLayouts() const;
+    bool GetReceiverTiles(const PString & outputId, const InputFrameMap & inputs, unsigned width, unsigned height, LayoutTiles & tiles) const;
+    LayoutFrame & RenderLayout(const LayoutTiles & tiles, const InputFrameMap & inputs, const RTP_DataFrame & mixed, PString & layoutKey);
+    const BYTE * GetScaledTile(const PString & inputId, const InputFrame & input, unsigned width, unsigned height);
+    void PruneCaches(const PTimeInterval & now);
+
+    struct EncodeJob
+    {
+      EncodeJob();
+      void Encode();
+
+      OpalTranscoder * m_transcoder;
+      RTP_DataFrame  * m_rawRTP;
+      std::vector< PSafePtr<OpalMixerMediaStream> > m_streams;
+      bool             m_failed;
+    };
+    typedef std::map<PString, EncodeJob> EncodeJobMap;
+
+    struct EncodeWork
+    {
+      EncodeWork(EncodeJob & job, PSemaphore & done);
+      void Work();
+
+      EncodeJob  & m_job;
+      PSemaphore & m_done;
+    };
+    typedef PQueuedThreadPool<EncodeWork> EncodePool;
+
+    void EncodeAll(EncodeJobMap & jobs);
+
     typedef PDictionary<PString, OpalTranscoder> TranscoderMap;
     TranscoderMap m_transcoders;
+    std::map<PString, PTimeInterval> m_lastEncodeTime;
+    PDECLARE_MUTEX(m_transcoderMutex);
+
+    ReceiverLayoutMap m_receiverLayouts;
+    PString           m_focus;
+    PDECLARE_MUTEX(m_layoutMutex);
+
+    // Only used by push thread
+    ScaledTileCache   m_scaledTiles;
+    LayoutFrameCache  m_layoutFrames;
+    unsigned          m_mixCount;
+    OpalYUV420PScaler m_scaler;
+
+    unsigned          m_encodingThreads;
+    EncodePool      * m_encodePool;
+    PSemaphore        m_encodesDone;
+    PTRACE_THROTTLE(m_throttleEncodeTime, 2, 60000);
 };
 #endif // OPAL_VIDEO
 
@@ -1179,6 +1447,33 @@ class OpalMixerNode : public PSafeObject
       OpalMixerMediaStream * stream     ///< Stream to detach
     );
 
+#if OPAL_VIDEO
+    /**Set the layout of the video sent to a receiver.
+       See OpalVideoStreamMixer::SetLayout() for more details.
+      */
+    bool SetVideoLayout(
+      const PString & streamId,                ///< Identifier of receivers media stream
+      OpalVideoStreamMixer::Layouts layout,    ///< Layout to use
+      OpalVideoFormat::ContentRole role = OpalVideoFormat::eNoRole ///< Video mixer to use
+    );
+
+    /**Set a custom layout of the video sent to a receiver.
+       See OpalVideoStreamMixer::SetCustomLayout() for more details.
+      */
+    bool SetVideoCustomLayout(
+      const PString & streamId,                        ///< Identifier of receivers media stream
+      const OpalVideoStreamMixer::LayoutTiles & tiles, ///< Tiles to composite
+      OpalVideoFormat::ContentRole role = OpalVideoFormat::eNoRole ///< Video mixer to use
+    );
+
+    /**Set the input stream that is the focus of the video, e.g. the active speaker.
+      */
+    bool SetVideoFocus(
+      const PString & streamId,                ///< Identifier of participants media stream
+      OpalVideoFormat::ContentRole role = OpalVideoFormat::eNoRole ///< Video mixer to use
+    );
+#endif // OPAL_VIDEO
+
     /**Use media bypass if applicable.
       */
     virtual void UseMediaPassThrough(
@@ -1204,6 +1499,33 @@ class OpalMixerNode : public PSafeObject
       const RTP_DataFrame & input           ///< Input RTP data for media
     );
 
+    /**Determine if encoded audio from a participant should be decoded.
+       This uses the RFC 6464 audio level from the RTP header extension, so
+       participants that are silent, or are not among the loudest
+       OpalMixerNodeInfo::m_audioLevelTopN speakers, do not need to be
+       decoded at all.
+
+       Default behaviour returns true if the frame has no audio level.
+      */
+    virtual bool ShouldDecodeAudio(
+      const PString & participant,  ///< Identifier for participant, e.g. connection token
+      const RTP_DataFrame & frame   ///< Encoded RTP audio frame
+    );
+
+    /**Get the sample rate of the audio written to the mixer by a participant.
+       This is the highest rate, between OpalMixerNodeInfo::m_sampleRate and
+       OpalMixerNodeInfo::m_maxSampleRate, that \p mediaFormat can be decoded
+       to directly, so no resampling is done in the media patch.
+      */
+    virtual unsigned GetAudioSampleRate(
+      const OpalMediaFormat & mediaFormat   ///< Participants media format
+    ) const;
+
+    /**Set the audio mixer to the highest sample rate of the participants.
+       This is called whenever an audio stream is attached or detached.
+      */
+    virtual void UpdateAudioSampleRate();
+
     /**Send a user input indication to all connections.
       */
     virtual void BroadcastUserInput(
@@ -1308,6 +1630,15 @@ class OpalMixerNode : public PSafeObject
 
     typedef std::map<PString, OpalBaseMixer *> MixerByIdMap;
     MixerByIdMap m_mixerById;
+
+    struct AudioLevelInfo
+    {
+      int           m_level;     // Smoothed -dBov
+      PTimeInterval m_lastTick;  // Time of last update
+    };
+    typedef std::map<PString, AudioLevelInfo> AudioLevelMap;
+    AudioLevelMap m_audioLevels;
+    PDECLARE_MUTEX(m_audioLevelMutex);
 };
 
 
@@ -62,6 +62,18 @@ class OpalVXMLSession : public PVXMLSession
     virtual void OnEndSession();
     virtual bool OnTransfer(const PString & destination, TransferType type);
 
+    /**Play a prompt file.
+       If the connection is operating with a native codec, then the file is
+       played from the endpoints cache of pre-encoded prompts, otherwise it is
+       played as usual by PVXMLSession.
+      */
+    virtual PBoolean PlayFile(
+      const PString & fn,
+      PINDEX repeat = 1,
+      PINDEX delay = 0,
+      PBoolean autoDelete = false
+    );
+
   protected:
     OpalIVRConnection & m_connection;
 };
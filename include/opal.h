@@ -510,7 +510,8 @@ typedef enum OpalSilenceDetectMode {
   OpalSilenceDetectNoChange,  /**< No change to the silence detect mode. */
   OpalSilenceDetectDisabled,  /**< Indicate silence detect is disabled */
   OpalSilenceDetectFixed,     /**< Indicate silence detect uses a fixed threshold */
-  OpalSilenceDetectAdaptive   /**< Indicate silence detect uses an adaptive threashold */
+  OpalSilenceDetectAdaptive,  /**< Indicate silence detect uses an adaptive threashold */
+  OpalSilenceDetectSubBand    /**< Indicate silence detect uses sub-band noise floor tracking */
 } OpalSilenceDetectMode;
 
 
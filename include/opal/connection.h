@@ -46,6 +46,7 @@
 #include <ptclib/mime.h>
 #include <ptlib/safecoll.h>
 #include <rtp/rtp.h>
+#include <codec/dtmfdetect.h>
 
 #if OPAL_SCRIPT
 // Inside #if so does not force loading of factories when statically linked.
@@ -2009,14 +2010,16 @@ class OpalConnection : public PSafeObject
 
     // The In-Band DTMF detector. This is used inside an audio filter which is
     // added to the audio channel.
-#if OPAL_PTLIB_DTMF
-    PDTMFDecoder m_dtmfDecoder;
-    bool         m_detectInBandDTMF;
-    unsigned     m_dtmfScaleMultiplier;
-    unsigned     m_dtmfScaleDivisor;
-    PNotifier    m_dtmfDetectNotifier;
+#if OPAL_DTMF_DETECT
+    OpalDTMFDetector m_dtmfDetector;
+    bool             m_detectInBandDTMF;
+    unsigned         m_dtmfScaleMultiplier;
+    unsigned         m_dtmfScaleDivisor;
+    PNotifier        m_dtmfDetectNotifier;
     PDECLARE_NOTIFIER(RTP_DataFrame, OpalConnection, OnDetectInBandDTMF);
+#endif
 
+#if OPAL_PTLIB_DTMF
     bool            m_sendInBandDTMF;
     OpalMediaFormat m_dtmfSendFormat;
     PBYTEArray      m_inBandDTMF;
@@ -1698,6 +1698,22 @@ class OpalManager : public PObject
     void SetMaxRtpPacketSize(
       PINDEX size
     ) { m_rtpPacketSizeMax = size; }
+
+    /**Get the number of raw video frames that may be queued for encoding.
+       Zero indicates video is encoded synchronously on the media patch
+       thread, which is the default.
+      */
+    PINDEX GetVideoEncoderQueueSize() const { return m_videoEncoderQueueSize; }
+
+    /**Set the number of raw video frames that may be queued for encoding.
+       If non-zero, video encoders run on their own thread, and the encoded
+       packets are sent from another, so capture, encoding and network I/O
+       all overlap. If the encoder cannot keep up, the oldest queued frame
+       is dropped. This only affects media patches created after the call.
+      */
+    void SetVideoEncoderQueueSize(
+      PINDEX frames
+    ) { m_videoEncoderQueueSize = frames; }
   //@}
 
 
@@ -2088,6 +2104,7 @@ class OpalManager : public PObject
 
     PINDEX        m_rtpPayloadSizeMax;
     PINDEX        m_rtpPacketSizeMax;
+    PINDEX        m_videoEncoderQueueSize;
     OpalJitterBuffer::Params m_jitterParams;
     PStringArray  m_mediaFormatOrder;
     PStringArray  m_mediaFormatMask;
@@ -1396,6 +1396,65 @@ class OpalMediaFormat : public PContainer
 };
 
 
+/**This class is an immutable copy of a media format.
+   Every accessor on OpalMediaFormat takes its mutex, and copying one takes
+   the mutex of the source. This is fine for signalling, but is a lot of
+   overhead for code that looks at the format for every media packet.
+
+   This class takes a private copy of the media format at construction, and
+   extracts the commonly used fields into plain members, so they can be
+   read by any number of threads with no locking at all. Any other option
+   can be read from GetMediaFormat(), which is never altered and never
+   shared, so its mutex is uncontended.
+
+   To change the format, construct a new instance, do not attempt to modify
+   the existing one. Instances are owned by the OpalMediaStream that
+   published them, hold one via an OpalFrozenMediaFormatPtr for as long as
+   it is being used.
+  */
+class OpalFrozenMediaFormat : public PObject
+{
+    PCLASSINFO(OpalFrozenMediaFormat, PObject);
+  public:
+    OpalFrozenMediaFormat(
+      const OpalMediaFormat & mediaFormat   ///< Media format to freeze
+    );
+
+    virtual void PrintOn(ostream & strm) const;
+
+    const OpalMediaFormat & GetMediaFormat() const { return m_mediaFormat; }
+    const PString & GetName() const { return m_name; }
+    const OpalMediaType & GetMediaType() const { return m_mediaType; }
+    RTP_DataFrame::PayloadTypes GetPayloadType() const { return m_payloadType; }
+    const PString & GetEncodingName() const { return m_encodingName; }
+    unsigned GetClockRate() const { return m_clockRate; }
+    unsigned GetFrameTime() const { return m_frameTime; }
+    PINDEX GetFrameSize() const { return m_frameSize; }
+    OpalBandwidth GetMaxBandwidth() const { return m_maxBandwidth; }
+    OpalBandwidth GetUsedBandwidth() const { return m_usedBandwidth; }
+    bool NeedsJitterBuffer() const { return m_needsJitter; }
+    bool IsTransportable() const { return m_transportable; }
+
+  protected:
+    OpalMediaFormat             m_mediaFormat;
+    PString                     m_name;
+    OpalMediaType               m_mediaType;
+    RTP_DataFrame::PayloadTypes m_payloadType;
+    PString                     m_encodingName;
+    unsigned                    m_clockRate;
+    unsigned                    m_frameTime;
+    PINDEX                      m_frameSize;
+    OpalBandwidth               m_maxBandwidth;
+    OpalBandwidth               m_usedBandwidth;
+    bool                        m_needsJitter;
+    bool                        m_transportable;
+
+  private:
+    OpalFrozenMediaFormat(const OpalFrozenMediaFormat & other) : PObject(other) { }
+    void operator=(const OpalFrozenMediaFormat &) { }
+};
+
+
 class OpalAudioFormatInternal;
 
 class OpalAudioFormat : public OpalMediaFormat
@@ -1517,6 +1576,8 @@ class OpalVideoFormat : public OpalMediaFormat
     static const PString & MaxRxFrameHeightOption();
     static const PString & TemporalSpatialTradeOffOption();
     static const PString & TxKeyFramePeriodOption();
+    static const PString & EncoderThreadsOption(); // Threads used by encoder, zero is automatic based on resolution
+    static const PString & EncoderSlicesOption();  // Slices per frame for parallel encoding, zero is one per thread
     static const PString & RateControlPeriodOption(); // Period over which the rate controller maintains the target bit rate.
     static const PString & FrameDropOption(); // Boolean to allow frame dropping to maintain target bit rate, default true
     static const PString & FreezeUntilIntraFrameOption();
@@ -41,10 +41,14 @@
 #include <rtp/jitter.h>
 #include <ptlib/safecoll.h>
 #include <ptclib/guid.h>
+#include <codec/tonecache.h>
+
+#include <list>
 
 
 class OpalMediaPatch;
 class OpalLine;
+class OpalMediaStream;
 class OpalConnection;
 class OpalMediaStatistics;
 
@@ -102,6 +106,29 @@ direction.
 
 */
 
+
+/**Holds the current OpalFrozenMediaFormat of a media stream.
+   The stream counts the holders of these, and any copy it has since
+   replaced is freed only once there are none. Obtaining one takes no lock.
+   The stream must outlive all of its holders.
+  */
+class OpalFrozenMediaFormatPtr
+{
+  public:
+    OpalFrozenMediaFormatPtr(const OpalMediaStream & stream);
+    OpalFrozenMediaFormatPtr(const OpalFrozenMediaFormatPtr & other);
+    OpalFrozenMediaFormatPtr & operator=(const OpalFrozenMediaFormatPtr & other);
+    ~OpalFrozenMediaFormatPtr();
+
+    const OpalFrozenMediaFormat * operator->() const { return m_format; }
+    const OpalFrozenMediaFormat & operator*() const { return *m_format; }
+
+  protected:
+    const OpalMediaStream       * m_stream;
+    const OpalFrozenMediaFormat * m_format;
+};
+
+
 /**This class describes a media stream as used in the OPAL system. A media
    stream is the channel through which media data is trasferred between OPAL
    entities. For example, data being sent to an RTP session over a network
@@ -152,6 +179,16 @@ class OpalMediaStream : public PSafeObject
       */
     virtual OpalMediaFormat GetMediaFormat() const;
 
+    /**Get an immutable copy of the currently selected media format.
+       This is intended for code that looks at the media format for every
+       packet, and takes no lock at all. A new copy is
+       published every time the media format is set or updated, so the
+       returned pointer should not be held beyond the processing of the
+       current packet, or it may not be the latest. The copy it refers to
+       remains valid for as long as the pointer is held.
+      */
+    OpalFrozenMediaFormatPtr GetFrozenMediaFormat() const;
+
     /**Set a new media format for the stream.
        Unlike UpdateMediaFormat() this will shut down the patch and attempt to
        create new transcoders to meet the requirement.
@@ -450,6 +487,8 @@ class OpalMediaStream : public PSafeObject
 
   protected:
     OpalMediaPatchPtr InternalSetPatchPart1(OpalMediaPatch * newPatch);
+    void PublishMediaFormat();
+    void FreeRetiredMediaFormats();
     void InternalSetPatchPart2(const OpalMediaPatchPtr & oldPatch);
     virtual bool InternalSetJitterBuffer(const OpalJitterBuffer::Init & init);
 
@@ -479,6 +518,13 @@ class OpalMediaStream : public PSafeObject
     unsigned                    m_frameTime;
     PINDEX                      m_frameSize;
 
+    atomic<const OpalFrozenMediaFormat *>    m_frozenMediaFormat;
+    mutable atomic<unsigned>                 m_frozenMediaFormatReaders;
+    std::list<const OpalFrozenMediaFormat *> m_retiredMediaFormats;
+    PDECLARE_MUTEX(m_frozenMediaFormatMutex);
+
+  friend class OpalFrozenMediaFormatPtr;
+
     typedef OpalMediaPatchPtr PatchPtr; // For backward compatibility
 
   private:
@@ -593,6 +639,59 @@ class OpalNullMediaStream : public OpalMediaStream, public OpalMediaStreamPacing
 };
 
 
+#if OPAL_PTLIB_DTMF
+/**This class describes a media stream that repeatedly plays a tone.
+   The tone is obtained from OpalToneCache, so is generated and encoded
+   only once for each media format no matter how many calls play it, and
+   this stream merely replays the packets with its own RTP header, that is
+   SSRC, sequence number and timestamp.
+  */
+class OpalToneMediaStream : public OpalNullMediaStream
+{
+    PCLASSINFO(OpalToneMediaStream, OpalNullMediaStream);
+  public:
+  /**@name Construction */
+  //@{
+    /**Construct a new source media stream for the tone.
+      */
+    OpalToneMediaStream(
+      OpalConnection & conn,               ///<  Connection that owns the stream
+      const OpalMediaFormat & mediaFormat, ///<  Media format for stream
+      unsigned sessionID,                  ///<  Session number for stream
+      const PString & toneSpec             ///<  Tone specification, as for PTones
+    );
+  //@}
+
+  /**@name Overrides of OpalMediaStream class */
+  //@{
+    /**Open the media stream.
+       Gets the tone from the OpalToneCache, failing if it cannot be generated
+       for the media format.
+      */
+    virtual PBoolean Open();
+
+    /**Read the next packet of the tone, pacing to real time.
+      */
+    virtual PBoolean ReadData(
+      BYTE * data,      ///<  Data buffer to read to
+      PINDEX size,      ///<  Size of buffer
+      PINDEX & length   ///<  Length of data actually read
+    );
+  //@}
+
+    /// Get the tone specification
+    const PString & GetToneSpec() const { return m_toneSpec; }
+
+  protected:
+    virtual bool InternalUpdateMediaFormat(const OpalMediaFormat & newMediaFormat);
+
+    PString                m_toneSpec;
+    OpalToneCache::Encoded m_tone;
+    PINDEX                 m_nextPacket;
+};
+#endif // OPAL_PTLIB_DTMF
+
+
 /**This class describes a media stream that transfers PCM-16 data to/from a PChannel.
   */
 class OpalRawMediaStream : public OpalMediaStream
@@ -41,6 +41,7 @@
 #include <list>
 
 class OpalTranscoder;
+class OpalSimulcastSelector;
 
 /**Media stream "patch cord".
    This class is the thread of control that transfers data from one
@@ -247,6 +248,10 @@ class OpalMediaPatch : public PSafeObject
     void StopThread();
     bool DispatchFrame(RTP_DataFrame & frame);
     bool DispatchFrameLocked(RTP_DataFrame & frame, bool bypassing);
+#if OPAL_VIDEO
+    void LockEncoders();
+    void UnlockEncoders();
+#endif
 
     OpalMediaStream & m_source;
 
@@ -256,9 +261,20 @@ class OpalMediaPatch : public PSafeObject
         Sink(OpalMediaPatch & p, const OpalMediaStreamPtr & s);
         ~Sink();
         bool CreateTranscoders();
+        bool InternalCreateTranscoders();
+        Sink * FindEncoderOwner(const OpalMediaFormat & destinationFormat);
+        void DetachEncoder(std::list<Sink *> & sharers);
         bool UpdateMediaFormat(const OpalMediaFormat & mediaFormat);
         bool ExecuteCommand(const OpalMediaCommand & command, bool atLeastOne);
         bool WriteFrame(RTP_DataFrame & sourceFrame, bool bypassing);
+        bool InternalWriteFrame(RTP_DataFrame & sourceFrame, bool bypassing);
+        bool TranscodeFrame(RTP_DataFrame & sourceFrame, RTP_DataFrameList * output);
+        bool WriteTranscodedFrame(RTP_DataFrame & frame, RTP_DataFrameList * output);
+        bool FanOutPacket(RTP_DataFrame & packet);
+#if OPAL_VIDEO
+        bool SetSimulcastBitRate(const OpalMediaFlowControl & flow);
+        bool IsVideoEncoder() const;
+#endif
 #if OPAL_STATISTICS
         void GetStatistics(OpalMediaStatistics & statistics, bool fromSource) const;
 #endif
@@ -270,6 +286,26 @@ class OpalMediaPatch : public PSafeObject
         RTP_DataFrameList  m_intermediateFrames;
         RTP_DataFrameList  m_finalFrames;
 
+        /* Sinks with identical encoded formats share one encoder. The owner
+           runs the codecs and sends a copy of the output to each of the
+           sharers, whose RTP sessions rewrite the SSRC and sequence number.
+           Only sinks of this patch, i.e. of one source stream, can share, so
+           calls with their own source streams, even of the same media, still
+           each have their own encoder. */
+        Sink             * m_encoderOwner;
+        std::list<Sink *>  m_encoderSharers;
+        PDECLARE_MUTEX(m_encoderSharersMutex);
+#if OPAL_VIDEO
+        OpalSimulcastSelector * m_simulcast;
+
+        /* If enabled, raw video is encoded and sent on separate threads. The
+           encode thread never takes the patch lock, so anything that changes
+           the codecs or filters must hold m_encodeMutex instead. */
+        class EncodePipeline;
+        EncodePipeline * m_encodePipeline;
+        PDECLARE_MUTEX(m_encodeMutex);
+#endif
+
 #if OPAL_STATISTICS
         OpalAudioFormat m_audioFormat;
         OpalAudioFormat::FrameDetectorPtr m_audioFrameDetector;
@@ -39,6 +39,10 @@
 #include <opal/mediasession.h>
 
 #include <rtp/rtp.h>
+#include <codec/g711a1_plc.h>
+
+#include <map>
+#include <list>
 
 class RTP_DataFrame;
 class OpalTranscoder;
@@ -143,6 +147,10 @@ class OpalTranscoder : public OpalMediaFormatPair
       const OpalMediaFormat & inputMediaFormat,  ///<  Input media format
       const OpalMediaFormat & outputMediaFormat  ///<  Output media format
     );
+
+    /** Destroy the transcoder.
+      */
+    ~OpalTranscoder();
   //@}
 
   /**@name Operations */
@@ -224,6 +232,16 @@ class OpalTranscoder : public OpalMediaFormatPair
       unsigned instanceLen = 0            ///<  Length of instance identifier
     );
 
+    /**Reset the transcoder so it may be re-used for another media stream.
+       This is called by OpalTranscoderPool when the transcoder is returned,
+       and must discard all state from the previous stream, e.g. codec
+       history, reference frames etc.
+
+       The default behaviour returns false, indicating the transcoder cannot
+       be re-used and is to be deleted.
+      */
+    virtual bool Reset();
+
     /**Find media format(s) for transcoders.
        This function attempts to find and intermediate media format that will
        allow two transcoders to be used to get data from the source format to
@@ -265,6 +283,15 @@ class OpalTranscoder : public OpalMediaFormatPair
       OpalMediaFormat & intermediateFormat  ///<  Intermediate format that can be used
     );
 
+    /**Clear the cache used by SelectFormats() and FindIntermediateFormat().
+       Which transcoders exist between which formats is remembered, as it
+       only changes when transcoders or media formats are registered. This
+       is called automatically when media formats are registered or plug
+       ins loaded, an application registering a transcoder factory at run
+       time must call it.
+      */
+    static void ClearSelectionCache();
+
     /**Get a list of possible destination media formats for the destination.
       */
     static OpalMediaFormatList GetDestinationFormats(
@@ -329,6 +356,20 @@ class OpalTranscoder : public OpalMediaFormatPair
     virtual bool AcceptEmptyPayload() const  { return acceptEmptyPayload; }
     virtual bool AcceptOtherPayloads() const { return acceptOtherPayloads; }
 
+    /**Enable concealment of lost packets in decoded audio.
+       When enabled, an empty payload, which OpalAudioJitterBuffer delivers
+       for a missing or too late packet, is replaced by the last decoded
+       audio extended by repeating its pitch waveform, attenuated to silence
+       over 60ms, as per ITU-T G.711 Appendix I. This is independent of the
+       codec, so is only used when the codec does not handle empty payloads
+       itself, see AcceptEmptyPayload(), and the output is 16 bit PCM.
+
+       @return false if concealment cannot be used for this transcoder.
+      */
+    bool SetConcealment(
+      bool enable   ///< Enable or disable concealment
+    );
+
 #if OPAL_STATISTICS
     virtual void GetStatistics(OpalMediaStatistics & statistics) const;
 #endif
@@ -346,6 +387,20 @@ class OpalTranscoder : public OpalMediaFormatPair
       unsigned instanceLen                ///<  Length of instance identifier
     );
 
+    /** Initialise a previously Reset() transcoder taken from the pool, with
+        the media formats negotiated for the new media stream.
+
+        The default behaviour clears the members of this class back to the
+        state they would be after construction and sets the media formats
+        as for OnCreated().
+      */
+    virtual bool OnReused(
+      const OpalMediaFormat & srcFormat,  ///< Source media format
+      const OpalMediaFormat & destFormat, ///< Destination media format
+      const BYTE * instance,              ///<  Unique instance identifier for transcoder
+      unsigned instanceLen                ///<  Length of instance identifier
+    );
+
     PINDEX    maxOutputSize;
     PNotifier commandNotifier;
     PDECLARE_MUTEX(updateMutex);
@@ -359,6 +414,128 @@ class OpalTranscoder : public OpalMediaFormatPair
 
     RTP_DataFrame::PayloadTypes m_lastPayloadType;
     unsigned                    m_consecutivePayloadTypeMismatches;
+
+#if OPAL_G711PLC
+    OpalG711_PLC * m_concealment;
+    unsigned       m_concealChannels;
+    PINDEX         m_concealFrameSize;    // Bytes of last decoded frame, zero if none yet
+    unsigned       m_concealedSamples;    // Samples concealed since last decoded frame
+#endif
+
+  private:
+    bool InternalConvert(const RTP_DataFrame & input, RTP_DataFrame & output);
+#if OPAL_G711PLC
+    void InternalConceal(RTP_DataFrame & output);
+#endif
+
+  friend class OpalTranscoderPool;
+};
+
+
+/**This class keeps idle transcoder instances for re-use by later media
+   streams. Constructing some codecs, e.g. Opus or H.264, is expensive and
+   at high call rates doing so for every media stream is significant.
+
+   A transcoder is only kept if its Reset() function succeeds, otherwise it
+   is deleted as usual. On Acquire() an idle transcoder for the same pair of
+   media formats is re-initialised with the negotiated options, or a new one
+   is created if there are none available.
+  */
+class OpalTranscoderPool : public PObject
+{
+    PCLASSINFO(OpalTranscoderPool, PObject);
+  public:
+    enum { DefaultMaxIdle = 10 };
+
+    OpalTranscoderPool();
+    ~OpalTranscoderPool();
+
+    /**Get the global transcoder pool.
+      */
+    static OpalTranscoderPool & GetInstance();
+
+    /**Standard stream print function, outputs statistics for all pairs.
+      */
+    virtual void PrintOn(
+      ostream & strm    ///<  Stream to output text representation
+    ) const;
+
+    /**Get a transcoder instance, re-using an idle one if possible.
+       The parameters are as for OpalTranscoder::Create().
+      */
+    OpalTranscoder * Acquire(
+      const OpalMediaFormat & srcFormat,  ///<  Name of source format
+      const OpalMediaFormat & dstFormat,  ///<  Name of destination format
+      const BYTE * instance = NULL,       ///<  Unique instance identifier for transcoder
+      unsigned instanceLen = 0            ///<  Length of instance identifier
+    );
+
+    /**Return a transcoder instance obtained from Acquire() or
+       OpalTranscoder::Create(). The transcoder is either kept for re-use or
+       deleted, in either case the caller must not use it again. A NULL
+       pointer is ignored.
+      */
+    void Release(
+      OpalTranscoder * transcoder   ///< Transcoder to return
+    );
+
+    /**Set the maximum number of idle transcoders kept for all pairs of media
+       formats, that do not have a specific limit. Zero disables pooling.
+      */
+    void SetMaxIdle(
+      unsigned count    ///< Maximum idle transcoders per pair
+    );
+
+    /**Set the maximum number of idle transcoders kept for the pair of media
+       formats. Zero disables pooling for the pair.
+      */
+    void SetMaxIdle(
+      const OpalMediaFormat & srcFormat,  ///<  Name of source format
+      const OpalMediaFormat & dstFormat,  ///<  Name of destination format
+      unsigned count                      ///< Maximum idle transcoders
+    );
+
+    /// Get the maximum number of idle transcoders for all pairs.
+    unsigned GetMaxIdle() const { return m_defaultMaxIdle; }
+
+    /**Delete all idle transcoders.
+      */
+    void Flush();
+
+    struct Statistics
+    {
+      Statistics();
+
+      unsigned m_created;   ///< Number of new transcoders created
+      unsigned m_reused;    ///< Number of transcoders re-used from pool
+      unsigned m_returned;  ///< Number of transcoders kept for re-use
+      unsigned m_discarded; ///< Number of transcoders deleted on release
+      unsigned m_idle;      ///< Number of transcoders currently idle
+    };
+
+    /**Get statistics on the pool for the pair of media formats.
+      */
+    Statistics GetStatistics(
+      const OpalMediaFormat & srcFormat,  ///<  Name of source format
+      const OpalMediaFormat & dstFormat   ///<  Name of destination format
+    ) const;
+
+  protected:
+    struct Entry
+    {
+      Entry();
+
+      std::list<OpalTranscoder *> m_idle;
+      unsigned                    m_maxIdle;
+      Statistics                  m_statistics;
+    };
+    typedef std::map<OpalTranscoderKey, Entry> EntryMap;
+
+    unsigned GetMaxIdle(const Entry & entry) const;
+
+    EntryMap m_entries;
+    unsigned m_defaultMaxIdle;
+    PDECLARE_MUTEX(m_mutex);
 };
 
 
@@ -512,6 +689,21 @@ class OpalStreamedTranscoder : public OpalTranscoder
        Returns converted value.
       */
     virtual int ConvertOne(int sample) const = 0;
+
+    /**Convert a block of samples from one format to another.
+       This is used by Convert() when the input and output are both a whole
+       number of bytes (8 or 16 bits) per sample, so a derived class can
+       convert the entire block in one call, e.g. via a lookup table, rather
+       than a virtual call per sample. The \p output buffer is large enough
+       for \p samples converted samples.
+
+       The default behaviour calls ConvertOne() for each sample.
+      */
+    virtual void ConvertBlock(
+      const BYTE * input,   ///<  Input samples
+      BYTE * output,        ///<  Output samples
+      PINDEX samples        ///<  Number of samples
+    ) const;
   //@}
 
   protected:
@@ -714,6 +714,11 @@ class RTP_DataFrame : public PBYTEArray
         PTime    m_receivedTime;  //< Local wall clock time packet was physically read from socket
         unsigned m_discontinuity; //< Number of packets lost since the last one
         PString  m_lipSyncId;     //< Identifier for pairing audio and video packets.
+        int      m_audioLevel;    /**< Audio level in -dBov (0 loudest to 127 silent) as per
+                                       RFC 6464, or -1 if unknown */
+        bool     m_voiceActivity; //< Voice activity flag that accompanies m_audioLevel
+        bool     m_suppressed;    /**< Payload deliberately removed, e.g. by a mixer gate,
+                                       so is not to be decoded or treated as lost */
     };
 
     /**Get meta data for RTP packet.
@@ -752,6 +757,34 @@ class RTP_DataFrame : public PBYTEArray
       */
     void SetDiscontinuity(unsigned lost) { m_metaData.m_discontinuity = lost; }
 
+    /** Get the audio level, as per RFC 6464.
+        This is in -dBov, where 0 is the loudest and 127 is silent. A value
+        of -1 indicates the audio level is unknown.
+      */
+    int GetAudioLevel() const { return m_metaData.m_audioLevel; }
+
+    /** Get the voice activity flag that accompanies the audio level.
+      */
+    bool GetVoiceActivity() const { return m_metaData.m_voiceActivity; }
+
+    /** Set the audio level, as per RFC 6464.
+      */
+    void SetAudioLevel(int level, bool voiceActivity)
+    {
+      m_metaData.m_audioLevel = level;
+      m_metaData.m_voiceActivity = voiceActivity;
+    }
+
+    /** Get flag indicating the payload was deliberately removed.
+        A frame with this set and an empty payload is not decoded, and is
+        not concealed as a lost packet.
+      */
+    bool IsSuppressed() const { return m_metaData.m_suppressed; }
+
+    /** Set flag indicating the payload was deliberately removed.
+      */
+    void SetSuppressed(bool suppressed) { m_metaData.m_suppressed = suppressed; }
+
     /** Get the identifier that links audio and video streams for
         "lip synch" purposes.
     */
@@ -82,6 +82,22 @@ class RTP_MetricsReport;
   */
 #define OPAL_OPT_TRANSPORT_WIDE_CONGESTION_CONTROL "Transport-Wide-Congestion-Control"
 
+/**OpalConnection::StringOption key to a boolean indicating the client to
+   mixer audio level header extension (RFC 6464) can be used. When enabled,
+   audio sent is stamped with the level calculated by the silence detector,
+   and the level of received audio is available via
+   RTP_DataFrame::GetAudioLevel() without decoding. Default false.
+  */
+#define OPAL_OPT_RTP_AUDIO_LEVEL "RTP-Audio-Level"
+
+/**OpalConnection::StringOption key to a boolean indicating simulcast
+   (RFC 8853) from the remote is accepted. All of the layers are then
+   received in the one session, and a layer is selected for each receiver
+   it is forwarded to, according to its available bandwidth. This also
+   enables the RtpStreamId header extension (RFC 8852). Default false.
+  */
+#define OPAL_OPT_SIMULCAST "Simulcast"
+
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -455,6 +471,34 @@ class OpalRTPSession : public OpalMediaSession
 
     static const PString & GetAbsSendTimeHdrExtURI();
     static const PString & GetTransportWideSeqNumHdrExtURI();
+    static const PString & GetRtpStreamIdHdrExtURI();
+    static const PString & GetAudioLevelHdrExtURI();
+
+    /**Set the simulcast layers (RFC 8853) the remote is sending.
+       Either, or both, of \p rids and \p ssrcs may be provided, the former
+       from "a=rid" and "a=simulcast", the latter from "a=ssrc-group:SIM".
+      */
+    void SetSimulcast(
+      const PStringArray & rids,        ///< RtpStreamId values for layers
+      const RTP_SyncSourceArray & ssrcs ///< SSRC values for layers
+    );
+
+    /**Indicate the remote is sending simulcast layers in this session.
+      */
+    bool IsSimulcast() const;
+
+    /**Get the simulcast layer RtpStreamId values, as provided by SetSimulcast().
+      */
+    PStringArray GetSimulcastStreamIds() const;
+
+    /**Get the RtpStreamId (RFC 8852) received for the SSRC.
+      */
+    PString GetRtpStreamId(RTP_SyncSourceId ssrc, Direction dir = e_Receiver) const;
+
+    /**Find the SSRC that has been receiving the RtpStreamId (RFC 8852).
+       @return zero if no SSRC has used \p rid.
+      */
+    RTP_SyncSourceId FindSyncSourceByRtpStreamId(const PString & rid, Direction dir = e_Receiver) const;
 
     /**Get the source identifier for remote data to us.
       */
@@ -698,6 +742,10 @@ class OpalRTPSession : public OpalMediaSession
     RTPHeaderExtensions m_headerExtensions;
     unsigned            m_absSendTimeHdrExtId;
     unsigned            m_transportWideSeqNumHdrExtId;
+    unsigned            m_rtpStreamIdHdrExtId;
+    unsigned            m_audioLevelHdrExtId;
+    PStringArray        m_simulcastRids;
+    RTP_SyncSourceArray m_simulcastSSRCs;
     PTimeInterval       m_staleReceiverTimeout;
     PINDEX              m_maxOutOfOrderPackets; // Number of packets before we give up waiting for an out of order packet
     PTimeInterval       m_waitOutOfOrderTime;   // Milliseconds before we give up on an out of order packet
@@ -777,6 +825,7 @@ class OpalRTPSession : public OpalMediaSession
       PString           m_canonicalName;
       PString           m_mediaStreamId;
       PString           m_mediaTrackId;
+      PString           m_rtpStreamId;
 
       RTP_SyncSourceId            m_rtxSSRC; // Bidirectional link between primary and secondary
       RTP_DataFrame::PayloadTypes m_rtxPT;   // Sending rtx payload type, or receiving rtx primary payload type, only set in seconday SSRC
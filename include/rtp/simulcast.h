@@ -0,0 +1,162 @@
+/*
+ * simulcast.h
+ *
+ * Simulcast layer selection for forwarded video
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#ifndef OPAL_RTP_SIMULCAST_H
+#define OPAL_RTP_SIMULCAST_H
+
+#ifdef P_USE_PRAGMA
+#pragma interface
+#endif
+
+#include <opal_config.h>
+
+#if OPAL_VIDEO
+
+#include <opal/mediafmt.h>
+#include <rtp/rtp.h>
+
+#include <map>
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**Select one of several simulcast layers for forwarding to a receiver.
+   A remote sending simulcast (RFC 8853) delivers several encodings of the
+   same video, each on its own SSRC, into the one RTP session. When that
+   media is forwarded without transcoding, each receiver must be sent
+   exactly one of those layers, and which one depends on the bandwidth
+   available to that receiver.
+
+   The bit rate of each layer is measured from the packets passing through,
+   so no assumption is made about the order or naming of the layers. The
+   highest layer that fits within the receivers available bandwidth is
+   selected. Changing layer is only done on an intra frame of the new layer,
+   so the receiver can decode it, and the sequence numbers and timestamps
+   are adjusted so the receiver sees a single continuous stream.
+
+   One instance is required per receiver.
+  */
+class OpalSimulcastSelector : public PObject
+{
+    PCLASSINFO(OpalSimulcastSelector, PObject);
+  public:
+    OpalSimulcastSelector(
+      const OpalVideoFormat & mediaFormat   ///< Media format of all layers
+    );
+    ~OpalSimulcastSelector();
+
+    /**Determine if the frame is to be forwarded to the receiver.
+       If the frame is from the currently selected layer then the sequence
+       number and timestamp to forward it with, for continuity with
+       previously forwarded frames, are returned. The frame itself is not
+       changed, so a frame shared with other receivers need only be copied
+       if it is actually forwarded.
+
+       @return false if the frame is not to be forwarded.
+      */
+    bool SelectFrame(
+      const RTP_DataFrame & frame,          ///< Frame received from any layer
+      RTP_SequenceNumber & sequenceNumber,  ///< Sequence number to forward frame with
+      RTP_Timestamp & timestamp             ///< Timestamp to forward frame with
+    );
+
+    /**Set the bit rate available to the receiver, e.g. from REMB or TMMBR.
+       A value of zero indicates no limit.
+      */
+    void SetAvailableBitRate(
+      OpalBandwidth bitRate     ///< Available bit rate
+    );
+
+    /**Get the bit rate available to the receiver.
+      */
+    OpalBandwidth GetAvailableBitRate() const;
+
+    /**Get the SSRC of a layer an intra frame is needed from, so the
+       receiver can be switched to it. Zero indicates none is needed. This
+       also clears the request, so it is only returned once.
+      */
+    RTP_SyncSourceId GetIntraFrameRequest();
+
+    /**Get the SSRC of the layer currently being forwarded.
+      */
+    RTP_SyncSourceId GetCurrentLayer() const;
+
+    /**Get the SSRC of the layer we would like to be forwarding.
+      */
+    RTP_SyncSourceId GetTargetLayer() const;
+
+    /**Get the measured bit rate for the layer.
+      */
+    OpalBandwidth GetLayerBitRate(
+      RTP_SyncSourceId ssrc     ///< SSRC of layer
+    ) const;
+
+  protected:
+    struct Layer
+    {
+      Layer();
+
+      OpalVideoFormat::FrameDetectorPtr m_frameDetector;
+      PTime         m_windowStart;
+      PINDEX        m_windowOctets;
+      OpalBandwidth m_bitRate;
+      PTime         m_lastPacketTime;
+    };
+    typedef std::map<RTP_SyncSourceId, Layer *> LayerMap;
+
+    void UpdateTarget(const PTime & now);
+    bool IsActive(const Layer & layer, const PTime & now) const;
+    void SwitchLayer(const RTP_DataFrame & frame, const PTime & now);
+
+    OpalVideoFormat    m_mediaFormat;
+    unsigned           m_clockRate;
+    LayerMap           m_layers;
+    OpalBandwidth      m_availableBitRate;
+    RTP_SyncSourceId   m_currentSSRC;
+    RTP_SyncSourceId   m_targetSSRC;
+    PTime              m_nextTargetUpdate;
+
+    // Output continuity
+    bool               m_forwarding;
+    RTP_SequenceNumber m_sequenceOffset;
+    RTP_SequenceNumber m_lastSequenceNumber;
+    RTP_Timestamp      m_timestampOffset;
+    RTP_Timestamp      m_lastTimestamp;
+    PTime              m_lastForwardTime;
+
+    RTP_SyncSourceId   m_intraFrameRequestSSRC;
+    PTime              m_lastIntraFrameRequest;
+
+    PDECLARE_MUTEX(m_mutex);
+};
+
+
+#endif // OPAL_VIDEO
+
+#endif // OPAL_RTP_SIMULCAST_H
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -518,6 +518,10 @@ class SDPRTPAVPMediaDescription : public SDPMediaDescription
     PString                       m_label;
     PString                       m_msid;
     vector<RTP_SyncSourceArray>   m_flowSSRC;
+    std::map<PString, PString>    m_rids;          // RFC8851, id to direction
+    PStringArray                  m_simulcastSend; // RFC8853, rid per layer
+    PStringArray                  m_simulcastRecv;
+    RTP_SyncSourceArray           m_simulcastSSRC; // RFC5576 SIM group
     OpalMediaFormat::RTCPFeedback m_rtcp_fb;
 #if OPAL_SRTP
     PList<SDPCryptoSuite>         m_cryptoSuites;
@@ -110,6 +110,7 @@ OPAL_RFC4175     := @OPAL_RFC4175@
 OPAL_RFC2435     := @OPAL_RFC2435@
 OPAL_AEC         := @OPAL_AEC@
 OPAL_G711PLC     := @OPAL_G711PLC@
+OPAL_DTMF_DETECT := @OPAL_DTMF_DETECT@
 OPAL_T38_CAP     := @OPAL_T38_CAPABILITY@
 OPAL_FAX         := @OPAL_FAX@
 OPAL_JAVA        := @OPAL_JAVA@
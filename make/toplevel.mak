@@ -133,6 +133,7 @@ SOURCES += $(OPAL_SRCDIR)/opal/manager.cxx \
            $(OPAL_SRCDIR)/rtp/rtp.cxx \
            $(OPAL_SRCDIR)/rtp/rtp_session.cxx \
            $(OPAL_SRCDIR)/rtp/rtp_stream.cxx \
+           $(OPAL_SRCDIR)/rtp/simulcast.cxx \
            $(OPAL_SRCDIR)/rtp/rtp_fec.cxx \
            $(OPAL_SRCDIR)/rtp/jitter.cxx \
            $(OPAL_SRCDIR)/rtp/metrics.cxx \
@@ -431,10 +432,13 @@ SOURCES += $(OPAL_SRCDIR)/codec/g711codec.cxx \
            $(OPAL_SRCDIR)/codec/rfc2833.cxx \
            $(OPAL_SRCDIR)/codec/opalwavfile.cxx \
            $(OPAL_SRCDIR)/codec/silencedetect.cxx \
+           $(OPAL_SRCDIR)/codec/resampler.cxx \
+           $(OPAL_SRCDIR)/codec/tonecache.cxx \
            $(OPAL_SRCDIR)/codec/opalpluginmgr.cxx
 
 ifeq ($(OPAL_VIDEO), yes)
   SOURCES += $(OPAL_SRCDIR)/codec/vidcodec.cxx \
+             $(OPAL_SRCDIR)/codec/yuvscale.cxx \
              $(OPAL_SRCDIR)/codec/h261mf.cxx \
              $(OPAL_SRCDIR)/codec/h263mf.cxx \
              $(OPAL_SRCDIR)/codec/h264mf.cxx \
@@ -454,6 +458,10 @@ ifeq ($(OPAL_G711PLC), yes)
   SOURCES += $(OPAL_SRCDIR)/codec/g711a1_plc.cxx
 endif
 
+ifeq ($(OPAL_DTMF_DETECT), yes)
+  SOURCES += $(OPAL_SRCDIR)/codec/dtmfdetect.cxx
+endif
+
 ifeq ($(OPAL_AEC), yes)
   SOURCES += $(OPAL_SRCDIR)/codec/echocancel.cxx
   ifeq ($(SPEEXDSP_SYSTEM), no)
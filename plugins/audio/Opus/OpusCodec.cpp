@@ -375,11 +375,18 @@ class OpusPluginCodec : public PluginCodec<MY_CODEC>
 
 ///////////////////////////////////////////////////////////////////////////////
 
+/* Expected packet loss, in percent, at which in-band FEC is turned on, when
+   it was negotiated, and above which loss is taken to be from congestion, so
+   the bit rate is reduced by the excess. */
+static unsigned const MinFECPacketLoss     = 1;
+static unsigned const CongestionPacketLoss = 10;
+
 class OpusPluginEncoder : public OpusPluginCodec
 {
   protected:
     OpusEncoder * m_encoder;
-    unsigned      m_dynamicPacketLoss;
+    unsigned      m_expectedPacketLoss;
+    bool          m_packetLossReport;
     bool          m_useDTX;
     unsigned      m_bitRate;
     opus_int32    m_complexity;
@@ -388,7 +395,8 @@ class OpusPluginEncoder : public OpusPluginCodec
     OpusPluginEncoder(const PluginCodec_Definition * defn)
       : OpusPluginCodec(defn)
       , m_encoder(NULL)
-      , m_dynamicPacketLoss(0)
+      , m_expectedPacketLoss(0)
+      , m_packetLossReport(false)
       , m_useDTX(false)
       , m_bitRate(12000)
       , m_complexity(0)
@@ -415,12 +423,44 @@ class OpusPluginEncoder : public OpusPluginCodec
     }
 
 
+    virtual bool Reset()
+    {
+      // Keeps the CTL settings, which get set again anyway
+      if (m_encoder == NULL || opus_encoder_ctl(m_encoder, OPUS_RESET_STATE) != OPUS_OK)
+        return false;
+
+      m_countFEC = m_useInBandFEC ? 0 : -1;
+      return true;
+    }
+
+
+    virtual bool SetOptions(const char * const * options)
+    {
+      /* A report from the remote arrives as the packet loss option alone.
+         A full update, e.g. on a bit rate change, repeats the media formats
+         stale value, which must not move the expected loss. */
+      m_packetLossReport = options[0] != NULL && options[2] == NULL;
+      return OpusPluginCodec::SetOptions(options);
+    }
+
+
     virtual bool SetOption(const char * optionName, const char * optionValue)
     {
       if (strcasecmp(optionName, DynamicPacketLoss.m_name) == 0) {
-        if (!SetOptionUnsigned(m_dynamicPacketLoss, optionValue, 0, 100))
+        if (!m_packetLossReport)
+          return true;
+
+        unsigned packetLoss = m_expectedPacketLoss;
+        if (!SetOptionUnsigned(packetLoss, optionValue, 0, 100))
           return false;
-        PTRACE(4, MY_CODEC_LOG, "Dynamic packet loss set to " << m_dynamicPacketLoss << '%');
+
+        /* Each report is the loss over the last RTCP interval, so act on a
+           rise at once, but only halve the gap on a fall, so a short lull
+           does not turn FEC off just before the next burst. */
+        if (packetLoss < m_expectedPacketLoss)
+          packetLoss = (m_expectedPacketLoss + packetLoss)/2;
+        m_expectedPacketLoss = packetLoss;
+        PTRACE(4, MY_CODEC_LOG, "Dynamic packet loss set to " << optionValue << "%, expecting " << m_expectedPacketLoss << '%');
         return true;
       }
 
@@ -443,17 +483,28 @@ class OpusPluginEncoder : public OpusPluginCodec
       if (m_encoder == NULL)
         return false;
 
+      /* The negotiated FEC and the target bit rate from flow control are
+         limits, within which the remote's reported loss decides what is used. */
+      bool useFEC = m_useInBandFEC && m_expectedPacketLoss >= MinFECPacketLoss;
+
+      unsigned bitRate = m_bitRate;
+      if (m_expectedPacketLoss > CongestionPacketLoss) {
+        bitRate -= bitRate*(m_expectedPacketLoss - CongestionPacketLoss)/100;
+        if (bitRate < MIN_BIT_RATE)
+          bitRate = MIN_BIT_RATE;
+      }
+
       //opus_encoder_ctl(m_encoder, OPUS_SET_MAX_BANDWIDTH(m_definition->sampleRate));
-      opus_encoder_ctl(m_encoder, OPUS_SET_INBAND_FEC(m_useInBandFEC));
-      opus_encoder_ctl(m_encoder, OPUS_SET_PACKET_LOSS_PERC(m_dynamicPacketLoss));
+      opus_encoder_ctl(m_encoder, OPUS_SET_INBAND_FEC(useFEC));
+      opus_encoder_ctl(m_encoder, OPUS_SET_PACKET_LOSS_PERC(m_expectedPacketLoss));
       opus_encoder_ctl(m_encoder, OPUS_SET_DTX(m_useDTX));
-      opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(m_bitRate));
+      opus_encoder_ctl(m_encoder, OPUS_SET_BITRATE(bitRate));
       opus_encoder_ctl(m_encoder, OPUS_SET_COMPLEXITY(m_complexity));
       PTRACE(4, MY_CODEC_LOG, "Encoder options set:"
-                              " fec=" << std::boolalpha << m_useInBandFEC << ","
-                              " pkt-loss=" << m_dynamicPacketLoss << "%,"
+                              " fec=" << std::boolalpha << useFEC << ","
+                              " pkt-loss=" << m_expectedPacketLoss << "%,"
                               " dtx=" << m_useDTX << ","
-                              " bitrate=" << m_bitRate << ","
+                              " bitrate=" << bitRate << '/' << m_bitRate << ","
                               " complexity=" << m_complexity);
       return true;
     }
@@ -538,6 +589,17 @@ class OpusPluginDecoder : public OpusPluginCodec
     }
 
 
+    virtual bool Reset()
+    {
+      if (m_decoder == NULL || opus_decoder_ctl(m_decoder, OPUS_RESET_STATE) != OPUS_OK)
+        return false;
+
+      m_countFEC = m_useInBandFEC ? 0 : -1;
+      m_decodeState = AwaitingInitialPacket;
+      return true;
+    }
+
+
     virtual bool Transcode(const void * fromPtr,
                              unsigned & fromLen,
                                  void * toPtr,
@@ -642,6 +704,9 @@ class OpusPluginDecoder : public OpusPluginCodec
           return DecodeFrame(fromPtr, fromLen, toPtr, samples, false);
 
         case UseFEC :
+          /* Count the lost frames actually recovered for the statistics, if
+             the packet has no FEC data opus_decode() falls back to PLC. */
+          PacketHasFec((const opus_uint8 *)fromPtr, fromLen);
           if (!DecodeFrame(fromPtr, fromLen, toPtr, samples, true))
             return false;
           break;
@@ -172,6 +172,34 @@ static struct PluginCodec_Option const TemporalSpatialTradeOff =
   "31"                                // Maximum value
 };
 
+static struct PluginCodec_Option const EncoderThreads =
+{
+  PluginCodec_IntegerOption,          // Option type
+  PLUGINCODEC_OPTION_ENCODER_THREADS, // User visible name
+  false,                              // User Read/Only flag
+  PluginCodec_NoMerge,                // Merge mode
+  "0",                                // Initial value
+  NULL,                               // FMTP option name
+  NULL,                               // FMTP default value
+  0,                                  // H.245 generic capability code and bit mask
+  "0",                                // Minimum value
+  "64"                                // Maximum value
+};
+
+static struct PluginCodec_Option const EncoderSlices =
+{
+  PluginCodec_IntegerOption,          // Option type
+  PLUGINCODEC_OPTION_ENCODER_SLICES,  // User visible name
+  false,                              // User Read/Only flag
+  PluginCodec_NoMerge,                // Merge mode
+  "0",                                // Initial value
+  NULL,                               // FMTP option name
+  NULL,                               // FMTP default value
+  0,                                  // H.245 generic capability code and bit mask
+  "0",                                // Minimum value
+  "64"                                // Maximum value
+};
+
 static struct PluginCodec_Option const SpatialResampling =
 {
   PluginCodec_BoolOption,             // Option type
@@ -247,6 +275,8 @@ static struct PluginCodec_Option const * OptionTableRFC[] = {
   &OutputPartition,
 #endif
   &TemporalSpatialTradeOff,
+  &EncoderThreads,
+  &EncoderSlices,
   &SpatialResampling,
   &SpatialResamplingUp,
   &SpatialResamplingDown,
@@ -258,6 +288,8 @@ static struct PluginCodec_Option const * OptionTableRFC[] = {
 static struct PluginCodec_Option const * OptionTableOM[] = {
   &MaxFrameSizeOM,
   &TemporalSpatialTradeOff,
+  &EncoderThreads,
+  &EncoderSlices,
   &SpatialResampling,
   &SpatialResamplingUp,
   &SpatialResamplingDown,
@@ -526,15 +558,34 @@ class VP8Encoder : public PluginVideoEncoder<VP8_CODEC>
                               " rc_buf_initial_sz=" << m_config.rc_buf_initial_sz << ","
                               " rc_buf_optimal_sz=" << m_config.rc_buf_optimal_sz << ","
                               " rc_undershoot_pct=" << m_config.rc_undershoot_pct << ","
-                              " rc_overshoot_pct=" << m_config.rc_overshoot_pct);
+                              " rc_overshoot_pct=" << m_config.rc_overshoot_pct << ","
+                              " g_threads=" << GetEncoderThreads() << ","
+                              " partitions=" << GetEncoderSlices());
 
-      if (m_config.g_w == m_width && m_config.g_h == m_height)
-        return !IS_ERROR(vpx_codec_enc_config_set, (&m_codec, &m_config));
+      // Thread count cannot be changed on the fly, need to re-initialise
+      if (m_config.g_w == m_width && m_config.g_h == m_height && m_config.g_threads == GetEncoderThreads()) {
+        if (IS_ERROR(vpx_codec_enc_config_set, (&m_codec, &m_config)))
+          return false;
+      }
+      else {
+        m_config.g_w = m_width;
+        m_config.g_h = m_height;
+        m_config.g_threads = GetEncoderThreads();
+        vpx_codec_destroy(&m_codec);
+        if (IS_ERROR(vpx_codec_enc_init, (&m_codec, vpx_codec_vp8_cx(), &m_config, m_initFlags)))
+          return false;
+      }
 
-      m_config.g_w = m_width;
-      m_config.g_h = m_height;
-      vpx_codec_destroy(&m_codec);
-      return !IS_ERROR(vpx_codec_enc_init, (&m_codec, vpx_codec_vp8_cx(), &m_config, m_initFlags));
+      // Token partitions allow each thread to pack its own part of the frame
+      unsigned slices = GetEncoderSlices();
+      int partitions = VP8_ONE_TOKENPARTITION;
+      if (slices >= 8)
+        partitions = VP8_EIGHT_TOKENPARTITION;
+      else if (slices >= 4)
+        partitions = VP8_FOUR_TOKENPARTITION;
+      else if (slices >= 2)
+        partitions = VP8_TWO_TOKENPARTITION;
+      return !IS_ERROR(vpx_codec_control, (&m_codec, VP8E_SET_TOKEN_PARTITIONS, partitions));
     }
 
 
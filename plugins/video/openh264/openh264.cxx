@@ -385,6 +385,34 @@ static struct PluginCodec_Option const TemporalSpatialTradeOff =
   "31"                                // Maximum value
 };
 
+static struct PluginCodec_Option const EncoderThreads =
+{
+  PluginCodec_IntegerOption,          // Option type
+  PLUGINCODEC_OPTION_ENCODER_THREADS, // User visible name
+  false,                              // User Read/Only flag
+  PluginCodec_NoMerge,                // Merge mode
+  "0",                                // Initial value
+  NULL,                               // FMTP option name
+  NULL,                               // FMTP default value
+  0,                                  // H.245 generic capability code and bit mask
+  "0",                                // Minimum value
+  "64"                                // Maximum value
+};
+
+static struct PluginCodec_Option const EncoderSlices =
+{
+  PluginCodec_IntegerOption,          // Option type
+  PLUGINCODEC_OPTION_ENCODER_SLICES,  // User visible name
+  false,                              // User Read/Only flag
+  PluginCodec_NoMerge,                // Merge mode
+  "0",                                // Initial value
+  NULL,                               // FMTP option name
+  NULL,                               // FMTP default value
+  0,                                  // H.245 generic capability code and bit mask
+  "0",                                // Minimum value
+  "64"                                // Maximum value
+};
+
 static struct PluginCodec_Option const MediaPacketizationsH323_0 =
 {
   PluginCodec_StringOption,           // Option type
@@ -451,6 +479,8 @@ static struct PluginCodec_Option const * const MyOptionTable_0[] = {
   &SDPForced,
   &MaxNaluSize,
   &TemporalSpatialTradeOff,
+  &EncoderThreads,
+  &EncoderSlices,
   &PacketizationModeSDP_0,
   &MediaPacketizationsH323_0,  // Note: must be last entry
   NULL
@@ -475,6 +505,8 @@ static struct PluginCodec_Option const * const MyOptionTable_1[] = {
   &SDPForced,
   &MaxNaluSize,
   &TemporalSpatialTradeOff,
+  &EncoderThreads,
+  &EncoderSlices,
   &PacketizationModeSDP_1,
   &MediaPacketizationsH323_1,  // Note: must be last entry
   NULL
@@ -754,6 +786,7 @@ class H264_Encoder : public PluginVideoEncoder<MY_CODEC>
       param.fMaxFrameRate = (float)PLUGINCODEC_VIDEO_CLOCK/m_frameTime;
       param.uiIntraPeriod = m_keyFramePeriod;
       param.bPrefixNalAddingCtrl = false;
+      param.iMultipleThreadIdc = (unsigned short)GetEncoderThreads();
 
       param.sSpatialLayers[0].uiProfileIdc = m_profile;
       param.sSpatialLayers[0].uiLevelIdc = m_level;
@@ -773,7 +806,13 @@ class H264_Encoder : public PluginVideoEncoder<MY_CODEC>
           break;
 
         case 1 :
-          param.sSpatialLayers[0].sSliceArgument.uiSliceMode = SM_SINGLE_SLICE;
+          if (GetEncoderSlices() > 1) {
+            // Fixed number of slices so each encoder thread can work on one
+            param.sSpatialLayers[0].sSliceArgument.uiSliceMode = SM_FIXEDSLCNUM_SLICE;
+            param.sSpatialLayers[0].sSliceArgument.uiSliceNum = std::min(GetEncoderSlices(), (unsigned)MAX_SLICES_NUM_TMP);
+          }
+          else
+            param.sSpatialLayers[0].sSliceArgument.uiSliceMode = SM_SINGLE_SLICE;
           param.uiMaxNalSize = 0;
           break;
 
@@ -800,6 +839,8 @@ class H264_Encoder : public PluginVideoEncoder<MY_CODEC>
              " level=" << GetLevelName(m_level) << '(' << m_level << "),"
              " tsto=" << m_tsto << " (" << param.iMaxQp << "),"
              " kfr=" << param.uiIntraPeriod << ","
+             " threads=" << param.iMultipleThreadIdc << ","
+             " slices=" << param.sSpatialLayers[0].sSliceArgument.uiSliceNum << ","
              " pkt-mode=" << mode);
       return err == cmResultSuccess;
     }
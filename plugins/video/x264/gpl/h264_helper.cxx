@@ -262,6 +262,16 @@ int main(int argc, char *argv[])
           x264.SetTSTO (val);
           WritePipe(&msg, sizeof(msg)); 
         break;
+      case SET_THREADS:
+          ReadPipe(&val, sizeof(val));
+          x264.SetThreads (val);
+          WritePipe(&msg, sizeof(msg)); 
+        break;
+      case SET_SLICES:
+          ReadPipe(&val, sizeof(val));
+          x264.SetSlices (val);
+          WritePipe(&msg, sizeof(msg)); 
+        break;
       case SET_PROFILE_LEVEL:
           ReadPipe(&val, sizeof(val));
           x264.SetProfileLevel((val>>16)&0xff, val&0xff, (val>>8)&0xff);
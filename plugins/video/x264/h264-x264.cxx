@@ -445,6 +445,34 @@ static struct PluginCodec_Option const TemporalSpatialTradeOff =
   "31"                                // Maximum value
 };
 
+static struct PluginCodec_Option const EncoderThreads =
+{
+  PluginCodec_IntegerOption,          // Option type
+  PLUGINCODEC_OPTION_ENCODER_THREADS, // User visible name
+  false,                              // User Read/Only flag
+  PluginCodec_NoMerge,                // Merge mode
+  "0",                                // Initial value
+  NULL,                               // FMTP option name
+  NULL,                               // FMTP default value
+  0,                                  // H.245 generic capability code and bit mask
+  "0",                                // Minimum value
+  "64"                                // Maximum value
+};
+
+static struct PluginCodec_Option const EncoderSlices =
+{
+  PluginCodec_IntegerOption,          // Option type
+  PLUGINCODEC_OPTION_ENCODER_SLICES,  // User visible name
+  false,                              // User Read/Only flag
+  PluginCodec_NoMerge,                // Merge mode
+  "0",                                // Initial value
+  NULL,                               // FMTP option name
+  NULL,                               // FMTP default value
+  0,                                  // H.245 generic capability code and bit mask
+  "0",                                // Minimum value
+  "64"                                // Maximum value
+};
+
 static struct PluginCodec_Option const SendAccessUnitDelimiters =
 {
   PluginCodec_BoolOption,                         // Option type
@@ -473,6 +501,8 @@ static struct PluginCodec_Option const * const MyOptionTable_High[] = {
   &SDPForced,
   &MaxNaluSize,
   &TemporalSpatialTradeOff,
+  &EncoderThreads,
+  &EncoderSlices,
   &SendAccessUnitDelimiters,
   &PacketizationModeSDP_1,
   &MediaPacketizationsH323_1,  // Note: must be last entry
@@ -498,6 +528,8 @@ static struct PluginCodec_Option const * const MyOptionTable_0[] = {
   &SDPForced,
   &MaxNaluSize,
   &TemporalSpatialTradeOff,
+  &EncoderThreads,
+  &EncoderSlices,
   &SendAccessUnitDelimiters,
   &PacketizationModeSDP_0,
   &MediaPacketizationsH323_0,  // Note: must be last entry
@@ -523,6 +555,8 @@ static struct PluginCodec_Option const * const MyOptionTable_1[] = {
   &SDPForced,
   &MaxNaluSize,
   &TemporalSpatialTradeOff,
+  &EncoderThreads,
+  &EncoderSlices,
   &SendAccessUnitDelimiters,
   &PacketizationModeSDP_1,
   &MediaPacketizationsH323_1,  // Note: must be last entry
@@ -764,6 +798,8 @@ class H264_Encoder : public PluginVideoEncoder<MY_CODEC>
       m_encoder.SetRateControlPeriod(m_rateControlPeriod);
       m_encoder.SetTSTO(m_tsto);
       m_encoder.SetMaxKeyFramePeriod(m_keyFramePeriod != 0 ? m_keyFramePeriod : 10*PLUGINCODEC_VIDEO_CLOCK/m_frameTime); // Every 10 seconds
+      m_encoder.SetThreads(GetEncoderThreads());
+      m_encoder.SetSlices(GetEncoderSlices());
 
       unsigned mode = m_isH323 ? m_packetisationModeH323 : m_packetisationModeSDP;
       if (mode == 0) {
@@ -791,6 +827,8 @@ class H264_Encoder : public PluginVideoEncoder<MY_CODEC>
                               "RTP=" << m_maxRTPSize << " "
                               "NALU=" << m_maxNALUSize << " "
                               "TSTO=" << m_tsto << " "
+                              "threads=" << GetEncoderThreads() << " "
+                              "slices=" << GetEncoderSlices() << " "
                               "Mode=" << mode);
       return true;
     }
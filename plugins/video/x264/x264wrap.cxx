@@ -267,6 +267,23 @@ bool H264Encoder::SetTSTO(unsigned tsto)
 }
 
 
+bool H264Encoder::SetThreads(unsigned threads)
+{
+  m_context.i_threads = threads;
+  return true;
+}
+
+
+bool H264Encoder::SetSlices(unsigned slices)
+{
+  /* Sliced threads split each frame between the threads, which unlike
+     frame based threading does not add a frame of latency per thread. */
+  m_context.b_sliced_threads = slices > 1;
+  m_context.i_slice_count = slices > 1 ? slices : 0;
+  return true;
+}
+
+
 bool H264Encoder::ApplyOptions()
 {
   if (m_codec != NULL)
@@ -285,7 +302,9 @@ bool H264Encoder::ApplyOptions()
             " " << m_context.rc.i_vbv_max_bitrate << "kbps,"
             " max-rtp=" << m_context.i_slice_max_size << ","
             " key-rate=" << m_context.i_keyint_max << ","
-            " qp-max=" << m_context.rc.i_qp_max);
+            " qp-max=" << m_context.rc.i_qp_max << ","
+            " threads=" << m_context.i_threads << ","
+            " slices=" << m_context.i_slice_count);
   return true;
 }
 
@@ -891,6 +910,18 @@ bool H264Encoder::SetMaxKeyFramePeriod(unsigned period)
 }
 
 
+bool H264Encoder::SetThreads(unsigned threads)
+{
+  return WriteValue(SET_THREADS, threads);
+}
+
+
+bool H264Encoder::SetSlices(unsigned slices)
+{
+  return WriteValue(SET_SLICES, slices);
+}
+
+
 bool H264Encoder::ApplyOptions()
 {
   unsigned msg = APPLY_OPTIONS;
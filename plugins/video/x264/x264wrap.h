@@ -69,6 +69,8 @@ extern "C" {
 #define SET_PROFILE_LEVEL         13
 #define SET_MAX_NALU_SIZE         14
 #define SET_RATE_CONTROL_PERIOD   15
+#define SET_THREADS               16
+#define SET_SLICES                17
 
 
 class H264Encoder
@@ -89,6 +91,8 @@ class H264Encoder
     bool SetMaxNALUSize(unsigned size);
     bool SetTSTO(unsigned tsto);
     bool SetMaxKeyFramePeriod(unsigned period);
+    bool SetThreads(unsigned threads);
+    bool SetSlices(unsigned slices);
 
     bool ApplyOptions();
 
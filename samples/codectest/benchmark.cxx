@@ -0,0 +1,565 @@
+/*
+ * benchmark.cxx
+ *
+ * OPAL application source file for testing codecs
+ *
+ * Micro-benchmarks of media processing
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Windows Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include "precompile.h"
+#include "main.h"
+
+#include <ptclib/random.h>
+#include <codec/silencedetect.h>
+#include <codec/echocancel.h>
+#include <codec/dtmfdetect.h>
+#include <codec/yuvscale.h>
+
+#include <math.h>
+
+
+static void OutputRate(const char * operation, unsigned iterations, PINDEX samples, const PTimeInterval & elapsed)
+{
+  double seconds = elapsed.GetMilliSeconds()/1000.0;
+  double total = (double)iterations*samples;
+
+  cout << "  " << setw(20) << left << operation << right
+       << iterations << " x " << samples << " samples in " << elapsed << "s";
+  if (seconds > 0)
+    cout << ", " << setprecision(4) << total/seconds/1e6 << " Msamples/s, "
+         << setprecision(3) << seconds*1e9/total << " ns/sample";
+  cout << endl;
+}
+
+
+static void FillAudio(RTP_DataFrame & frame, PINDEX samples, unsigned clockRate)
+{
+  PRandom rand;
+  frame.SetPayloadSize(samples*sizeof(short));
+  short * pcm = (short *)frame.GetPayloadPtr();
+  for (PINDEX i = 0; i < samples; ++i)
+    pcm[i] = (short)(8000*sin(2*M_PI*440*i/clockRate) + (int)(rand.Generate()%2000) - 1000);
+}
+
+
+static void BenchmarkStreamed(const char * operation,
+                              const OpalStreamedTranscoder & transcoder,
+                              const RTP_DataFrame & input,
+                              bool sixteenBit,
+                              unsigned iterations)
+{
+  /* Baseline of per sample virtual call, which is what Convert() did before
+     ConvertBlock(), so the improvement is visible. */
+  const BYTE * bytes = input.GetPayloadPtr();
+  const short * words = (const short *)bytes;
+  PINDEX samples = sixteenBit ? input.GetPayloadSize()/2 : input.GetPayloadSize();
+
+  volatile int sink = 0;
+  PTimeInterval start = PTimer::Tick();
+  for (unsigned it = 0; it < iterations; ++it) {
+    for (PINDEX i = 0; i < samples; ++i)
+      sink += transcoder.ConvertOne(sixteenBit ? words[i] : bytes[i]);
+  }
+  OutputRate(operation, iterations, samples, PTimer::Tick() - start);
+}
+
+
+static void BenchmarkAudio(OpalTranscoder & encoder, OpalTranscoder & decoder, const OpalMediaFormat & rawFormat, unsigned iterations)
+{
+  // 20ms packets
+  PINDEX samples = rawFormat.GetClockRate()/50;
+  RTP_DataFrame pcm;
+  FillAudio(pcm, samples, rawFormat.GetClockRate());
+
+  cout << encoder.GetOutputFormat() << " <-> " << rawFormat << ':' << endl;
+
+  RTP_DataFrameList encoded;
+  PTimeInterval start = PTimer::Tick();
+  for (unsigned it = 0; it < iterations; ++it)
+    encoder.ConvertFrames(pcm, encoded);
+  OutputRate("encode", iterations, samples, PTimer::Tick() - start);
+
+  if (encoded.empty()) {
+    cout << "  Encoder produced no output." << endl;
+    return;
+  }
+
+  RTP_DataFrame payload = encoded.front();
+  RTP_DataFrameList decoded;
+  start = PTimer::Tick();
+  for (unsigned it = 0; it < iterations; ++it)
+    decoder.ConvertFrames(payload, decoded);
+  OutputRate("decode", iterations, samples, PTimer::Tick() - start);
+
+  const OpalStreamedTranscoder * streamed = dynamic_cast<const OpalStreamedTranscoder *>(&encoder);
+  if (streamed != NULL)
+    BenchmarkStreamed("encode per sample", *streamed, pcm, true, iterations);
+
+  streamed = dynamic_cast<const OpalStreamedTranscoder *>(&decoder);
+  if (streamed != NULL)
+    BenchmarkStreamed("decode per sample", *streamed, payload, false, iterations);
+}
+
+
+static void BenchmarkAudio(const OpalMediaFormat & mediaFormat, unsigned iterations)
+{
+  OpalMediaFormatList rawFormats = OpalTranscoder::GetDestinationFormats(mediaFormat);
+  if (rawFormats.IsEmpty()) {
+    cout << "No transcoders for " << mediaFormat << endl;
+    return;
+  }
+  OpalMediaFormat rawFormat = rawFormats[0];
+
+  OpalTranscoder * encoder = OpalTranscoder::Create(rawFormat, mediaFormat);
+  OpalTranscoder * decoder = OpalTranscoder::Create(mediaFormat, rawFormat);
+  if (encoder != NULL && decoder != NULL)
+    BenchmarkAudio(*encoder, *decoder, rawFormat, iterations);
+  else
+    cout << "Could not create transcoders for " << mediaFormat << endl;
+
+  delete encoder;
+  delete decoder;
+}
+
+
+static unsigned ScalarAverageSignalLevel(const BYTE * buffer, PINDEX size)
+{
+  // The original branchy loop, as a baseline
+  int sum = 0;
+  PINDEX samples = size/2;
+  const short * pcm = (const short *)buffer;
+  const short * end = pcm + samples;
+  while (pcm != end) {
+    if (*pcm < 0)
+      sum -= *pcm++;
+    else
+      sum += *pcm++;
+  }
+  return sum / samples;
+}
+
+
+static void OutputFrameCost(const char * operation, unsigned iterations, PINDEX samples, const PTimeInterval & elapsed)
+{
+  OutputRate(operation, iterations, samples, elapsed);
+  cout << "  " << setw(20) << ' ' << setprecision(4) << elapsed.GetMilliSeconds()*1e6/iterations << " ns/frame" << endl;
+}
+
+
+static void BenchmarkSilenceDetector(unsigned iterations)
+{
+  static const unsigned ClockRates[] = { 8000, 16000, 48000 };
+  for (PINDEX r = 0; r < PARRAYSIZE(ClockRates); ++r) {
+    unsigned clockRate = ClockRates[r];
+
+    // 20ms frames
+    PINDEX samples = clockRate/50;
+    RTP_DataFrame pcm;
+    FillAudio(pcm, samples, clockRate);
+    const BYTE * buffer = pcm.GetPayloadPtr();
+    PINDEX size = pcm.GetPayloadSize();
+
+    cout << "Silence detector at " << clockRate << "Hz:" << endl;
+
+    volatile unsigned sink = 0;
+    PTimeInterval start = PTimer::Tick();
+    for (unsigned it = 0; it < iterations; ++it)
+      sink += ScalarAverageSignalLevel(buffer, size);
+    OutputFrameCost("scalar level", iterations, samples, PTimer::Tick() - start);
+
+    start = PTimer::Tick();
+    for (unsigned it = 0; it < iterations; ++it)
+      sink += OpalSilenceDetector::GetAverageSignalLevelPCM16(buffer, size, false);
+    OutputFrameCost("vector level", iterations, samples, PTimer::Tick() - start);
+
+    static const OpalSilenceDetector::Modes Modes[] = {
+      OpalSilenceDetector::AdaptiveSilenceDetection,
+      OpalSilenceDetector::SubBandSilenceDetection
+    };
+    for (PINDEX m = 0; m < PARRAYSIZE(Modes); ++m) {
+      OpalPCM16SilenceDetector detector(OpalSilenceDetector::Params(Modes[m]));
+      detector.SetClockRate(clockRate);
+
+      unsigned timestamp = samples;
+      start = PTimer::Tick();
+      for (unsigned it = 0; it < iterations; ++it, timestamp += samples)
+        sink += detector.Detect(buffer, size, timestamp);
+      OutputFrameCost(PSTRSTRM(Modes[m]), iterations, samples, PTimer::Tick() - start);
+    }
+  }
+}
+
+
+#if OPAL_AEC
+static void BenchmarkEchoCanceler(unsigned iterations)
+{
+  static const unsigned ClockRates[] = { 8000, 16000 };
+  for (PINDEX r = 0; r < PARRAYSIZE(ClockRates); ++r) {
+    unsigned clockRate = ClockRates[r];
+
+    // 20ms frames, speaker and an attenuated copy as the microphone
+    PINDEX samples = clockRate/50;
+    RTP_DataFrame speaker;
+    FillAudio(speaker, samples, clockRate);
+    RTP_DataFrame microphone(speaker.GetPayloadSize());
+
+    cout << "Echo canceler at " << clockRate << "Hz:" << endl;
+
+    // The original per sample double precision DC filter, as a baseline
+    const short * in = (const short *)speaker.GetPayloadPtr();
+    short * out = (short *)microphone.GetPayloadPtr();
+    double mean = 0;
+    PTimeInterval start = PTimer::Tick();
+    for (unsigned it = 0; it < iterations; ++it) {
+      for (PINDEX i = 0; i < samples; ++i) {
+        mean = 0.999*mean + 0.001*in[i];
+        out[i] = in[i] - (short)mean;
+      }
+    }
+    OutputFrameCost("double DC filter", iterations, samples, PTimer::Tick() - start);
+
+    OpalEchoCanceler::Params params;
+    params.m_enabled = true;
+    OpalEchoCanceler aec;
+    aec.SetParameters(params);
+    aec.SetClockRate(clockRate);
+
+    start = PTimer::Tick();
+    for (unsigned it = 0; it < iterations; ++it) {
+      aec.AddEchoReference(in, samples);
+      for (PINDEX i = 0; i < samples; ++i)
+        out[i] = in[i]/4;
+      aec.CancelEcho(out, samples);
+    }
+    OutputFrameCost("cancel per call", iterations, samples, PTimer::Tick() - start);
+  }
+}
+#endif // OPAL_AEC
+
+
+#if OPAL_DTMF_DETECT
+static void FillDTMF(PShortArray & pcm, char digit, double deviation)
+{
+  static const char Digits[] = "123A456B789C*0#D";
+  static const double Rows[4] = { 697, 770, 852, 941 };
+  static const double Columns[4] = { 1209, 1336, 1477, 1633 };
+
+  PINDEX index = strchr(Digits, digit) - Digits;
+  double row = Rows[index/4]*(1+deviation);
+  double col = Columns[index%4]*(1+deviation);
+
+  // 60ms of tone, about -16dBov each, then 40ms of silence
+  PINDEX toneSamples = OpalDTMFDetector::SampleRate*60/1000;
+  PINDEX totalSamples = OpalDTMFDetector::SampleRate/10;
+  pcm.SetSize(totalSamples);
+  for (PINDEX i = 0; i < toneSamples; ++i)
+    pcm[i] = (short)(5000*sin(2*M_PI*row*i/OpalDTMFDetector::SampleRate) +
+                     5000*sin(2*M_PI*col*i/OpalDTMFDetector::SampleRate));
+  for (PINDEX i = toneSamples; i < totalSamples; ++i)
+    pcm[i] = 0;
+}
+
+
+static void BenchmarkDTMFDetector(unsigned iterations)
+{
+  static const char Digits[] = "123A456B789C*0#D";
+
+  /* Check every digit is detected within 1.5% of nominal frequency, and
+     rejected 3.5% off, as per ITU-T Q.24 */
+  static const struct {
+    double m_deviation;
+    bool   m_detect;
+  } Deviations[] = {
+    { -0.035, false },
+    { -0.015, true  },
+    {  0,     true  },
+    {  0.015, true  },
+    {  0.035, false }
+  };
+
+  cout << "DTMF detector:" << endl;
+
+  bool allPassed = true;
+  for (PINDEX d = 0; d < PARRAYSIZE(Deviations); ++d) {
+    unsigned passed = 0;
+    for (const char * digit = Digits; *digit != '\0'; ++digit) {
+      PShortArray pcm;
+      FillDTMF(pcm, *digit, Deviations[d].m_deviation);
+      OpalDTMFDetector detector;
+      PString tones = detector.Decode((const short *)pcm, pcm.GetSize());
+      if (tones == (Deviations[d].m_detect ? PString(*digit) : PString::Empty()))
+        ++passed;
+    }
+    cout << "  " << setw(20) << left << PSTRSTRM(showpos << Deviations[d].m_deviation*100 << '%') << right
+         << (Deviations[d].m_detect ? "detected " : "rejected ") << passed << '/' << strlen(Digits) << endl;
+    if (passed != strlen(Digits))
+      allPassed = false;
+  }
+
+  // Random noise above the energy threshold, which should be rejected by the filter bank
+  PShortArray noise(OpalDTMFDetector::SampleRate/10);
+  PRandom rand;
+  for (PINDEX i = 0; i < noise.GetSize(); ++i)
+    noise[i] = (short)((int)(rand.Generate()%16000) - 8000);
+  OpalDTMFDetector detector;
+  bool noiseRejected = detector.Decode((const short *)noise, noise.GetSize()).IsEmpty();
+  cout << "  " << setw(20) << left << "noise" << right << (noiseRejected ? "rejected" : "detected") << endl;
+
+  cout << "  " << (allPassed && noiseRejected ? "PASSED" : "FAILED") << endl;
+
+  // 20ms frames, of tone and of noise
+  PINDEX samples = OpalDTMFDetector::SampleRate/50;
+  PShortArray tone;
+  FillDTMF(tone, '5', 0);
+
+  volatile PINDEX sink = 0;
+  PTimeInterval start = PTimer::Tick();
+  for (unsigned it = 0; it < iterations; ++it)
+    sink += detector.Decode((const short *)tone, samples).GetLength();
+  OutputFrameCost("tone", iterations, samples, PTimer::Tick() - start);
+
+  start = PTimer::Tick();
+  for (unsigned it = 0; it < iterations; ++it)
+    sink += detector.Decode((const short *)noise, samples).GetLength();
+  OutputFrameCost("noise", iterations, samples, PTimer::Tick() - start);
+}
+#endif // OPAL_DTMF_DETECT
+
+
+#if OPAL_VIDEO
+static void OutputThroughput(const char * operation, unsigned iterations, PINDEX bytes, const PTimeInterval & elapsed)
+{
+  double seconds = elapsed.GetMilliSeconds()/1000.0;
+  double total = (double)iterations*bytes;
+
+  cout << "  " << setw(20) << left << operation << right
+       << iterations << " frames in " << elapsed << "s";
+  if (seconds > 0)
+    cout << ", " << setprecision(4) << total*8/seconds/1e9 << " Gb/s, "
+         << setprecision(4) << seconds*1e6/iterations << " us/frame";
+  cout << endl;
+}
+
+
+static void BenchmarkVideo(OpalTranscoder & encoder, OpalTranscoder & decoder, const OpalMediaFormat & rawFormat,
+                           unsigned width, unsigned height, unsigned iterations)
+{
+  PINDEX frameBytes = PVideoFrameInfo::CalculateFrameBytes(width, height, rawFormat.GetName());
+  if (frameBytes == 0) {
+    cout << "Cannot benchmark raw format " << rawFormat << endl;
+    return;
+  }
+
+  RTP_DataFrame raw(sizeof(OpalVideoTranscoder::FrameHeader) + frameBytes);
+  OpalVideoTranscoder::FrameHeader * header = (OpalVideoTranscoder::FrameHeader *)raw.GetPayloadPtr();
+  header->x = header->y = 0;
+  header->width = width;
+  header->height = height;
+  BYTE * pixels = OpalVideoFrameDataPtr(header);
+  for (PINDEX i = 0; i < frameBytes; ++i)
+    pixels[i] = (BYTE)(i*7 + i/width);
+
+  cout << encoder.GetOutputFormat() << " <-> " << rawFormat << " at " << width << 'x' << height << ':' << endl;
+
+  // Same list every time, as OpalMediaPatch does, so frames may be recycled
+  RTP_DataFrameList encoded;
+  PTimeInterval start = PTimer::Tick();
+  for (unsigned it = 0; it < iterations; ++it)
+    encoder.ConvertFrames(raw, encoded);
+  OutputThroughput("packetise", iterations, frameBytes, PTimer::Tick() - start);
+
+  if (encoded.empty()) {
+    cout << "  Encoder produced no output." << endl;
+    return;
+  }
+  cout << "  " << setw(20) << ' ' << encoded.GetSize() << " packets per frame" << endl;
+
+  RTP_DataFrameList decoded;
+  unsigned decodedFrames = 0;
+  DWORD sequence = 0;
+  start = PTimer::Tick();
+  for (unsigned it = 0; it < iterations; ++it) {
+    for (RTP_DataFrameList::iterator packet = encoded.begin(); packet != encoded.end(); ++packet) {
+      // Look like a new video frame each time around, or decoder sees lost packets
+      packet->SetTimestamp(it*3000);
+      packet->SetSequenceNumber((WORD)sequence);
+      *(PUInt16b *)packet->GetPayloadPtr() = (WORD)(sequence >> 16);
+      ++sequence;
+      decoder.ConvertFrames(*packet, decoded);
+      decodedFrames += decoded.GetSize();
+    }
+  }
+  OutputThroughput("depacketise", iterations, frameBytes, PTimer::Tick() - start);
+
+  if (decodedFrames != iterations)
+    cout << "  Decoder produced " << decodedFrames << " frames, expected " << iterations << endl;
+  else if (memcmp(OpalVideoFrameDataPtr((const OpalVideoTranscoder::FrameHeader *)decoded.back().GetPayloadPtr()), pixels, frameBytes) != 0)
+    cout << "  Decoded frame does not match original!" << endl;
+}
+
+
+static void BenchmarkVideo(const OpalMediaFormat & mediaFormat, unsigned iterations)
+{
+  OpalMediaFormatList rawFormats = OpalTranscoder::GetDestinationFormats(mediaFormat);
+  if (rawFormats.IsEmpty()) {
+    cout << "No transcoders for " << mediaFormat << endl;
+    return;
+  }
+  OpalMediaFormat rawFormat = rawFormats[0];
+
+  // Frames are a lot bigger than audio packets, so scale the count down
+  iterations = std::max(iterations/100, 1U);
+
+  static const struct {
+    unsigned m_width;
+    unsigned m_height;
+  } Sizes[] = { { 1280, 720 }, { 1920, 1080 } };
+
+  for (PINDEX i = 0; i < PARRAYSIZE(Sizes); ++i) {
+    OpalTranscoder * encoder = OpalTranscoder::Create(rawFormat, mediaFormat);
+    OpalTranscoder * decoder = OpalTranscoder::Create(mediaFormat, rawFormat);
+    if (encoder != NULL && decoder != NULL)
+      BenchmarkVideo(*encoder, *decoder, rawFormat, Sizes[i].m_width, Sizes[i].m_height, iterations);
+    else
+      cout << "Could not create transcoders for " << mediaFormat << endl;
+
+    delete encoder;
+    delete decoder;
+  }
+}
+
+
+static void BenchmarkScaler(unsigned iterations)
+{
+  // Enlarge, reduce, and one axis each way, with widths not a multiple of the vector size
+  static const struct {
+    const char * m_name;
+    unsigned     m_srcWidth;
+    unsigned     m_srcHeight;
+    unsigned     m_dstWidth;
+    unsigned     m_dstHeight;
+  } Sizes[] = {
+    { "enlarge",          352,  288, 1280, 720 },
+    { "enlarge odd",      176,  144,  642, 362 },
+    { "reduce",          1920, 1080,  320, 180 },
+    { "reduce odd",      1920, 1080,  634, 358 },
+    { "wider/shorter",    640,  480, 1280, 240 },
+    { "narrower/taller", 1280,  240,  640, 480 }
+  };
+
+  cout << "YUV420P scaler:" << endl;
+
+  PRandom rand;
+  bool allPassed = true;
+  for (PINDEX s = 0; s < PARRAYSIZE(Sizes); ++s) {
+    unsigned srcWidth = Sizes[s].m_srcWidth;
+    unsigned srcHeight = Sizes[s].m_srcHeight;
+    unsigned dstWidth = Sizes[s].m_dstWidth;
+    unsigned dstHeight = Sizes[s].m_dstHeight;
+
+    PBYTEArray src(PVideoFrameInfo::CalculateFrameBytes(srcWidth, srcHeight));
+    for (PINDEX i = 0; i < src.GetSize(); ++i)
+      src[i] = (BYTE)rand.Generate();
+
+    PINDEX dstSize = PVideoFrameInfo::CalculateFrameBytes(dstWidth, dstHeight);
+    PBYTEArray simdOutput(dstSize), scalarOutput(dstSize);
+
+    OpalYUV420PScaler simdScaler(true), scalarScaler(false);
+
+    cout << ' ' << Sizes[s].m_name << ' ' << srcWidth << 'x' << srcHeight << " to " << dstWidth << 'x' << dstHeight << ':' << endl;
+
+    PTimeInterval start = PTimer::Tick();
+    for (unsigned it = 0; it < iterations; ++it)
+      scalarScaler.Scale(srcWidth, srcHeight, src, dstWidth, dstHeight, scalarOutput.GetPointer());
+    OutputThroughput("scalar", iterations, dstSize, PTimer::Tick() - start);
+
+    start = PTimer::Tick();
+    for (unsigned it = 0; it < iterations; ++it)
+      simdScaler.Scale(srcWidth, srcHeight, src, dstWidth, dstHeight, simdOutput.GetPointer());
+    OutputThroughput("vector", iterations, dstSize, PTimer::Tick() - start);
+
+    // Vector and scalar code must give identical results, not just similar
+    PINDEX mismatch = 0;
+    while (mismatch < dstSize && simdOutput[mismatch] == scalarOutput[mismatch])
+      ++mismatch;
+    if (mismatch == dstSize)
+      cout << "  " << setw(20) << ' ' << "identical output" << endl;
+    else {
+      cout << "  " << setw(20) << ' ' << "output differs at byte " << mismatch << endl;
+      allPassed = false;
+    }
+  }
+
+  cout << "  " << (allPassed ? "PASSED" : "FAILED") << endl;
+}
+#endif // OPAL_VIDEO
+
+
+void CodecTest::Benchmark(PArgList & args)
+{
+  unsigned iterations = args.GetOptionString("count", "10000").AsUnsigned();
+  if (iterations == 0)
+    iterations = 1;
+
+  for (PINDEX i = 0; i < args.GetCount(); ++i) {
+    if (args[i] *= "silence") {
+      BenchmarkSilenceDetector(iterations);
+      continue;
+    }
+
+#if OPAL_AEC
+    if (args[i] *= "echo") {
+      BenchmarkEchoCanceler(iterations);
+      continue;
+    }
+#endif
+
+#if OPAL_VIDEO
+    if (args[i] *= "scale") {
+      BenchmarkScaler(iterations);
+      continue;
+    }
+#endif
+
+#if OPAL_DTMF_DETECT
+    if (args[i] *= "dtmf") {
+      BenchmarkDTMFDetector(iterations);
+      continue;
+    }
+#endif
+
+    OpalMediaFormat mediaFormat = args[i];
+    if (mediaFormat.IsEmpty())
+      cout << "Unknown media format name \"" << args[i] << '"' << endl;
+    else if (mediaFormat.GetMediaType() == OpalMediaType::Audio())
+      BenchmarkAudio(mediaFormat, iterations);
+#if OPAL_VIDEO
+    else if (mediaFormat.GetMediaType() == OpalMediaType::Video())
+      BenchmarkVideo(mediaFormat, iterations);
+#endif
+    else
+      cout << "No benchmark available for " << mediaFormat << endl;
+  }
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
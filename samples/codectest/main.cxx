@@ -93,11 +93,16 @@ void CodecTest::Main()
              "i-info. display per-frame info (use multiple times for more info)\n"
              "-pcap: save encoded packets in a PCAP file\n"
              "-list. list all available plugin codecs\n"
+             "-benchmark. run micro-benchmarks of the named formats (video at 720p and 1080p), \"silence\", \"echo\", \"dtmf\" or \"scale\" (see --count)\n"
+             "-throughput. run multi-threaded throughput test of named, or all, codecs\n"
+             "-threads: maximum number of threads for --throughput, default is CPU count\n"
+             "-input: WAV or YUV file used as --throughput input, default is synthetic\n"
+             "-output: file for --throughput CSV results, default is stdout\n"
              PTRACE_ARGLIST
              "h-help. print this help message.\n"
              , false);
   if (!args.IsParsed() || args.HasOption('h') ||
-              (args.GetCount() == 0 && !args.HasOption("list"))) {
+              (args.GetCount() == 0 && !args.HasOption("list") && !args.HasOption("throughput"))) {
     cerr << "usage: " << GetFile().GetTitle() << " [ options ] fmtname [ fmtname ]\n"
               "  where fmtname is the Media Format Name for the codec(s) to test, up to two\n"
               "  formats (one audio and one video) may be specified.\n";
@@ -145,6 +150,16 @@ void CodecTest::Main()
     return;
   }
 
+  if (args.HasOption("benchmark")) {
+    Benchmark(args);
+    return;
+  }
+
+  if (args.HasOption("throughput")) {
+    Throughput(args);
+    return;
+  }
+
   g_infoCount = args.GetOptionCount('i');
 
   unsigned threadCount = args.GetOptionString('S').AsInteger();
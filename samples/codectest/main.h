@@ -194,6 +194,8 @@ class CodecTest : public PProcess
     ~CodecTest();
 
     virtual void Main();
+    void Benchmark(PArgList & args);
+    void Throughput(PArgList & args);
 
     class TestThreadInfo : public PObject
     {
@@ -0,0 +1,658 @@
+/*
+ * throughput.cxx
+ *
+ * OPAL application source file for testing codecs
+ *
+ * Multi-threaded codec throughput benchmark
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Portable Windows Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include "precompile.h"
+#include "main.h"
+
+#include <ptclib/random.h>
+#include <ptclib/pwavfile.h>
+#include <ptclib/pvidfile.h>
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+#include <stdlib.h>
+#include <math.h>
+
+
+/* Count C++ heap use, so we can report allocations per frame and memory
+   per transcoder instance. This is not possible when PTLib is doing its own
+   memory checking, so the columns are reported as -1. Note that anything a
+   plug in allocates with malloc() directly is not seen. */
+
+static atomic<uint64_t> s_allocationCount(0);
+static atomic<int64_t>  s_allocatedBytes(0);
+
+#if PMEMORY_CHECK
+
+static const bool CountingAllocations = false;
+
+#else
+
+static const bool CountingAllocations = true;
+
+union AllocationHeader
+{
+  size_t m_size;
+  double m_align;
+  void * m_alignPtr;
+  char   m_pad[16];
+};
+
+void * operator new(size_t size)
+{
+  AllocationHeader * hdr = (AllocationHeader *)malloc(size + sizeof(AllocationHeader));
+  if (hdr == NULL)
+    throw std::bad_alloc();
+  hdr->m_size = size;
+  ++s_allocationCount;
+  s_allocatedBytes += (int64_t)size;
+  return hdr + 1;
+}
+
+void * operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void * ptr) throw()
+{
+  if (ptr == NULL)
+    return;
+  AllocationHeader * hdr = (AllocationHeader *)ptr - 1;
+  s_allocatedBytes -= (int64_t)hdr->m_size;
+  free(hdr);
+}
+
+void operator delete[](void * ptr) throw()
+{
+  operator delete(ptr);
+}
+
+#endif // PMEMORY_CHECK
+
+
+typedef std::chrono::steady_clock BenchmarkClock;
+
+static int64_t ElapsedNanoSeconds(const BenchmarkClock::time_point & start)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(BenchmarkClock::now() - start).count();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+struct ThroughputInput
+{
+  ThroughputInput()
+    : m_frameTime(0)
+  {
+  }
+
+  PString                    m_source;
+  std::vector<RTP_DataFrame> m_frames;
+  unsigned                   m_frameTime;
+};
+
+
+struct ThroughputCodec
+{
+  OpalMediaFormat m_rawFormat;
+  OpalMediaFormat m_mediaFormat;
+};
+
+
+struct ThroughputResult
+{
+  ThroughputResult()
+    : m_frames(0)
+    , m_elapsed(0)
+  {
+  }
+
+  std::vector<int64_t> m_encodeTimes;
+  std::vector<int64_t> m_decodeTimes;
+  unsigned             m_frames;
+  int64_t              m_elapsed;
+  PString              m_error;
+};
+
+
+class ThroughputThread : public PThread
+{
+    PCLASSINFO(ThroughputThread, PThread);
+  public:
+    ThroughputThread(const ThroughputCodec & codec,
+                     const ThroughputInput & input,
+                     unsigned frames,
+                     PSemaphore & ready,
+                     PSemaphore & go,
+                     PSemaphore & done)
+      : PThread(5000, NoAutoDeleteThread, NormalPriority, "Throughput")
+      , m_codec(codec)
+      , m_input(input)
+      , m_framesToTranscode(frames)
+      , m_ready(ready)
+      , m_go(go)
+      , m_done(done)
+    {
+      Resume();
+    }
+
+    virtual void Main();
+
+    const ThroughputResult & GetResult() const { return m_result; }
+
+  protected:
+    void CopyFrame(RTP_DataFrame & source, unsigned index);
+    bool Transcode(OpalTranscoder & encoder,
+                   OpalTranscoder & decoder,
+                   RTP_DataFrame & source,
+                   RTP_DataFrameList & encoded,
+                   RTP_DataFrameList & decoded,
+                   int64_t * encodeTime,
+                   int64_t * decodeTime);
+
+    const ThroughputCodec & m_codec;
+    const ThroughputInput & m_input;
+    unsigned                m_framesToTranscode;
+    PSemaphore            & m_ready;
+    PSemaphore            & m_go;
+    PSemaphore            & m_done;
+    ThroughputResult        m_result;
+};
+
+
+void ThroughputThread::CopyFrame(RTP_DataFrame & source, unsigned index)
+{
+  // Copy the data rather than share the input frame, so no allocation in the loop
+  const RTP_DataFrame & frame = m_input.m_frames[index%m_input.m_frames.size()];
+  source.SetPayloadSize(frame.GetPayloadSize());
+  memcpy(source.GetPayloadPtr(), frame.GetPayloadPtr(), frame.GetPayloadSize());
+  source.SetMarker(frame.GetMarker());
+}
+
+
+bool ThroughputThread::Transcode(OpalTranscoder & encoder,
+                                 OpalTranscoder & decoder,
+                                 RTP_DataFrame & source,
+                                 RTP_DataFrameList & encoded,
+                                 RTP_DataFrameList & decoded,
+                                 int64_t * encodeTime,
+                                 int64_t * decodeTime)
+{
+  BenchmarkClock::time_point start = BenchmarkClock::now();
+  if (!encoder.ConvertFrames(source, encoded))
+    return false;
+  if (encodeTime != NULL)
+    *encodeTime = ElapsedNanoSeconds(start);
+
+  start = BenchmarkClock::now();
+  for (RTP_DataFrameList::iterator it = encoded.begin(); it != encoded.end(); ++it) {
+    if (!decoder.ConvertFrames(*it, decoded))
+      return false;
+  }
+  if (decodeTime != NULL)
+    *decodeTime = ElapsedNanoSeconds(start);
+
+  return true;
+}
+
+
+void ThroughputThread::Main()
+{
+  OpalTranscoder * encoder = OpalTranscoder::Create(m_codec.m_rawFormat, m_codec.m_mediaFormat);
+  OpalTranscoder * decoder = OpalTranscoder::Create(m_codec.m_mediaFormat, m_codec.m_rawFormat);
+
+  RTP_DataFrame source;
+  RTP_DataFrameList encoded, decoded;
+
+  if (encoder == NULL || decoder == NULL)
+    m_result.m_error = "Could not create transcoders";
+  else {
+    // All allocations we can do in advance, are, so they are not counted
+    m_result.m_encodeTimes.reserve(m_framesToTranscode);
+    m_result.m_decodeTimes.reserve(m_framesToTranscode);
+
+    // Warm up, codecs often do a lot on the first frame
+    CopyFrame(source, 0);
+    if (!Transcode(*encoder, *decoder, source, encoded, decoded, NULL, NULL))
+      m_result.m_error = "Transcoding failed";
+  }
+
+  m_ready.Signal();
+  m_go.Wait();
+
+  if (m_result.m_error.IsEmpty()) {
+    RTP_Timestamp timestamp = source.GetTimestamp();
+    BenchmarkClock::time_point start = BenchmarkClock::now();
+
+    for (unsigned i = 0; i < m_framesToTranscode; ++i) {
+      CopyFrame(source, i);
+      timestamp += m_input.m_frameTime;
+      source.SetTimestamp(timestamp);
+
+      int64_t encodeTime, decodeTime;
+      if (!Transcode(*encoder, *decoder, source, encoded, decoded, &encodeTime, &decodeTime)) {
+        m_result.m_error = "Transcoding failed";
+        break;
+      }
+
+      m_result.m_encodeTimes.push_back(encodeTime);
+      m_result.m_decodeTimes.push_back(decodeTime);
+      ++m_result.m_frames;
+    }
+
+    m_result.m_elapsed = ElapsedNanoSeconds(start);
+  }
+
+  m_done.Signal();
+
+  delete encoder;
+  delete decoder;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+static void MakeSyntheticAudio(ThroughputInput & input, const OpalMediaFormat & rawFormat, PINDEX frameBytes)
+{
+  // Five seconds of tone plus noise, VAD and silence detection will not kick in
+  unsigned clockRate = rawFormat.GetClockRate();
+  PINDEX samples = frameBytes/sizeof(short);
+  unsigned count = samples > 0 ? 5*clockRate/samples : 0;
+  if (count == 0)
+    count = 1;
+
+  PRandom rand;
+  unsigned t = 0;
+  input.m_source = "synthetic";
+  input.m_frameTime = samples;
+  input.m_frames.resize(count);
+  for (unsigned f = 0; f < count; ++f) {
+    RTP_DataFrame & frame = input.m_frames[f];
+    frame.SetPayloadSize(frameBytes);
+    short * pcm = (short *)frame.GetPayloadPtr();
+    for (PINDEX i = 0; i < samples; ++i, ++t)
+      pcm[i] = (short)(6000*sin(2*M_PI*440*t/clockRate) + 3000*sin(2*M_PI*1250*t/clockRate)
+                       + (int)(rand.Generate()%2000) - 1000);
+  }
+}
+
+
+static bool LoadAudio(ThroughputInput & input, const PFilePath & filename, const OpalMediaFormat & rawFormat, PINDEX frameBytes)
+{
+#if P_WAVFILE
+  if (filename.IsEmpty() || filename.GetType() != ".wav")
+    return false;
+
+  PWAVFile wav;
+  if (!wav.Open(filename, PFile::ReadOnly)) {
+    cerr << "Could not open WAV file \"" << filename << '"' << endl;
+    return false;
+  }
+
+  if (wav.GetSampleRate() != rawFormat.GetClockRate() || wav.GetChannels() != 1 || wav.GetSampleSize() != 16) {
+    cerr << "WAV file \"" << filename << "\" is not mono 16 bit at " << rawFormat.GetClockRate() << "Hz,"
+            " using synthetic input for " << rawFormat << endl;
+    return false;
+  }
+
+  input.m_source = filename.GetFileName();
+  input.m_frameTime = frameBytes/sizeof(short);
+
+  RTP_DataFrame frame;
+  frame.SetPayloadSize(frameBytes);
+  while (wav.Read(frame.GetPayloadPtr(), frameBytes) && wav.GetLastReadCount() == frameBytes)
+    input.m_frames.push_back(frame);
+
+  return !input.m_frames.empty();
+#else
+  return false;
+#endif
+}
+
+
+#if OPAL_VIDEO
+static RTP_DataFrame & AddVideoFrame(ThroughputInput & input, unsigned width, unsigned height)
+{
+  input.m_frames.push_back(RTP_DataFrame());
+  RTP_DataFrame & frame = input.m_frames.back();
+  frame.SetPayloadSize(PVideoFrameInfo::CalculateFrameBytes(width, height)+sizeof(OpalVideoTranscoder::FrameHeader));
+  frame.SetMarker(true);
+  OpalVideoTranscoder::FrameHeader * header = (OpalVideoTranscoder::FrameHeader *)frame.GetPayloadPtr();
+  header->x = header->y = 0;
+  header->width = width;
+  header->height = height;
+  return frame;
+}
+
+
+static void MakeSyntheticVideo(ThroughputInput & input, unsigned width, unsigned height)
+{
+  // A second of a moving gradient with a block and some noise, so motion estimation has work
+  static const unsigned FrameCount = 30;
+
+  PRandom rand;
+  input.m_source = "synthetic";
+  input.m_frameTime = OpalMediaFormat::VideoClockRate/FrameCount;
+  for (unsigned f = 0; f < FrameCount; ++f) {
+    RTP_DataFrame & frame = AddVideoFrame(input, width, height);
+    BYTE * y = OpalVideoFrameDataPtr((OpalVideoTranscoder::FrameHeader *)frame.GetPayloadPtr());
+    unsigned blockX = f*width/FrameCount;
+    for (unsigned row = 0; row < height; ++row) {
+      for (unsigned col = 0; col < width; ++col) {
+        bool inBlock = col >= blockX && col < blockX+width/8 && row >= height/3 && row < height/3+height/8;
+        *y++ = inBlock ? 235 : (BYTE)(((col + row + f*4) & 0xbf) + rand.Generate()%16);
+      }
+    }
+    unsigned chromaBytes = (width/2)*(height/2);
+    for (unsigned i = 0; i < chromaBytes; ++i) {
+      *y++ = (BYTE)(128 + (i/width + f)%32);
+      y[chromaBytes-1] = (BYTE)(128 - (i%width)%32);
+    }
+  }
+}
+
+
+static bool LoadVideo(ThroughputInput & input, const PFilePath & filename, unsigned & width, unsigned & height)
+{
+  if (filename.IsEmpty())
+    return false;
+
+  PAutoPtr<PVideoFile> file(PVideoFileFactory::CreateInstance(filename.GetType()));
+  if (file.get() == NULL)
+    return false;
+
+  if (!file->Open(filename, PFile::ReadOnly)) {
+    cerr << "Could not open video file \"" << filename << '"' << endl;
+    return false;
+  }
+
+  file->GetFrameSize(width, height);
+  input.m_source = filename.GetFileName();
+  input.m_frameTime = OpalMediaFormat::VideoClockRate/std::max(file->GetFrameRate(), 1U);
+
+  // Limit how much we keep in memory, we loop over them anyway
+  static const unsigned MaxFrames = 100;
+  while (input.m_frames.size() < MaxFrames) {
+    RTP_DataFrame & frame = AddVideoFrame(input, width, height);
+    if (!file->ReadFrame(OpalVideoFrameDataPtr((OpalVideoTranscoder::FrameHeader *)frame.GetPayloadPtr()))) {
+      input.m_frames.pop_back();
+      break;
+    }
+  }
+
+  return !input.m_frames.empty();
+}
+#endif // OPAL_VIDEO
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+static bool IsRawFormat(const OpalMediaFormat & mediaFormat)
+{
+  return mediaFormat.GetName().NumCompare(OPAL_PCM16) == PObject::EqualTo
+#if OPAL_VIDEO
+      || mediaFormat == OpalYUV420P
+#endif
+      ;
+}
+
+
+static void GetThroughputCodecs(PArgList & args, std::vector<ThroughputCodec> & codecs)
+{
+  // Named formats only, or everything that encodes from raw media and back again
+  OpalMediaFormatList mediaFormats;
+  if (args.GetCount() > 0) {
+    for (PINDEX i = 0; i < args.GetCount(); ++i) {
+      OpalMediaFormat mediaFormat = args[i];
+      if (mediaFormat.IsValid())
+        mediaFormats += mediaFormat;
+      else
+        cerr << "Unknown media format name \"" << args[i] << '"' << endl;
+    }
+  }
+
+  OpalTranscoderList keys = OpalTranscoderFactory::GetKeyList();
+  for (OpalTranscoderIterator it = keys.begin(); it != keys.end(); ++it) {
+    OpalMediaFormat rawFormat = it->first;
+    OpalMediaFormat mediaFormat = it->second;
+    if (!IsRawFormat(rawFormat) || IsRawFormat(mediaFormat))
+      continue;
+
+    if (!mediaFormats.IsEmpty() && mediaFormats.FindFormat(mediaFormat) == mediaFormats.end())
+      continue;
+
+    if (mediaFormat.GetMediaType() != OpalMediaType::Audio()
+#if OPAL_VIDEO
+        && mediaFormat.GetMediaType() != OpalMediaType::Video()
+#endif
+       )
+      continue;
+
+    if (std::find(keys.begin(), keys.end(), OpalTranscoderKey(it->second, it->first)) == keys.end())
+      continue; // Need a decoder as well
+
+    ThroughputCodec codec;
+    codec.m_rawFormat = rawFormat;
+    codec.m_mediaFormat = mediaFormat;
+    codecs.push_back(codec);
+  }
+}
+
+
+static int64_t Percentile(std::vector<int64_t> & times, unsigned percent)
+{
+  if (times.empty())
+    return 0;
+
+  std::vector<int64_t>::iterator nth = times.begin() + (times.size()-1)*percent/100;
+  std::nth_element(times.begin(), nth, times.end());
+  return *nth;
+}
+
+
+static void MeasureInstance(const ThroughputCodec & codec, const ThroughputInput & input, int64_t & encoderBytes, int64_t & decoderBytes)
+{
+  encoderBytes = decoderBytes = -1;
+  if (!CountingAllocations)
+    return;
+
+  // Includes a frame through each, as many codecs allocate lazily
+  RTP_DataFrame source = input.m_frames[0];
+  RTP_DataFrameList encoded, decoded;
+
+  int64_t base = s_allocatedBytes;
+  OpalTranscoder * encoder = OpalTranscoder::Create(codec.m_rawFormat, codec.m_mediaFormat);
+  if (encoder != NULL && encoder->ConvertFrames(source, encoded)) {
+    int64_t held = 0;
+    for (RTP_DataFrameList::iterator it = encoded.begin(); it != encoded.end(); ++it)
+      held += it->GetSize();
+    encoderBytes = s_allocatedBytes - base - held;
+
+    base = s_allocatedBytes;
+    OpalTranscoder * decoder = OpalTranscoder::Create(codec.m_mediaFormat, codec.m_rawFormat);
+    if (decoder != NULL) {
+      for (RTP_DataFrameList::iterator it = encoded.begin(); it != encoded.end(); ++it)
+        decoder->ConvertFrames(*it, decoded);
+      held = 0;
+      for (RTP_DataFrameList::iterator it = decoded.begin(); it != decoded.end(); ++it)
+        held += it->GetSize();
+      decoderBytes = s_allocatedBytes - base - held;
+    }
+    delete decoder;
+  }
+  delete encoder;
+}
+
+
+static bool PrepareInput(const ThroughputCodec & codec, const PFilePath & filename, unsigned width, unsigned height,
+                         ThroughputCodec & prepared, ThroughputInput & input)
+{
+  prepared = codec;
+
+#if OPAL_VIDEO
+  if (codec.m_mediaFormat.GetMediaType() == OpalMediaType::Video()) {
+    if (!LoadVideo(input, filename, width, height))
+      MakeSyntheticVideo(input, width, height);
+    prepared.m_mediaFormat.SetOptionInteger(OpalVideoFormat::FrameWidthOption(), width);
+    prepared.m_mediaFormat.SetOptionInteger(OpalVideoFormat::FrameHeightOption(), height);
+    prepared.m_mediaFormat.SetOptionInteger(OpalVideoFormat::MaxRxFrameWidthOption(), width);
+    prepared.m_mediaFormat.SetOptionInteger(OpalVideoFormat::MaxRxFrameHeightOption(), height);
+    prepared.m_mediaFormat.SetOptionInteger(OpalVideoFormat::FrameTimeOption(), input.m_frameTime);
+    prepared.m_mediaFormat.ToCustomisedOptions();
+    return true;
+  }
+#endif
+
+  OpalTranscoder * encoder = OpalTranscoder::Create(codec.m_rawFormat, codec.m_mediaFormat);
+  if (encoder == NULL)
+    return false;
+  PINDEX frameBytes = encoder->GetOptimalDataFrameSize(true);
+  delete encoder;
+
+  if (frameBytes <= 0)
+    return false;
+
+  if (!LoadAudio(input, filename, codec.m_rawFormat, frameBytes))
+    MakeSyntheticAudio(input, codec.m_rawFormat, frameBytes);
+  return true;
+}
+
+
+void CodecTest::Throughput(PArgList & args)
+{
+  unsigned maxThreads = args.GetOptionString("threads").AsUnsigned();
+  if (maxThreads == 0)
+    maxThreads = PThread::GetNumProcessors();
+  unsigned cpus = std::max(PThread::GetNumProcessors(), 1U);
+
+  unsigned frames = args.GetOptionString("count", "1000").AsUnsigned();
+  if (frames == 0)
+    frames = 1;
+
+  PFilePath inputFile = args.GetOptionString("input");
+
+  unsigned width = PVideoFrameInfo::CIFWidth, height = PVideoFrameInfo::CIFHeight;
+  if (args.HasOption("frame-size") && !PVideoFrameInfo::ParseSize(args.GetOptionString("frame-size"), width, height)) {
+    cerr << "Illegal video frame size \"" << args.GetOptionString("frame-size") << '"' << endl;
+    return;
+  }
+
+  PTextFile outputFile;
+  if (args.HasOption("output") && !outputFile.Open(args.GetOptionString("output"), PFile::WriteOnly)) {
+    cerr << "Could not open output file \"" << args.GetOptionString("output") << '"' << endl;
+    return;
+  }
+  ostream & output = outputFile.IsOpen() ? (ostream &)outputFile : cout;
+
+  std::vector<ThroughputCodec> codecs;
+  GetThroughputCodecs(args, codecs);
+  if (codecs.empty()) {
+    cerr << "No codecs to benchmark." << endl;
+    return;
+  }
+
+  // Times are in microseconds, memory in bytes, -1 is not available
+  output << "format,raw,media,input,threads,frames,elapsed_s,fps,fps_per_core,"
+            "encode_p50_us,encode_p99_us,decode_p50_us,decode_p99_us,"
+            "allocs_per_frame,encoder_bytes,decoder_bytes" << endl;
+
+  for (std::vector<ThroughputCodec>::iterator codec = codecs.begin(); codec != codecs.end(); ++codec) {
+    ThroughputCodec prepared;
+    ThroughputInput input;
+    if (!PrepareInput(*codec, inputFile, width, height, prepared, input)) {
+      cerr << "Could not prepare input for " << codec->m_mediaFormat << endl;
+      continue;
+    }
+
+    int64_t encoderBytes, decoderBytes;
+    MeasureInstance(prepared, input, encoderBytes, decoderBytes);
+
+    for (unsigned threads = 1; threads <= maxThreads; threads = threads < maxThreads && threads*2 > maxThreads ? maxThreads : threads*2) {
+      PSemaphore ready(0, threads), go(0, threads), done(0, threads);
+
+      PList<ThroughputThread> workers;
+      for (unsigned t = 0; t < threads; ++t)
+        workers.Append(new ThroughputThread(prepared, input, frames, ready, go, done));
+
+      for (unsigned t = 0; t < threads; ++t)
+        ready.Wait();
+
+      uint64_t allocations = s_allocationCount;
+      BenchmarkClock::time_point start = BenchmarkClock::now();
+      for (unsigned t = 0; t < threads; ++t)
+        go.Signal();
+      for (unsigned t = 0; t < threads; ++t)
+        done.Wait();
+      int64_t elapsed = ElapsedNanoSeconds(start);
+      allocations = s_allocationCount - allocations;
+
+      std::vector<int64_t> encodeTimes, decodeTimes;
+      unsigned totalFrames = 0;
+      PString error;
+      for (PList<ThroughputThread>::iterator it = workers.begin(); it != workers.end(); ++it) {
+        it->WaitForTermination();
+        const ThroughputResult & result = it->GetResult();
+        if (!result.m_error.IsEmpty())
+          error = result.m_error;
+        totalFrames += result.m_frames;
+        encodeTimes.insert(encodeTimes.end(), result.m_encodeTimes.begin(), result.m_encodeTimes.end());
+        decodeTimes.insert(decodeTimes.end(), result.m_decodeTimes.begin(), result.m_decodeTimes.end());
+      }
+
+      if (!error.IsEmpty()) {
+        cerr << error << " for " << codec->m_mediaFormat << endl;
+        break;
+      }
+
+      double seconds = elapsed/1e9;
+      double fps = seconds > 0 ? totalFrames/seconds : 0;
+      output << codec->m_mediaFormat << ','
+             << codec->m_rawFormat << ','
+             << codec->m_mediaFormat.GetMediaType() << ','
+             << input.m_source << ','
+             << threads << ','
+             << totalFrames << ','
+             << fixed << setprecision(3) << seconds << ','
+             << setprecision(1) << fps << ','
+             << fps/std::min(threads, cpus) << ','
+             << Percentile(encodeTimes, 50)/1000.0 << ','
+             << Percentile(encodeTimes, 99)/1000.0 << ','
+             << Percentile(decodeTimes, 50)/1000.0 << ','
+             << Percentile(decodeTimes, 99)/1000.0 << ','
+             << setprecision(2) << (CountingAllocations && totalFrames > 0 ? (double)allocations/totalFrames : -1.0) << ','
+             << encoderBytes << ','
+             << decoderBytes << endl;
+      output.unsetf(ios::floatfield);
+    }
+  }
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -0,0 +1,154 @@
+/*
+ * main.cxx
+ *
+ * OPAL application source file for media patch test
+ *
+ * Copyright (c) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ *
+ */
+
+#include <opal/manager.h>
+#include <opal/call.h>
+#include <opal/patch.h>
+#include <rtp/rtpep.h>
+#include <rtp/rtpconn.h>
+#include <rtp/rtp_session.h>
+
+
+class TestEndPoint : public OpalRTPEndPoint
+{
+    PCLASSINFO(TestEndPoint, OpalRTPEndPoint)
+  public:
+    TestEndPoint(OpalManager & manager)
+      : OpalRTPEndPoint(manager, "test", NoAttributes)
+    {
+    }
+
+    virtual PSafePtr<OpalConnection> MakeConnection(OpalCall &, const PString &, void *, unsigned, OpalConnection::StringOptions *)
+    {
+      return NULL;
+    }
+};
+
+
+class TestConnection : public OpalRTPConnection
+{
+    PCLASSINFO(TestConnection, OpalRTPConnection)
+  public:
+    TestConnection(OpalCall & call, TestEndPoint & endpoint)
+      : OpalRTPConnection(call, endpoint, "test")
+    {
+    }
+
+    virtual PBoolean IsNetworkConnection() const { return true; }
+};
+
+
+class Test : public PProcess
+{
+    PCLASSINFO(Test, PProcess)
+  public:
+    Test();
+
+    virtual void Main();
+};
+
+
+PCREATE_PROCESS(Test);
+
+
+Test::Test()
+  : PProcess("Open Phone Abstraction Library", "Patch Test", OPAL_MAJOR, OPAL_MINOR, ReleaseCode, OPAL_PATCH, false, false, OPAL_OEM)
+{
+}
+
+
+static bool Check(bool ok, const char * what)
+{
+  cout << what << ": " << (ok ? "PASSED" : "FAILED") << endl;
+  return ok;
+}
+
+
+void Test::Main()
+{
+  PArgList & args = GetArguments();
+  args.Parse("[Options:]"
+             PTRACE_ARGLIST
+             "h-help."
+             , false);
+  if (!args.IsParsed()|| args.HasOption('h')) {
+    args.Usage(cerr, "[ options ]");
+    return;
+  }
+
+  PTRACE_INITIALISE(args);
+
+  OpalManager manager;
+  TestEndPoint * endpoint = new TestEndPoint(manager);
+  PSafePtr<OpalCall> call = new OpalCall(manager);
+  PSafePtr<TestConnection> connection = new TestConnection(*call, *endpoint);
+
+  OpalRTPSession * session1 = new OpalRTPSession(OpalMediaSession::Init(*connection, 1, OpalMediaType::Audio(), false));
+  OpalRTPSession * session2 = new OpalRTPSession(OpalMediaSession::Init(*connection, 2, OpalMediaType::Audio(), false));
+
+  OpalMediaStreamPtr source = new OpalNullMediaStream(*connection, OpalPCM16, 1, true);
+  OpalMediaStreamPtr owner = new OpalRTPMediaStream(*connection, OpalG711_ULAW_64K, false, *session1);
+  OpalMediaStreamPtr sharer = new OpalRTPMediaStream(*connection, OpalG711_ULAW_64K, false, *session2);
+
+  PSafePtr<OpalMediaPatch> patch = new OpalMediaPatch(*source);
+  source->SetPatch(patch);
+
+  bool ok = Check(patch->AddSink(owner) && patch->AddSink(sharer), "Add sinks");
+
+  OpalTranscoder * ownerCodec = patch->GetAndLockSinkTranscoder(0);
+  patch->UnLockSinkTranscoder();
+  OpalTranscoder * sharerCodec = patch->GetAndLockSinkTranscoder(1);
+  patch->UnLockSinkTranscoder();
+  ok = Check(ownerCodec != NULL && ownerCodec == sharerCodec, "Encoder shared") && ok;
+
+  RTP_DataFrame::PayloadTypes payloadType = sharer->GetMediaFormat().GetPayloadType();
+
+  // Raw source format must not leak into the sharer
+  patch->UpdateMediaFormat(OpalPCM16);
+  ok = Check(sharer->GetMediaFormat() == OpalG711_ULAW_64K &&
+             sharer->GetMediaFormat().GetPayloadType() == payloadType, "Sharer keeps encoded format") && ok;
+
+  // Owner option change must reach the sharer
+  OpalMediaFormat newFormat = OpalG711_ULAW_64K;
+  newFormat.SetOptionInteger(OpalAudioFormat::TxFramesPerPacketOption(), 80);
+  patch->UpdateMediaFormat(newFormat);
+  ok = Check(owner->GetMediaFormat().GetOptionInteger(OpalAudioFormat::TxFramesPerPacketOption()) == 80, "Owner updated") && ok;
+  ok = Check(sharer->GetMediaFormat().GetOptionInteger(OpalAudioFormat::TxFramesPerPacketOption()) == 80 &&
+             sharer->GetMediaFormat().GetPayloadType() == payloadType, "Sharer updated") && ok;
+
+  patch->Close();
+  patch.SetNULL();
+  source.SetNULL();
+  owner.SetNULL();
+  sharer.SetNULL();
+  delete session1;
+  delete session2;
+
+  cout << (ok ? "PASSED" : "FAILED") << endl;
+  SetTerminationValue(ok ? 0 : 1);
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
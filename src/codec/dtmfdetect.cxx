@@ -0,0 +1,289 @@
+/*
+ * dtmfdetect.cxx
+ *
+ * In-band DTMF tone detection
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#include <ptlib.h>
+
+#ifdef __GNUC__
+#pragma implementation "dtmfdetect.h"
+#endif
+
+#include <opal_config.h>
+
+#include <codec/dtmfdetect.h>
+
+#if OPAL_DTMF_DETECT
+
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define OPAL_DTMF_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define OPAL_DTMF_NEON 1
+#endif
+
+#define new PNEW
+#define PTraceModule() "DTMF"
+
+
+static const char   DigitTable[4][4] = { { '1', '2', '3', 'A' },
+                                         { '4', '5', '6', 'B' },
+                                         { '7', '8', '9', 'C' },
+                                         { '*', '0', '#', 'D' } };
+
+static const float  MinToneAmplitude = 400;  // About -38dBov per tone
+static const float  NormalTwist      = 6.3f; // Row may be 8dB louder than column
+static const float  ReverseTwist     = 2.5f; // Column may be 4dB louder than row
+static const float  MinToneToTotal   = 0.5f; // Fraction of block energy in the two tones
+static const float  RelativePeak     = 4.0f; // Best row/column must be 6dB above the others
+static const double FrequencyOffset  = 0.05; // Off frequency check filters, +/-5% of nominal
+
+
+/* Goertzel coefficients, 2cos(2*pi*f/fs), rows then columns. These are the
+   exact frequencies rather than the nearest bin, the block being too short
+   for that to matter. There is a bank at the nominal frequencies, and banks
+   either side of it for checking a tone is not off frequency. */
+struct DTMFCoefficients
+{
+  float m_nominal[OpalDTMFDetector::NumFilters];
+  float m_low[OpalDTMFDetector::NumFilters];
+  float m_high[OpalDTMFDetector::NumFilters];
+
+  DTMFCoefficients()
+  {
+    static const double Frequencies[OpalDTMFDetector::NumFilters] = { 697, 770, 852, 941, 1209, 1336, 1477, 1633 };
+    for (PINDEX i = 0; i < OpalDTMFDetector::NumFilters; ++i) {
+      m_nominal[i] = Coefficient(Frequencies[i]);
+      m_low[i]     = Coefficient(Frequencies[i]*(1-FrequencyOffset));
+      m_high[i]    = Coefficient(Frequencies[i]*(1+FrequencyOffset));
+    }
+  }
+
+  static float Coefficient(double frequency)
+  {
+    return (float)(2*cos(2*3.14159265358979323846*frequency/OpalDTMFDetector::SampleRate));
+  }
+};
+
+static const DTMFCoefficients & GetCoefficients()
+{
+  static const DTMFCoefficients coefficients;
+  return coefficients;
+}
+
+
+/* Run the whole filter bank over a block, each filter being a SIMD lane:
+     s[n] = x[n] + c*s[n-1] - s[n-2]
+     energy = s[n-1]^2 + s[n-2]^2 - c*s[n-1]*s[n-2] */
+static void GoertzelBank(const short * samples, PINDEX count, const float * coeff, float * energy)
+{
+#if OPAL_DTMF_SSE2
+  __m128 c0 = _mm_loadu_ps(coeff);
+  __m128 c1 = _mm_loadu_ps(coeff + 4);
+  __m128 s1a = _mm_setzero_ps(), s2a = s1a, s1b = s1a, s2b = s1a;
+  for (PINDEX i = 0; i < count; ++i) {
+    __m128 x = _mm_set1_ps(samples[i]);
+    __m128 s0a = _mm_sub_ps(_mm_add_ps(x, _mm_mul_ps(c0, s1a)), s2a);
+    __m128 s0b = _mm_sub_ps(_mm_add_ps(x, _mm_mul_ps(c1, s1b)), s2b);
+    s2a = s1a; s1a = s0a;
+    s2b = s1b; s1b = s0b;
+  }
+  _mm_storeu_ps(energy,     _mm_sub_ps(_mm_add_ps(_mm_mul_ps(s1a, s1a), _mm_mul_ps(s2a, s2a)), _mm_mul_ps(_mm_mul_ps(c0, s1a), s2a)));
+  _mm_storeu_ps(energy + 4, _mm_sub_ps(_mm_add_ps(_mm_mul_ps(s1b, s1b), _mm_mul_ps(s2b, s2b)), _mm_mul_ps(_mm_mul_ps(c1, s1b), s2b)));
+#elif OPAL_DTMF_NEON
+  float32x4_t c0 = vld1q_f32(coeff);
+  float32x4_t c1 = vld1q_f32(coeff + 4);
+  float32x4_t s1a = vdupq_n_f32(0), s2a = s1a, s1b = s1a, s2b = s1a;
+  for (PINDEX i = 0; i < count; ++i) {
+    float32x4_t x = vdupq_n_f32(samples[i]);
+    float32x4_t s0a = vsubq_f32(vmlaq_f32(x, c0, s1a), s2a);
+    float32x4_t s0b = vsubq_f32(vmlaq_f32(x, c1, s1b), s2b);
+    s2a = s1a; s1a = s0a;
+    s2b = s1b; s1b = s0b;
+  }
+  vst1q_f32(energy,     vsubq_f32(vmlaq_f32(vmulq_f32(s1a, s1a), s2a, s2a), vmulq_f32(vmulq_f32(c0, s1a), s2a)));
+  vst1q_f32(energy + 4, vsubq_f32(vmlaq_f32(vmulq_f32(s1b, s1b), s2b, s2b), vmulq_f32(vmulq_f32(c1, s1b), s2b)));
+#else
+  // Inner loop over the filters, so compiler can vectorise
+  float s1[OpalDTMFDetector::NumFilters] = { 0 }, s2[OpalDTMFDetector::NumFilters] = { 0 };
+  for (PINDEX i = 0; i < count; ++i) {
+    float x = samples[i];
+    for (PINDEX f = 0; f < OpalDTMFDetector::NumFilters; ++f) {
+      float s0 = x + coeff[f]*s1[f] - s2[f];
+      s2[f] = s1[f];
+      s1[f] = s0;
+    }
+  }
+  for (PINDEX f = 0; f < OpalDTMFDetector::NumFilters; ++f)
+    energy[f] = s1[f]*s1[f] + s2[f]*s2[f] - coeff[f]*s1[f]*s2[f];
+#endif
+}
+
+
+static float BlockEnergy(const short * samples, PINDEX count)
+{
+  // Integer sum of squares, 102 full scale samples still fits in 64 bits easily
+  PInt64 sum = 0;
+  for (PINDEX i = 0; i < count; ++i)
+    sum += samples[i]*samples[i];
+  return (float)sum;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+OpalDTMFDetector::OpalDTMFDetector()
+  : m_silenceLevel(50)
+{
+  Reset();
+}
+
+
+void OpalDTMFDetector::Reset()
+{
+  m_blockCount = 0;
+  m_lastHit = '\0';
+  m_currentTone = '\0';
+}
+
+
+PString OpalDTMFDetector::Decode(const short * samples, PINDEX count, unsigned mult, unsigned div)
+{
+  PString tones;
+
+  float scale = div > 0 ? (float)mult/div : 1.0f;
+
+  while (count > 0) {
+    PINDEX copy = std::min(count, (PINDEX)BlockSize - m_blockCount);
+    memcpy(&m_block[m_blockCount], samples, copy*sizeof(short));
+    m_blockCount += copy;
+    samples += copy;
+    count -= copy;
+
+    if (m_blockCount == BlockSize) {
+      OnBlockResult(DetectBlock(scale), tones);
+      m_blockCount = 0;
+    }
+  }
+
+  return tones;
+}
+
+
+PString OpalDTMFDetector::Decode(const RTP_DataFrame & frame, unsigned mult, unsigned div)
+{
+  int level = frame.GetAudioLevel();
+  if (m_silenceLevel == 0 || level < 0 || level < (int)m_silenceLevel)
+    return Decode((const short *)frame.GetPayloadPtr(), frame.GetPayloadSize()/sizeof(short), mult, div);
+
+  // Flagged as silent, so the same as a block with no tone, without looking
+  PString tones;
+  m_blockCount = 0;
+  OnBlockResult('\0', tones);
+  OnBlockResult('\0', tones);
+  return tones;
+}
+
+
+char OpalDTMFDetector::DetectBlock(float scale)
+{
+  float scale2 = scale*scale;
+
+  // Cheap energy check first, most blocks of most calls stop here
+  float total = BlockEnergy(m_block, BlockSize)*scale2;
+  if (total < BlockSize*MinToneAmplitude*MinToneAmplitude)
+    return '\0';
+
+  const DTMFCoefficients & coefficients = GetCoefficients();
+
+  float energy[NumFilters];
+  GoertzelBank(m_block, BlockSize, coefficients.m_nominal, energy);
+
+  PINDEX row = 0, col = 4;
+  for (PINDEX i = 1; i < 4; ++i) {
+    if (energy[i] > energy[row])
+      row = i;
+    if (energy[i+4] > energy[col])
+      col = i+4;
+  }
+
+  float rowEnergy = energy[row]*scale2;
+  float colEnergy = energy[col]*scale2;
+
+  // Goertzel energy of a tone of amplitude A over N samples is (A*N/2)^2
+  static const float MinToneEnergy = (MinToneAmplitude*BlockSize/2)*(MinToneAmplitude*BlockSize/2);
+  if (rowEnergy < MinToneEnergy || colEnergy < MinToneEnergy)
+    return '\0';
+
+  if (colEnergy > rowEnergy*ReverseTwist || colEnergy*NormalTwist < rowEnergy)
+    return '\0';
+
+  // Off frequency tones, or speech, spread across adjacent filters
+  for (PINDEX i = 0; i < 4; ++i) {
+    if ((i != row && energy[i]*RelativePeak > energy[row]) || (i+4 != col && energy[i+4]*RelativePeak > energy[col]))
+      return '\0';
+  }
+
+  // Total energy of the two tones over the block is N/2 * sum of squares
+  if (rowEnergy + colEnergy < MinToneToTotal*total*BlockSize/2)
+    return '\0';
+
+  /* The relative peak check cannot tell a tone a few percent off from one
+     on frequency, they are all well inside the main lobe of the filter. So,
+     as this is now a candidate digit, run the banks 5% either side. A tone
+     more than 2.5% off is closer to one of those, and has more energy in
+     it than in the nominal filter. */
+  float low[NumFilters], high[NumFilters];
+  GoertzelBank(m_block, BlockSize, coefficients.m_low, low);
+  GoertzelBank(m_block, BlockSize, coefficients.m_high, high);
+  if (low[row] > energy[row] || high[row] > energy[row] || low[col] > energy[col] || high[col] > energy[col])
+    return '\0';
+
+  return DigitTable[row][col-4];
+}
+
+
+void OpalDTMFDetector::OnBlockResult(char hit, PString & tones)
+{
+  if (hit != '\0') {
+    if (hit == m_lastHit && hit != m_currentTone) {
+      m_currentTone = hit;
+      tones += hit;
+      PTRACE(4, "Detected tone '" << hit << '\'');
+    }
+  }
+  else if (m_lastHit == '\0')
+    m_currentTone = '\0';
+
+  m_lastHit = hit;
+}
+
+
+#endif // OPAL_DTMF_DETECT
+
+
+// End of File ///////////////////////////////////////////////////////////////
@@ -46,29 +46,32 @@ extern "C" {
 
 #include <codec/echocancel.h>
 
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define OPAL_AEC_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define OPAL_AEC_NEON 1
+#endif
+
 
 ///////////////////////////////////////////////////////////////////////////////
 
 OpalEchoCanceler::OpalEchoCanceler()
   : receiveHandler(PCREATE_NOTIFIER(ReceivedPacket))
   , sendHandler(PCREATE_NOTIFIER(SentPacket))
+  , clockRate(8000)
+  , echoState(NULL)
+  , preprocessState(NULL)
+  , m_echoRing(EchoRingSize)
+  , m_echoRingWrite(0)
+  , m_echoRingRead(0)
+  , m_blockSize(0)
+  , m_dcMean(0)
+  , m_dcAlpha(0)
 {
-  echoState = NULL;
-  preprocessState = NULL;
-
-  e_buf = NULL;
-  echo_buf = NULL;
-  ref_buf = NULL;
-  noise = NULL;
-
-  echo_chan = new PQueueChannel();
-  echo_chan->Open(10000);
-  echo_chan->SetReadTimeout(10);
-  echo_chan->SetWriteTimeout(10);
-
-  mean = 0;
-  clockRate = 8000;
-
   PTRACE(4, "Echo Canceler\tHandler created");
 }
 
@@ -76,27 +79,7 @@ OpalEchoCanceler::OpalEchoCanceler()
 OpalEchoCanceler::~OpalEchoCanceler()
 {
   PWaitAndSignal m(stateMutex);
-  if (echoState) {
-    speex_echo_state_destroy(echoState);
-    echoState = NULL;
-  }
-  
-  if (preprocessState) {
-    speex_preprocess_state_destroy(preprocessState);
-    preprocessState = NULL;
-  }
-
-  if (ref_buf)
-    free(ref_buf);
-  if (e_buf)
-    free(e_buf);
-  if (echo_buf)
-    free(echo_buf);
-  if (noise)
-    free(noise);
-  
-  echo_chan->Close();
-  delete(echo_chan);
+  InternalDestroyState();
 }
 
 
@@ -104,100 +87,198 @@ void OpalEchoCanceler::SetParameters(const Params& newParam)
 {
   PWaitAndSignal m(stateMutex);
   param = newParam;
+  InternalDestroyState();
+}
+
+
+void OpalEchoCanceler::SetClockRate(const int rate)
+{
+  PWaitAndSignal m(stateMutex);
+  if (clockRate != rate) {
+    clockRate = rate;
+    InternalDestroyState();
+  }
+}
 
+
+void OpalEchoCanceler::InternalDestroyState()
+{
   if (echoState) {
     speex_echo_state_destroy(echoState);
     echoState = NULL;
   }
-  
+
   if (preprocessState) {
     speex_preprocess_state_destroy(preprocessState);
     preprocessState = NULL;
   }
+
+  m_blockSize = 0;
 }
 
 
-void OpalEchoCanceler::SetClockRate(const int rate)
+bool OpalEchoCanceler::InternalInitState(unsigned blockSize)
 {
-  clockRate = rate;
+  InternalDestroyState();
+
+  echoState = speex_echo_state_init(blockSize, param.m_duration);
+  preprocessState = speex_preprocess_state_init(blockSize, clockRate);
+  if (echoState == NULL || preprocessState == NULL) {
+    InternalDestroyState();
+    return false;
+  }
+
+  int dummy = 0;
+  speex_preprocess_ctl(preprocessState, SPEEX_PREPROCESS_SET_DENOISE, &dummy);
+
+  m_blockSize = blockSize;
+  m_captureBlock.resize(blockSize);
+  m_echoBlock.resize(blockSize);
+  m_noise.resize(blockSize+1);
+
+  // Same time constant as the original per sample 0.999 pole, applied per block
+  m_dcAlpha = (int32_t)((1.0 - pow(0.999, (double)blockSize))*32768 + 0.5);
+
+  PTRACE(4, "Echo Canceler\tState initialised: block=" << blockSize << ", rate=" << clockRate);
+  return true;
 }
 
 
-void OpalEchoCanceler::SentPacket(RTP_DataFrame& echo_frame, P_INT_PTR)
+void OpalEchoCanceler::AddEchoReference(const short * samples, PINDEX count)
 {
-  /* Write to the soundcard, and write the frame to the PQueueChannel */
-  if (param.m_enabled && echo_frame.GetPayloadSize() > 0)
-    echo_chan->Write(echo_frame.GetPayloadPtr(), echo_frame.GetPayloadSize());
+  unsigned write = m_echoRingWrite;
+  unsigned space = EchoRingSize - (write - (unsigned)m_echoRingRead);
+  if ((unsigned)count > space) {
+    // Capture side not keeping up, or not running, drop rather than block
+    PTRACE(5, "Echo Canceler\tReference buffer full, dropping " << count << " samples");
+    return;
+  }
+
+  unsigned offset = write & (EchoRingSize-1);
+  unsigned first = std::min((unsigned)count, EchoRingSize - offset);
+  memcpy(&m_echoRing[offset], samples, first*sizeof(short));
+  if (first < (unsigned)count)
+    memcpy(&m_echoRing[0], samples+first, (count-first)*sizeof(short));
+
+  m_echoRingWrite = write + count;
 }
 
 
-void OpalEchoCanceler::ReceivedPacket(RTP_DataFrame& input_frame, P_INT_PTR)
+void OpalEchoCanceler::InternalRemoveDC(const short * input, short * output, PINDEX count)
 {
-  if (!param.m_enabled || input_frame.GetPayloadSize() == 0)
-    return;
+  int32_t sum = 0;
+  PINDEX i = 0;
+
+#if OPAL_AEC_SSE2
+  const __m128i ones = _mm_set1_epi16(1);
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 8 <= count; i += 8)
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(input + i)), ones));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  sum = _mm_cvtsi128_si32(acc);
+#elif OPAL_AEC_NEON
+  int32x4_t acc = vdupq_n_s32(0);
+  for (; i + 8 <= count; i += 8)
+    acc = vpadalq_s16(acc, vld1q_s16(input + i));
+  sum = vgetq_lane_s32(acc, 0) + vgetq_lane_s32(acc, 1) + vgetq_lane_s32(acc, 2) + vgetq_lane_s32(acc, 3);
+#endif
+
+  for (; i < count; ++i)
+    sum += input[i];
+
+  // One pole low pass of the block average, in Q8, gives the DC offset
+  int32_t average = (int32_t)(((int64_t)sum << 8) / count);
+  m_dcMean += (int32_t)(((int64_t)(average - m_dcMean) * m_dcAlpha) >> 15);
+  short offset = (short)((m_dcMean + 128) >> 8);
+
+  i = 0;
+#if OPAL_AEC_SSE2
+  const __m128i dc = _mm_set1_epi16(offset);
+  for (; i + 8 <= count; i += 8)
+    _mm_storeu_si128((__m128i *)(output + i), _mm_subs_epi16(_mm_loadu_si128((const __m128i *)(input + i)), dc));
+#elif OPAL_AEC_NEON
+  const int16x8_t dc = vdupq_n_s16(offset);
+  for (; i + 8 <= count; i += 8)
+    vst1q_s16(output + i, vqsubq_s16(vld1q_s16(input + i), dc));
+#endif
+
+  for (; i < count; ++i) {
+    int value = input[i] - offset;
+    output[i] = (short)(value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+  }
+}
 
-  size_t inputSize = input_frame.GetPayloadSize(); // Size is in bytes
 
+void OpalEchoCanceler::CancelEcho(short * samples, PINDEX count)
+{
   PWaitAndSignal m(stateMutex);
 
-  if (echoState == NULL) 
-    echoState = speex_echo_state_init(inputSize/sizeof(short), param.m_duration);
+  /* Speex state is for a fixed block size, so use 10ms blocks and process
+     the frame as a number of them. Then a change in frame size, e.g. 20ms
+     to 30ms, does not need the state to be reinitialised, only frames that
+     are not a multiple of 10ms do. */
+  if (m_blockSize == 0 || count % m_blockSize != 0) {
+    unsigned blockSize = clockRate/100;
+    if (blockSize == 0 || count % blockSize != 0)
+      blockSize = count;
+    if (!InternalInitState(blockSize))
+      return;
+  }
 
-  if (preprocessState == NULL) { 
-    preprocessState = speex_preprocess_state_init(inputSize/sizeof(short), clockRate);
-    int dummy = 0;
-    speex_preprocess_ctl(preprocessState, SPEEX_PREPROCESS_SET_DENOISE, &dummy);
+  // If the reference has got too far ahead of the capture, discard the oldest
+  unsigned read = m_echoRingRead;
+  unsigned available = m_echoRingWrite - read;
+  if (available > EchoRingSize/2 && available > (unsigned)count) {
+    PTRACE(5, "Echo Canceler\tReference too far ahead, discarding " << (available - count) << " samples");
+    read += available - count;
   }
 
-  if (echo_buf == NULL)
-    echo_buf = (spx_int16_t *) malloc(inputSize);
-  if (noise == NULL)
+  for (PINDEX block = 0; block < count; block += m_blockSize) {
+    short * frame = samples + block;
+
+    InternalRemoveDC(frame, m_captureBlock.data(), m_blockSize);
+
+    if (m_echoRingWrite - read < m_blockSize) {
+      // Nothing to read from the speaker signal, only suppress the noise
+      speex_preprocess(preprocessState, m_captureBlock.data(), NULL);
+      memcpy(frame, m_captureBlock.data(), m_blockSize*sizeof(short));
+      continue;
+    }
+
+    unsigned offset = read & (EchoRingSize-1);
+    unsigned first = std::min(m_blockSize, EchoRingSize - offset);
+    memcpy(m_echoBlock.data(), &m_echoRing[offset], first*sizeof(short));
+    if (first < m_blockSize)
+      memcpy(m_echoBlock.data()+first, &m_echoRing[0], (m_blockSize-first)*sizeof(short));
+    read += m_blockSize;
+
+    // Cancel the echo, output straight into the frame, and suppress the noise
 #if OPAL_SPEEX_FLOAT_NOISE
-    noise = malloc((inputSize/sizeof(short)+1)*sizeof(float));
+    speex_echo_cancel(echoState, m_captureBlock.data(), m_echoBlock.data(), frame, (float *)m_noise.data());
+    speex_preprocess(preprocessState, frame, (float *)m_noise.data());
 #else
-    noise = malloc((inputSize/sizeof(short)+1)*sizeof(spx_int32_t));
+    speex_echo_cancel(echoState, m_captureBlock.data(), m_echoBlock.data(), frame, (spx_int32_t *)m_noise.data());
+    speex_preprocess(preprocessState, frame, (spx_int32_t *)m_noise.data());
 #endif
-  if (e_buf == NULL)
-    e_buf = (spx_int16_t *) malloc(inputSize);
-  if (ref_buf == NULL)
-    ref_buf = (spx_int16_t *) malloc(inputSize);
-
-  /* Remove the DC offset */
-  short *j = (short *) input_frame.GetPayloadPtr();
-  for (size_t i = 0 ; i < inputSize/sizeof(short) ; i++) {
-    mean = 0.999*mean + 0.001*j[i];
-    ((spx_int16_t *)ref_buf)[i] = j[i] - (short) mean;
   }
-  
-  /* Read from the PQueueChannel a reference echo frame of the size
-   * of the captured frame. */
-  if (!echo_chan->Read((short *) echo_buf, input_frame.GetPayloadSize())) {
-    
-    /* Nothing to read from the speaker signal, only suppress the noise
-     * and return.
-     */
-    speex_preprocess(preprocessState, (spx_int16_t *)ref_buf, NULL);
-    memcpy(input_frame.GetPayloadPtr(), (spx_int16_t *)ref_buf, input_frame.GetPayloadSize());
 
-    return;
-  }
-   
-  /* Cancel the echo in this frame */
-#if OPAL_SPEEX_FLOAT_NOISE
-  speex_echo_cancel(echoState, (short *)ref_buf, (short *)echo_buf, (short *)e_buf, (float *)noise);
-#else
-  speex_echo_cancel(echoState, (short *)ref_buf, (short *)echo_buf, (short *)e_buf, (spx_int32_t *)noise);
-#endif
-  
-  /* Suppress the noise */
-#if OPAL_SPEEX_FLOAT_NOISE
-  speex_preprocess(preprocessState, (spx_int16_t *)e_buf, (float *)noise);
-#else
-  speex_preprocess(preprocessState, (spx_int16_t *)e_buf, (spx_int32_t *)noise);
-#endif
+  m_echoRingRead = read;
+}
 
-  /* Use the result of the echo cancelation as capture frame */
-  memcpy(input_frame.GetPayloadPtr(), e_buf, input_frame.GetPayloadSize());
+
+void OpalEchoCanceler::SentPacket(RTP_DataFrame& echo_frame, P_INT_PTR)
+{
+  // Save the frame being written to the soundcard as the echo reference
+  if (param.m_enabled && echo_frame.GetPayloadSize() > 0)
+    AddEchoReference((const short *)echo_frame.GetPayloadPtr(), echo_frame.GetPayloadSize()/sizeof(short));
+}
+
+
+void OpalEchoCanceler::ReceivedPacket(RTP_DataFrame& input_frame, P_INT_PTR)
+{
+  if (param.m_enabled && input_frame.GetPayloadSize() > 0)
+    CancelEcho((short *)input_frame.GetPayloadPtr(), input_frame.GetPayloadSize()/sizeof(short));
 }
 
 
@@ -34,6 +34,10 @@
 
 #include <codec/g711codec.h>
 
+#if defined(__AVX2__)
+  #include <immintrin.h>
+#endif
+
 #define new PNEW
 
 extern "C" {
@@ -44,6 +48,71 @@ extern "C" {
 };
 
 
+///////////////////////////////////////////////////////////////////////////////
+
+/* Lookup tables built from the reference functions above, so the results are
+   bit exact with them. Encoding indexes on the full 16 bit sample, which is
+   64k per law, but removes all of the branching. Decode tables are int so
+   they can also be used with a SIMD gather. */
+struct G711Tables
+{
+  int  m_ulaw2linear[256];
+  int  m_alaw2linear[256];
+  BYTE m_linear2ulaw[65536];
+  BYTE m_linear2alaw[65536];
+
+  G711Tables()
+  {
+    for (int i = 0; i < 256; ++i) {
+      m_ulaw2linear[i] = ulaw2linear(i);
+      m_alaw2linear[i] = alaw2linear(i);
+    }
+    for (int i = 0; i < 65536; ++i) {
+      m_linear2ulaw[i] = (BYTE)linear2ulaw((short)i);
+      m_linear2alaw[i] = (BYTE)linear2alaw((short)i);
+    }
+  }
+};
+
+static const G711Tables & GetTables()
+{
+  static const G711Tables tables;
+  return tables;
+}
+
+
+static void DecodeBlock(const int * table, const BYTE * input, short * output, PINDEX samples)
+{
+  PINDEX i = 0;
+
+#if defined(__AVX2__)
+  for (; i+16 <= samples; i += 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)(input+i));
+    __m256i lo = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(bytes), 4);
+    __m256i hi = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), 4);
+    // Pack is per 128 bit lane, so need to put the 64 bit quarters back in order
+    _mm256_storeu_si256((__m256i *)(output+i), _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), 0xD8));
+  }
+#endif
+
+  for (; i < samples; ++i)
+    output[i] = (short)table[input[i]];
+}
+
+
+static void EncodeBlock(const BYTE * table, const short * input, BYTE * output, PINDEX samples)
+{
+  for (PINDEX i = 0; i < samples; ++i)
+    output[i] = table[(unsigned short)input[i]];
+}
+
+
+static inline bool IsSixteenBit(int sample)
+{
+  return sample >= SHRT_MIN && sample <= SHRT_MAX;
+}
+
+
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -96,13 +165,19 @@ Opal_G711_uLaw_PCM::Opal_G711_uLaw_PCM()
 
 int Opal_G711_uLaw_PCM::ConvertOne(int sample) const
 {
-  return ulaw2linear(sample);
+  return ConvertSample(sample);
+}
+
+
+void Opal_G711_uLaw_PCM::ConvertBlock(const BYTE * input, BYTE * output, PINDEX samples) const
+{
+  DecodeBlock(GetTables().m_ulaw2linear, input, (short *)output, samples);
 }
 
 
 int Opal_G711_uLaw_PCM::ConvertSample(int sample)
 {
-  return ulaw2linear(sample);
+  return GetTables().m_ulaw2linear[sample & 0xff];
 }
 
 
@@ -117,13 +192,19 @@ Opal_PCM_G711_uLaw::Opal_PCM_G711_uLaw()
 
 int Opal_PCM_G711_uLaw::ConvertOne(int sample) const
 {
-  return linear2ulaw(sample);
+  return ConvertSample(sample);
+}
+
+
+void Opal_PCM_G711_uLaw::ConvertBlock(const BYTE * input, BYTE * output, PINDEX samples) const
+{
+  EncodeBlock(GetTables().m_linear2ulaw, (const short *)input, output, samples);
 }
 
 
 int Opal_PCM_G711_uLaw::ConvertSample(int sample)
 {
-  return linear2ulaw(sample);
+  return IsSixteenBit(sample) ? GetTables().m_linear2ulaw[(unsigned short)sample] : linear2ulaw(sample);
 }
 
 
@@ -138,13 +219,19 @@ Opal_G711_ALaw_PCM::Opal_G711_ALaw_PCM()
 
 int Opal_G711_ALaw_PCM::ConvertOne(int sample) const
 {
-  return alaw2linear(sample);
+  return ConvertSample(sample);
+}
+
+
+void Opal_G711_ALaw_PCM::ConvertBlock(const BYTE * input, BYTE * output, PINDEX samples) const
+{
+  DecodeBlock(GetTables().m_alaw2linear, input, (short *)output, samples);
 }
 
 
 int Opal_G711_ALaw_PCM::ConvertSample(int sample)
 {
-  return alaw2linear(sample);
+  return GetTables().m_alaw2linear[sample & 0xff];
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -158,13 +245,19 @@ Opal_PCM_G711_ALaw::Opal_PCM_G711_ALaw()
 
 int Opal_PCM_G711_ALaw::ConvertOne(int sample) const
 {
-  return linear2alaw(sample);
+  return ConvertSample(sample);
+}
+
+
+void Opal_PCM_G711_ALaw::ConvertBlock(const BYTE * input, BYTE * output, PINDEX samples) const
+{
+  EncodeBlock(GetTables().m_linear2alaw, (const short *)input, output, samples);
 }
 
 
 int Opal_PCM_G711_ALaw::ConvertSample(int sample)
 {
-  return linear2alaw(sample);
+  return IsSixteenBit(sample) ? GetTables().m_linear2alaw[(unsigned short)sample] : linear2alaw(sample);
 }
 
 
@@ -596,6 +596,7 @@ OpalPluginTranscoder::OpalPluginTranscoder(const PluginCodec_Definition * defn,
   , freeOptionsControl(defn, PLUGINCODEC_CONTROL_FREE_CODEC_OPTIONS)
   , getOutputDataSizeControl(defn, PLUGINCODEC_CONTROL_GET_OUTPUT_DATA_SIZE)
   , getCodecStatistics(defn, PLUGINCODEC_CONTROL_GET_STATISTICS)
+  , resetCodecControl(defn, PLUGINCODEC_CONTROL_RESET_CODEC)
 {
 #if PTRACING
   m_firstLoggedUpdateOptions[true] = m_firstLoggedUpdateOptions[false] = true;
@@ -621,6 +622,16 @@ bool OpalPluginTranscoder::CreateContext()
 }
 
 
+bool OpalPluginTranscoder::ResetContext()
+{
+  if (context == NULL || resetCodecControl.Call((void *)NULL, (unsigned *)NULL, context) <= 0)
+    return false;
+
+  m_maxPayloadSize = PluginCodec_RTP_MaxPayloadSize;
+  return true;
+}
+
+
 bool OpalPluginTranscoder::UpdateOptions(OpalMediaFormat & fmt)
 {
   if (context == NULL)
@@ -938,6 +949,28 @@ bool OpalPluginVideoTranscoder::OnCreated(const OpalMediaFormat & srcFormat,
 }
 
 
+bool OpalPluginVideoTranscoder::OnReused(const OpalMediaFormat & srcFormat,
+                                         const OpalMediaFormat & destFormat,
+                                         const BYTE * instance, unsigned instanceLen)
+{
+  PWaitAndSignal mutex(updateMutex);
+
+  delete m_bufferRTP;
+  m_bufferRTP = NULL;
+  m_totalFrames = 0;
+  m_markersState = e_MarkersInitial;
+  m_lastPacketMarker = false;
+  m_currentFrameTimestamp = UINT_MAX;
+  m_lastPacketTimestamp = UINT_MAX;
+  m_lastMarkerTimestamp = UINT_MAX;
+#if PTRACING
+  m_consecutiveIntraFrames = 0;
+#endif
+
+  return OpalVideoTranscoder::OnReused(srcFormat, destFormat, instance, instanceLen);
+}
+
+
 PBoolean OpalPluginVideoTranscoder::UpdateMediaFormats(const OpalMediaFormat & input, const OpalMediaFormat & output)
 {
   PWaitAndSignal mutex(updateMutex);
@@ -1692,6 +1725,8 @@ void OpalPluginCodecManager::OnLoadPlugin(PDynaLink & dll, P_INT_PTR code)
   }
 
   delete handler;
+
+  OpalTranscoder::ClearSelectionCache();
 }
 
 void OpalPluginCodecManager::RegisterStaticCodec(
@@ -53,7 +53,7 @@ class OpalOpusFormatInternal : public OpalAudioFormatInternal
 #if OPAL_SDP
       OpalMediaOption * option;
 
-      option = new OpalMediaOptionBoolean(UseInBandFEC_OptionName, true, OpalMediaOption::AndMerge, DEFAULT_USE_DTX);
+      option = new OpalMediaOptionBoolean(UseInBandFEC_OptionName, true, OpalMediaOption::AndMerge, DEFAULT_USE_FEC);
       option->SetFMTP(UseInBandFEC_FMTPName, NULL);
       AddOption(option);
 
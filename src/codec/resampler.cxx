@@ -0,0 +1,250 @@
+/*
+ * resampler.cxx
+ *
+ * Polyphase sample rate conversion for linear PCM audio
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#include <ptlib.h>
+
+#ifdef __GNUC__
+#pragma implementation "resampler.h"
+#endif
+
+#include <opal_config.h>
+
+#include <codec/resampler.h>
+
+#include <math.h>
+
+#ifndef M_PI
+  #define M_PI 3.14159265358979323846
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define OPAL_RESAMPLER_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define OPAL_RESAMPLER_NEON 1
+#endif
+
+#define new PNEW
+#define PTraceModule() "Resampler"
+
+
+static const int    CoefficientBits = 14;
+static const double KaiserBeta      = 7.0;  // About 70dB stop band
+static const double CutOffRatio     = 0.9;  // Pass band edge as fraction of the lower Nyquist
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+static unsigned GreatestCommonDivisor(unsigned a, unsigned b)
+{
+  while (b != 0) {
+    unsigned t = a % b;
+    a = b;
+    b = t;
+  }
+  return a;
+}
+
+
+// Zeroth order modified Bessel function of the first kind, for Kaiser window
+static double BesselI0(double x)
+{
+  double sum = 1, term = 1;
+  for (int k = 1; k < 50 && term > sum*1e-12; ++k) {
+    double t = x/(2*k);
+    term *= t*t;
+    sum += term;
+  }
+  return sum;
+}
+
+
+/* Dot product of Q14 coefficients with samples, count is a multiple of 8.
+   The coefficients of a phase sum to one, so the accumulator cannot exceed
+   a few times 2^29 for any real filter and 32 bits is sufficient. */
+static int DotProductPCM16(const short * coeff, const short * pcm, unsigned count)
+{
+  int sum = 0;
+  unsigned i = 0;
+
+#if OPAL_RESAMPLER_SSE2
+  __m128i acc = _mm_setzero_si128();
+  for (; i + 8 <= count; i += 8)
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_loadu_si128((const __m128i *)(coeff + i)),
+                                            _mm_loadu_si128((const __m128i *)(pcm + i))));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  sum = _mm_cvtsi128_si32(acc);
+#elif OPAL_RESAMPLER_NEON
+  int32x4_t acc = vdupq_n_s32(0);
+  for (; i + 8 <= count; i += 8) {
+    int16x8_t c = vld1q_s16(coeff + i);
+    int16x8_t x = vld1q_s16(pcm + i);
+    acc = vmlal_s16(acc, vget_low_s16(c), vget_low_s16(x));
+    acc = vmlal_s16(acc, vget_high_s16(c), vget_high_s16(x));
+  }
+  sum = vgetq_lane_s32(acc, 0) + vgetq_lane_s32(acc, 1) + vgetq_lane_s32(acc, 2) + vgetq_lane_s32(acc, 3);
+#endif
+
+  for (; i < count; ++i)
+    sum += coeff[i]*pcm[i];
+
+  return sum;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+OpalPCMResampler::OpalPCMResampler(unsigned inputRate, unsigned outputRate)
+  : OpalTranscoder(GetOpalPCM16(inputRate), GetOpalPCM16(outputRate))
+  , m_inputRate(inputRate)
+  , m_outputRate(outputRate)
+{
+  unsigned gcd = GreatestCommonDivisor(inputRate, outputRate);
+  m_interpolation = outputRate/gcd;
+  m_decimation = inputRate/gcd;
+
+  // When decimating the filter must be proportionally longer in input samples
+  m_taps = TapsPerPhase*((m_decimation + m_interpolation - 1)/m_interpolation);
+
+  /* Design prototype low pass at the interpolated rate, cut off at the lower
+     of the two Nyquist frequencies, then split into m_interpolation phases. */
+  unsigned length = m_taps*m_interpolation;
+  double centre = (length - 1)/2.0;
+  double cutoff = CutOffRatio*0.5/std::max(m_interpolation, m_decimation);
+  double windowScale = 1/BesselI0(KaiserBeta);
+
+  std::vector<double> prototype(length);
+  for (unsigned n = 0; n < length; ++n) {
+    double x = n - centre;
+    double sinc = x == 0 ? 2*cutoff : sin(2*M_PI*cutoff*x)/(M_PI*x);
+    double r = x/centre;
+    prototype[n] = sinc*BesselI0(KaiserBeta*sqrt(std::max(0.0, 1 - r*r)))*windowScale;
+  }
+
+  // Each phase is normalised to unity DC gain, and time reversed for the dot product
+  m_coefficients.resize(length);
+  for (unsigned phase = 0; phase < m_interpolation; ++phase) {
+    double sum = 0;
+    for (unsigned k = 0; k < m_taps; ++k)
+      sum += prototype[phase + k*m_interpolation];
+
+    short * coeff = &m_coefficients[phase*m_taps];
+    int total = 0;
+    unsigned largest = 0;
+    for (unsigned k = 0; k < m_taps; ++k) {
+      unsigned j = m_taps - 1 - k;
+      coeff[j] = (short)floor(prototype[phase + k*m_interpolation]/sum*(1 << CoefficientBits) + 0.5);
+      total += coeff[j];
+      if (abs(coeff[j]) > abs(coeff[largest]))
+        largest = j;
+    }
+    coeff[largest] = (short)(coeff[largest] + (1 << CoefficientBits) - total);
+  }
+
+  Reset();
+
+  PTRACE(4, "Created " << inputRate << " to " << outputRate << " resampler,"
+            " L=" << m_interpolation << " M=" << m_decimation << " taps=" << m_taps);
+}
+
+
+PINDEX OpalPCMResampler::GetOptimalDataFrameSize(PBoolean input) const
+{
+  // As for OpalStreamedTranscoder, a "frame" is a millisecond of audio
+  PString framesPerPacketOption = input ? OpalAudioFormat::TxFramesPerPacketOption()
+                                        : OpalAudioFormat::RxFramesPerPacketOption();
+  PINDEX frames = outputMediaFormat.GetOptionInteger(framesPerPacketOption,
+                   inputMediaFormat.GetOptionInteger(framesPerPacketOption, 1));
+  if (frames < 1)
+    frames = 1;
+
+  return frames*(input ? m_inputRate : m_outputRate)/1000*sizeof(short);
+}
+
+
+PBoolean OpalPCMResampler::Convert(const RTP_DataFrame & input, RTP_DataFrame & output)
+{
+  PINDEX count = input.GetPayloadSize()/sizeof(short);
+  if (!output.SetPayloadSize(GetMaxOutputSamples(count)*sizeof(short)))
+    return false;
+
+  count = Resample((const short *)input.GetPayloadPtr(), count, (short *)output.GetPayloadPtr());
+  output.SetPayloadSize(count*sizeof(short));
+  return true;
+}
+
+
+bool OpalPCMResampler::Reset()
+{
+  m_history.assign(m_taps - 1, 0);
+  m_phase = (m_taps - 1)*m_interpolation;
+  return true;
+}
+
+
+PINDEX OpalPCMResampler::Resample(const short * input, PINDEX count, short * output)
+{
+  if (count <= 0)
+    return 0;
+
+  // Append to history so the filter can run straight through the join
+  size_t historySize = m_history.size();
+  m_history.resize(historySize + count);
+  memcpy(&m_history[historySize], input, count*sizeof(short));
+
+  const short * samples = &m_history[0];
+  size_t available = m_history.size();
+  const unsigned firstTap = m_taps - 1;
+  const int rounding = 1 << (CoefficientBits - 1);
+
+  PINDEX produced = 0;
+  unsigned position = m_phase;
+  for (;;) {
+    size_t newest = position/m_interpolation;
+    if (newest >= available)
+      break;
+
+    int sum = DotProductPCM16(&m_coefficients[(position%m_interpolation)*m_taps],
+                              samples + newest - firstTap, m_taps);
+    sum = (sum + rounding) >> CoefficientBits;
+    output[produced++] = (short)(sum < -32768 ? -32768 : (sum > 32767 ? 32767 : sum));
+
+    position += m_decimation;
+  }
+
+  // Keep the tail for next time, with position relative to its start
+  size_t consumed = available - firstTap;
+  memmove(&m_history[0], &m_history[consumed], firstTap*sizeof(short));
+  m_history.resize(firstTap);
+  m_phase = position - (unsigned)consumed*m_interpolation;
+
+  return produced;
+}
+
+
+// End of File ///////////////////////////////////////////////////////////////
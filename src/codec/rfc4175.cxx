@@ -40,6 +40,14 @@
 #include <codec/rfc4175.h>
 #include <codec/opalplugin.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define OPAL_RFC4175_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define OPAL_RFC4175_NEON 1
+#endif
+
 
 #define   FRAME_WIDTH   1920
 #define   FRAME_HEIGHT  1080
@@ -151,6 +159,126 @@ PINDEX OpalRFC4175Transcoder::RFC4175HeaderSize(PINDEX lines)
 
 /////////////////////////////////////////////////////////////////////////////
 
+/* Pack/unpack of YCbCr-4:2:0 pgroups: Y00 Y01 Y10 Y11 Cb Cr for each 2x2
+   block. The SIMD paths do eight pgroups (48 bytes) per iteration. */
+static void PackYCbCr420(BYTE * dst, const BYTE * y0, const BYTE * y1, const BYTE * cb, const BYTE * cr, PINDEX pgroups)
+{
+  PINDEX i = 0;
+
+#if OPAL_RFC4175_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i lowLane = _mm_set_epi32(0, 0, -1, -1);
+  for (; i + 8 <= pgroups; i += 8) {
+    // As 16 bit words, a[n] = two Y from row 0, b[n] = two from row 1, c[n] = Cb,Cr
+    __m128i a = _mm_loadu_si128((const __m128i *)(y0 + 2*i));
+    __m128i b = _mm_loadu_si128((const __m128i *)(y1 + 2*i));
+    __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(cb + i)), _mm_loadl_epi64((const __m128i *)(cr + i)));
+
+    // Each 64 bit lane becomes one pgroup in its low six bytes
+    __m128i ab0 = _mm_unpacklo_epi16(a, b);
+    __m128i ab1 = _mm_unpackhi_epi16(a, b);
+    __m128i c0 = _mm_unpacklo_epi16(c, zero);
+    __m128i c1 = _mm_unpackhi_epi16(c, zero);
+    __m128i q[4] = { _mm_unpacklo_epi32(ab0, c0), _mm_unpackhi_epi32(ab0, c0),
+                     _mm_unpacklo_epi32(ab1, c1), _mm_unpackhi_epi32(ab1, c1) };
+
+    // Close the two byte gap in each, giving two pgroups in the low 12 bytes
+    for (int n = 0; n < 4; ++n)
+      q[n] = _mm_or_si128(_mm_and_si128(q[n], lowLane), _mm_srli_si128(_mm_andnot_si128(lowLane, q[n]), 2));
+
+    __m128i * out = (__m128i *)(dst + 6*i);
+    _mm_storeu_si128(out,     _mm_or_si128(q[0], _mm_slli_si128(q[1], 12)));
+    _mm_storeu_si128(out + 1, _mm_or_si128(_mm_srli_si128(q[1], 4), _mm_slli_si128(q[2], 8)));
+    _mm_storeu_si128(out + 2, _mm_or_si128(_mm_srli_si128(q[2], 8), _mm_slli_si128(q[3], 4)));
+  }
+#elif OPAL_RFC4175_NEON
+  for (; i + 8 <= pgroups; i += 8) {
+    uint8x8x2_t c = vzip_u8(vld1_u8(cb + i), vld1_u8(cr + i));
+    uint16x8x3_t v;
+    v.val[0] = vreinterpretq_u16_u8(vld1q_u8(y0 + 2*i));
+    v.val[1] = vreinterpretq_u16_u8(vld1q_u8(y1 + 2*i));
+    v.val[2] = vreinterpretq_u16_u8(vcombine_u8(c.val[0], c.val[1]));
+    vst3q_u16((uint16_t *)(dst + 6*i), v);
+  }
+#endif
+
+  dst += 6*i;
+  for (; i < pgroups; ++i) {
+    *dst++ = y0[2*i];
+    *dst++ = y0[2*i+1];
+    *dst++ = y1[2*i];
+    *dst++ = y1[2*i+1];
+    *dst++ = cb[i];
+    *dst++ = cr[i];
+  }
+}
+
+
+static void UnpackYCbCr420(const BYTE * src, BYTE * y0, BYTE * y1, BYTE * cb, BYTE * cr, PINDEX pgroups)
+{
+  PINDEX i = 0;
+
+#if OPAL_RFC4175_SSE2
+  const __m128i lowSix = _mm_set_epi32(0, 0, 0xffff, -1);
+  const __m128i lowTwelve = _mm_set_epi32(0, -1, -1, -1);
+  const __m128i lowByte = _mm_set1_epi16(0xff);
+  for (; i + 8 <= pgroups; i += 8) {
+    const __m128i * in = (const __m128i *)(src + 6*i);
+    __m128i i0 = _mm_loadu_si128(in);
+    __m128i i1 = _mm_loadu_si128(in + 1);
+    __m128i i2 = _mm_loadu_si128(in + 2);
+
+    // Two pgroups in the low 12 bytes of each
+    __m128i q[4] = { _mm_and_si128(i0, lowTwelve),
+                     _mm_and_si128(_mm_or_si128(_mm_srli_si128(i0, 12), _mm_slli_si128(i1, 4)), lowTwelve),
+                     _mm_and_si128(_mm_or_si128(_mm_srli_si128(i1, 8), _mm_slli_si128(i2, 8)), lowTwelve),
+                     _mm_srli_si128(i2, 4) };
+
+    // Spread to one pgroup per 64 bit lane, then gather 32 bit Y words and 16 bit CbCr words
+    for (int n = 0; n < 4; ++n) {
+      q[n] = _mm_or_si128(_mm_and_si128(q[n], lowSix), _mm_slli_si128(_mm_and_si128(_mm_srli_si128(q[n], 6), lowSix), 8));
+      q[n] = _mm_shuffle_epi32(q[n], _MM_SHUFFLE(3, 1, 2, 0));
+    }
+    __m128i ab0 = _mm_unpacklo_epi64(q[0], q[1]);
+    __m128i ab1 = _mm_unpacklo_epi64(q[2], q[3]);
+    __m128i c0 = _mm_unpackhi_epi64(q[0], q[1]);
+    __m128i c1 = _mm_unpackhi_epi64(q[2], q[3]);
+
+    // Sign extending keeps the saturating pack exact
+    __m128i a = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(ab0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(ab1, 16), 16));
+    __m128i b = _mm_packs_epi32(_mm_srai_epi32(ab0, 16), _mm_srai_epi32(ab1, 16));
+    __m128i c = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(c0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(c1, 16), 16));
+
+    _mm_storeu_si128((__m128i *)(y0 + 2*i), a);
+    _mm_storeu_si128((__m128i *)(y1 + 2*i), b);
+    _mm_storel_epi64((__m128i *)(cb + i), _mm_packus_epi16(_mm_and_si128(c, lowByte), c));
+    _mm_storel_epi64((__m128i *)(cr + i), _mm_packus_epi16(_mm_srli_epi16(c, 8), c));
+  }
+#elif OPAL_RFC4175_NEON
+  for (; i + 8 <= pgroups; i += 8) {
+    uint16x8x3_t v = vld3q_u16((const uint16_t *)(src + 6*i));
+    vst1q_u8(y0 + 2*i, vreinterpretq_u8_u16(v.val[0]));
+    vst1q_u8(y1 + 2*i, vreinterpretq_u8_u16(v.val[1]));
+    uint8x16_t c = vreinterpretq_u8_u16(v.val[2]);
+    uint8x8x2_t u = vuzp_u8(vget_low_u8(c), vget_high_u8(c));
+    vst1_u8(cb + i, u.val[0]);
+    vst1_u8(cr + i, u.val[1]);
+  }
+#endif
+
+  src += 6*i;
+  for (; i < pgroups; ++i) {
+    y0[2*i]   = *src++;
+    y0[2*i+1] = *src++;
+    y1[2*i]   = *src++;
+    y1[2*i+1] = *src++;
+    cb[i]     = *src++;
+    cr[i]     = *src++;
+  }
+}
+
+/////////////////////////////////////////////////////////////////////////////
+
 OpalRFC4175Encoder::OpalRFC4175Encoder(      
   const OpalMediaFormat & inputMediaFormat,  ///<  Input media format
   const OpalMediaFormat & outputMediaFormat  ///<  Output media format
@@ -171,17 +299,17 @@ void OpalRFC4175Encoder::StartEncoding(const RTP_DataFrame &)
 
 bool OpalRFC4175Encoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFrameList & outputFrames)
 {
-  outputFrames.RemoveAll();
-
   // make sure the incoming frame is big enough for a frame header
   if (input.GetPayloadSize() < (int)(sizeof(PluginCodec_Video_FrameHeader))) {
     PTRACE(1,"RFC4175\tPayload of grabbed frame too small for frame header");
+    outputFrames.RemoveAll();
     return false;
   }
 
   PluginCodec_Video_FrameHeader * header = (PluginCodec_Video_FrameHeader *)input.GetPayloadPtr();
   if (header->x != 0 && header->y != 0) {
     PTRACE(1,"RFC4175\tVideo grab of partial frame unsupported");
+    outputFrames.RemoveAll();
     return false;
   }
 
@@ -192,24 +320,37 @@ bool OpalRFC4175Encoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
   // make sure the incoming frame is big enough for the specified frame size
   if (input.GetPayloadSize() < (PINDEX)(sizeof(PluginCodec_Video_FrameHeader) + PixelsToBytes(m_frameWidth*m_frameHeight))) {
     PTRACE(1,"RFC4175\tPayload of grabbed frame too small for full frame");
+    outputFrames.RemoveAll();
     return false;
   }
 
   m_srcTimestamp = input.GetTimestamp();
 
+  // use as much of the negotiated packet size as we can, fewer packets is cheaper all round
+  m_maximumPacketSize = RTP_DataFrame::MinHeaderSize +
+          outputMediaFormat.GetOptionInteger(OpalMediaFormat::MaxTxPacketSizeOption(),
+                                             REASONABLE_UDP_PACKET_SIZE - RTP_DataFrame::MinHeaderSize);
+
   StartEncoding(input);
 
-  // save pointer to output data
+  // re-use any frames from last time, rather than allocating every packet
   m_dstFrames = &outputFrames;
-  m_dstScanlineCounts.resize(0);
+  m_dstIterator = outputFrames.begin();
+  m_dstFrame = NULL;
+  m_dstFrameCount = 0;
 
   // encode the full frame
   EncodeFullFrame();
+  FinishOutputFrame();
+
+  while (outputFrames.GetSize() > m_dstFrameCount)
+    outputFrames.RemoveTail();
 
-  // grab the actual data
-  EndEncoding();
+  // set marker bit on last frame
+  if (m_dstFrame != NULL)
+    m_dstFrame->SetMarker(true);
 
-  PTRACE(6,"RFC4175\tFrame encoded to " << outputFrames.GetSize() << " packets from seq = " << outputFrames[0].GetSequenceNumber());
+  PTRACE_IF(6, !outputFrames.IsEmpty(), "RFC4175\tFrame encoded to " << outputFrames.GetSize() << " packets from seq = " << outputFrames[0].GetSequenceNumber());
 
   return true;
 }
@@ -232,7 +373,7 @@ void OpalRFC4175Encoder::EncodeScanLineSegment(PINDEX y, PINDEX offs, PINDEX wid
     PINDEX roomLeft = m_maximumPacketSize - m_dstPacketSize;
 
     // if current frame cannot hold at least one pgroup, then add a new frame
-    if ((m_dstFrames->GetSize() == 0) || (roomLeft < (PINDEX)(sizeof(ScanLineHeader) + GetPgroupSize()))) {
+    if ((m_dstFrame == NULL) || (roomLeft < (PINDEX)(sizeof(ScanLineHeader) + GetPgroupSize()))) {
       AddNewDstFrame();
       continue;
     }
@@ -272,29 +413,46 @@ void OpalRFC4175Encoder::AddNewDstFrame()
   // complete the previous output frame (if any)
   FinishOutputFrame();
 
-  // allocate a new output frame
-  RTP_DataFrame * frame = new RTP_DataFrame(m_maximumPacketSize - RTP_DataFrame::MinHeaderSize);
-  m_dstFrames->Append(frame);
+  PINDEX maxPayloadSize = m_maximumPacketSize - RTP_DataFrame::MinHeaderSize;
+
+  if (m_dstIterator != m_dstFrames->end()) {
+    // recycle a frame from the last video frame, clearing anything added downstream
+    m_dstFrame = &*m_dstIterator;
+    ++m_dstIterator;
+    m_dstFrame->SetExtension(false);
+    m_dstFrame->SetMarker(false);
+    m_dstFrame->SetPaddingSize(0);
+    m_dstFrame->SetPayloadSize(maxPayloadSize);
+  }
+  else {
+    m_dstFrame = new RTP_DataFrame(maxPayloadSize);
+    m_dstFrames->Append(m_dstFrame);
+  }
+  ++m_dstFrameCount;
 
   // initialise payload size for maximum size
-  frame->SetPayloadType(outputMediaFormat.GetPayloadType());
+  m_dstFrame->SetPayloadType(outputMediaFormat.GetPayloadType());
   // initialise current output scanline count;
   m_dstScanLineCount = 0;
-  m_dstPacketSize    = frame->GetHeaderSize() + 2;
-  m_dstScanLineTable = (ScanLineHeader *)(frame->GetPayloadPtr() + 2);
+  m_dstPacketSize    = m_dstFrame->GetHeaderSize() + 2;
+  m_dstScanLineTable = (ScanLineHeader *)(m_dstFrame->GetPayloadPtr() + 2);
 }
 
 void OpalRFC4175Encoder::FinishOutputFrame()
 {
-  if ((m_dstFrames->GetSize() > 0) && (m_dstScanLineCount > 0)) {
+  if ((m_dstFrame != NULL) && (m_dstScanLineCount > 0)) {
 
     // populate the frame fields
-    RTP_DataFrame & dst = m_dstFrames->back();
+    RTP_DataFrame & dst = *m_dstFrame;
 
     // set the end of scan line table bit
     --m_dstScanLineTable;
     m_dstScanLineTable->m_offset = ((WORD)m_dstScanLineTable->m_offset) & 0x7FFF;
 
+    // copy the pixel data while the table is still in cache
+    ScanLineHeader * table = (ScanLineHeader *)(dst.GetPayloadPtr() + 2);
+    EncodeScanLines(table, m_dstScanLineCount, (BYTE *)(table + m_dstScanLineCount));
+
     // set the timestamp and payload type
     dst.SetTimestamp(m_srcTimestamp);
     dst.SetPayloadType(outputMediaFormat.GetPayloadType());
@@ -307,8 +465,7 @@ void OpalRFC4175Encoder::FinishOutputFrame()
     // set actual payload size
     dst.SetPayloadSize(m_dstPacketSize - dst.GetHeaderSize());
 
-    // save scanline count
-    m_dstScanlineCounts.push_back(m_dstScanLineCount);
+    m_dstScanLineCount = 0;
   }
 }
 
@@ -319,18 +476,40 @@ OpalRFC4175Decoder::OpalRFC4175Decoder(
   const OpalMediaFormat & outputMediaFormat  ///<  Output media format
 ) : OpalRFC4175Transcoder(inputMediaFormat, outputMediaFormat)
 {
-  m_inputFrames.AllowDeleteObjects();
   m_first            = true;
   m_missingPackets   = false;
   m_maxWidth         = 0;
   m_maxHeight        = 0;
   m_frameWidth  = 0;
   m_frameHeight = 0;
+  m_outputFrame   = NULL;
+  m_outputWidth   = 0;
+  m_outputHeight  = 0;
+  m_outputPicture = NULL;
+  SetNegotiatedFrameSize();
 }
 
 
 OpalRFC4175Decoder::~OpalRFC4175Decoder()
 {
+  delete m_outputFrame;
+}
+
+
+bool OpalRFC4175Decoder::UpdateMediaFormats(const OpalMediaFormat & input, const OpalMediaFormat & output)
+{
+  if (!OpalRFC4175Transcoder::UpdateMediaFormats(input, output))
+    return false;
+
+  SetNegotiatedFrameSize();
+  return true;
+}
+
+
+void OpalRFC4175Decoder::SetNegotiatedFrameSize()
+{
+  m_negotiatedWidth  = inputMediaFormat.GetOptionInteger(OpalVideoFormat::FrameWidthOption());
+  m_negotiatedHeight = inputMediaFormat.GetOptionInteger(OpalVideoFormat::FrameHeightOption());
 }
 
 
@@ -361,14 +540,14 @@ bool OpalRFC4175Decoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
     // flush output and change to the new timestamp
     // and reset the sequence number to ignore packets for previous frames
     if (timestamp != m_timeStampOfFrame) {
-      if (m_inputFrames.GetSize() > 0) {
+      if (m_outputFrame != NULL) {
         if ((m_timeStampOfFrame > timestamp) && ((m_timeStampOfFrame - timestamp) < 1024)) {
           PTRACE(2, "RFC4175\tIgnoring packet with earlier timestamp");
           return true;
         }
         PTRACE(2, "RFC4175\tDetected lost marker bit");
         m_missingPackets = true;
-        DecodeFramesAndSetFrameSize(output);
+        FinishOutputFrame(output);
       }
       m_firstSequenceOfFrame = receivedSeqNo;
       m_timeStampOfFrame     = timestamp;
@@ -387,9 +566,12 @@ bool OpalRFC4175Decoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
 
   m_nextSequenceNumber = receivedSeqNo + 1;
 
-  // make a pass through the scan line table and update the overall frame width and height
+  // make a pass through the scan line table to get the extent of this packet
   PINDEX lineCount = 0;
-  ScanLineHeader * scanLinePtr = (ScanLineHeader *)(input.GetPayloadPtr() + 2);
+  PINDEX dataSize = 0;
+  PINDEX packetWidth = 0;
+  PINDEX packetHeight = 0;
+  const ScanLineHeader * scanLinePtr = (const ScanLineHeader *)(input.GetPayloadPtr() + 2);
 
   bool lastLine = false;
   while (!lastLine && RFC4175HeaderSize(lineCount+1) < input.GetPayloadSize()) {
@@ -411,11 +593,13 @@ bool OpalRFC4175Decoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
 
     // update frame width and height seen so far
     PINDEX right = offset + lineLength * GetColsPerPgroup();
-    if (right > m_maxWidth)
-      m_maxWidth = right;
+    if (right > packetWidth)
+      packetWidth = right;
     PINDEX bottom = lineNumber + GetRowsPerPgroup();
-    if (bottom > m_maxHeight)
-      m_maxHeight = bottom;
+    if (bottom > packetHeight)
+      packetHeight = bottom;
+
+    dataSize += lineLength * GetPgroupSize();
 
     // count lines
     ++lineCount;
@@ -424,35 +608,111 @@ bool OpalRFC4175Decoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
     ++scanLinePtr;
   }
 
-  // add the frame to the input frame list, if OK
-  m_inputFrames.Append(input.Clone());
-  m_scanlineCounts.push_back(lineCount);
+  if (RFC4175HeaderSize(lineCount) + dataSize > input.GetPayloadSize()) {
+    PTRACE(2, "RFC4175\tIgnoring packet with scan lines longer than payload");
+    m_missingPackets = true;
+  }
+  else if (lineCount > 0) {
+    if (packetWidth > m_maxWidth)
+      m_maxWidth = packetWidth;
+    if (packetHeight > m_maxHeight)
+      m_maxHeight = packetHeight;
+
+    /* Start with the last frame size, or the negotiated size for the first
+       frame, so the partial picture only needs moving to a bigger frame on
+       a change of size. If it still has to grow, double it, so moving the
+       picture is not repeated for every packet. */
+    PINDEX width, height;
+    if (m_outputFrame != NULL) {
+      width = m_outputWidth;
+      height = m_outputHeight;
+    }
+    else if (m_frameWidth > 0 && m_frameHeight > 0) {
+      width = m_frameWidth;
+      height = m_frameHeight;
+    }
+    else {
+      width = m_negotiatedWidth;
+      height = m_negotiatedHeight;
+    }
+    if (packetWidth > width)
+      width = std::max(packetWidth, width*2);
+    if (packetHeight > height)
+      height = std::max(packetHeight, height*2);
+    if (!PrepareOutputFrame(width, height))
+      return false;
+
+    DecodeScanLines((const ScanLineHeader *)(input.GetPayloadPtr() + 2), lineCount, input.GetPayloadPtr() + RFC4175HeaderSize(lineCount));
+  }
 
-  // if marker set, decode the frames
+  // if marker set, output the frame
   if (input.GetMarker()) 
-    DecodeFramesAndSetFrameSize(output);
+    FinishOutputFrame(output);
+
+  return true;
+}
+
+
+bool OpalRFC4175Decoder::PrepareOutputFrame(PINDEX width, PINDEX height)
+{
+  if (m_outputFrame != NULL && width == m_outputWidth && height == m_outputHeight)
+    return true;
+
+  RTP_DataFrame * frame = new RTP_DataFrame(sizeof(PluginCodec_Video_FrameHeader) + PixelsToBytes(width*height));
+  if (frame->GetPayloadSize() < (PINDEX)sizeof(PluginCodec_Video_FrameHeader)) {
+    PTRACE(1, "RFC4175\tCould not allocate " << width << 'x' << height << " frame");
+    delete frame;
+    return false;
+  }
+
+  frame->SetPayloadType(outputMediaFormat.GetPayloadType());
+
+  // get pointer to header and payload
+  PluginCodec_Video_FrameHeader * hdr = (PluginCodec_Video_FrameHeader *)frame->GetPayloadPtr();
+  hdr->x = 0;
+  hdr->y = 0;
+  hdr->width  = width;
+  hdr->height = height;
+
+  // keep anything already received, should only happen on a size change
+  if (m_outputFrame != NULL) {
+    PTRACE(4, "RFC4175\tMoving partial frame from " << m_outputWidth << 'x' << m_outputHeight << " to " << width << 'x' << height);
+    CopyPicture(m_outputPicture, m_outputWidth, m_outputHeight, OpalVideoFrameDataPtr(hdr), width, height);
+    delete m_outputFrame;
+  }
 
+  m_outputFrame   = frame;
+  m_outputWidth   = width;
+  m_outputHeight  = height;
+  m_outputPicture = OpalVideoFrameDataPtr(hdr);
   return true;
 }
 
 
-void OpalRFC4175Decoder::DecodeFramesAndSetFrameSize(RTP_DataFrameList & output)
+void OpalRFC4175Decoder::FinishOutputFrame(RTP_DataFrameList & output)
 {
   // update frame width and height if the frame was complete or if it is the first frame we have seen
   if (!m_missingPackets || ((m_frameWidth == 0) && (m_frameHeight == 0))) {
-    PTRACE(4, "RFC4175\tChanged received frame size from "
-           << m_frameWidth << 'x' << m_frameHeight << " to " << m_maxWidth << 'x' << m_maxHeight);
+    PTRACE_IF(4, m_frameWidth != m_maxWidth || m_frameHeight != m_maxHeight, "RFC4175\tChanged received frame size from "
+              << m_frameWidth << 'x' << m_frameHeight << " to " << m_maxWidth << 'x' << m_maxHeight);
     m_frameWidth  = m_maxWidth;
     m_frameHeight = m_maxHeight;
   }
 
-  DecodeFrames(output);
+  if (m_outputFrame == NULL)
+    PTRACE(2, "RFC4175\tNo input frames to decode");
+  else if (m_frameWidth > 0 && m_frameHeight > 0 && PrepareOutputFrame(m_frameWidth, m_frameHeight)) {
+    m_outputFrame->SetMarker(true);
+    output.Append(m_outputFrame);
+    m_outputFrame = NULL;
+  }
 
-  m_missingPackets   = false;
-  m_maxWidth         = 0;
-  m_maxHeight        = 0;
-  m_inputFrames.RemoveAll();
-  m_scanlineCounts.resize(0);
+  delete m_outputFrame;
+  m_outputFrame    = NULL;
+  m_outputPicture  = NULL;
+  m_missingPackets = false;
+  m_maxWidth       = 0;
+  m_maxHeight      = 0;
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -465,122 +725,70 @@ void Opal_YUV420P_to_RFC4175YCbCr420::StartEncoding(const RTP_DataFrame & input)
   m_srcCrPlane   = m_srcCbPlane + (m_frameWidth * m_frameHeight / 4);
 }
 
-void Opal_YUV420P_to_RFC4175YCbCr420::EndEncoding()
+void Opal_YUV420P_to_RFC4175YCbCr420::EncodeScanLines(const ScanLineHeader * table, PINDEX count, BYTE * data)
 {
-  FinishOutputFrame();
+  for (PINDEX i = 0; i < count; ++i) {
+    const ScanLineHeader & hdr = table[i];
 
-  PTRACE(6, "RFC4175\tEncoded YUV420P input frame to " << m_dstFrames->GetSize() << " RFC4175 output frames in YCbCr420 format");
-
-  PINDEX f= 0;
-  for (RTP_DataFrameList::iterator output = m_dstFrames->begin(); output != m_dstFrames->end(); ++output,++f) {
-    ScanLineHeader * hdrs = (ScanLineHeader *)(output->GetPayloadPtr() + 2);
-    BYTE * scanLineDataPtr = output->GetPayloadPtr() + 2 + m_dstScanlineCounts[f] * sizeof(ScanLineHeader);
-    for (PINDEX i = 0; i < m_dstScanlineCounts[f]; ++i) {
-      ScanLineHeader & hdr = hdrs[i];
-
-      PINDEX x     = hdr.m_offset & 0x7fff;
-      PINDEX y     = hdr.m_y & 0x7fff;
-      unsigned len = (hdr.m_length / GetPgroupSize()) * GetColsPerPgroup();
-
-      BYTE * yPlane0  = m_srcYPlane  + (m_frameWidth * y + x);
-      BYTE * yPlane1  = yPlane0    + m_frameWidth;
-      BYTE * cbPlane  = m_srcCbPlane + (m_frameWidth * y / 4) + x / 2;
-      BYTE * crPlane  = m_srcCrPlane + (m_frameWidth * y / 4) + x / 2;
-
-      unsigned p;
-      for (p = 0; p < len; p += 2) {
-        *scanLineDataPtr++ = *yPlane0++;
-        *scanLineDataPtr++ = *yPlane0++;
-        *scanLineDataPtr++ = *yPlane1++;
-        *scanLineDataPtr++ = *yPlane1++;
-        *scanLineDataPtr++ = *cbPlane++;
-        *scanLineDataPtr++ = *crPlane++;
-      }
-    }
-  } 
+    PINDEX x       = hdr.m_offset & 0x7fff;
+    PINDEX y       = hdr.m_y & 0x7fff;
+    PINDEX pgroups = hdr.m_length / GetPgroupSize();
 
-  // set marker bit on last frame
-  if (m_dstFrames->GetSize() != 0) {
-    RTP_DataFrame & dst = m_dstFrames->back();
-    dst.SetMarker(true);
+    BYTE * yPlane0  = m_srcYPlane  + (m_frameWidth * y + x);
+    BYTE * cbPlane  = m_srcCbPlane + (m_frameWidth * y / 4) + x / 2;
+    BYTE * crPlane  = m_srcCrPlane + (m_frameWidth * y / 4) + x / 2;
+
+    PackYCbCr420(data, yPlane0, yPlane0 + m_frameWidth, cbPlane, crPlane, pgroups);
+    data += hdr.m_length;
   }
 }
 
 /////////////////////////////////////////////////////////////////////////////
 
-bool Opal_RFC4175YCbCr420_to_YUV420P::DecodeFrames(RTP_DataFrameList & output)
+void Opal_RFC4175YCbCr420_to_YUV420P::DecodeScanLines(const ScanLineHeader * table, PINDEX count, const BYTE * data)
 {
-  if (m_inputFrames.GetSize() == 0) {
-    PTRACE(2, "RFC4175\tNo input frames to decode");
-    return false;
-  }
+  BYTE * dstYPlane  = m_outputPicture;
+  BYTE * dstCbPlane = dstYPlane  + (m_outputWidth * m_outputHeight);
+  BYTE * dstCrPlane = dstCbPlane + (m_outputWidth * m_outputHeight / 4);
 
-  PTRACE(6, "RFC4175\tDecoding output from " << m_inputFrames.GetSize() << " input frames");
+  for (PINDEX l = 0; l < count; ++l, ++table) {
+    // scan line length (in pgroups)
+    PINDEX pgroups = table->m_length / GetPgroupSize();
 
-  // allocate destination frame
-  output.Append(new RTP_DataFrame(sizeof(PluginCodec_Video_FrameHeader) + PixelsToBytes(m_frameWidth*m_frameHeight)));
-  RTP_DataFrame & outputFrame = output.back();
-  outputFrame.SetMarker(true);
-  outputFrame.SetPayloadType(outputMediaFormat.GetPayloadType());
+    // line number 
+    WORD y = table->m_y & 0x7fff; 
 
-  // get pointer to header and payload
-  PluginCodec_Video_FrameHeader * hdr = (PluginCodec_Video_FrameHeader *)outputFrame.GetPayloadPtr();
-  hdr->x = 0;
-  hdr->y = 0;
-  hdr->width  = m_frameWidth;
-  hdr->height = m_frameHeight;
-
-  BYTE * payload    = OpalVideoFrameDataPtr(hdr);
-  BYTE * dstYPlane  = payload;
-  BYTE * dstCbPlane = dstYPlane  + (m_frameWidth * m_frameHeight);
-  BYTE * dstCrPlane = dstCbPlane + (m_frameWidth * m_frameHeight / 4);
-
-  // pass through all of the input frames, and extract information
-  PINDEX f = 0;
-  for (RTP_DataFrameList::iterator source = m_inputFrames.begin(); source != m_inputFrames.end(); ++source,++f) {
-    // scan through table
-    PINDEX l;
-    ScanLineHeader * tablePtr = (ScanLineHeader *)(source->GetPayloadPtr() + 2);
-
-    BYTE * yuvData = source->GetPayloadPtr() + 2 + m_scanlineCounts[f] * sizeof(ScanLineHeader);
-
-    for (l = 0; l < m_scanlineCounts[f]; ++l) {
-
-      // scan line length (in pixels units)
-      PINDEX width = (tablePtr->m_length / GetPgroupSize()) * GetColsPerPgroup();
-
-      // line number 
-      WORD y = tablePtr->m_y & 0x7fff; 
-
-      // pixel offset of scanline start
-      WORD x = tablePtr->m_offset & 0x7fff;
-
-      ++tablePtr;
-
-      // only convert lines on even boundaries
-      if (
-          ((y & 1) == 0) 
-          ) {
-
-        BYTE * yPlane0 = dstYPlane  + y * m_frameWidth + x;
-        BYTE * yPlane1 = yPlane0    + m_frameWidth;
-        BYTE * cbPlane = dstCbPlane + (y * m_frameWidth / 4) + x / 2;
-        BYTE * crPlane = dstCrPlane + (y * m_frameWidth / 4) + x / 2;
-
-        PINDEX i;
-        for (i = 0; i < width; i += 2) {
-          *yPlane0++ = *yuvData++;
-          *yPlane0++ = *yuvData++;
-          *yPlane1++ = *yuvData++;
-          *yPlane1++ = *yuvData++;
-          *cbPlane++ = *yuvData++;
-          *crPlane++ = *yuvData++;
-        }
-      }
+    // pixel offset of scanline start
+    WORD x = table->m_offset & 0x7fff;
+
+    // only convert lines on even boundaries
+    if ((y & 1) == 0) {
+      BYTE * yPlane0 = dstYPlane  + y * m_outputWidth + x;
+      BYTE * cbPlane = dstCbPlane + (y * m_outputWidth / 4) + x / 2;
+      BYTE * crPlane = dstCrPlane + (y * m_outputWidth / 4) + x / 2;
+      UnpackYCbCr420(data, yPlane0, yPlane0 + m_outputWidth, cbPlane, crPlane, pgroups);
     }
+
+    data += pgroups * GetPgroupSize();
   }
+}
 
-  return true;
+
+void Opal_RFC4175YCbCr420_to_YUV420P::CopyPicture(const BYTE * src, PINDEX srcWidth, PINDEX srcHeight,
+                                                  BYTE * dst, PINDEX dstWidth, PINDEX dstHeight) const
+{
+  PINDEX width = std::min(srcWidth, dstWidth);
+  PINDEX height = std::min(srcHeight, dstHeight);
+
+  for (PINDEX y = 0; y < height; ++y)
+    memcpy(dst + y*dstWidth, src + y*srcWidth, width);
+
+  for (int plane = 0; plane < 2; ++plane) {
+    const BYTE * srcPlane = src + srcWidth*srcHeight + plane*(srcWidth*srcHeight/4);
+    BYTE * dstPlane = dst + dstWidth*dstHeight + plane*(dstWidth*dstHeight/4);
+    for (PINDEX y = 0; y < height/2; ++y)
+      memcpy(dstPlane + y*dstWidth/2, srcPlane + y*srcWidth/2, width/2);
+  }
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -591,89 +799,44 @@ void Opal_RGB24_to_RFC4175RGB::StartEncoding(const RTP_DataFrame & input)
   m_rgbBase = input.GetPayloadPtr() + sizeof(PluginCodec_Video_FrameHeader);
 }
 
-void Opal_RGB24_to_RFC4175RGB::EndEncoding()
+void Opal_RGB24_to_RFC4175RGB::EncodeScanLines(const ScanLineHeader * table, PINDEX count, BYTE * data)
 {
- FinishOutputFrame();
-
-  PTRACE(6, "RFC4175\tEncoded RGB24 input frame to " << m_dstFrames->GetSize() << " RFC4175 output frames in RGB format");
-
-  BYTE* inPtr = m_rgbBase;
-
-  PINDEX f = 0;
-  for (RTP_DataFrameList::iterator output = m_dstFrames->begin(); output != m_dstFrames->end(); ++output,++f) {
-    ScanLineHeader * hdrs = (ScanLineHeader *)(output->GetPayloadPtr() + 2);
-    BYTE * scanLineDataPtr = output->GetPayloadPtr() + 2 + m_dstScanlineCounts[f] * sizeof (ScanLineHeader);
-	
-    for (PINDEX i = 0; i < m_dstScanlineCounts[f]; ++i) {
-      ScanLineHeader & hdr = hdrs[i];
-
-      memcpy(scanLineDataPtr, inPtr, (int)hdr.m_length); 
-      scanLineDataPtr+= hdr.m_length;
-      inPtr += hdr.m_length; 
-    }
-  } 
-
-  // set marker bit on last frame
-  if (m_dstFrames->GetSize() != 0) {
-    RTP_DataFrame & dst = m_dstFrames->back();
-    dst.SetMarker(TRUE);
+  for (PINDEX i = 0; i < count; ++i) {
+    const ScanLineHeader & hdr = table[i];
+    PINDEX x = hdr.m_offset & 0x7fff;
+    PINDEX y = hdr.m_y & 0x7fff;
+    memcpy(data, m_rgbBase + (y * m_frameWidth + x) * 3, hdr.m_length);
+    data += hdr.m_length;
   }
 }
 
 /////////////////////////////////////////////////////////////////////////////
 
-bool Opal_RFC4175RGB_to_RGB24::DecodeFrames(RTP_DataFrameList & output)
+void Opal_RFC4175RGB_to_RGB24::DecodeScanLines(const ScanLineHeader * table, PINDEX count, const BYTE * data)
 {
-  if (m_inputFrames.GetSize() == 0) {
-    PTRACE(2, "RFC4175\tNo input frames to decode");
-    return false;
-  }
-
-  PTRACE(6, "RFC4175\tDecoding output from " << m_inputFrames.GetSize() << " input frames");
+  for (PINDEX l = 0; l < count; ++l, ++table) {
+    // scan line length
+    PINDEX length = (table->m_length / GetPgroupSize()) * GetPgroupSize();
 
-  // allocate destination frame
-  output.Append(new RTP_DataFrame(sizeof(PluginCodec_Video_FrameHeader) + PixelsToBytes(m_frameWidth*m_frameHeight)));
-  RTP_DataFrame & outputFrame = output.back();
-  outputFrame.SetMarker(true);
-
-  // get pointer to header and payload
-  PluginCodec_Video_FrameHeader * hdr = (PluginCodec_Video_FrameHeader *)outputFrame.GetPayloadPtr();
-  hdr->x = 0;
-  hdr->y = 0;
-  hdr->width  = m_frameWidth;
-  hdr->height = m_frameHeight;
-
-  BYTE * rgbDest = OpalVideoFrameDataPtr(hdr);
-
-  // pass through all of the input frames, and extract information
-  PINDEX f = 0;
-  for (RTP_DataFrameList::iterator source = m_inputFrames.begin(); source != m_inputFrames.end(); ++source,++f) {
-    // scan through table
-    PINDEX l;
-    ScanLineHeader * tablePtr = (ScanLineHeader *)(source->GetPayloadPtr() + 2);
-
-    BYTE * rgbSource = source->GetPayloadPtr() + 2 + m_scanlineCounts[f] * sizeof(ScanLineHeader);
-
-    for (l = 0; l < m_scanlineCounts[f]; ++l) {
-
-      // scan line length
-      PINDEX width = (tablePtr->m_length / GetPgroupSize()) * GetColsPerPgroup();
-
-      // line number 
-      WORD y = tablePtr->m_y & 0x7fff; 
-
-      // pixel offset of scanline start
-      WORD x = tablePtr->m_offset & 0x7fff;
-
-      ++tablePtr;
+    // line number 
+    WORD y = table->m_y & 0x7fff; 
 
-      memcpy(rgbDest + (y * m_frameWidth + x) * 3, rgbSource, width * 3);
+    // pixel offset of scanline start
+    WORD x = table->m_offset & 0x7fff;
 
-      rgbSource += width*3;
-    }
+    memcpy(m_outputPicture + (y * m_outputWidth + x) * 3, data, length);
+    data += length;
   }
+}
 
-  return true;
+
+void Opal_RFC4175RGB_to_RGB24::CopyPicture(const BYTE * src, PINDEX srcWidth, PINDEX srcHeight,
+                                           BYTE * dst, PINDEX dstWidth, PINDEX dstHeight) const
+{
+  PINDEX width = std::min(srcWidth, dstWidth);
+  PINDEX height = std::min(srcHeight, dstHeight);
+  for (PINDEX y = 0; y < height; ++y)
+    memcpy(dst + y*dstWidth*3, src + y*srcWidth*3, width*3);
 }
 
 #endif // OPAL_RFC4175
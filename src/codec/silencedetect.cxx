@@ -34,6 +34,16 @@
 #include <codec/silencedetect.h>
 #include <opal/patch.h>
 
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define OPAL_SILENCE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define OPAL_SILENCE_NEON 1
+#endif
+
 #define new PNEW
 #define PTraceModule() "Silence"
 
@@ -49,6 +59,8 @@ extern "C" {
 OpalSilenceDetector::OpalSilenceDetector(const Params & theParam)
   : m_receiveHandler(PCREATE_NOTIFIER(ReceivedPacket))
   , m_clockRate (8000)
+  , m_lastSignalLevel(0)
+  , m_lastAudioLevel(-1)
 {
   // Initialise the adaptive threshold variables.
   SetParameters(theParam);
@@ -167,7 +179,12 @@ OpalSilenceDetector::Result OpalSilenceDetector::GetResult(unsigned * currentThr
 
 void OpalSilenceDetector::ReceivedPacket(RTP_DataFrame & frame, P_INT_PTR)
 {
-  switch (Detect(frame.GetPayloadPtr(), frame.GetPayloadSize(), frame.GetTimestamp())) {
+  Result result = Detect(frame.GetPayloadPtr(), frame.GetPayloadSize(), frame.GetTimestamp());
+
+  // Pass on the level for the RFC 6464 header extension, encoders copy the meta data
+  frame.SetAudioLevel(m_lastAudioLevel, result != IsSilent);
+
+  switch (result) {
     case IsSilent :
       frame.SetPayloadSize(0); // Not in talk burst so silence the frame
       break;
@@ -188,6 +205,19 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
 
   PWaitAndSignal mutex(m_inUse);
 
+  // Average is absolute value up to 32767
+  unsigned rawSignalLevel = GetAverageSignalLevel(audioPtr, audioLen);
+
+  /* Audio level in -dBov as per RFC 6464, full scale is 32767. This uses the
+     average absolute value rather than RMS, which is close enough for the
+     purposes of comparing speakers. */
+  if (rawSignalLevel == UINT_MAX)
+    m_lastAudioLevel = -1;
+  else if (rawSignalLevel == 0)
+    m_lastAudioLevel = 127;
+  else
+    m_lastAudioLevel = std::min(127, std::max(0, (int)(-20.0*log10(rawSignalLevel/32767.0) + 0.5)));
+
   // Can never have silence if NoSilenceDetection
   if (m_mode == NoSilenceDetection)
     return m_lastResult;
@@ -200,19 +230,17 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
   unsigned timeSinceLastFrame = timestamp - m_lastTimestamp;
   m_lastTimestamp = timestamp;
 
-  // Average is absolute value up to 32767
-  unsigned rawSignalLevel = GetAverageSignalLevel(audioPtr, audioLen);
-
   // Can never have average signal level that high, this indicates that the
   // GetAverageSignalLevel (possibly hardware) cannot do energy calculation.
-  if (m_lastSignalLevel == UINT_MAX)
+  if (rawSignalLevel == UINT_MAX)
     return m_lastResult = VoiceActive;
 
   // Convert to a logarithmic scale - use uLaw which is complemented
   m_lastSignalLevel = linear2ulaw(rawSignalLevel) ^ 0xff;
 
-  // Now if signal level above threshold we are "talking"
-  bool haveSignal = m_lastSignalLevel > m_levelThreshold;
+  // Now if signal level above threshold, or sub-band analysis says so, we are "talking"
+  int subBandVoice = m_mode == SubBandSilenceDetection ? DetectSubBandVoice(audioPtr, audioLen) : -1;
+  bool haveSignal = subBandVoice >= 0 ? subBandVoice > 0 : m_lastSignalLevel > m_levelThreshold;
 
   // If no change ie still talking or still silent, reset frame counter
   if ((m_lastResult != IsSilent) == haveSignal) {
@@ -241,7 +269,7 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
     }
   }
 
-  if (m_mode == FixedSilenceDetection)
+  if (m_mode == FixedSilenceDetection || subBandVoice >= 0)
     return m_lastResult;
 
   // Adaptive silence detection
@@ -318,31 +346,132 @@ OpalSilenceDetector::Result OpalSilenceDetector::Detect(const BYTE * audioPtr, P
 }
 
 
+int OpalSilenceDetector::DetectSubBandVoice(const BYTE *, PINDEX)
+{
+  return -1;
+}
+
+
+static unsigned SumAbsolutePCM16(const short * pcm, PINDEX samples)
+{
+  unsigned sum = 0;
+  PINDEX i = 0;
+
+#if OPAL_SILENCE_SSE2
+  /* Eight samples at a time, the saturating subtract makes |-32768| = 32767
+     so it fits in 16 bits, then multiply-add by one sums adjacent pairs
+     into 32 bit lanes. */
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  __m128i acc = zero;
+  for (; i + 8 <= samples; i += 8) {
+    __m128i x = _mm_loadu_si128((const __m128i *)(pcm + i));
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(_mm_max_epi16(x, _mm_subs_epi16(zero, x)), ones));
+  }
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+  sum = (unsigned)_mm_cvtsi128_si32(acc);
+#elif OPAL_SILENCE_NEON
+  int32x4_t acc = vdupq_n_s32(0);
+  for (; i + 8 <= samples; i += 8)
+    acc = vpadalq_s16(acc, vqabsq_s16(vld1q_s16(pcm + i)));
+  sum = (unsigned)(vgetq_lane_s32(acc, 0) + vgetq_lane_s32(acc, 1) + vgetq_lane_s32(acc, 2) + vgetq_lane_s32(acc, 3));
+#endif
+
+  // Remainder, or everything if no SIMD, branch free so compiler can vectorise
+  for (; i < samples; ++i) {
+    int sample = pcm[i];
+    int sign = sample >> 31;
+    sum += (sample ^ sign) - sign;
+  }
+
+  return sum;
+}
+
+
 unsigned OpalSilenceDetector::GetAverageSignalLevelPCM16(const BYTE * buffer, PINDEX size, bool asPercentage)
 {
   // Calculate the average signal level of this frame
-  int sum = 0;
   PINDEX samples = size/2;
-  const short * pcm = (const short *)buffer;
-  const short * end = pcm + samples;
-  while (pcm != end) {
-    if (*pcm < 0)
-      sum -= *pcm++;
-    else
-      sum += *pcm++;
-  }
+  if (samples == 0)
+    return 0;
 
-  unsigned average = sum / samples;
+  unsigned average = SumAbsolutePCM16((const short *)buffer, samples) / samples;
   return asPercentage ? ((linear2ulaw(average) ^ 0xff) * 100 / 127) : average;
 }
 
 
 /////////////////////////////////////////////////////////////////////////////
 
+OpalPCM16SilenceDetector::OpalPCM16SilenceDetector(const Params & newParam)
+  : OpalSilenceDetector(newParam)
+{
+  memset(m_subBandNoise, 0, sizeof(m_subBandNoise));
+}
+
+
 unsigned OpalPCM16SilenceDetector::GetAverageSignalLevel(const BYTE * buffer, PINDEX size)
 {
   return GetAverageSignalLevelPCM16(buffer, size, false);
 }
 
 
+int OpalPCM16SilenceDetector::DetectSubBandVoice(const BYTE * buffer, PINDEX size)
+{
+  PINDEX quads = size/8;
+  if (quads == 0)
+    return -1;
+
+  /* Two level Haar decomposition, four samples at a time, giving the
+     average absolute value of 0..fs/8, fs/8..fs/4 and fs/4..fs/2 */
+  unsigned sum[NumSubBands] = { 0, 0, 0 };
+  const short * pcm = (const short *)buffer;
+  for (PINDEX i = 0; i < quads; ++i, pcm += 4) {
+    int lo1 = pcm[0] + pcm[1];
+    int lo2 = pcm[2] + pcm[3];
+    sum[0] += std::abs(lo1 + lo2);
+    sum[1] += std::abs(lo1 - lo2);
+    sum[2] += std::abs(pcm[0] - pcm[1]) + std::abs(pcm[2] - pcm[3]);
+  }
+
+  unsigned energy[NumSubBands];
+  energy[0] = sum[0]/(quads*4);
+  energy[1] = sum[1]/(quads*4);
+  energy[2] = sum[2]/(quads*2);
+
+  static const unsigned MinimumLevel = 8;  // About -72dBov, below this is always noise
+  static const unsigned SignalRatio = 3;   // About 9.5dB above the noise floor
+
+  unsigned bandsWithSignal = 0;
+  unsigned totalEnergy = 0;
+  unsigned totalNoise = 0;
+  for (PINDEX band = 0; band < NumSubBands; ++band) {
+    unsigned & noise = m_subBandNoise[band];
+    if (noise == 0)
+      noise = std::max(energy[band], MinimumLevel); // Bootstrap, first frame assumed noise
+
+    if (energy[band] > MinimumLevel && energy[band] > noise*SignalRatio)
+      ++bandsWithSignal;
+
+    totalEnergy += energy[band];
+    totalNoise += noise;
+  }
+
+  bool voice = bandsWithSignal > 0 && totalEnergy > totalNoise*2;
+
+  /* Noise floor drops immediately to a new minimum, and rises slowly, more
+     slowly while talking, so it can follow a change in background noise
+     without tracking speech. */
+  for (PINDEX band = 0; band < NumSubBands; ++band) {
+    unsigned & noise = m_subBandNoise[band];
+    if (energy[band] < noise)
+      noise = std::max(energy[band], MinimumLevel);
+    else
+      noise += std::max(1U, noise/(voice ? 256 : 64));
+  }
+
+  return voice ? 1 : 0;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
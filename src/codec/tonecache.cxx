@@ -0,0 +1,312 @@
+/*
+ * tonecache.cxx
+ *
+ * Shared cache of rendered and encoded call progress tones
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#include <ptlib.h>
+
+#ifdef __GNUC__
+#pragma implementation "tonecache.h"
+#endif
+
+#include <opal_config.h>
+
+#include <codec/tonecache.h>
+
+#if OPAL_PTLIB_DTMF
+
+#include <opal/transcoders.h>
+#include <ptclib/dtmf.h>
+
+
+#define new PNEW
+#define PTraceModule() "ToneCache"
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+OpalToneCache::OpalToneCache(PINDEX maxBytes, PINDEX maxEntries)
+  : m_maxBytes(maxBytes)
+  , m_maxEntries(maxEntries)
+  , m_currentBytes(0)
+{
+}
+
+
+OpalToneCache & OpalToneCache::GetInstance()
+{
+  static OpalToneCache cache;
+  return cache;
+}
+
+
+bool OpalToneCache::GetRenderedTone(const PString & toneSpec, unsigned sampleRate, PShortArray & samples)
+{
+  PStringStream key;
+  key << "PCM\n" << sampleRate << '\n' << toneSpec;
+
+  {
+    PWaitAndSignal lock(m_mutex);
+    Entry * entry = InternalFind(key);
+    if (entry != NULL) {
+      samples = entry->m_samples;
+      return true;
+    }
+  }
+
+  // Render outside of the lock so other tones are not held up
+  Entry entry;
+  if (!RenderTone(toneSpec, sampleRate, entry.m_samples))
+    return false;
+
+  samples = entry.m_samples;
+  entry.m_size = entry.m_samples.GetSize()*sizeof(short);
+
+  PTRACE(4, "Rendered tone \"" << toneSpec << "\" at " << sampleRate << "Hz, " << entry.m_samples.GetSize() << " samples");
+
+  PWaitAndSignal lock(m_mutex);
+  InternalAdd(key, entry);
+  return true;
+}
+
+
+bool OpalToneCache::GetEncodedTone(const PString & toneSpec, const OpalMediaFormat & mediaFormat, Encoded & tone)
+{
+  // Sort the options so the key does not depend on dictionary ordering
+  PStringToString options = mediaFormat.GetOptions();
+  std::map<PString, PString> sortedOptions;
+  for (PStringToString::const_iterator it = options.begin(); it != options.end(); ++it)
+    sortedOptions[it->first] = it->second;
+
+  PStringStream key;
+  key << mediaFormat.GetName() << '\n' << toneSpec;
+  for (std::map<PString, PString>::iterator it = sortedOptions.begin(); it != sortedOptions.end(); ++it)
+    key << '\n' << it->first << '=' << it->second;
+
+  {
+    PWaitAndSignal lock(m_mutex);
+    Entry * entry = InternalFind(key);
+    if (entry != NULL) {
+      tone = entry->m_encoded;
+      return true;
+    }
+  }
+
+  // Encode outside of the lock so other tones are not held up
+  Entry entry;
+  if (!EncodeTone(toneSpec, mediaFormat, entry.m_encoded))
+    return false;
+
+  tone = entry.m_encoded;
+  entry.m_size = entry.m_encoded.m_data.GetSize() + entry.m_encoded.m_offsets.size()*sizeof(PINDEX);
+
+  PTRACE(4, "Encoded tone \"" << toneSpec << "\" to " << mediaFormat << ", "
+         << tone.GetCount() << " packets, " << tone.m_data.GetSize() << " bytes");
+
+  PWaitAndSignal lock(m_mutex);
+  InternalAdd(key, entry);
+  return true;
+}
+
+
+void OpalToneCache::SetLimits(PINDEX maxBytes, PINDEX maxEntries)
+{
+  PWaitAndSignal lock(m_mutex);
+  m_maxBytes = maxBytes;
+  m_maxEntries = maxEntries;
+  InternalEvict();
+}
+
+
+PINDEX OpalToneCache::GetCurrentEntries() const
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_entries.size();
+}
+
+
+void OpalToneCache::Clear()
+{
+  PWaitAndSignal lock(m_mutex);
+  m_entries.clear();
+  m_lru.clear();
+  m_currentBytes = 0;
+}
+
+
+OpalToneCache::Entry * OpalToneCache::InternalFind(const PString & key)
+{
+  EntryMap::iterator it = m_entries.find(key);
+  if (it == m_entries.end())
+    return NULL;
+
+  m_lru.splice(m_lru.begin(), m_lru, it->second.m_position);
+  return &it->second;
+}
+
+
+void OpalToneCache::InternalAdd(const PString & key, const Entry & entry)
+{
+  // May have been added by another call while we were generating
+  if (m_entries.find(key) != m_entries.end())
+    return;
+
+  if (m_maxBytes > 0 && entry.m_size > m_maxBytes) {
+    PTRACE(3, "Tone too large to cache, size=" << entry.m_size);
+    return;
+  }
+
+  m_lru.push_front(key);
+  Entry & newEntry = m_entries[key];
+  newEntry = entry;
+  newEntry.m_position = m_lru.begin();
+  m_currentBytes += entry.m_size;
+
+  InternalEvict();
+}
+
+
+void OpalToneCache::InternalEvict()
+{
+  while (!m_lru.empty() &&
+         ((m_maxBytes > 0 && m_currentBytes > m_maxBytes) ||
+          (m_maxEntries > 0 && (PINDEX)m_entries.size() > m_maxEntries))) {
+    EntryMap::iterator it = m_entries.find(m_lru.back());
+    if (it != m_entries.end()) {
+      m_currentBytes -= it->second.m_size;
+      PTRACE(4, "Evicting cached tone, size=" << it->second.m_size);
+      m_entries.erase(it);
+    }
+    m_lru.pop_back();
+  }
+}
+
+
+bool OpalToneCache::RenderTone(const PString & toneSpec, unsigned sampleRate, PShortArray & samples)
+{
+  PTones tones(PTones::DefaultVolume, sampleRate);
+  if (!tones.Generate(toneSpec) || tones.IsEmpty()) {
+    PTRACE(2, "Illegal tone specification \"" << toneSpec << '"');
+    return false;
+  }
+
+  samples = tones;
+  return true;
+}
+
+
+bool OpalToneCache::EncodeTone(const PString & toneSpec, const OpalMediaFormat & mediaFormat, Encoded & tone)
+{
+  unsigned clockRate = mediaFormat.GetClockRate();
+  unsigned frameTime = mediaFormat.GetFrameTime();
+  if (clockRate == 0 || frameTime == 0) {
+    PTRACE(3, "Cannot encode tones for " << mediaFormat << ", no frame time");
+    return false;
+  }
+
+  if (mediaFormat.GetOptionInteger(OpalAudioFormat::ChannelsOption(), 1) != 1) {
+    PTRACE(3, "Cannot encode tones for " << mediaFormat << ", not mono");
+    return false;
+  }
+
+  PShortArray samples;
+  if (!GetRenderedTone(toneSpec, clockRate, samples))
+    return false;
+
+  unsigned framesPerPacket = mediaFormat.GetOptionInteger(OpalAudioFormat::TxFramesPerPacketOption(), 1);
+  PINDEX samplesPerPacket = frameTime*std::max(framesPerPacket, 1U);
+  PINDEX bytesPerPacket = samplesPerPacket*sizeof(short);
+  PINDEX packetCount = (samples.GetSize() + samplesPerPacket - 1)/samplesPerPacket;
+
+  tone.m_packetTime = samplesPerPacket;
+  tone.m_offsets.resize(packetCount+1);
+  tone.m_offsets[0] = 0;
+
+  const OpalMediaFormat & pcmFormat = GetOpalPCM16(clockRate);
+
+  // Raw PCM needs no encoding, just padding to whole packets
+  if (mediaFormat == pcmFormat) {
+    tone.m_data.SetSize(packetCount*bytesPerPacket);
+    memcpy(tone.m_data.GetPointer(), (const short *)samples, samples.GetSize()*sizeof(short));
+    for (PINDEX i = 1; i <= packetCount; ++i)
+      tone.m_offsets[i] = i*bytesPerPacket;
+    return true;
+  }
+
+  OpalTranscoderPool & pool = OpalTranscoderPool::GetInstance();
+  OpalTranscoder * transcoder = pool.Acquire(pcmFormat, mediaFormat);
+  if (transcoder == NULL) {
+    PTRACE(3, "Cannot encode tone \"" << toneSpec << "\", no transcoder from " << pcmFormat << " to " << mediaFormat);
+    return false;
+  }
+
+  RTP_DataFrame input(bytesPerPacket);
+  RTP_DataFrame output;
+  PINDEX length = 0;
+
+  /* The cycle is encoded twice and only the second kept, so a stateful
+     codec, e.g. Opus or G.729, starts it with the state it had at the end
+     of the previous cycle, and the decoder sees a seamless repeat. */
+  for (PINDEX p = 0; p < packetCount*2; ++p) {
+    // Pad final partial packet with silence
+    PINDEX i = p % packetCount;
+    PINDEX offset = i*samplesPerPacket;
+    PINDEX count = std::min(samplesPerPacket, samples.GetSize() - offset);
+    memcpy(input.GetPayloadPtr(), (const short *)samples + offset, count*sizeof(short));
+    if (count < samplesPerPacket)
+      memset(input.GetPayloadPtr() + count*sizeof(short), 0, (samplesPerPacket-count)*sizeof(short));
+
+    input.SetTimestamp(p*samplesPerPacket);
+
+    if (!transcoder->Convert(input, output)) {
+      PTRACE(3, "Could not encode tone \"" << toneSpec << "\" to " << mediaFormat);
+      pool.Release(transcoder);
+      return false;
+    }
+
+    if (p < packetCount)
+      continue;
+
+    PINDEX encodedSize = output.GetPayloadSize();
+    memcpy(tone.m_data.GetPointer(length+encodedSize)+length, output.GetPayloadPtr(), encodedSize);
+    length += encodedSize;
+    tone.m_offsets[i+1] = length;
+  }
+
+  pool.Release(transcoder);
+
+  if (length == 0) {
+    PTRACE(3, "Tone \"" << toneSpec << "\" encoded to nothing for " << mediaFormat);
+    return false;
+  }
+
+  tone.m_data.SetSize(length);
+  return true;
+}
+
+
+#endif // OPAL_PTLIB_DTMF
+
+
+// End of File ///////////////////////////////////////////////////////////////
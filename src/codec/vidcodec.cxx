@@ -163,6 +163,28 @@ bool OpalVideoTranscoder::UpdateMediaFormats(const OpalMediaFormat & input, cons
 }
 
 
+bool OpalVideoTranscoder::OnReused(const OpalMediaFormat & srcFormat,
+                                   const OpalMediaFormat & destFormat,
+                                   const BYTE * instance, unsigned instanceLen)
+{
+  PWaitAndSignal mutex(updateMutex);
+
+  m_frozenTillIFrame = false;
+  m_lastFrameWasIFrame = false;
+  m_frameDropBits = 0;
+  m_lastTimestamp = UINT_MAX;
+  m_framesDropped = 0;
+
+  if (!OpalTranscoder::OnReused(srcFormat, destFormat, instance, instanceLen))
+    return false;
+
+  // New receiver, so it needs an intra frame to start
+  if (outputMediaFormat != OpalYUV420P)
+    m_encodingIntraFrameControl.IntraFrameRequest();
+  return true;
+}
+
+
 PINDEX OpalVideoTranscoder::GetOptimalDataFrameSize(PBoolean input) const
 {
   if (input)
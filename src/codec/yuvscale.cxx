@@ -0,0 +1,340 @@
+/*
+ * yuvscale.cxx
+ *
+ * YUV420P video frame scaling
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#include <ptlib.h>
+
+#ifdef __GNUC__
+#pragma implementation "yuvscale.h"
+#endif
+
+#include <opal_config.h>
+
+#if OPAL_VIDEO
+
+#include <codec/yuvscale.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define OPAL_YUVSCALE_SSE2 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  #include <arm_neon.h>
+  #define OPAL_YUVSCALE_NEON 1
+#endif
+
+#define new PNEW
+#define PTraceModule() "YUVScale"
+
+
+static const int WeightBits       = 14;   // Filter coefficients
+static const int IntermediateBits = 7;    // Fraction bits after horizontal pass, 255<<7 fits in a short
+static const int WeightOne        = 1 << WeightBits;
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+/* Weighted sum of rows of the intermediate, back to 8 bits. Weights are all
+   positive and sum to one, so no overflow in 32 bits and no clamping needed
+   beyond the saturating pack. */
+static void VerticalPass(const short * const * rows, const short * weights, unsigned taps, BYTE * dst, unsigned width, bool simd)
+{
+  static const int Shift = WeightBits + IntermediateBits;
+  static const int Rounding = 1 << (Shift - 1);
+
+  unsigned x = 0;
+
+#if OPAL_YUVSCALE_SSE2
+  for (; simd && x + 8 <= width; x += 8) {
+    __m128i lo = _mm_set1_epi32(Rounding), hi = lo;
+    for (unsigned k = 0; k < taps; k += 2) {
+      __m128i r0 = _mm_loadu_si128((const __m128i *)(rows[k] + x));
+      __m128i r1 = k+1 < taps ? _mm_loadu_si128((const __m128i *)(rows[k+1] + x)) : _mm_setzero_si128();
+      __m128i w = _mm_set1_epi32((k+1 < taps ? weights[k+1] << 16 : 0) | (unsigned short)weights[k]);
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), w));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), w));
+    }
+    __m128i words = _mm_packs_epi32(_mm_srai_epi32(lo, Shift), _mm_srai_epi32(hi, Shift));
+    _mm_storel_epi64((__m128i *)(dst + x), _mm_packus_epi16(words, words));
+  }
+#elif OPAL_YUVSCALE_NEON
+  for (; simd && x + 8 <= width; x += 8) {
+    int32x4_t lo = vdupq_n_s32(0), hi = lo;
+    for (unsigned k = 0; k < taps; ++k) {
+      int16x8_t r = vld1q_s16(rows[k] + x);
+      lo = vmlal_n_s16(lo, vget_low_s16(r), weights[k]);
+      hi = vmlal_n_s16(hi, vget_high_s16(r), weights[k]);
+    }
+    int16x8_t words = vcombine_s16(vmovn_s32(vrshrq_n_s32(lo, Shift)), vmovn_s32(vrshrq_n_s32(hi, Shift)));
+    vst1_u8(dst + x, vqmovun_s16(words));
+  }
+#endif
+
+  for (; x < width; ++x) {
+    int sum = Rounding;
+    for (unsigned k = 0; k < taps; ++k)
+      sum += rows[k][x]*weights[k];
+    sum >>= Shift;
+    dst[x] = (BYTE)(sum > 255 ? 255 : sum);
+  }
+}
+
+
+/* Weighted sum of source rows to the 16 bit intermediate, used when reducing
+   the number of rows so the horizontal pass has less to do. */
+static void VerticalPass(const BYTE * const * rows, const short * weights, unsigned taps, short * dst, unsigned width, bool simd)
+{
+  static const int Shift = WeightBits - IntermediateBits;
+  static const int Rounding = 1 << (Shift - 1);
+
+  unsigned x = 0;
+
+#if OPAL_YUVSCALE_SSE2
+  const __m128i zero = _mm_setzero_si128();
+  for (; simd && x + 8 <= width; x += 8) {
+    __m128i lo = _mm_set1_epi32(Rounding), hi = lo;
+    for (unsigned k = 0; k < taps; k += 2) {
+      __m128i r0 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(rows[k] + x)), zero);
+      __m128i r1 = k+1 < taps ? _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(rows[k+1] + x)), zero) : zero;
+      __m128i w = _mm_set1_epi32((k+1 < taps ? weights[k+1] << 16 : 0) | (unsigned short)weights[k]);
+      lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r0, r1), w));
+      hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r0, r1), w));
+    }
+    _mm_storeu_si128((__m128i *)(dst + x), _mm_packs_epi32(_mm_srai_epi32(lo, Shift), _mm_srai_epi32(hi, Shift)));
+  }
+#elif OPAL_YUVSCALE_NEON
+  for (; simd && x + 8 <= width; x += 8) {
+    int32x4_t lo = vdupq_n_s32(0), hi = lo;
+    for (unsigned k = 0; k < taps; ++k) {
+      int16x8_t r = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(rows[k] + x)));
+      lo = vmlal_n_s16(lo, vget_low_s16(r), weights[k]);
+      hi = vmlal_n_s16(hi, vget_high_s16(r), weights[k]);
+    }
+    vst1q_s16(dst + x, vcombine_s16(vmovn_s32(vrshrq_n_s32(lo, Shift)), vmovn_s32(vrshrq_n_s32(hi, Shift))));
+  }
+#endif
+
+  for (; x < width; ++x) {
+    int sum = Rounding;
+    for (unsigned k = 0; k < taps; ++k)
+      sum += rows[k][x]*weights[k];
+    dst[x] = (short)(sum >> Shift);
+  }
+}
+
+
+/* Horizontal filter, either source bytes to the intermediate, or the
+   intermediate to output bytes, depending on which pass is first. */
+template <typename InType, typename OutType, int Shift>
+static void HorizontalPass(const InType * src, const unsigned * start, const short * weights, unsigned taps, OutType * dst, unsigned width)
+{
+  static const int Rounding = 1 << (Shift - 1);
+
+  // Bilinear is by far the most common, so worth its own loop
+  if (taps == 2) {
+    for (unsigned x = 0; x < width; ++x, weights += 2) {
+      const InType * s = src + start[x];
+      dst[x] = (OutType)((s[0]*weights[0] + s[1]*weights[1] + Rounding) >> Shift);
+    }
+    return;
+  }
+
+  for (unsigned x = 0; x < width; ++x, weights += taps) {
+    const InType * s = src + start[x];
+    int sum = Rounding;
+    for (unsigned k = 0; k < taps; ++k)
+      sum += s[k]*weights[k];
+    dst[x] = (OutType)(sum >> Shift);
+  }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+void OpalYUV420PScaler::AxisFilter::Build(unsigned srcSize, unsigned dstSize)
+{
+  m_start.resize(dstSize);
+
+  if (srcSize == 1) {
+    m_taps = 1;
+    m_start.assign(dstSize, 0);
+    m_weights.assign(dstSize, (short)WeightOne);
+    return;
+  }
+
+  if (dstSize >= srcSize) {
+    // Bilinear, aligning pixel centres, which is exact for the same size
+    m_taps = 2;
+    m_weights.resize(dstSize*2);
+    for (unsigned d = 0; d < dstSize; ++d) {
+      PInt64 position = ((PInt64)(2*d + 1)*srcSize - dstSize)*WeightOne/(2*dstSize);
+      if (position < 0)
+        position = 0;
+      unsigned index = (unsigned)(position >> WeightBits);
+      int fraction = (int)(position & (WeightOne - 1));
+      if (index >= srcSize - 1) {
+        index = srcSize - 2;
+        fraction = WeightOne;
+      }
+      m_start[d] = index;
+      m_weights[2*d] = (short)(WeightOne - fraction);
+      m_weights[2*d+1] = (short)fraction;
+    }
+    return;
+  }
+
+  /* Area average, output pixel d covers source [d*src/dst, (d+1)*src/dst),
+     working in units of 1/dst of a source pixel keeps it all integer. */
+  m_taps = std::min((srcSize + dstSize - 1)/dstSize + 1, srcSize);
+  m_weights.resize(dstSize*m_taps);
+  for (unsigned d = 0; d < dstSize; ++d) {
+    unsigned begin = d*srcSize;
+    unsigned end = begin + srcSize;
+    unsigned first = std::min(begin/dstSize, srcSize - m_taps);
+    m_start[d] = first;
+
+    short * weights = &m_weights[d*m_taps];
+    int total = 0;
+    unsigned largest = 0;
+    for (unsigned k = 0; k < m_taps; ++k) {
+      unsigned pixelBegin = (first + k)*dstSize;
+      unsigned pixelEnd = pixelBegin + dstSize;
+      unsigned overlapBegin = std::max(begin, pixelBegin);
+      unsigned overlapEnd = std::min(end, pixelEnd);
+      unsigned overlap = overlapEnd > overlapBegin ? overlapEnd - overlapBegin : 0;
+      weights[k] = (short)((overlap*WeightOne + srcSize/2)/srcSize);
+      total += weights[k];
+      if (weights[k] > weights[largest])
+        largest = k;
+    }
+    weights[largest] = (short)(weights[largest] + WeightOne - total);
+  }
+}
+
+
+OpalYUV420PScaler::OpalYUV420PScaler(bool simd)
+  : m_simd(simd)
+{
+}
+
+
+const OpalYUV420PScaler::Filters & OpalYUV420PScaler::GetFilters(unsigned srcWidth, unsigned srcHeight, unsigned dstWidth, unsigned dstHeight)
+{
+  PUInt64 key = ((PUInt64)srcWidth << 48) | ((PUInt64)srcHeight << 32) | (dstWidth << 16) | dstHeight;
+  FilterCache::iterator it = m_filters.find(key);
+  if (it != m_filters.end())
+    return it->second;
+
+  // Sizes rarely change, so a flush on overflow is fine
+  if (m_filters.size() >= MaxCachedTables)
+    m_filters.clear();
+
+  PTRACE(4, "Creating filters for " << srcWidth << 'x' << srcHeight << " to " << dstWidth << 'x' << dstHeight);
+
+  Filters & filters = m_filters[key];
+  filters.m_luma.m_horizontal.Build(srcWidth, dstWidth);
+  filters.m_luma.m_vertical.Build(srcHeight, dstHeight);
+  filters.m_chroma.m_horizontal.Build(srcWidth/2, dstWidth/2);
+  filters.m_chroma.m_vertical.Build(srcHeight/2, dstHeight/2);
+  return filters;
+}
+
+
+bool OpalYUV420PScaler::Scale(unsigned srcWidth, unsigned srcHeight, const BYTE * src,
+                              unsigned dstX, unsigned dstY, unsigned dstWidth, unsigned dstHeight,
+                              unsigned dstFrameWidth, unsigned dstFrameHeight, BYTE * dst)
+{
+  if (srcWidth < 2 || srcHeight < 2 || dstWidth < 2 || dstHeight < 2 ||
+      srcWidth > 65535 || srcHeight > 65535 || dstWidth > 65535 || dstHeight > 65535 ||
+      dstX + dstWidth > dstFrameWidth || dstY + dstHeight > dstFrameHeight) {
+    PTRACE(2, "Cannot scale " << srcWidth << 'x' << srcHeight << " to "
+           << dstX << ',' << dstY << '/' << dstWidth << 'x' << dstHeight << " in " << dstFrameWidth << 'x' << dstFrameHeight);
+    return false;
+  }
+
+  const BYTE * srcCb = src + srcWidth*srcHeight;
+  const BYTE * srcCr = srcCb + srcWidth*srcHeight/4;
+  BYTE * dstCb = dst + dstFrameWidth*dstFrameHeight;
+  BYTE * dstCr = dstCb + dstFrameWidth*dstFrameHeight/4;
+  unsigned chromaOffset = (dstY/2)*(dstFrameWidth/2) + dstX/2;
+
+  const Filters & filters = GetFilters(srcWidth, srcHeight, dstWidth, dstHeight);
+  ScalePlane(filters.m_luma, srcWidth, srcHeight, src,
+             dstWidth, dstHeight, dst + dstY*dstFrameWidth + dstX, dstFrameWidth);
+  ScalePlane(filters.m_chroma, srcWidth/2, srcHeight/2, srcCb,
+             dstWidth/2, dstHeight/2, dstCb + chromaOffset, dstFrameWidth/2);
+  ScalePlane(filters.m_chroma, srcWidth/2, srcHeight/2, srcCr,
+             dstWidth/2, dstHeight/2, dstCr + chromaOffset, dstFrameWidth/2);
+  return true;
+}
+
+
+void OpalYUV420PScaler::ScalePlane(const PlaneFilter & filter,
+                                   unsigned srcWidth, unsigned srcHeight, const BYTE * src,
+                                   unsigned dstWidth, unsigned dstHeight, BYTE * dst, unsigned dstStride)
+{
+  if (srcWidth == dstWidth && srcHeight == dstHeight) {
+    for (unsigned y = 0; y < dstHeight; ++y)
+      memcpy(dst + y*dstStride, src + y*srcWidth, dstWidth);
+    return;
+  }
+
+  const AxisFilter & horizontal = filter.m_horizontal;
+  const AxisFilter & vertical = filter.m_vertical;
+
+  if (dstHeight < srcHeight) {
+    // Reducing rows, so do those first, a row at a time, and filter fewer horizontally
+    m_intermediate.resize(srcWidth);
+    short * intermediate = &m_intermediate[0];
+    std::vector<const BYTE *> rows(vertical.m_taps);
+    for (unsigned y = 0; y < dstHeight; ++y) {
+      for (unsigned k = 0; k < vertical.m_taps; ++k)
+        rows[k] = src + (vertical.m_start[y] + k)*srcWidth;
+      VerticalPass(&rows[0], &vertical.m_weights[y*vertical.m_taps], vertical.m_taps, intermediate, srcWidth, m_simd);
+      HorizontalPass<short, BYTE, WeightBits + IntermediateBits>(intermediate, &horizontal.m_start[0], &horizontal.m_weights[0],
+                                                                horizontal.m_taps, dst + y*dstStride, dstWidth);
+    }
+    return;
+  }
+
+  // Every source row is used by at least one output row, so filter them all once
+  m_intermediate.resize(srcHeight*dstWidth);
+  short * intermediate = &m_intermediate[0];
+  for (unsigned y = 0; y < srcHeight; ++y)
+    HorizontalPass<BYTE, short, WeightBits - IntermediateBits>(src + y*srcWidth, &horizontal.m_start[0], &horizontal.m_weights[0],
+                                                              horizontal.m_taps, intermediate + y*dstWidth, dstWidth);
+
+  std::vector<const short *> rows(vertical.m_taps);
+  for (unsigned y = 0; y < dstHeight; ++y) {
+    for (unsigned k = 0; k < vertical.m_taps; ++k)
+      rows[k] = intermediate + (vertical.m_start[y] + k)*dstWidth;
+    VerticalPass(&rows[0], &vertical.m_weights[y*vertical.m_taps], vertical.m_taps, dst + y*dstStride, dstWidth, m_simd);
+  }
+}
+
+
+#endif // OPAL_VIDEO
+
+
+// End of File ///////////////////////////////////////////////////////////////
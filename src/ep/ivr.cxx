@@ -36,6 +36,8 @@
 #include <ep/ivr.h>
 #include <opal/call.h>
 #include <opal/patch.h>
+#include <opal/transcoders.h>
+#include <codec/opalwavfile.h>
 
 
 #define new PNEW
@@ -379,6 +381,20 @@ void OpalIVRConnection::OnEndDialog()
 }
 
 
+bool OpalIVRConnection::GetEncodedPrompt(const PFilePath & filename, PBYTEArray & data)
+{
+  OpalMediaStreamPtr stream = GetMediaStream(OpalMediaType::Audio(), true);
+  if (stream == NULL)
+    return false;
+
+  OpalMediaFormat mediaFormat = stream->GetMediaFormat();
+  if (!mediaFormat.IsTransportable())
+    return false;
+
+  return endpoint.GetPromptCache().GetEncodedPrompt(filename, mediaFormat, data);
+}
+
+
 OpalMediaFormatList OpalIVRConnection::GetMediaFormats() const
 {
   OpalMediaFormatList mediaFormats = m_endpoint.GetMediaFormats();
@@ -494,4 +510,202 @@ PBoolean OpalIVRMediaStream::IsSynchronous() const
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+
+OpalIVRPromptCache::OpalIVRPromptCache(PINDEX maxBytes, PINDEX maxEntries)
+  : m_maxBytes(maxBytes)
+  , m_maxEntries(maxEntries)
+  , m_currentBytes(0)
+{
+}
+
+
+bool OpalIVRPromptCache::GetEncodedPrompt(const PFilePath & filename, const OpalMediaFormat & mediaFormat, PBYTEArray & data)
+{
+  PFileInfo info;
+  if (!PFile::GetInfo(filename, info)) {
+    PTRACE(4, "Cannot get prompt file info for \"" << filename << '"');
+    return false;
+  }
+
+  // Sort the options so the key does not depend on dictionary ordering
+  PStringToString options = mediaFormat.GetOptions();
+  std::map<PString, PString> sortedOptions;
+  for (PStringToString::const_iterator it = options.begin(); it != options.end(); ++it)
+    sortedOptions[it->first] = it->second;
+
+  PStringStream key;
+  key << filename << '\n' << info.size << '\n' << info.modified.GetTimeInSeconds() << '\n' << mediaFormat.GetName();
+  for (std::map<PString, PString>::iterator it = sortedOptions.begin(); it != sortedOptions.end(); ++it)
+    key << '\n' << it->first << '=' << it->second;
+
+  {
+    PWaitAndSignal lock(m_mutex);
+    EntryMap::iterator it = m_entries.find(key);
+    if (it != m_entries.end()) {
+      m_lru.splice(m_lru.begin(), m_lru, it->second.m_position);
+      data = it->second.m_data;
+      PTRACE(5, "Using cached " << mediaFormat << " prompt \"" << filename << '"');
+      return true;
+    }
+  }
+
+  // Encode outside of the lock so other prompts are not held up
+  PBYTEArray encoded;
+  if (!EncodePrompt(filename, mediaFormat, encoded))
+    return false;
+
+  PWaitAndSignal lock(m_mutex);
+
+  // May have been added by another call while we were encoding
+  EntryMap::iterator it = m_entries.find(key);
+  if (it != m_entries.end()) {
+    m_lru.splice(m_lru.begin(), m_lru, it->second.m_position);
+    data = it->second.m_data;
+    return true;
+  }
+
+  data = encoded;
+
+  if (m_maxBytes > 0 && encoded.GetSize() > m_maxBytes) {
+    PTRACE(3, "Encoded " << mediaFormat << " prompt \"" << filename << "\" too large to cache");
+    return true;
+  }
+
+  m_lru.push_front(key);
+  Entry & entry = m_entries[key];
+  entry.m_data = encoded;
+  entry.m_position = m_lru.begin();
+  m_currentBytes += encoded.GetSize();
+
+  PTRACE(4, "Cached " << mediaFormat << " prompt \"" << filename << "\","
+            " size=" << encoded.GetSize() << ", total=" << m_currentBytes);
+
+  InternalEvict();
+  return true;
+}
+
+
+void OpalIVRPromptCache::SetLimits(PINDEX maxBytes, PINDEX maxEntries)
+{
+  PWaitAndSignal lock(m_mutex);
+  m_maxBytes = maxBytes;
+  m_maxEntries = maxEntries;
+  InternalEvict();
+}
+
+
+PINDEX OpalIVRPromptCache::GetCurrentEntries() const
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_entries.size();
+}
+
+
+void OpalIVRPromptCache::Clear()
+{
+  PWaitAndSignal lock(m_mutex);
+  m_entries.clear();
+  m_lru.clear();
+  m_currentBytes = 0;
+}
+
+
+void OpalIVRPromptCache::InternalEvict()
+{
+  while (!m_lru.empty() &&
+         ((m_maxBytes > 0 && m_currentBytes > m_maxBytes) ||
+          (m_maxEntries > 0 && (PINDEX)m_entries.size() > m_maxEntries))) {
+    EntryMap::iterator it = m_entries.find(m_lru.back());
+    if (it != m_entries.end()) {
+      m_currentBytes -= it->second.m_data.GetSize();
+      PTRACE(4, "Evicting cached prompt, size=" << it->second.m_data.GetSize());
+      m_entries.erase(it);
+    }
+    m_lru.pop_back();
+  }
+}
+
+
+bool OpalIVRPromptCache::EncodePrompt(const PFilePath & filename, const OpalMediaFormat & mediaFormat, PBYTEArray & data)
+{
+  PINDEX frameSize = mediaFormat.GetFrameSize();
+  unsigned frameTime = mediaFormat.GetFrameTime();
+  if (frameSize == 0 || frameTime == 0) {
+    PTRACE(3, "Cannot cache prompts for variable frame size codec " << mediaFormat);
+    return false;
+  }
+
+  OpalWAVFile wavFile(filename, PFile::ReadOnly);
+  if (!wavFile.IsOpen()) {
+    PTRACE(3, "Cannot open prompt file \"" << filename << "\" for encoding");
+    return false;
+  }
+
+  if (wavFile.GetChannels() != 1) {
+    PTRACE(3, "Cannot encode prompt file \"" << filename << "\", not mono");
+    return false;
+  }
+
+  unsigned sampleRate = wavFile.GetSampleRate();
+  PAutoPtr<OpalTranscoder> transcoder(OpalTranscoder::Create(GetOpalPCM16(sampleRate), mediaFormat));
+  if (transcoder.get() == NULL) {
+    PTRACE(3, "Cannot encode prompt file \"" << filename << "\", no transcoder from " << sampleRate << "Hz to " << mediaFormat);
+    return false;
+  }
+
+  // Frame time is in media clock units, convert to samples at file rate
+  PINDEX samplesPerFrame = (PINDEX)((PUInt64)frameTime*sampleRate/mediaFormat.GetClockRate());
+  PINDEX bytesPerFrame = samplesPerFrame*sizeof(short);
+
+  RTP_DataFrame input(bytesPerFrame);
+  RTP_DataFrame output;
+  RTP_Timestamp timestamp = 0;
+  PINDEX length = 0;
+
+  for (;;) {
+    if (!wavFile.Read(input.GetPayloadPtr(), bytesPerFrame))
+      break;
+
+    PINDEX count = wavFile.GetLastReadCount();
+    if (count == 0)
+      break;
+
+    // Pad final partial frame with silence
+    if (count < bytesPerFrame)
+      memset(input.GetPayloadPtr()+count, 0, bytesPerFrame-count);
+
+    input.SetTimestamp(timestamp);
+    timestamp += samplesPerFrame;
+
+    if (!transcoder->Convert(input, output)) {
+      PTRACE(3, "Could not encode prompt file \"" << filename << "\" to " << mediaFormat);
+      return false;
+    }
+
+    PINDEX encodedSize = output.GetPayloadSize();
+    if (encodedSize == 0 || encodedSize % frameSize != 0) {
+      PTRACE(3, "Cannot cache prompt file \"" << filename << "\", "
+             << mediaFormat << " produced irregular frame size " << encodedSize);
+      return false;
+    }
+
+    memcpy(data.GetPointer(length+encodedSize)+length, output.GetPayloadPtr(), encodedSize);
+    length += encodedSize;
+
+    if (count < bytesPerFrame)
+      break;
+  }
+
+  if (length == 0) {
+    PTRACE(3, "Prompt file \"" << filename << "\" is empty");
+    return false;
+  }
+
+  data.SetSize(length);
+  PTRACE(4, "Encoded prompt file \"" << filename << "\" to " << mediaFormat << ", " << length << " bytes");
+  return true;
+}
+
+
 #endif // OPAL_IVR
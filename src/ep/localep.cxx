@@ -285,7 +285,10 @@ OpalLocalConnection::OpalLocalConnection(OpalCall & call,
 #endif
 {
 #if OPAL_PTLIB_DTMF
-  m_sendInBandDTMF = m_detectInBandDTMF = false;
+  m_sendInBandDTMF = false;
+#endif
+#if OPAL_DTMF_DETECT
+  m_detectInBandDTMF = false;
 #endif
 
 #if OPAL_HAS_H281
@@ -401,10 +404,62 @@ bool OpalLocalConnection::HoldRemote(bool placeOnHold)
 }
 
 
+#if OPAL_PTLIB_DTMF
+static bool CanEncodeTone(const OpalMediaFormat & mediaFormat)
+{
+  // Same restrictions as OpalToneCache::EncodeTone()
+  return mediaFormat.GetMediaType() == OpalMediaType::Audio() &&
+         mediaFormat.GetClockRate() > 0 &&
+         mediaFormat.GetFrameTime() > 0 &&
+         mediaFormat.GetOptionInteger(OpalAudioFormat::ChannelsOption(), 1) == 1;
+}
+#endif
+
+
+OpalMediaFormatList OpalLocalConnection::GetMediaFormats() const
+{
+  OpalMediaFormatList mediaFormats = OpalConnection::GetMediaFormats();
+
+#if OPAL_PTLIB_DTMF
+  if (!m_stringOptions.GetString(OPAL_OPT_LOCAL_TONE).IsEmpty()) {
+    OpalMediaFormatList encodedFormats = m_endpoint.GetManager().GetCommonMediaFormats(true, false);
+    for (OpalMediaFormatList::iterator it = encodedFormats.begin(); it != encodedFormats.end(); ++it) {
+      if (CanEncodeTone(*it))
+        mediaFormats += *it;
+    }
+  }
+#endif
+
+  return mediaFormats;
+}
+
+
 OpalMediaStream * OpalLocalConnection::CreateMediaStream(const OpalMediaFormat & mediaFormat,
                                                          unsigned sessionID,
                                                          PBoolean isSource)
 {
+#if OPAL_PTLIB_DTMF
+  if (isSource && mediaFormat.GetMediaType() == OpalMediaType::Audio()) {
+    PString toneSpec = m_stringOptions.GetString(OPAL_OPT_LOCAL_TONE);
+    if (!toneSpec.IsEmpty())
+      return new OpalToneMediaStream(*this, mediaFormat, sessionID, toneSpec);
+  }
+
+  // Encoded formats are only offered for playing tones, sinks stay raw
+  if (!isSource) {
+    OpalMediaFormatList rawFormats = OpalConnection::GetMediaFormats();
+    if (!rawFormats.HasFormat(mediaFormat.GetName())) {
+      OpalMediaFormatList::const_iterator raw = rawFormats.FindFormat('@' + mediaFormat.GetMediaType());
+      if (raw == rawFormats.end()) {
+        PTRACE(2, "No raw format for sink " << mediaFormat);
+        return NULL;
+      }
+      PTRACE(4, "Using raw format " << *raw << " for sink instead of " << mediaFormat);
+      return CreateMediaStream(*raw, sessionID, isSource);
+    }
+  }
+#endif
+
   if (m_endpoint.UseCallback(mediaFormat, isSource))
     return new OpalLocalMediaStream(*this, mediaFormat, sessionID, isSource, GetSynchronicity(mediaFormat, isSource));
 
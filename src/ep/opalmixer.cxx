@@ -36,6 +36,7 @@
 #include <opal/patch.h>
 #include <rtp/rtp.h>
 #include <rtp/jitter.h>
+#include <codec/resampler.h>
 #include <ptlib/vconvert.h>
 #include <ptclib/pwavfile.h>
 #include <sip/handlers.h>
@@ -313,23 +314,55 @@ void OpalAudioMixer::RemoveAllStreams()
 }
 
 
-bool OpalAudioMixer::SetSampleRate(unsigned rate)
+bool OpalAudioMixer::SetSampleRate(unsigned rate, bool resampleStreams)
 {
   PWaitAndSignal mutex(m_mutex);
 
-  if (m_inputStreams.size() > 0)
-    return rate == m_sampleRate;
+  if (rate == m_sampleRate)
+    return true;
+
+  if (!resampleStreams && m_inputStreams.size() > 0)
+    return false;
+
+  // Output timestamps just carry on, in the new units
 
   m_periodTS = m_periodMS*rate/1000;
   m_sampleRate = rate;
   m_mixedAudio.resize(m_periodTS);
   for (StreamMap_T::iterator iter = m_inputStreams.begin(); iter != m_inputStreams.end(); ++iter)
-    ((AudioStream *)iter->second)->m_cacheSamples.SetSize(m_periodTS);
+    ((AudioStream *)iter->second)->OnMixerSampleRateChanged();
   PTRACE(4, "Sample rate set to " << rate);
   return true;
 }
 
 
+bool OpalAudioMixer::SetStreamSampleRate(const Key_T & key, unsigned rate)
+{
+  PWaitAndSignal mutex(m_mutex);
+
+  StreamMap_T::iterator iter = m_inputStreams.find(key);
+  if (iter == m_inputStreams.end())
+    return false;
+
+  ((AudioStream *)iter->second)->SetSampleRate(rate);
+  return true;
+}
+
+
+unsigned OpalAudioMixer::GetHighestStreamSampleRate() const
+{
+  PWaitAndSignal mutex(m_mutex);
+
+  unsigned highest = 0;
+  for (StreamMap_T::const_iterator iter = m_inputStreams.begin(); iter != m_inputStreams.end(); ++iter) {
+    unsigned rate = ((const AudioStream *)iter->second)->m_sampleRate;
+    if (highest < rate)
+      highest = rate;
+  }
+  return highest;
+}
+
+
 bool OpalAudioMixer::SetJitterBufferSize(const Key_T & key, const OpalJitterBuffer::Init & init)
 {
   PWaitAndSignal mutex(m_mutex);
@@ -461,6 +494,8 @@ OpalAudioMixer::AudioStream::AudioStream(OpalAudioMixer & mixer)
   , m_nextTimestamp(0)
   , m_cacheSamples(mixer.GetPeriodTS())
   , m_samplesUsed(0)
+  , m_sampleRate(mixer.GetSampleRate())
+  , m_resampler(NULL)
 {
 }
 
@@ -468,18 +503,78 @@ OpalAudioMixer::AudioStream::AudioStream(OpalAudioMixer & mixer)
 OpalAudioMixer::AudioStream::~AudioStream()
 {
   delete m_jitter;
+  delete m_resampler;
 }
 
 
 void OpalAudioMixer::AudioStream::QueuePacket(const RTP_DataFrame & rtp)
 {
+  // The jitter buffer works on the stream's own timestamps, so resample after it
   if (m_jitter == NULL)
-    m_queue.push(rtp);
+    QueueResampled(rtp);
   else
     m_jitter->WriteData(rtp);
 }
 
 
+void OpalAudioMixer::AudioStream::QueueResampled(const RTP_DataFrame & rtp)
+{
+  if (m_resampler == NULL) {
+    m_queue.push(rtp);
+    return;
+  }
+
+  // Only the audio is used from the queue, so the timestamp is left alone
+  RTP_DataFrame resampled;
+  resampled.CopyHeader(rtp);
+  if (m_resampler->Convert(rtp, resampled))
+    m_queue.push(resampled);
+}
+
+
+void OpalAudioMixer::AudioStream::SetSampleRate(unsigned rate)
+{
+  if (m_sampleRate == rate)
+    return;
+
+  m_sampleRate = rate;
+
+  // Anything in the jitter buffer is in the old units, so start again
+  m_nextTimestamp = 0;
+  if (m_jitter != NULL) {
+    OpalJitterBuffer::Init init(OpalMediaType::Audio(),
+                                m_jitter->GetMinJitterDelay()/m_jitter->GetTimeUnits(),
+                                m_jitter->GetMaxJitterDelay()/m_jitter->GetTimeUnits(),
+                                m_sampleRate/1000);
+    delete m_jitter;
+    m_jitter = OpalJitterBuffer::Create(OpalMediaType::Audio(), init);
+    PTRACE_CONTEXT_ID_SET(*m_jitter, this);
+  }
+
+  OnMixerSampleRateChanged();
+}
+
+
+void OpalAudioMixer::AudioStream::OnMixerSampleRateChanged()
+{
+  // Expected to already be mutexed
+
+  delete m_resampler;
+  m_resampler = NULL;
+  if (m_sampleRate != m_mixer.m_sampleRate) {
+    m_resampler = new OpalPCMResampler(m_sampleRate, m_mixer.m_sampleRate);
+    PTRACE(4, "Resampling stream from " << m_sampleRate << " to " << m_mixer.m_sampleRate);
+  }
+
+  /* Anything already queued was resampled to the old mixer rate, so start
+     again. The jitter buffer is before the resampler, so is unaffected. */
+  while (!m_queue.empty())
+    m_queue.pop();
+  m_samplesUsed = 0;
+  m_cacheSamples.SetSize(m_mixer.GetPeriodTS());
+}
+
+
 const short * OpalAudioMixer::AudioStream::GetAudioDataPtr()
 {
   size_t samplesLeft = m_mixer.GetPeriodTS();
@@ -493,8 +588,10 @@ const short * OpalAudioMixer::AudioStream::GetAudioDataPtr()
       frame.SetTimestamp(m_nextTimestamp);
       if (!m_jitter->ReadData(frame) || frame.GetPayloadSize() == 0)
         break;
-      m_nextTimestamp = frame.GetTimestamp();
-      m_queue.push(frame);
+      // Next read follows on from this frame, in the stream's own units
+      m_nextTimestamp = frame.GetTimestamp() + frame.GetPayloadSize()/sizeof(short);
+      QueueResampled(frame);
+      continue;
     }
 
     size_t payloadSamples = m_queue.front().GetPayloadSize()/sizeof(short);
@@ -506,7 +603,6 @@ const short * OpalAudioMixer::AudioStream::GetAudioDataPtr()
 
     cachePtr += samplesToCopy;
     samplesLeft -= samplesToCopy;
-    m_nextTimestamp += samplesToCopy;
 
     m_samplesUsed += samplesToCopy;
     if (m_samplesUsed >= payloadSamples) {
@@ -517,7 +613,7 @@ const short * OpalAudioMixer::AudioStream::GetAudioDataPtr()
 
   if (samplesLeft > 0) {
     memset(cachePtr, 0, samplesLeft*sizeof(short)); // Silence
-    m_nextTimestamp += samplesLeft;
+    m_nextTimestamp += (unsigned)((PUInt64)samplesLeft*m_sampleRate/m_mixer.m_sampleRate);
   }
 
   return m_cacheSamples;
@@ -535,11 +631,24 @@ OpalVideoMixer::OpalVideoMixer(Styles style, unsigned width, unsigned height, un
   , m_bgFillGreen(0)
   , m_bgFillBlue(0)
   , m_lastStreamCount(0)
+  , m_frameStoreGeneration(0)
+  , m_lastMixGeneration(UINT_MAX)
+  , m_repeatFrame(false)
+  , m_compositingThreads(0)
+  , m_tilePool(NULL)
+  , m_tilesDone(0, INT_MAX)
 {
   SetFrameSize(width, height);
 }
 
 
+OpalVideoMixer::~OpalVideoMixer()
+{
+  StopPushThread();
+  delete m_tilePool;
+}
+
+
 bool OpalVideoMixer::SetFrameRate(unsigned rate)
 {
   if (rate == 0 || rate > 100)
@@ -564,12 +673,29 @@ bool OpalVideoMixer::SetFrameSize(unsigned width, unsigned height)
   PColourConverter::FillYUV420P(0, 0, m_width, m_height, m_width, m_height,
                                 m_frameStore.GetPointer(PVideoFrameInfo::CalculateFrameBytes(m_width, m_height)),
                                 m_bgFillRed, m_bgFillGreen, m_bgFillBlue);
+  ++m_frameStoreGeneration;
 
   m_mutex.Signal();
   return true;
 }
 
 
+void OpalVideoMixer::SetCompositingThreads(unsigned threads)
+{
+  PWaitAndSignal mutex(m_mutex);
+
+  if (m_compositingThreads == threads)
+    return;
+
+  PTRACE(4, "Compositing threads changed from " << m_compositingThreads << " to " << threads);
+  m_compositingThreads = threads;
+
+  // Recreated with new size on next mix
+  delete m_tilePool;
+  m_tilePool = NULL;
+}
+
+
 OpalBaseMixer::Stream * OpalVideoMixer::CreateStream()
 {
   return new VideoStream(*this);
@@ -603,16 +729,79 @@ bool OpalVideoMixer::MixVideo()
   w &= 0xfffffffc;
   h &= 0xfffffffc;
 
+  // Take the next frame from every input, even those not in the layout
+  for (StreamMap_T::iterator iter = m_inputStreams.begin(); iter != m_inputStreams.end(); ++iter) {
+    VideoStream * vid = dynamic_cast<VideoStream *>(iter->second);
+    if (vid != NULL)
+      vid->LatchFrame();
+  }
+
+  // Only composite tiles that have a new frame, or were moved/erased
+  m_tiles.clear();
   for (StreamMap_T::iterator iter = m_inputStreams.begin(); iter != m_inputStreams.end(); ++iter) {
-    InsertVideoFrame(iter, x, y, w, h);
+    VideoStream * vid = dynamic_cast<VideoStream *>(iter->second);
+    if (vid != NULL && vid->IsTileDirty(x, y, w, h))
+      m_tiles.push_back(TileJob(vid, x, y, w, h));
     if (!NextMix(x, y, w, h, left))
       break;
   }
 
+  m_repeatFrame = m_tiles.empty() && m_lastMixGeneration == m_frameStoreGeneration;
+  m_lastMixGeneration = m_frameStoreGeneration;
+
+  if (m_repeatFrame)
+    PTRACE(DETAIL_LOG_LEVEL, "No tiles changed, repeating previous frame");
+  else
+    CompositeTiles(m_tiles);
   return true;
 }
 
 
+void OpalVideoMixer::CompositeTiles(TileList & tiles)
+{
+  PTimeInterval startTime = PTimer::Tick();
+
+  /* Each tile is scaled into a disjoint region of m_frameStore, and each
+     input stream appears in only one tile, so they can be done in parallel.
+     Nothing else can touch the frame store or the stream queues as we are
+     called with m_mutex held. */
+  size_t queued = 0;
+  if (m_compositingThreads > 1 && tiles.size() > 1) {
+    if (m_tilePool == NULL)
+      m_tilePool = new TilePool(m_compositingThreads, 0, "VideoMixTile");
+
+    // The mixer thread does the last tile itself, rather than wait idle
+    for (size_t i = 0; i < tiles.size()-1; ++i) {
+      TileJob * job = new TileJob(tiles[i]);
+      job->m_done = &m_tilesDone;
+      if (m_tilePool->AddWork(job))
+        ++queued;
+      else {
+        delete job;
+        tiles[i].Work();
+      }
+    }
+    tiles.back().Work();
+  }
+  else {
+    for (TileList::iterator it = tiles.begin(); it != tiles.end(); ++it)
+      it->Work();
+  }
+
+  while (queued-- > 0)
+    m_tilesDone.Wait();
+
+  PTimeInterval mixTime = PTimer::Tick() - startTime;
+  if (mixTime.GetMilliSeconds() > m_periodMS/2) {
+    PTRACE(m_throttleMixTime, "Compositing " << tiles.size() << " tiles took " << mixTime
+           << ", more than half the frame period of " << m_periodMS << "ms" << m_throttleMixTime);
+  }
+  else {
+    PTRACE(DETAIL_LOG_LEVEL, "Compositing " << tiles.size() << " tiles took " << mixTime);
+  }
+}
+
+
 bool OpalVideoMixer::StartMix(unsigned & x, unsigned & y, unsigned & w, unsigned & h, unsigned & left)
 {
   switch (m_style) {
@@ -651,6 +840,7 @@ bool OpalVideoMixer::StartMix(unsigned & x, unsigned & y, unsigned & w, unsigned
         PColourConverter::FillYUV420P(0, 0, m_width, m_height, m_width, m_height,
                                       m_frameStore.GetPointer(),
                                       m_bgFillRed, m_bgFillGreen, m_bgFillBlue);
+        ++m_frameStoreGeneration;
         m_lastStreamCount = m_inputStreams.size();
       }
       switch (m_lastStreamCount) {
@@ -722,6 +912,13 @@ size_t OpalVideoMixer::GetOutputSize() const
 
 OpalVideoMixer::VideoStream::VideoStream(OpalVideoMixer & mixer)
   : m_mixer(mixer)
+  , m_frameSerial(0)
+  , m_drawnSerial(0)
+  , m_lastX(0)
+  , m_lastY(0)
+  , m_lastW(0)
+  , m_lastH(0)
+  , m_lastGeneration(0)
 {
 }
 
@@ -732,21 +929,32 @@ void OpalVideoMixer::VideoStream::QueuePacket(const RTP_DataFrame & rtp)
 }
 
 
-void OpalVideoMixer::VideoStream::InsertVideoFrame(unsigned x, unsigned y, unsigned w, unsigned h)
+OpalVideoMixer::TileJob::TileJob(VideoStream * stream, unsigned x, unsigned y, unsigned w, unsigned h, PSemaphore * done)
+  : m_stream(stream)
+  , m_x(x)
+  , m_y(y)
+  , m_w(w)
+  , m_h(h)
+  , m_done(done)
 {
-  if (m_queue.empty())
-    return;
+}
 
-  PluginCodec_Video_FrameHeader * header = (PluginCodec_Video_FrameHeader *)m_queue.front().GetPayloadPtr();
 
-  PTRACE(DETAIL_LOG_LEVEL, "Copying video: " << header->width << 'x' << header->height
-         << " -> " << x << ',' << y << '/' << w << 'x' << h);
+void OpalVideoMixer::TileJob::Work()
+{
+  m_stream->InsertVideoFrame(m_x, m_y, m_w, m_h);
+  if (m_done != NULL)
+    m_done->Signal();
+}
 
-  PColourConverter::CopyYUV420P(0, 0, header->width, header->height,
-                                header->width, header->height, OpalVideoFrameDataPtr(header),
-                                x, y, w, h,
-                                m_mixer.m_width, m_mixer.m_height, m_mixer.m_frameStore.GetPointer(),
-                                PVideoFrameInfo::eScale);
+
+void OpalVideoMixer::VideoStream::LatchFrame()
+{
+  if (m_queue.empty())
+    return;
+
+  m_lastFrame = m_queue.front();
+  ++m_frameSerial;
 
   /* To avoid continual build up of frames in queue if input frame rate
      greater than mixer frame, we flush the queue, but keep one to allow for
@@ -757,6 +965,45 @@ void OpalVideoMixer::VideoStream::InsertVideoFrame(unsigned x, unsigned y, unsig
 }
 
 
+bool OpalVideoMixer::VideoStream::HasFrame() const
+{
+  return m_lastFrame.GetPayloadSize() >= (PINDEX)sizeof(PluginCodec_Video_FrameHeader);
+}
+
+
+bool OpalVideoMixer::VideoStream::IsTileDirty(unsigned x, unsigned y, unsigned w, unsigned h) const
+{
+  if (!HasFrame())
+    return false;
+
+  return m_drawnSerial != m_frameSerial ||
+         m_lastGeneration != m_mixer.m_frameStoreGeneration ||
+         m_lastX != x || m_lastY != y || m_lastW != w || m_lastH != h;
+}
+
+
+void OpalVideoMixer::VideoStream::InsertVideoFrame(unsigned x, unsigned y, unsigned w, unsigned h)
+{
+  if (!HasFrame())
+    return;
+
+  m_drawnSerial = m_frameSerial;
+  m_lastX = x;
+  m_lastY = y;
+  m_lastW = w;
+  m_lastH = h;
+  m_lastGeneration = m_mixer.m_frameStoreGeneration;
+
+  PluginCodec_Video_FrameHeader * header = (PluginCodec_Video_FrameHeader *)m_lastFrame.GetPayloadPtr();
+
+  PTRACE(DETAIL_LOG_LEVEL, "Copying video: " << header->width << 'x' << header->height
+         << " -> " << x << ',' << y << '/' << w << 'x' << h);
+
+  m_scaler.Scale(header->width, header->height, OpalVideoFrameDataPtr(header),
+                 x, y, w, h, m_mixer.m_width, m_mixer.m_height, m_mixer.m_frameStore.GetPointer());
+}
+
+
 #endif // OPAL_VIDEO
 
 
@@ -1011,6 +1258,7 @@ OpalMixerConnection::OpalMixerConnection(PSafePtr<OpalMixerNode> node,
   , m_endpoint(ep)
   , m_node(node)
   , m_listenOnly(node->GetNodeInfo().m_listenOnly)
+  , m_audioLevelFilter(PCREATE_NOTIFIER(OnAudioLevelFilter))
 {
   m_node->AttachConnection(this);
 
@@ -1039,7 +1287,17 @@ void OpalMixerConnection::OnReleased()
 
 OpalMediaFormatList OpalMixerConnection::GetMediaFormats() const
 {
-  OpalMediaFormatList list = OpalTranscoder::GetPossibleFormats(OpalPCM16);
+  static const unsigned Rates[] = { 8000, 16000, 32000, 48000 };
+  const OpalMixerNodeInfo & info = m_node->GetNodeInfo();
+  OpalMediaFormatList rawFormats;
+  for (PINDEX i = 0; i < PARRAYSIZE(Rates); ++i) {
+    if (Rates[i] >= info.m_sampleRate && Rates[i] <= info.m_maxSampleRate)
+      rawFormats += GetOpalPCM16(Rates[i]);
+  }
+  if (rawFormats.IsEmpty())
+    rawFormats += GetOpalPCM16(info.m_sampleRate);
+
+  OpalMediaFormatList list = OpalTranscoder::GetPossibleFormats(rawFormats);
   list += OpalRFC2833;
 #if OPAL_T38_CAPABILITY
   list += OpalCiscoNSE;
@@ -1065,6 +1323,36 @@ void OpalMixerConnection::OnStartMediaPatch(OpalMediaPatch & patch)
 {
   OpalLocalConnection::OnStartMediaPatch(patch);
   m_node->UseMediaPassThrough(patch.GetSource().GetSessionID());
+
+  /* Check the audio level of encoded audio coming into the mixer, before it
+     gets to the decoder, so silent or quiet participants are not decoded. */
+  OpalMediaFormat mediaFormat = patch.GetSource().GetMediaFormat();
+  const OpalMixerNodeInfo & info = m_node->GetNodeInfo();
+  if (&patch.GetSource().GetConnection() != this &&
+      mediaFormat.GetMediaType() == OpalMediaType::Audio() &&
+      mediaFormat.IsTransportable() &&
+      (info.m_audioLevelTopN > 0 || info.m_audioLevelSilence < 127)) {
+    patch.AddFilter(m_audioLevelFilter, mediaFormat);
+    PTRACE(4, "Added audio level filter on " << patch);
+  }
+}
+
+
+void OpalMixerConnection::OnStopMediaPatch(OpalMediaPatch & patch)
+{
+  if (&patch.GetSource().GetConnection() != this)
+    patch.RemoveFilter(m_audioLevelFilter, patch.GetSource().GetMediaFormat());
+  OpalLocalConnection::OnStopMediaPatch(patch);
+}
+
+
+void OpalMixerConnection::OnAudioLevelFilter(RTP_DataFrame & frame, P_INT_PTR)
+{
+  // A suppressed empty payload passes through the decoder without decoding or concealing anything
+  bool suppress = frame.GetPayloadSize() > 0 && !m_node->ShouldDecodeAudio(GetToken(), frame);
+  if (suppress)
+    frame.SetPayloadSize(0);
+  frame.SetSuppressed(suppress);
 }
 
 
@@ -1151,7 +1439,8 @@ OpalMixerMediaStream::OpalMixerMediaStream(OpalConnection & conn,
       m_mediaFormat = OpalYUV420P;
     else
 #endif
-      m_mediaFormat = OpalPCM16;
+      m_mediaFormat = GetOpalPCM16(m_node->GetAudioSampleRate(m_mediaFormat));
+    PublishMediaFormat();
   }
 }
 
@@ -1360,6 +1649,10 @@ void OpalMixerNode::DetachConnection(OpalConnection * connection)
   if (m_connections.Remove(connection))
     UseMediaPassThrough(0, connection);
 
+  m_audioLevelMutex.Wait();
+  m_audioLevels.erase(connection->GetToken());
+  m_audioLevelMutex.Signal();
+
   if (LockReadOnly()) {
     m_manager.OnNodeStatusChanged(*this, OpalConferenceState::UserRemoved);
     UnlockReadOnly();
@@ -1407,8 +1700,13 @@ bool OpalMixerNode::AttachStream(OpalMixerMediaStream * stream)
 
   m_mixerById[id] = m_audioMixer;
 
-  if (stream->IsSink())
-    return m_audioMixer->AddStream(id);
+  if (stream->IsSink()) {
+    if (!m_audioMixer->AddStream(id))
+      return false;
+    m_audioMixer->SetStreamSampleRate(id, stream->GetMediaFormat().GetClockRate());
+    UpdateAudioSampleRate();
+    return true;
+  }
 
   m_audioMixer->Append(stream);
   return true;
@@ -1438,11 +1736,48 @@ void OpalMixerNode::DetachStream(OpalMixerMediaStream * stream)
 
   if (stream->IsSource())
     m_audioMixer->Remove(stream);
-  else
+  else {
     m_audioMixer->RemoveStream(stream->GetID());
+    UpdateAudioSampleRate();
+  }
 }
 
 
+#if OPAL_VIDEO
+bool OpalMixerNode::SetVideoLayout(const PString & streamId, OpalVideoStreamMixer::Layouts layout, OpalVideoFormat::ContentRole role)
+{
+  VideoMixerMap::iterator it = m_videoMixers.find(role);
+  if (it == m_videoMixers.end())
+    return false;
+
+  it->second->SetLayout(streamId, layout);
+  return true;
+}
+
+
+bool OpalMixerNode::SetVideoCustomLayout(const PString & streamId, const OpalVideoStreamMixer::LayoutTiles & tiles, OpalVideoFormat::ContentRole role)
+{
+  VideoMixerMap::iterator it = m_videoMixers.find(role);
+  if (it == m_videoMixers.end())
+    return false;
+
+  it->second->SetCustomLayout(streamId, tiles);
+  return true;
+}
+
+
+bool OpalMixerNode::SetVideoFocus(const PString & streamId, OpalVideoFormat::ContentRole role)
+{
+  VideoMixerMap::iterator it = m_videoMixers.find(role);
+  if (it == m_videoMixers.end())
+    return false;
+
+  it->second->SetFocus(streamId);
+  return true;
+}
+#endif // OPAL_VIDEO
+
+
 void OpalMixerNode::UseMediaPassThrough(unsigned sessionID, OpalConnection * connection)
 {
   if (!m_info->m_mediaPassThru)
@@ -1491,6 +1826,88 @@ bool OpalMixerNode::WritePacket(const OpalMixerMediaStream & stream, const RTP_D
 }
 
 
+bool OpalMixerNode::ShouldDecodeAudio(const PString & participant, const RTP_DataFrame & frame)
+{
+  int level = frame.GetAudioLevel();
+  if (level < 0)
+    return true; // No RFC 6464 header extension, so must always decode
+
+  PTimeInterval now = PTimer::Tick();
+
+  PWaitAndSignal lock(m_audioLevelMutex);
+
+  // Smooth the level a little, so the top speakers do not change every packet
+  AudioLevelMap::iterator it = m_audioLevels.find(participant);
+  if (it == m_audioLevels.end()) {
+    AudioLevelInfo & info = m_audioLevels[participant];
+    info.m_level = level;
+    info.m_lastTick = now;
+  }
+  else {
+    it->second.m_level = (it->second.m_level*3 + level)/4;
+    it->second.m_lastTick = now;
+    level = it->second.m_level;
+  }
+
+  if (level > (int)m_info->m_audioLevelSilence)
+    return false;
+
+  if (m_info->m_audioLevelTopN == 0 || m_audioLevels.size() <= m_info->m_audioLevelTopN)
+    return true;
+
+  /* Count participants that are louder, ignoring those we have not heard from
+     recently, as they have stopped sending due to silence suppression. */
+  static PTimeInterval const StaleTime(0, 1);
+  unsigned louder = 0;
+  for (it = m_audioLevels.begin(); it != m_audioLevels.end(); ++it) {
+    if (it->second.m_level < level && (now - it->second.m_lastTick) < StaleTime) {
+      if (++louder >= m_info->m_audioLevelTopN) {
+        PTRACE(6, "Not decoding audio from " << participant << ", level=" << level);
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
+unsigned OpalMixerNode::GetAudioSampleRate(const OpalMediaFormat & mediaFormat) const
+{
+  static const unsigned Rates[] = { 48000, 32000, 16000, 8000 };
+  for (PINDEX i = 0; i < PARRAYSIZE(Rates); ++i) {
+    if (Rates[i] < m_info->m_sampleRate || Rates[i] > m_info->m_maxSampleRate)
+      continue;
+
+    const OpalMediaFormat & rawFormat = GetOpalPCM16(Rates[i]);
+    if (mediaFormat == rawFormat)
+      return Rates[i];
+
+    // Only a direct decoder counts, anything else is resampling anyway
+    OpalMediaFormat intermediateFormat;
+    if (OpalTranscoder::FindIntermediateFormat(mediaFormat, rawFormat, intermediateFormat) && !intermediateFormat.IsValid())
+      return Rates[i];
+  }
+
+  return m_info->m_sampleRate;
+}
+
+
+void OpalMixerNode::UpdateAudioSampleRate()
+{
+  unsigned rate = m_audioMixer->GetHighestStreamSampleRate();
+  if (rate > m_info->m_maxSampleRate)
+    rate = m_info->m_maxSampleRate;
+  if (rate < m_info->m_sampleRate)
+    rate = m_info->m_sampleRate;
+
+  if (rate != m_audioMixer->GetSampleRate()) {
+    PTRACE(3, "Changing audio sample rate from " << m_audioMixer->GetSampleRate() << " to " << rate << " on " << *this);
+    m_audioMixer->SetSampleRate(rate, true);
+  }
+}
+
+
 void OpalMixerNode::BroadcastUserInput(const OpalConnection * connection, const PString & value)
 {
   for (PSafePtr<OpalConnection> conn(m_connections, PSafeReference); conn != NULL; ++conn) {
@@ -1749,8 +2166,8 @@ void OpalAudioStreamMixer::PushOne(PSafePtr<OpalMixerMediaStream> & stream,
       return;
   }
 
-  OpalMediaFormat mediaFormat = stream->GetMediaFormat();
-  if (mediaFormat == OpalPCM16) {
+  OpalFrozenMediaFormatPtr mediaFormat = stream->GetFrozenMediaFormat();
+  if (mediaFormat->GetName() == GetOpalPCM16(m_sampleRate).GetName()) {
     if (cache.m_raw.GetPayloadSize() < stream->GetDataSize()) {
       MIXER_DEBUG_OUT(','
                    << cache.m_raw.GetTimestamp() << ','
@@ -1770,28 +2187,53 @@ void OpalAudioStreamMixer::PushOne(PSafePtr<OpalMixerMediaStream> & stream,
     return;
   }
 
-  if (cache.m_transcoder == NULL) {
-    cache.m_transcoder = OpalTranscoder::Create(OpalPCM16, mediaFormat);
+  if (cache.m_transcoder == NULL || cache.m_sampleRate != m_sampleRate) {
+    delete cache.m_resampler;
+    cache.m_resampler = NULL;
+    delete cache.m_transcoder;
+    cache.m_transcoder = NULL;
+    cache.m_sampleRate = m_sampleRate;
+
+    /* If the encoder does not take the mixer rate, resample to the rate it
+       does take, e.g. G.711 from a 48kHz mixer is via 8kHz PCM-16. */
+    const OpalMediaFormat & rawFormat = GetOpalPCM16(m_sampleRate);
+    OpalMediaFormat intermediateFormat;
+    if (OpalTranscoder::FindIntermediateFormat(rawFormat, mediaFormat->GetMediaFormat(), intermediateFormat)) {
+      if (!intermediateFormat.IsValid())
+        cache.m_transcoder = OpalTranscoder::Create(rawFormat, mediaFormat->GetMediaFormat());
+      else if ((cache.m_resampler = OpalTranscoder::Create(rawFormat, intermediateFormat)) != NULL)
+        cache.m_transcoder = OpalTranscoder::Create(intermediateFormat, mediaFormat->GetMediaFormat());
+    }
     if (cache.m_transcoder == NULL) {
-      PTRACE(2, "Could not create transcoder to "
+      PTRACE(2, "Could not create transcoder from " << rawFormat << " to "
              << mediaFormat << " for stream id " << stream->GetID());
       CloseOne(stream);
       return;
     }
-    PTRACE(3, "Created transcoder to " << mediaFormat << " for stream id " << stream->GetID());
+    PTRACE(3, "Created transcoder from " << rawFormat
+           << (cache.m_resampler != NULL ? " via " + intermediateFormat.GetName() : PString::Empty())
+           << " to " << mediaFormat << " for stream id " << stream->GetID());
   }
 
-  if (cache.m_raw.GetPayloadSize() < cache.m_transcoder->GetOptimalDataFrameSize(true)) {
+  PINDEX rawSize = cache.m_transcoder->GetOptimalDataFrameSize(true);
+  if (cache.m_resampler != NULL)
+    rawSize = rawSize*m_sampleRate/cache.m_resampler->GetOutputFormat().GetClockRate();
+
+  if (cache.m_raw.GetPayloadSize() < rawSize) {
     MIXER_DEBUG_OUT(','
                  << cache.m_raw.GetTimestamp() << ','
                  << cache.m_raw.GetPayloadSize() << ',');
     return;
   }
 
-  if (cache.m_encoded.SetPayloadSize(cache.m_transcoder->GetOptimalDataFrameSize(false)) &&
-      cache.m_transcoder->Convert(cache.m_raw, cache.m_encoded)) {
+  if ((cache.m_resampler == NULL || cache.m_resampler->Convert(cache.m_raw, cache.m_resampled)) &&
+      cache.m_encoded.SetPayloadSize(cache.m_transcoder->GetOptimalDataFrameSize(false)) &&
+      cache.m_transcoder->Convert(cache.m_resampler != NULL ? cache.m_resampled : cache.m_raw, cache.m_encoded)) {
     cache.m_encoded.SetPayloadType(cache.m_transcoder->GetPayloadType(false));
-    cache.m_encoded.SetTimestamp(cache.m_raw.GetTimestamp());
+    /* Mixed audio is in mixer sample rate units, scaling its timestamp would
+       not wrap at the same point as the codec clock, so advance our own. */
+    cache.m_encoded.SetTimestamp(cache.m_encodedTimestamp);
+    cache.m_encodedTimestamp += (unsigned)((PUInt64)cache.m_raw.GetPayloadSize()/sizeof(short)*mediaFormat->GetClockRate()/m_sampleRate);
     cache.m_state = CachedAudio::Completed;
     MIXER_DEBUG_OUT(cache.m_encoded.GetPayloadType() << ','
         << cache.m_encoded.GetTimestamp() << ','
@@ -1831,7 +2273,7 @@ bool OpalAudioStreamMixer::OnPush()
       PushOne(stream, m_cache[stream->GetID()], ((AudioStream *)inputStream->second)->m_cacheSamples);
     else {
       // Listen only participant, can use cached encoded audio
-      PString encodedFrameKey = stream->GetMediaFormat();
+      PString encodedFrameKey = stream->GetFrozenMediaFormat()->GetName();
       encodedFrameKey.sprintf(":%u", stream->GetDataSize());
       PushOne(stream, m_cache[encodedFrameKey], NULL);
     }
@@ -1864,13 +2306,17 @@ bool OpalAudioStreamMixer::OnPush()
 
 OpalAudioStreamMixer::CachedAudio::CachedAudio()
   : m_state(Collecting)
+  , m_resampler(NULL)
   , m_transcoder(NULL)
+  , m_sampleRate(0)
+  , m_encodedTimestamp(0)
 {
 }
 
 
 OpalAudioStreamMixer::CachedAudio::~CachedAudio()
 {
+  delete m_resampler;
   delete m_transcoder;
 }
 
@@ -1880,13 +2326,19 @@ OpalAudioStreamMixer::CachedAudio::~CachedAudio()
 #if OPAL_VIDEO
 OpalVideoStreamMixer::OpalVideoStreamMixer(const OpalMixerNodeInfo & info)
   : OpalVideoMixer(info.m_style, info.m_width, info.m_height, info.m_rate)
+  , m_mixCount(0)
+  , m_encodingThreads(info.m_encodingThreads)
+  , m_encodePool(NULL)
+  , m_encodesDone(0, INT_MAX)
 {
+  SetCompositingThreads(info.m_compositingThreads);
 }
 
 
 OpalVideoStreamMixer::~OpalVideoStreamMixer()
 {
   StopPushThread();
+  delete m_encodePool;
 }
 
 
@@ -1895,6 +2347,7 @@ bool OpalVideoStreamMixer::SetFrameRate(unsigned rate)
   if (!OpalVideoMixer::SetFrameRate(rate))
     return false;
 
+  PWaitAndSignal mutex(m_transcoderMutex);
   for (TranscoderMap::iterator it = m_transcoders.begin(); it != m_transcoders.end(); ++it) {
     OpalMediaFormat mediaFormat;
     mediaFormat.SetOptionInteger(OpalMediaFormat::FrameTimeOption(), m_periodTS);
@@ -1904,54 +2357,95 @@ bool OpalVideoStreamMixer::SetFrameRate(unsigned rate)
 }
 
 
+/* When the mixed frame is a repeat, the encoders are not given it, apart from
+   this often, so rate control, receivers and media timeouts see something. */
+static const PTimeInterval RepeatFrameRefreshTime(0, 1);
+
 bool OpalVideoStreamMixer::OnMixed(RTP_DataFrame * & output)
 {
-  typedef std::map<PString, RTP_DataFrameList> CachedPackets;
-  CachedPackets cachedPackets;
-  typedef std::map<unsigned, RTP_DataFrame> CachedFrameStore;
+  PTimeInterval now = PTimer::Tick();
+  ++m_mixCount;
+
+  EncodeJobMap encodeJobs;
+  typedef std::map<PString, RTP_DataFrame> CachedFrameStore;
   CachedFrameStore cachedFrameStore;
 
+  const OpalVideoTranscoder::FrameHeader * mixedHeader = (const OpalVideoTranscoder::FrameHeader *)output->GetPayloadPtr();
+
+  // Only need to look at the inputs if someone has their own layout
+  InputFrameMap inputs;
+  if (HasReceiverLayouts()) {
+    PWaitAndSignal mutex(m_mutex);
+    for (StreamMap_T::iterator iter = m_inputStreams.begin(); iter != m_inputStreams.end(); ++iter) {
+      VideoStream * vid = dynamic_cast<VideoStream *>(iter->second);
+      if (vid != NULL) {
+        InputFrame & input = inputs[iter->first];
+        input.m_frame = vid->m_lastFrame;
+        input.m_serial = vid->m_frameSerial;
+      }
+    }
+  }
+
   for (StreamDict::iterator it = m_outputStreams.begin(); it != m_outputStreams.end(); ++it) {
     PSafePtr<OpalMixerMediaStream> stream = it->second;
     if (stream->IsPaused())
       continue;
 
-    OpalMediaFormat mediaFormat = stream->GetMediaFormat();
-    if (mediaFormat == OpalYUV420P) {
+    RTP_DataFrame * mixed = output;
+    bool repeat = IsRepeatFrame();
+
+    PString layoutKey;
+    LayoutTiles tiles;
+    if (!inputs.empty() && GetReceiverTiles(stream->GetID(), inputs, mixedHeader->width, mixedHeader->height, tiles)) {
+      LayoutFrame & layout = RenderLayout(tiles, inputs, *output, layoutKey);
+      mixed = &layout.m_frame;
+      repeat = layout.m_repeat;
+    }
+
+    const OpalVideoTranscoder::FrameHeader * header = (const OpalVideoTranscoder::FrameHeader *)mixed->GetPayloadPtr();
+
+    OpalFrozenMediaFormatPtr frozenFormat = stream->GetFrozenMediaFormat();
+    if (frozenFormat->GetName() == OPAL_YUV420P) {
       stream.SetSafetyMode(PSafeReference); // OpalMediaStream::PushPacket might block
-      stream->PushPacket(*output);
+      stream->PushPacket(*mixed);
       stream.SetSafetyMode(PSafeReadOnly); // restore lock
     }
     else {
       unsigned width, height;
-      const OpalVideoTranscoder::FrameHeader * header = (const OpalVideoTranscoder::FrameHeader *)output->GetPayloadPtr();
       if (stream->CheckMixedVideoSize(header->width, header->height)) {
         // Try and set outgoing video to same size as mixed frame store
-        mediaFormat.SetOptionInteger(OpalVideoFormat::FrameWidthOption(), header->width);
-        mediaFormat.SetOptionInteger(OpalVideoFormat::FrameHeightOption(), header->height);
-        if (!stream->UpdateMediaFormat(mediaFormat, true)) {
+        OpalMediaFormat adjustedFormat = frozenFormat->GetMediaFormat();
+        adjustedFormat.SetOptionInteger(OpalVideoFormat::FrameWidthOption(), header->width);
+        adjustedFormat.SetOptionInteger(OpalVideoFormat::FrameHeightOption(), header->height);
+        if (!stream->UpdateMediaFormat(adjustedFormat, true)) {
           PTRACE(2, "Could not adjust media format to " << header->width << 'x' << header->height);
           continue;
         }
-        mediaFormat = stream->GetMediaFormat();
-        width = mediaFormat.GetOptionInteger(OpalVideoFormat::FrameWidthOption());
-        height = mediaFormat.GetOptionInteger(OpalVideoFormat::FrameHeightOption());
-        PTRACE(4, "Output of " << mediaFormat << " started at " << width << 'x' << height
+        frozenFormat = stream->GetFrozenMediaFormat();
+        width = frozenFormat->GetMediaFormat().GetOptionInteger(OpalVideoFormat::FrameWidthOption());
+        height = frozenFormat->GetMediaFormat().GetOptionInteger(OpalVideoFormat::FrameHeightOption());
+        PTRACE(4, "Output of " << *frozenFormat << " started at " << width << 'x' << height
                << " (" << header->width << 'x' << header->height << ")"
                   " to stream id " << stream->GetID());
       }
       else {
-        width = mediaFormat.GetOptionInteger(OpalVideoFormat::FrameWidthOption());
-        height = mediaFormat.GetOptionInteger(OpalVideoFormat::FrameHeightOption());
+        width = frozenFormat->GetMediaFormat().GetOptionInteger(OpalVideoFormat::FrameWidthOption());
+        height = frozenFormat->GetMediaFormat().GetOptionInteger(OpalVideoFormat::FrameHeightOption());
       }
 
+      PStringStream keyFrameStore;
+      keyFrameStore << width << 'x' << height;
+      if (!layoutKey.IsEmpty())
+        keyFrameStore << ' ' << layoutKey;
+
       PStringStream keyPackets;
-      keyPackets << mediaFormat << ' ' << width << 'x' << height;
+      keyPackets << frozenFormat->GetName() << ' ' << keyFrameStore;
 
-      CachedPackets::iterator itPackets = cachedPackets.find(keyPackets);
-      if (itPackets == cachedPackets.end()) {
+      EncodeJobMap::iterator itJob = encodeJobs.find(keyPackets);
+      if (itJob == encodeJobs.end()) {
         OpalTranscoder * transcoder = m_transcoders.GetAt(keyPackets);
         if (transcoder == NULL) {
+          OpalMediaFormat mediaFormat = frozenFormat->GetMediaFormat();
           mediaFormat.SetOptionInteger(OpalMediaFormat::FrameTimeOption(), m_periodTS);
           transcoder = OpalTranscoder::Create(OpalYUV420P, mediaFormat);
           if (transcoder == NULL) {
@@ -1961,58 +2455,448 @@ bool OpalVideoStreamMixer::OnMixed(RTP_DataFrame * & output)
           }
           PTRACE(3, "Created transcoder to " << mediaFormat << ' '
                  << width << 'x' << height << " for stream id " << stream->GetID());
+          PWaitAndSignal mutex(m_transcoderMutex);
           m_transcoders.SetAt(keyPackets, transcoder);
         }
+        else if (repeat && (now - m_lastEncodeTime[keyPackets]) < RepeatFrameRefreshTime) {
+          PTRACE(5, "Skipping encode of repeated video frame for " << keyPackets);
+          encodeJobs[keyPackets]; // Job with no transcoder so other streams with same format also skip
+          continue;
+        }
+        m_lastEncodeTime[keyPackets] = now;
 
         RTP_DataFrame * rawRTP;
         if (header->width == width && header->height == height) {
           PTRACE(5, "Using mixer video frame: " << width << 'x' << height);
-          rawRTP = output;
+          rawRTP = mixed;
         }
         else {
-          unsigned frameStoreKey = width + height*65536;
-          CachedFrameStore::iterator itFrameStore = cachedFrameStore.find(frameStoreKey);
+          CachedFrameStore::iterator itFrameStore = cachedFrameStore.find(keyFrameStore);
           if (itFrameStore != cachedFrameStore.end()) {
             PTRACE(5, "Using cached video frame: " << header->width << 'x' << header->height << " to " << width << 'x' << height);
             rawRTP = &itFrameStore->second;
           }
           else {
             PTRACE(5, "Scaling video frame: " << header->width << 'x' << header->height << " to " << width << 'x' << height);
-            rawRTP = &cachedFrameStore[frameStoreKey];
-            rawRTP->CopyHeader(*output);
+            rawRTP = &cachedFrameStore[keyFrameStore];
+            rawRTP->CopyHeader(*mixed);
             rawRTP->SetPayloadSize(PVideoFrameInfo::CalculateFrameBytes(width, height)+sizeof(OpalVideoTranscoder::FrameHeader));
             OpalVideoTranscoder::FrameHeader * resized = (OpalVideoTranscoder::FrameHeader *)rawRTP->GetPayloadPtr();
             resized->width = width;
             resized->height = height;
-            PColourConverter::CopyYUV420P(0, 0, header->width, header->height,
-                                          header->width, header->height, OpalVideoFrameDataPtr(header),
-                                          0, 0, width, height,
-                                          width, height, OpalVideoFrameDataPtr(resized),
-                                          PVideoFrameInfo::eScale);
+            m_scaler.Scale(header->width, header->height, OpalVideoFrameDataPtr(header),
+                           width, height, OpalVideoFrameDataPtr(resized));
           }
         }
 
-        RTP_DataFrameList packets;
-        if (!transcoder->ConvertFrames(*rawRTP, packets)) {
-          PTRACE(2, "Could not convert video to " << mediaFormat << " for stream id " << stream->GetID());
-          CloseOne(stream);
-          continue;
-        }
+        itJob = encodeJobs.insert(EncodeJobMap::value_type(keyPackets, EncodeJob())).first;
+        itJob->second.m_transcoder = transcoder;
+        itJob->second.m_rawRTP = rawRTP;
+      }
 
-        itPackets = cachedPackets.insert(CachedPackets::value_type(keyPackets, packets)).first;
+      // Pushed from encoder thread as soon as its encode is done
+      if (itJob->second.m_transcoder != NULL) {
+        stream.SetSafetyMode(PSafeReference); // OpalMediaStream::PushPacket might block
+        itJob->second.m_streams.push_back(stream);
       }
+    }
+  }
 
-      stream.SetSafetyMode(PSafeReference); // OpalMediaStream::PushPacket might block
+  EncodeAll(encodeJobs);
 
-      for (RTP_DataFrameList::iterator frame = itPackets->second.begin(); frame != itPackets->second.end(); ++frame)
-        stream->PushPacket(*frame);
+  for (EncodeJobMap::iterator itJob = encodeJobs.begin(); itJob != encodeJobs.end(); ++itJob) {
+    if (itJob->second.m_failed) {
+      PTRACE(2, "Could not convert video for " << itJob->first);
+      for (std::vector< PSafePtr<OpalMixerMediaStream> >::iterator stream = itJob->second.m_streams.begin(); stream != itJob->second.m_streams.end(); ++stream)
+        CloseOne(*stream);
+    }
+  }
 
-      stream.SetSafetyMode(PSafeReadOnly); // restore lock
+  PruneCaches(now);
+
+  return true;
+}
+
+
+void OpalVideoStreamMixer::EncodeAll(EncodeJobMap & jobs)
+{
+  PTimeInterval startTime = PTimer::Tick();
+
+  PWaitAndSignal mutex(m_transcoderMutex);
+
+  std::vector<EncodeJob *> active;
+  for (EncodeJobMap::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+    if (it->second.m_transcoder != NULL)
+      active.push_back(&it->second);
+  }
+
+  if (active.empty())
+    return;
+
+  /* Each distinct format/size/layout has its own transcoder and its own set
+     of output streams, so they can be encoded concurrently. The mixer thread
+     does the last one itself, rather than wait idle, and then waits for the
+     rest so the transcoders are never in use by two mixes at once. */
+  size_t queued = 0;
+  if (m_encodingThreads > 1 && active.size() > 1) {
+    if (m_encodePool == NULL)
+      m_encodePool = new EncodePool(m_encodingThreads, 0, "VideoMixEncode");
+
+    for (size_t i = 0; i < active.size()-1; ++i) {
+      EncodeWork * work = new EncodeWork(*active[i], m_encodesDone);
+      if (m_encodePool->AddWork(work))
+        ++queued;
+      else {
+        delete work;
+        active[i]->Encode();
+      }
     }
+    active.back()->Encode();
+  }
+  else {
+    for (std::vector<EncodeJob *>::iterator it = active.begin(); it != active.end(); ++it)
+      (*it)->Encode();
+  }
+
+  while (queued-- > 0)
+    m_encodesDone.Wait();
+
+  PTimeInterval encodeTime = PTimer::Tick() - startTime;
+  if (encodeTime.GetMilliSeconds() > m_periodMS/2) {
+    PTRACE(m_throttleEncodeTime, "Encoding " << active.size() << " formats took " << encodeTime
+           << ", more than half the frame period of " << m_periodMS << "ms" << m_throttleEncodeTime);
+  }
+  else {
+    PTRACE(DETAIL_LOG_LEVEL, "Encoding " << active.size() << " formats took " << encodeTime);
+  }
+}
+
+
+void OpalVideoStreamMixer::SetEncodingThreads(unsigned threads)
+{
+  PWaitAndSignal mutex(m_transcoderMutex);
+
+  if (m_encodingThreads == threads)
+    return;
+
+  PTRACE(4, "Encoding threads changed from " << m_encodingThreads << " to " << threads);
+  m_encodingThreads = threads;
+
+  // Recreated with new size on next mix
+  delete m_encodePool;
+  m_encodePool = NULL;
+}
+
+
+OpalVideoStreamMixer::EncodeJob::EncodeJob()
+  : m_transcoder(NULL)
+  , m_rawRTP(NULL)
+  , m_failed(false)
+{
+}
+
+
+void OpalVideoStreamMixer::EncodeJob::Encode()
+{
+  RTP_DataFrameList packets;
+  if (!m_transcoder->ConvertFrames(*m_rawRTP, packets)) {
+    m_failed = true;
+    return;
+  }
+
+  for (std::vector< PSafePtr<OpalMixerMediaStream> >::iterator stream = m_streams.begin(); stream != m_streams.end(); ++stream) {
+    for (RTP_DataFrameList::iterator frame = packets.begin(); frame != packets.end(); ++frame)
+      (*stream)->PushPacket(*frame);
+  }
+}
+
+
+OpalVideoStreamMixer::EncodeWork::EncodeWork(EncodeJob & job, PSemaphore & done)
+  : m_job(job)
+  , m_done(done)
+{
+}
+
+
+void OpalVideoStreamMixer::EncodeWork::Work()
+{
+  m_job.Encode();
+  m_done.Signal();
+}
+
+
+/* Transcoders for a receivers layout that has changed, e.g. due to a change
+   of focus, are not used again, so are removed after this long. */
+static const PTimeInterval UnusedTranscoderTime(0, 10);
+
+void OpalVideoStreamMixer::PruneCaches(const PTimeInterval & now)
+{
+  for (ScaledTileCache::iterator it = m_scaledTiles.begin(); it != m_scaledTiles.end(); ) {
+    if (it->second.m_lastUsed != m_mixCount)
+      m_scaledTiles.erase(it++);
+    else
+      ++it;
+  }
+
+  for (LayoutFrameCache::iterator it = m_layoutFrames.begin(); it != m_layoutFrames.end(); ) {
+    if (it->second.m_lastUsed != m_mixCount)
+      m_layoutFrames.erase(it++);
+    else
+      ++it;
+  }
+
+  for (std::map<PString, PTimeInterval>::iterator it = m_lastEncodeTime.begin(); it != m_lastEncodeTime.end(); ) {
+    if ((now - it->second) < UnusedTranscoderTime)
+      ++it;
+    else {
+      PTRACE(4, "Removing unused transcoder for " << it->first);
+      PWaitAndSignal mutex(m_transcoderMutex);
+      m_transcoders.RemoveAt(it->first);
+      m_lastEncodeTime.erase(it++);
+    }
+  }
+}
+
+
+void OpalVideoStreamMixer::SetLayout(const PString & outputId, Layouts layout)
+{
+  PWaitAndSignal mutex(m_layoutMutex);
+
+  if (layout == eCommonLayout)
+    m_receiverLayouts.erase(outputId);
+  else {
+    ReceiverLayout & info = m_receiverLayouts[outputId];
+    info.m_layout = layout;
+    if (layout != eCustomLayout)
+      info.m_tiles.clear();
+  }
+
+  PTRACE(3, "Set layout " << layout << " for stream id " << outputId);
+}
+
+
+void OpalVideoStreamMixer::SetCustomLayout(const PString & outputId, const LayoutTiles & tiles)
+{
+  PWaitAndSignal mutex(m_layoutMutex);
+
+  ReceiverLayout & info = m_receiverLayouts[outputId];
+  info.m_layout = eCustomLayout;
+  info.m_tiles = tiles;
+
+  PTRACE(3, "Set custom layout of " << tiles.size() << " tiles for stream id " << outputId);
+}
+
+
+OpalVideoStreamMixer::Layouts OpalVideoStreamMixer::GetLayout(const PString & outputId) const
+{
+  PWaitAndSignal mutex(m_layoutMutex);
+  ReceiverLayoutMap::const_iterator it = m_receiverLayouts.find(outputId);
+  return it != m_receiverLayouts.end() ? it->second.m_layout : eCommonLayout;
+}
+
+
+void OpalVideoStreamMixer::SetFocus(const PString & inputId)
+{
+  PWaitAndSignal mutex(m_layoutMutex);
+  if (m_focus != inputId) {
+    PTRACE(4, "Focus changed from \"" << m_focus << "\" to \"" << inputId << '"');
+    m_focus = inputId;
+  }
+}
+
+
+PString OpalVideoStreamMixer::GetFocus() const
+{
+  PWaitAndSignal mutex(m_layoutMutex);
+  return m_focus;
+}
+
+
+bool OpalVideoStreamMixer::HasReceiverLayouts() const
+{
+  PWaitAndSignal mutex(m_layoutMutex);
+  return !m_receiverLayouts.empty();
+}
+
+
+static void AddGridTiles(const PStringArray & keys, unsigned width, unsigned height, OpalVideoStreamMixer::LayoutTiles & tiles)
+{
+  PINDEX count = keys.GetSize();
+  if (count == 0)
+    return;
+
+  // Same progression as OpalVideoMixer::eGrid
+  unsigned columns = count <= 1 ? 1 : count <= 4 ? 2 : count <= 9 ? 3 : 4;
+  unsigned w = (width/columns) & 0xfffffffc;
+  unsigned h = (height/columns) & 0xfffffffc;
+  unsigned y = count == 2 ? ((height/4) & 0xfffffffe) : 0;
+
+  for (PINDEX i = 0; i < count && i < (PINDEX)(columns*columns); ++i)
+    tiles.push_back(OpalVideoStreamMixer::LayoutTile(keys[i], (i%columns)*w, y + (i/columns)*h, w, h));
+}
+
+
+bool OpalVideoStreamMixer::GetReceiverTiles(const PString & outputId,
+                                            const InputFrameMap & inputs,
+                                            unsigned width,
+                                            unsigned height,
+                                            LayoutTiles & tiles) const
+{
+  PWaitAndSignal mutex(m_layoutMutex);
+
+  ReceiverLayoutMap::const_iterator it = m_receiverLayouts.find(outputId);
+  if (it == m_receiverLayouts.end())
+    return false;
+
+  PStringArray others;
+  for (InputFrameMap::const_iterator input = inputs.begin(); input != inputs.end(); ++input) {
+    if (input->first != outputId && input->first != m_focus)
+      others.AppendString(input->first);
+  }
+
+  switch (it->second.m_layout) {
+    case eCustomLayout :
+      for (LayoutTiles::const_iterator tile = it->second.m_tiles.begin(); tile != it->second.m_tiles.end(); ++tile) {
+        // Same boundary restrictions as OpalVideoMixer::MixVideo()
+        LayoutTile adjusted(tile->m_key, tile->m_x & 0xfffffffe, tile->m_y & 0xfffffffe, tile->m_width & 0xfffffffc, tile->m_height & 0xfffffffc);
+        if (adjusted.m_width > 0 && adjusted.m_height > 0 &&
+            adjusted.m_x + adjusted.m_width <= width && adjusted.m_y + adjusted.m_height <= height)
+          tiles.push_back(adjusted);
+      }
+      break;
+
+    case eSpeakerFocus :
+      if (m_focus != outputId && inputs.find(m_focus) != inputs.end()) {
+        // Focus is 3/4 size at the top centre, everyone else is in a strip of up to four below
+        unsigned w = (width*3/4) & 0xfffffffc;
+        unsigned h = (height*3/4) & 0xfffffffc;
+        tiles.push_back(LayoutTile(m_focus, ((width - w)/2) & 0xfffffffe, 0, w, h));
+
+        unsigned sw = (width/4) & 0xfffffffc;
+        unsigned sh = (height - h) & 0xfffffffc;
+        for (PINDEX i = 0; i < others.GetSize() && i < 4; ++i)
+          tiles.push_back(LayoutTile(others[i], i*sw, h, sw, sh));
+        break;
+      }
+      // No focus, or receiver is the focus, so fall into next case for everyone else
+
+    default : // eExcludeSelf
+      if (m_focus != outputId && inputs.find(m_focus) != inputs.end())
+        others.InsertAt(0, new PString(m_focus));
+      AddGridTiles(others, width, height, tiles);
   }
 
   return true;
 }
+
+
+OpalVideoStreamMixer::LayoutFrame & OpalVideoStreamMixer::RenderLayout(const LayoutTiles & tiles,
+                                                                       const InputFrameMap & inputs,
+                                                                       const RTP_DataFrame & mixed,
+                                                                       PString & layoutKey)
+{
+  const OpalVideoTranscoder::FrameHeader * mixedHeader = (const OpalVideoTranscoder::FrameHeader *)mixed.GetPayloadPtr();
+  unsigned width = mixedHeader->width;
+  unsigned height = mixedHeader->height;
+
+  PStringStream strm;
+  for (LayoutTiles::const_iterator tile = tiles.begin(); tile != tiles.end(); ++tile)
+    strm << tile->m_key << '@' << tile->m_x << ',' << tile->m_y << '/' << tile->m_width << 'x' << tile->m_height << ';';
+  layoutKey = strm;
+
+  // Receivers with identical layouts share the one composite
+  LayoutFrame & layout = m_layoutFrames[layoutKey];
+  if (layout.m_lastUsed == m_mixCount)
+    return layout;
+  layout.m_lastUsed = m_mixCount;
+
+  std::vector<unsigned> serials;
+  for (LayoutTiles::const_iterator tile = tiles.begin(); tile != tiles.end(); ++tile) {
+    InputFrameMap::const_iterator input = inputs.find(tile->m_key);
+    serials.push_back(input != inputs.end() ? input->second.m_serial : 0);
+  }
+
+  // Previous frame may still be referenced by a media stream
+  layout.m_frame.MakeUnique();
+  layout.m_frame.CopyHeader(mixed);
+
+  PINDEX frameSize = PVideoFrameInfo::CalculateFrameBytes(width, height) + sizeof(OpalVideoTranscoder::FrameHeader);
+  layout.m_repeat = layout.m_frame.GetPayloadSize() == frameSize && layout.m_serials == serials;
+  if (layout.m_repeat)
+    return layout;
+
+  layout.m_serials = serials;
+  layout.m_frame.SetPayloadSize(frameSize);
+  OpalVideoTranscoder::FrameHeader * header = (OpalVideoTranscoder::FrameHeader *)layout.m_frame.GetPayloadPtr();
+  header->x = header->y = 0;
+  header->width = width;
+  header->height = height;
+  BYTE * frameStore = OpalVideoFrameDataPtr(header);
+  PColourConverter::FillYUV420P(0, 0, width, height, width, height, frameStore, m_bgFillRed, m_bgFillGreen, m_bgFillBlue);
+
+  for (LayoutTiles::const_iterator tile = tiles.begin(); tile != tiles.end(); ++tile) {
+    InputFrameMap::const_iterator input = inputs.find(tile->m_key);
+    if (input == inputs.end() || input->second.m_frame.GetPayloadSize() < (PINDEX)sizeof(OpalVideoTranscoder::FrameHeader))
+      continue;
+
+    // Tile is already the right size, so this is a straight copy
+    m_scaler.Scale(tile->m_width, tile->m_height, GetScaledTile(input->first, input->second, tile->m_width, tile->m_height),
+                   tile->m_x, tile->m_y, tile->m_width, tile->m_height, width, height, frameStore);
+  }
+
+  PTRACE(DETAIL_LOG_LEVEL, "Rendered layout of " << tiles.size() << " tiles: " << layoutKey);
+  return layout;
+}
+
+
+const BYTE * OpalVideoStreamMixer::GetScaledTile(const PString & inputId, const InputFrame & input, unsigned width, unsigned height)
+{
+  PStringStream key;
+  key << inputId << ' ' << width << 'x' << height;
+
+  /* Each input is scaled once per distinct tile size per new frame, no matter
+     how many receivers, or layouts, it appears in. */
+  ScaledTile & tile = m_scaledTiles[key];
+  tile.m_lastUsed = m_mixCount;
+  if (tile.m_serial != input.m_serial || tile.m_data.IsEmpty()) {
+    const OpalVideoTranscoder::FrameHeader * header = (const OpalVideoTranscoder::FrameHeader *)input.m_frame.GetPayloadPtr();
+    m_scaler.Scale(header->width, header->height, OpalVideoFrameDataPtr(header),
+                   width, height, tile.m_data.GetPointer(PVideoFrameInfo::CalculateFrameBytes(width, height)));
+    tile.m_serial = input.m_serial;
+  }
+
+  return tile.m_data;
+}
+
+
+OpalVideoStreamMixer::LayoutTile::LayoutTile(const PString & key, unsigned x, unsigned y, unsigned width, unsigned height)
+  : m_key(key)
+  , m_x(x)
+  , m_y(y)
+  , m_width(width)
+  , m_height(height)
+{
+}
+
+
+OpalVideoStreamMixer::InputFrame::InputFrame()
+  : m_serial(0)
+{
+}
+
+
+OpalVideoStreamMixer::ScaledTile::ScaledTile()
+  : m_serial(0)
+  , m_lastUsed(0)
+{
+}
+
+
+OpalVideoStreamMixer::LayoutFrame::LayoutFrame()
+  : m_lastUsed(0)
+  , m_repeat(false)
+{
+}
 #endif
 
 
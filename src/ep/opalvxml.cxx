@@ -88,6 +88,18 @@ bool OpalVXMLSession::OnTransfer(const PString & destination, TransferType type)
 }
 
 
+PBoolean OpalVXMLSession::PlayFile(const PString & fn, PINDEX repeat, PINDEX delay, PBoolean autoDelete)
+{
+  // Temporary files are only played once, so are not worth caching
+  PBYTEArray data;
+  if (autoDelete || !m_connection.GetEncodedPrompt(fn, data))
+    return PVXMLSession::PlayFile(fn, repeat, delay, autoDelete);
+
+  PTRACE(4, "IVR\tPlaying pre-encoded prompt \"" << fn << '"');
+  return PlayData(data, repeat, delay);
+}
+
+
 #endif // OPAL_IVR
 
 
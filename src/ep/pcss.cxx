@@ -48,6 +48,7 @@
 #include <opal/manager.h>
 #include <opal/patch.h>
 #include <lids/lid.h>
+#include <codec/tonecache.h>
 
 
 #define new PNEW
@@ -589,16 +590,23 @@ void OpalPCSSConnection::RingbackMain()
     } while (!m_ringbackStop.Wait(200));
   }
   else {
-    PTones tone(m_localRingbackTone);
-    PTimeInterval delay;
-    do {
-      if (channel->HasPlayCompleted()) {
-        tone.Write(*channel);
-        delay = tone.GetSize()*1000/tone.GetSampleRate()/2;
+    // Rendered once and shared by every connection using the same ringback
+    PShortArray tone;
+    if (OpalToneCache::GetInstance().GetRenderedTone(m_localRingbackTone, OpalPCM16.GetClockRate(), tone)) {
+      // Write 100ms at a time, blocking on the sound buffers, so stops promptly
+      PINDEX chunk = OpalPCM16.GetClockRate()/10;
+      PINDEX offset = 0;
+      while (!m_ringbackStop.Wait(0)) {
+        PINDEX count = std::min(chunk, tone.GetSize() - offset);
+        if (!channel->Write((const short *)tone + offset, count*sizeof(short))) {
+          PTRACE(2, "Ringback write failed: " << channel->GetErrorText(PChannel::LastWriteError));
+          break;
+        }
+        offset += count;
+        if (offset >= tone.GetSize())
+          offset = 0;
       }
-      else
-        delay = 10;
-    } while (!m_ringbackStop.Wait(delay));
+    }
   }
 
   delete channel;
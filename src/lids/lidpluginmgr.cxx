@@ -37,6 +37,7 @@
 #if OPAL_LID
 
 #include <lids/lidpluginmgr.h>
+#include <codec/tonecache.h>
 #include <ptclib/dtmf.h>
 
 
@@ -972,8 +973,8 @@ void OpalPluginLID::TonePlayer(PThread &, P_INT_PTR tone)
     m_player.SetVolume(100);
 
 #if OPAL_PTLIB_DTMF
-  PTones toneData;
-  if (toneData.Generate(m_callProgressTones[tone])) {
+  PShortArray toneData;
+  if (OpalToneCache::GetInstance().GetRenderedTone(m_callProgressTones[tone], OpalPCM16.GetClockRate(), toneData)) {
     while (!m_stopTone.Wait(0)) {
       if (!m_player.Write(toneData, toneData.GetSize()*2)) {
         PTRACE(2, "LID Plugin\tTone generation write failed.");
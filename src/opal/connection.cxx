@@ -135,17 +135,17 @@ OpalConnection::OpalConnection(OpalCall & call,
 #if OPAL_AEC
   , m_echoCanceler(NULL)
 #endif
-#if OPAL_PTLIB_DTMF
   , m_jitterParams(m_endpoint.GetManager().GetJitterParameters())
   , m_rxBandwidthAvailable(m_endpoint.GetInitialBandwidth(OpalBandwidth::Rx))
   , m_txBandwidthAvailable(m_endpoint.GetInitialBandwidth(OpalBandwidth::Tx))
+#if OPAL_DTMF_DETECT
   , m_dtmfScaleMultiplier(1)
   , m_dtmfScaleDivisor(1)
   , m_dtmfDetectNotifier(PCREATE_NOTIFIER(OnDetectInBandDTMF))
-  , m_sendInBandDTMF(true)
-  , m_emittedInBandDTMF(0)
 #endif
 #if OPAL_PTLIB_DTMF
+  , m_sendInBandDTMF(true)
+  , m_emittedInBandDTMF(0)
   , m_dtmfSendNotifier(PCREATE_NOTIFIER(OnSendInBandDTMF))
 #endif
 #if OPAL_HAS_MIXER
@@ -168,7 +168,7 @@ OpalConnection::OpalConnection(OpalCall & call,
   if (stringOptions != NULL)
     m_stringOptions.Merge(*stringOptions, PStringOptions::e_MergeOverwrite);
 
-#if OPAL_PTLIB_DTMF
+#if OPAL_DTMF_DETECT
   switch (options&DetectInBandDTMFOptionMask) {
     case DetectInBandDTMFOptionDisable :
       m_detectInBandDTMF = false;
@@ -1022,10 +1022,13 @@ void OpalConnection::OnClosedMediaStream(const OpalMediaStream & stream)
     }
 #endif
 
-#if OPAL_PTLIB_DTMF
+#if OPAL_DTMF_DETECT
     if (patch->RemoveFilter(m_dtmfDetectNotifier, OpalPCM16)) {
       PTRACE(4, "Removed detect DTMF filter on connection " << *this << ", patch " << patch);
     }
+#endif
+
+#if OPAL_PTLIB_DTMF
     if (!m_dtmfSendFormat.IsEmpty() && patch->RemoveFilter(m_dtmfSendNotifier, m_dtmfSendFormat)) {
       PTRACE(4, "Removed DTMF send filter on connection " << *this << ", patch " << patch);
     }
@@ -1111,12 +1114,14 @@ void OpalConnection::OnPatchMediaStream(PBoolean isSource, OpalMediaPatch & patc
 #endif
     }
 
-#if OPAL_PTLIB_DTMF
+#if OPAL_DTMF_DETECT
     if (m_detectInBandDTMF && isSource) {
       patch.AddFilter(m_dtmfDetectNotifier, OpalPCM16);
       PTRACE(4, "Added detect DTMF filter on connection " << *this << ", patch " << patch);
     }
+#endif
 
+#if OPAL_PTLIB_DTMF
     if (m_sendInBandDTMF && !isSource) {
       if (mediaFormat == OpalG711_ULAW_64K || mediaFormat == OpalG711_ALAW_64K)
         m_dtmfSendFormat = mediaFormat;
@@ -1514,26 +1519,26 @@ PBoolean OpalConnection::PromptUserInput(PBoolean /*play*/)
 }
 
 
-#if OPAL_PTLIB_DTMF
+#if OPAL_DTMF_DETECT
 void OpalConnection::OnDetectInBandDTMF(RTP_DataFrame & frame, P_INT_PTR)
 {
   // This function is set up as an 'audio filter'.
   // This allows us to access the 16 bit PCM audio (at 8Khz sample rate)
   // before the audio is passed on to the sound card (or other output device)
 
-  // Pass the 16 bit PCM audio through the DTMF decoder
-  PString tones = m_dtmfDecoder.Decode((const short *)frame.GetPayloadPtr(),
-                                       frame.GetPayloadSize()/sizeof(short),
-                                       m_dtmfScaleMultiplier,
-                                       m_dtmfScaleDivisor);
+  // Pass the 16 bit PCM audio through the DTMF detector, frames flagged as silent are skipped
+  PString tones = m_dtmfDetector.Decode(frame, m_dtmfScaleMultiplier, m_dtmfScaleDivisor);
   if (!tones.IsEmpty()) {
     PTRACE(3, "DTMF detected: \"" << tones << '"');
     for (PINDEX i = 0; i < tones.GetLength(); i++)
       GetEndPoint().GetManager().QueueDecoupledEvent(new PSafeWorkArg2<OpalConnection, char, unsigned>(
-                            this, tones[i], PDTMFDecoder::DetectTime, &OpalConnection::OnUserInputTone));
+                            this, tones[i], OpalDTMFDetector::DetectTime, &OpalConnection::OnUserInputTone));
   }
 }
+#endif
 
+
+#if OPAL_PTLIB_DTMF
 void OpalConnection::OnSendInBandDTMF(RTP_DataFrame & frame, P_INT_PTR)
 {
   if (m_inBandDTMF.IsEmpty())
@@ -1800,9 +1805,11 @@ void OpalConnection::OnApplyStringOptions()
 
 #if OPAL_PTLIB_DTMF
     m_sendInBandDTMF   = m_stringOptions.GetBoolean(OPAL_OPT_ENABLE_INBAND_DTMF, m_sendInBandDTMF);
-    m_detectInBandDTMF = m_stringOptions.GetBoolean(OPAL_OPT_DETECT_INBAND_DTMF, m_detectInBandDTMF);
     m_sendInBandDTMF   = m_stringOptions.GetBoolean(OPAL_OPT_SEND_INBAND_DTMF,   m_sendInBandDTMF);
+#endif
 
+#if OPAL_DTMF_DETECT
+    m_detectInBandDTMF = m_stringOptions.GetBoolean(OPAL_OPT_DETECT_INBAND_DTMF, m_detectInBandDTMF);
     m_dtmfScaleMultiplier = m_stringOptions.GetInteger(OPAL_OPT_DTMF_MULT, m_dtmfScaleMultiplier);
     m_dtmfScaleDivisor    = m_stringOptions.GetInteger(OPAL_OPT_DTMF_DIV,  m_dtmfScaleDivisor);
 #endif
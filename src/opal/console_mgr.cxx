@@ -1953,7 +1953,7 @@ PString OpalManagerConsole::GetArgumentSpec() const
 
          "[Audio options:]"
          "-jitter:           Set audio jitter buffer size (min[,max] default 50,250)\n"
-         "-silence-detect:   Set audio silence detect mode (\"none\", \"fixed\" or default \"adaptive\")\n"
+         "-silence-detect:   Set audio silence detect mode (\"none\", \"fixed\", \"subband\" or default \"adaptive\")\n"
          "-no-inband-detect. Disable detection of in-band tones.\n";
 
 #if OPAL_VIDEO
@@ -2175,6 +2175,8 @@ bool OpalManagerConsole::Initialise(PArgList & args, bool verbose, const PString
       params.m_mode = OpalSilenceDetector::AdaptiveSilenceDetection;
     else if (arg.NumCompare("fixed") == EqualTo)
       params.m_mode = OpalSilenceDetector::FixedSilenceDetection;
+    else if (arg.NumCompare("subband") == EqualTo)
+      params.m_mode = OpalSilenceDetector::SubBandSilenceDetection;
     else
       params.m_mode = OpalSilenceDetector::NoSilenceDetection;
     SetSilenceDetectParams(params);
@@ -3047,7 +3049,7 @@ bool OpalManagerCLI::Initialise(PArgList & args, bool verbose, const PString & d
 
   m_cli->SetCommand("audio vad", PCREATE_NOTIFIER(CmdSilenceDetect),
                     "Voice Activity Detection (aka Silence Detection)",
-                    "{ \"off\" | \"on\" | \"adaptive\" | <level> }");
+                    "{ \"off\" | \"on\" | \"adaptive\" | \"subband\" | <level> }");
   m_cli->SetCommand("audio in-band-dtmf-disable", m_disableDetectInBandDTMF, "In-band (digital filter) DTMF detection");
 
   m_cli->SetCommand("auto-start", PCREATE_NOTIFIER(CmdAutoStart),
@@ -3842,6 +3844,8 @@ void OpalManagerCLI::CmdSilenceDetect(PCLI::Arguments & args, P_INT_PTR)
       params.m_mode = OpalSilenceDetector::NoSilenceDetection;
     else if (PConstCaselessString("adaptive").NumCompare(args[0]) == EqualTo)
       params.m_mode = OpalSilenceDetector::AdaptiveSilenceDetection;
+    else if (PConstCaselessString("subband").NumCompare(args[0]) == EqualTo)
+      params.m_mode = OpalSilenceDetector::SubBandSilenceDetection;
     else if (args[0].FindSpan("0123456789") == P_MAX_INDEX) {
       params.m_mode = OpalSilenceDetector::FixedSilenceDetection;
       params.m_threshold = args[0].AsUnsigned();
@@ -3867,6 +3871,12 @@ void OpalManagerCLI::CmdSilenceDetect(PCLI::Arguments & args, P_INT_PTR)
              "silence deadband=" << params.m_silenceDeadband;
       break;
 
+    case OpalSilenceDetector::SubBandSilenceDetection:
+      out << "SUB-BAND, "
+             "signal deadband=" << params.m_signalDeadband << ", "
+             "silence deadband=" << params.m_silenceDeadband;
+      break;
+
     default :
       out << "OFF";
   }
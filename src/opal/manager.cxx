@@ -40,6 +40,7 @@
 #include <opal/patch.h>
 #include <opal/mediastrm.h>
 #include <codec/g711codec.h>
+#include <codec/resampler.h>
 #include <codec/vidcodec.h>
 #include <codec/rfc4175.h>
 #include <codec/rfc2435.h>
@@ -120,6 +121,9 @@ static const char * const DefaultMediaFormatMask[] = {
 // Linux it would not get loaded due to static initialisation optimisation
 OPAL_REGISTER_G711();
 
+// Same deal for the PCM-16 sample rate converters
+OPAL_REGISTER_PCM_RESAMPLERS();
+
 // Same deal for RC4175 video
 #if OPAL_RFC4175
 OPAL_REGISTER_RFC4175();
@@ -296,6 +300,7 @@ OpalManager::OpalManager()
   , m_defaultDisplayName(m_defaultUserName)
   , m_rtpPayloadSizeMax(1400) // RFC879 recommends 576 bytes, but that is ancient history, 99.999% of the time 1400+ bytes is used.
   , m_rtpPacketSizeMax(10*1024)
+  , m_videoEncoderQueueSize(0)
   , m_mediaFormatOrder(PARRAYSIZE(DefaultMediaFormatOrder), DefaultMediaFormatOrder)
   , m_mediaFormatMask(PARRAYSIZE(DefaultMediaFormatMask), DefaultMediaFormatMask)
   , m_disableDetectInBandDTMF(false)
@@ -402,6 +407,9 @@ OpalManager::~OpalManager()
   // Clean up any calls that the cleaner thread missed on the way out
   GarbageCollection();
 
+  // Before plug ins get unloaded
+  OpalTranscoderPool::GetInstance().Flush();
+
 #if OPAL_PTLIB_NAT
   PInterfaceMonitor::GetInstance().RemoveNotifier(m_onInterfaceChange);
   delete m_natMethods;
@@ -42,6 +42,10 @@
 #include <ptlib/videoio.h>
 #include <ptclib/cypher.h>
 
+#include <map>
+#include <list>
+#include <vector>
+
 
 #define new PNEW
 #define PTraceModule() "MediaFormat"
@@ -126,6 +130,194 @@ static PMutex & GetMediaFormatsListMutex()
 }
 
 
+/* Read only copy of the registered media formats, with indexes for the
+   common lookups. Media formats are constantly looked up by name or payload
+   type from all over the place, but are only registered at start up or
+   when plug ins are loaded, so lookups use the snapshot without taking the
+   global mutex. Any change to the registered formats discards the snapshot
+   and the next lookup builds a new one. Discarded snapshots are freed once
+   there are no readers at all, as a reader may still be using one. The
+   entries are copies that share the OpalMediaFormatInternal with the
+   registered formats, so in place updates of options are seen immediately,
+   and do not need a new snapshot. */
+class OpalMediaFormatSnapshot
+{
+  public:
+    OpalMediaFormatSnapshot(const OpalMediaFormatList & registeredFormats)
+    {
+      for (OpalMediaFormatList::const_iterator it = registeredFormats.begin(); it != registeredFormats.end(); ++it) {
+        OpalMediaFormat * format = new OpalMediaFormat(*it);
+        size_t index = m_index.size();
+
+        m_formats.OpalMediaFormatBaseList::Append(format);
+        m_index.push_back(format);
+
+        PCaselessString name = format->GetName();
+        if (m_byName.find(name) == m_byName.end())
+          m_byName[name] = index;
+
+        const char * encodingName = format->GetEncodingName();
+        if (encodingName != NULL && *encodingName != '\0')
+          m_byEncoding[encodingName].push_back(index);
+
+        RTP_DataFrame::PayloadTypes pt = format->GetPayloadType();
+        if (pt < RTP_DataFrame::LastKnownPayloadType)
+          m_byPayloadType[pt].push_back(index);
+      }
+    }
+
+    const OpalMediaFormatList & GetFormats() const { return m_formats; }
+
+    const OpalMediaFormat * FindFormat(const PString & wildcard) const
+    {
+      // Anything using wildcard features has to do the full search
+      if (wildcard.IsEmpty() || wildcard.FindOneOf("*@!") != P_MAX_INDEX) {
+        OpalMediaFormatList::const_iterator it = m_formats.FindFormat(wildcard);
+        return it != m_formats.end() ? &*it : NULL;
+      }
+
+      NameIndex::const_iterator it = m_byName.find(wildcard);
+      return it != m_byName.end() ? m_index[it->second] : NULL;
+    }
+
+    const OpalMediaFormat * FindFormat(RTP_DataFrame::PayloadTypes pt,
+                                       unsigned clockRate,
+                                       const char * name,
+                                       const char * protocol) const
+    {
+      // Same search order as OpalMediaFormatList::FindFormat(), encoding name first
+      if (name != NULL && *name != '\0') {
+        EncodingIndex::const_iterator it = m_byEncoding.find(name);
+        if (it != m_byEncoding.end()) {
+          for (std::vector<size_t>::const_iterator index = it->second.begin(); index != it->second.end(); ++index) {
+            const OpalMediaFormat & format = *m_index[*index];
+            if ((clockRate == 0    || clockRate == format.GetClockRate()) &&
+                (protocol  == NULL || format.IsValidForProtocol(protocol)))
+              return &format;
+          }
+        }
+      }
+
+      if (pt < RTP_DataFrame::LastKnownPayloadType) {
+        const std::vector<size_t> & indexes = m_byPayloadType[pt];
+        for (std::vector<size_t>::const_iterator index = indexes.begin(); index != indexes.end(); ++index) {
+          const OpalMediaFormat & format = *m_index[*index];
+          if (format.GetPayloadType() == pt && // In case changed in place
+              (clockRate == 0    || clockRate == format.GetClockRate()) &&
+              (protocol  == NULL || format.IsValidForProtocol(protocol)))
+            return &format;
+        }
+      }
+
+      return NULL;
+    }
+
+  protected:
+    typedef std::map<PCaselessString, size_t> NameIndex;
+    typedef std::map<PCaselessString, std::vector<size_t> > EncodingIndex;
+
+    OpalMediaFormatList                  m_formats;
+    std::vector<const OpalMediaFormat *> m_index;
+    NameIndex                            m_byName;
+    EncodingIndex                        m_byEncoding;
+    std::vector<size_t>                  m_byPayloadType[RTP_DataFrame::LastKnownPayloadType];
+};
+
+
+struct OpalMediaFormatSnapshots
+{
+  OpalMediaFormatSnapshots()
+    : m_current(NULL)
+    , m_readers(0)
+  {
+  }
+
+  ~OpalMediaFormatSnapshots()
+  {
+    OpalMediaFormatSnapshot * current = m_current;
+    delete current;
+    FreeRetired();
+  }
+
+  /* Must have GetMediaFormatsListMutex() locked. A reader counts itself
+     before loading m_current, so once the count is seen as zero after a
+     snapshot is retired, nothing can still be using it. */
+  void FreeRetired()
+  {
+    if (m_readers != 0)
+      return;
+
+    for (std::list<OpalMediaFormatSnapshot *>::iterator it = m_retired.begin(); it != m_retired.end(); ++it)
+      delete *it;
+    m_retired.clear();
+  }
+
+  atomic<OpalMediaFormatSnapshot *>    m_current;
+  atomic<unsigned>                     m_readers;
+  std::list<OpalMediaFormatSnapshot *> m_retired;
+};
+
+
+static OpalMediaFormatSnapshots & GetMediaFormatsSnapshots()
+{
+  static OpalMediaFormatSnapshots snapshots;
+  return snapshots;
+}
+
+
+// Holds the current snapshot, so it is not freed, for the lifetime of the object
+class OpalMediaFormatSnapshotRef
+{
+  public:
+    OpalMediaFormatSnapshotRef()
+      : m_snapshots(GetMediaFormatsSnapshots())
+    {
+      ++m_snapshots.m_readers;
+
+      if ((m_snapshot = m_snapshots.m_current) != NULL)
+        return;
+
+      PWaitAndSignal mutex(GetMediaFormatsListMutex());
+      OpalMediaFormatSnapshot * snapshot = m_snapshots.m_current;
+      if (snapshot == NULL) {
+        snapshot = new OpalMediaFormatSnapshot(GetMediaFormatsList());
+        m_snapshots.m_current = snapshot;
+      }
+      m_snapshot = snapshot;
+
+      // If we are the only reader, we are not using a retired one
+      --m_snapshots.m_readers;
+      m_snapshots.FreeRetired();
+      ++m_snapshots.m_readers;
+    }
+
+    ~OpalMediaFormatSnapshotRef()
+    {
+      --m_snapshots.m_readers;
+    }
+
+    const OpalMediaFormatSnapshot * operator->() const { return m_snapshot; }
+
+  private:
+    OpalMediaFormatSnapshots      & m_snapshots;
+    const OpalMediaFormatSnapshot * m_snapshot;
+};
+
+
+// Must have GetMediaFormatsListMutex() locked
+static void MediaFormatsListChanged()
+{
+  OpalMediaFormatSnapshots & snapshots = GetMediaFormatsSnapshots();
+  OpalMediaFormatSnapshot * snapshot = snapshots.m_current;
+  snapshots.m_current = NULL;
+  if (snapshot != NULL)
+    snapshots.m_retired.push_back(snapshot);
+  snapshots.FreeRetired();
+
+  OpalTranscoder::ClearSelectionCache();
+}
+
+
 static void Clamp(OpalMediaFormatInternal & fmt1, const OpalMediaFormatInternal & fmt2, const PString & variableOption, const PString & minOption, const PString & maxOption)
 {
   if (fmt1.FindOption(variableOption) == NULL)
@@ -816,11 +1008,9 @@ OpalMediaFormat::OpalMediaFormat(RTP_DataFrame::PayloadTypes pt, unsigned clockR
   : m_info(NULL)
   , m_dynamic(false)
 {
-  PWaitAndSignal mutex(GetMediaFormatsListMutex());
-  const OpalMediaFormatList & registeredFormats = GetMediaFormatsList();
-
-  OpalMediaFormatList::const_iterator fmt = registeredFormats.FindFormat(pt, clockRate, name, protocol);
-  if (fmt != registeredFormats.end())
+  OpalMediaFormatSnapshotRef snapshot;
+  const OpalMediaFormat * fmt = snapshot->FindFormat(pt, clockRate, name, protocol);
+  if (fmt != NULL)
     *this = *fmt;
 }
 
@@ -893,8 +1083,10 @@ void OpalMediaFormat::Construct(OpalMediaFormatInternal * info)
   if (fmt != registeredFormats.end()) {
     PAssert(!m_dynamic, PLogicError);
 
-    if (info->codecVersionTime > fmt->m_info->codecVersionTime)
+    if (info->codecVersionTime > fmt->m_info->codecVersionTime) {
       *fmt->m_info = *info;
+      MediaFormatsListChanged();
+    }
     else
       *this = *fmt;
     delete info;
@@ -902,6 +1094,7 @@ void OpalMediaFormat::Construct(OpalMediaFormatInternal * info)
   else {
     m_info = info;
     registeredFormats.OpalMediaFormatBaseList::Append(this);
+    MediaFormatsListChanged();
   }
 }
 
@@ -910,13 +1103,11 @@ OpalMediaFormat & OpalMediaFormat::operator=(RTP_DataFrame::PayloadTypes pt)
 {
   PWaitAndSignal m(m_mutex);
 
-  PWaitAndSignal mutex(GetMediaFormatsListMutex());
-  const OpalMediaFormatList & registeredFormats = GetMediaFormatsList();
-
-  OpalMediaFormatList::const_iterator fmt = registeredFormats.FindFormat(pt);
-  if (fmt == registeredFormats.end())
+  OpalMediaFormatSnapshotRef snapshot;
+  const OpalMediaFormat * fmt = snapshot->FindFormat(pt, 0, NULL, NULL);
+  if (fmt == NULL)
     *this = OpalMediaFormat();
-  else if (this != &*fmt)
+  else
     *this = *fmt;
 
   return *this;
@@ -933,11 +1124,10 @@ OpalMediaFormat & OpalMediaFormat::operator=(const char * wildcard)
 OpalMediaFormat & OpalMediaFormat::operator=(const PString & wildcard)
 {
   PWaitAndSignal m(m_mutex);
-  PWaitAndSignal mutex(GetMediaFormatsListMutex());
-  const OpalMediaFormatList & registeredFormats = GetMediaFormatsList();
 
-  OpalMediaFormatList::const_iterator fmt = registeredFormats.FindFormat(wildcard);
-  if (fmt == registeredFormats.end())
+  OpalMediaFormatSnapshotRef snapshot;
+  const OpalMediaFormat * fmt = snapshot->FindFormat(wildcard);
+  if (fmt == NULL)
     *this = OpalMediaFormat();
   else
     *this = *fmt;
@@ -1163,8 +1353,8 @@ OpalMediaFormatList OpalMediaFormat::GetAllRegisteredMediaFormats()
 
 void OpalMediaFormat::GetAllRegisteredMediaFormats(OpalMediaFormatList & copy)
 {
-  PWaitAndSignal mutex(GetMediaFormatsListMutex());
-  const OpalMediaFormatList & registeredFormats = GetMediaFormatsList();
+  OpalMediaFormatSnapshotRef snapshot;
+  const OpalMediaFormatList & registeredFormats = snapshot->GetFormats();
 
   for (OpalMediaFormatList::const_iterator format = registeredFormats.begin(); format != registeredFormats.end(); ++format)
     copy += *format;
@@ -1252,8 +1442,16 @@ bool OpalMediaFormat::SetRegisteredMediaFormat(const OpalMediaFormat & mediaForm
          be assigning the left hand side with exactly the same value. But what
          is really happening is the above only compares the name, and below
          copies all of the attributes (OpalMediaFormatOtions) across. */
+      RTP_DataFrame::PayloadTypes oldPayloadType = format->GetPayloadType();
+      PString oldEncodingName = format->GetEncodingName();
       *format->m_info = *mediaFormat.m_info;
       format->m_info->options.MakeUnique();
+
+      // Snapshot shares the internal data, so only needs rebuilding if an indexed field changed
+      if (format->GetPayloadType() != oldPayloadType || oldEncodingName != format->GetEncodingName())
+        MediaFormatsListChanged();
+      else
+        OpalTranscoder::ClearSelectionCache();
       return true;
     }
   }
@@ -1276,10 +1474,39 @@ bool OpalMediaFormat::RemoveRegisteredMediaFormats(const PString & wildcard)
     found = true;
   }
 
+  if (found)
+    MediaFormatsListChanged();
   return found;
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+
+OpalFrozenMediaFormat::OpalFrozenMediaFormat(const OpalMediaFormat & mediaFormat)
+  : m_mediaFormat(mediaFormat)
+  , m_name(mediaFormat.GetName())
+  , m_mediaType(mediaFormat.GetMediaType())
+  , m_payloadType(mediaFormat.GetPayloadType())
+  , m_encodingName(mediaFormat.GetEncodingName())
+  , m_clockRate(mediaFormat.GetClockRate())
+  , m_frameTime(mediaFormat.GetFrameTime())
+  , m_frameSize(mediaFormat.GetFrameSize())
+  , m_maxBandwidth(mediaFormat.GetMaxBandwidth())
+  , m_usedBandwidth(mediaFormat.GetUsedBandwidth())
+  , m_needsJitter(mediaFormat.NeedsJitterBuffer())
+  , m_transportable(mediaFormat.IsTransportable())
+{
+  // Do not share the internal data, or someone else could change it under us
+  m_mediaFormat.MakeUnique();
+}
+
+
+void OpalFrozenMediaFormat::PrintOn(ostream & strm) const
+{
+  strm << m_name;
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 
 OpalMediaFormatInternal::OpalMediaFormatInternal(const char * fullName,
@@ -1341,6 +1568,7 @@ OpalMediaFormatInternal::OpalMediaFormatInternal(const char * fullName,
 
   PWaitAndSignal mutex(GetMediaFormatsListMutex());
   DeconflictPayloadTypes(GetMediaFormatsList());
+  MediaFormatsListChanged();
 }
 
 
@@ -1984,6 +2212,8 @@ const PString & OpalVideoFormat::MaxRxFrameWidthOption()          { static const
 const PString & OpalVideoFormat::MaxRxFrameHeightOption()         { static const PConstString s(PLUGINCODEC_OPTION_MAX_RX_FRAME_HEIGHT);       return s; }
 const PString & OpalVideoFormat::TemporalSpatialTradeOffOption()  { static const PConstString s(PLUGINCODEC_OPTION_TEMPORAL_SPATIAL_TRADE_OFF);return s; }
 const PString & OpalVideoFormat::TxKeyFramePeriodOption()         { static const PConstString s(PLUGINCODEC_OPTION_TX_KEY_FRAME_PERIOD);       return s; }
+const PString & OpalVideoFormat::EncoderThreadsOption()           { static const PConstString s(PLUGINCODEC_OPTION_ENCODER_THREADS);           return s; }
+const PString & OpalVideoFormat::EncoderSlicesOption()            { static const PConstString s(PLUGINCODEC_OPTION_ENCODER_SLICES);            return s; }
 const PString & OpalVideoFormat::RateControlPeriodOption()        { static const PConstString s(PLUGINCODEC_OPTION_RATE_CONTROL_PERIOD);       return s; }
 const PString & OpalVideoFormat::FrameDropOption()                { static const PConstString s("Frame Drop");                                 return s; }
 const PString & OpalVideoFormat::FreezeUntilIntraFrameOption()    { static const PConstString s("Freeze Until Intra-Frame");                   return s; }
@@ -2173,8 +2403,8 @@ OpalMediaFormatList & OpalMediaFormatList::operator+=(const PString & wildcard)
 {
   MakeUnique();
 
-  PWaitAndSignal mutex(GetMediaFormatsListMutex());
-  OpalMediaFormatList & registeredFormats = GetMediaFormatsList();
+  OpalMediaFormatSnapshotRef snapshot;
+  const OpalMediaFormatList & registeredFormats = snapshot->GetFormats();
 
   OpalMediaFormatList::const_iterator fmt;
   while ((fmt = registeredFormats.FindFormat(wildcard, fmt)) != registeredFormats.end())
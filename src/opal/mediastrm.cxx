@@ -54,6 +54,40 @@
 #define new PNEW
 
 
+///////////////////////////////////////////////////////////////////////////////
+
+OpalFrozenMediaFormatPtr::OpalFrozenMediaFormatPtr(const OpalMediaStream & stream)
+  : m_stream(&stream)
+{
+  ++m_stream->m_frozenMediaFormatReaders;
+  m_format = m_stream->m_frozenMediaFormat;
+}
+
+
+OpalFrozenMediaFormatPtr::OpalFrozenMediaFormatPtr(const OpalFrozenMediaFormatPtr & other)
+  : m_stream(other.m_stream)
+  , m_format(other.m_format)
+{
+  ++m_stream->m_frozenMediaFormatReaders;
+}
+
+
+OpalFrozenMediaFormatPtr & OpalFrozenMediaFormatPtr::operator=(const OpalFrozenMediaFormatPtr & other)
+{
+  ++other.m_stream->m_frozenMediaFormatReaders;
+  --m_stream->m_frozenMediaFormatReaders;
+  m_stream = other.m_stream;
+  m_format = other.m_format;
+  return *this;
+}
+
+
+OpalFrozenMediaFormatPtr::~OpalFrozenMediaFormatPtr()
+{
+  --m_stream->m_frozenMediaFormatReaders;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 OpalMediaStream::OpalMediaStream(OpalConnection & conn, const OpalMediaFormat & fmt, unsigned _sessionID, PBoolean isSourceStream)
@@ -72,10 +106,14 @@ OpalMediaStream::OpalMediaStream(OpalConnection & conn, const OpalMediaFormat &
   , m_payloadType(m_mediaFormat.GetPayloadType())
   , m_frameTime(m_mediaFormat.GetFrameTime())
   , m_frameSize(m_mediaFormat.GetFrameSize())
+  , m_frozenMediaFormat(NULL)
+  , m_frozenMediaFormatReaders(0)
 {
   PTRACE_CONTEXT_ID_FROM(conn);
   PTRACE_CONTEXT_ID_TO(m_identifier);
 
+  PublishMediaFormat();
+
   if (m_defaultDataSize == 0)
     m_defaultDataSize = m_connection.GetEndPoint().GetManager().GetMaxRtpPayloadSize();
 
@@ -88,6 +126,11 @@ OpalMediaStream::~OpalMediaStream()
 {
   Close();
   m_connection.SafeDereference();
+
+  const OpalFrozenMediaFormat * frozen = m_frozenMediaFormat;
+  delete frozen;
+  FreeRetiredMediaFormats();
+
   PTRACE(5, "Destroyed " << (IsSource() ? "Source" : "Sink") << ' ' << this);
 }
 
@@ -112,6 +155,40 @@ OpalMediaFormat OpalMediaStream::GetMediaFormat() const
 }
 
 
+OpalFrozenMediaFormatPtr OpalMediaStream::GetFrozenMediaFormat() const
+{
+  return OpalFrozenMediaFormatPtr(*this);
+}
+
+
+void OpalMediaStream::PublishMediaFormat()
+{
+  const OpalFrozenMediaFormat * frozen = new OpalFrozenMediaFormat(m_mediaFormat);
+
+  PWaitAndSignal lock(m_frozenMediaFormatMutex);
+  const OpalFrozenMediaFormat * previous = m_frozenMediaFormat;
+  m_frozenMediaFormat = frozen;
+  if (previous != NULL)
+    m_retiredMediaFormats.push_back(previous);
+  FreeRetiredMediaFormats();
+}
+
+
+/* Must have m_frozenMediaFormatMutex locked, or be in the destructor. A
+   reader counts itself before loading m_frozenMediaFormat, so once the
+   count is seen as zero after a copy is retired, nothing can still be
+   using it. If there were readers, they are freed on the next publish. */
+void OpalMediaStream::FreeRetiredMediaFormats()
+{
+  if (m_frozenMediaFormatReaders != 0)
+    return;
+
+  for (std::list<const OpalFrozenMediaFormat *>::iterator it = m_retiredMediaFormats.begin(); it != m_retiredMediaFormats.end(); ++it)
+    delete *it;
+  m_retiredMediaFormats.clear();
+}
+
+
 bool OpalMediaStream::SetMediaFormat(const OpalMediaFormat & newMediaFormat)
 {
   if (!PAssert(newMediaFormat.IsValid(), PInvalidParameter))
@@ -129,6 +206,7 @@ bool OpalMediaStream::SetMediaFormat(const OpalMediaFormat & newMediaFormat)
 
     oldMediaFormat = m_mediaFormat;
     m_mediaFormat = newMediaFormat;
+    PublishMediaFormat();
 
     // We make referenced copy of pointer so can't be deleted out from under us
     mediaPatch = m_mediaPatch;
@@ -146,6 +224,7 @@ bool OpalMediaStream::SetMediaFormat(const OpalMediaFormat & newMediaFormat)
     // Couldn't switch, put it back
     P_INSTRUMENTED_LOCK_READ_WRITE(return false);
     m_mediaFormat = oldMediaFormat;
+    PublishMediaFormat();
   }
 
   mediaPatch->ResetTranscoders();
@@ -182,6 +261,7 @@ bool OpalMediaStream::InternalUpdateMediaFormat(const OpalMediaFormat & newMedia
   m_payloadType = m_mediaFormat.GetPayloadType();
   m_frameTime = m_mediaFormat.GetFrameTime();
   m_frameSize = m_mediaFormat.GetFrameSize();
+  PublishMediaFormat();
   return true;
 }
 
@@ -792,6 +872,76 @@ bool OpalNullMediaStream::InternalUpdateMediaFormat(const OpalMediaFormat & newM
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+
+#if OPAL_PTLIB_DTMF
+
+OpalToneMediaStream::OpalToneMediaStream(OpalConnection & conn,
+                                         const OpalMediaFormat & mediaFormat,
+                                         unsigned sessionID,
+                                         const PString & toneSpec)
+  : OpalNullMediaStream(conn, mediaFormat, sessionID, true, true)
+  , m_toneSpec(toneSpec)
+  , m_nextPacket(0)
+{
+}
+
+
+PBoolean OpalToneMediaStream::Open()
+{
+  if (m_isOpen)
+    return true;
+
+  m_nextPacket = 0;
+  if (!OpalToneCache::GetInstance().GetEncodedTone(m_toneSpec, m_mediaFormat, m_tone)) {
+    PTRACE(2, "Cannot play tone \"" << m_toneSpec << "\" using " << m_mediaFormat);
+    return false;
+  }
+
+  PTRACE(4, "Playing tone \"" << m_toneSpec << "\" using " << m_mediaFormat << ", " << m_tone.GetCount() << " packets");
+  return OpalNullMediaStream::Open();
+}
+
+
+PBoolean OpalToneMediaStream::ReadData(BYTE * buffer, PINDEX size, PINDEX & length)
+{
+  if (!IsOpen() || m_tone.GetCount() == 0)
+    return false;
+
+  if (m_nextPacket >= m_tone.GetCount())
+    m_nextPacket = 0;
+
+  length = m_tone.GetPayloadSize(m_nextPacket);
+  if (!PAssert(length <= size, PInvalidParameter))
+    return false;
+
+  memcpy(buffer, m_tone.GetPayload(m_nextPacket), length);
+  ++m_nextPacket;
+
+  m_timestamp += m_tone.m_packetTime;
+
+  // Pace on the time in the packet, as encoded size may vary
+  unsigned frames = OpalMediaStreamPacing::m_frameTime > 0 ? m_tone.m_packetTime/OpalMediaStreamPacing::m_frameTime : 1;
+  Pace(true, OpalMediaStreamPacing::m_frameSize*frames, m_marker);
+  return true;
+}
+
+
+bool OpalToneMediaStream::InternalUpdateMediaFormat(const OpalMediaFormat & newMediaFormat)
+{
+  if (!OpalNullMediaStream::InternalUpdateMediaFormat(newMediaFormat))
+    return false;
+
+  if (!m_isOpen)
+    return true;
+
+  m_nextPacket = 0;
+  return OpalToneCache::GetInstance().GetEncodedTone(m_toneSpec, m_mediaFormat, m_tone);
+}
+
+#endif // OPAL_PTLIB_DTMF
+
+
 ///////////////////////////////////////////////////////////////////////////////
 
 OpalRawMediaStream::OpalRawMediaStream(OpalConnection & conn,
@@ -43,6 +43,8 @@
 
 #if OPAL_VIDEO
 #include <codec/vidcodec.h>
+#include <rtp/rtp_stream.h>
+#include <rtp/simulcast.h>
 #endif
 
 #define PTraceModule() "Patch"
@@ -283,9 +285,101 @@ static bool SetStreamDataSize(OpalMediaStream & stream, OpalTranscoder & codec)
 
 bool OpalMediaPatch::Sink::CreateTranscoders()
 {
-  delete m_primaryCodec;
+  std::list<Sink *> sharers;
+  DetachEncoder(sharers);
+
+  bool ok;
+  {
+#if OPAL_VIDEO
+    // Exclude the encode thread, if there is one, while the codecs are swapped
+    PWaitAndSignal lock(m_encodeMutex);
+#endif
+
+    ok = InternalCreateTranscoders();
+
+#if OPAL_VIDEO
+    if (ok && m_encodePipeline == NULL && IsVideoEncoder()) {
+      PINDEX queueSize = m_patch.m_source.GetConnection().GetEndPoint().GetManager().GetVideoEncoderQueueSize();
+      if (queueSize > 0)
+        m_encodePipeline = new EncodePipeline(*this, queueSize);
+    }
+#endif
+  }
+
+  // Any sinks that were sharing our encoder need to find another one
+  for (std::list<Sink *>::iterator it = sharers.begin(); it != sharers.end(); ++it)
+    (*it)->CreateTranscoders();
+
+  return ok;
+}
+
+
+static bool IsSameEncodedFormat(const OpalMediaFormat & fmt1, const OpalMediaFormat & fmt2)
+{
+  if (fmt1 != fmt2 || !fmt1.IsTransportable())
+    return false;
+
+  PStringToString options1 = fmt1.GetOptions();
+  PStringToString options2 = fmt2.GetOptions();
+  if (options1.GetSize() != options2.GetSize())
+    return false;
+
+  for (PStringToString::const_iterator it = options1.begin(); it != options1.end(); ++it) {
+    if (options2(it->first) != it->second)
+      return false;
+  }
+
+  return true;
+}
+
+
+OpalMediaPatch::Sink * OpalMediaPatch::Sink::FindEncoderOwner(const OpalMediaFormat & destinationFormat)
+{
+  // Only RTP streams rewrite the headers so each receiver gets its own SSRC and sequence numbers
+  if (dynamic_cast<OpalRTPMediaStream *>(&*m_stream) == NULL)
+    return NULL;
+
+#if OPAL_VIDEO
+  if (m_simulcast != NULL)
+    return NULL;
+#endif
+
+  for (PList<Sink>::iterator s = m_patch.m_sinks.begin(); s != m_patch.m_sinks.end(); ++s) {
+    if (&*s != this &&
+        s->m_encoderOwner == NULL &&
+        s->m_primaryCodec != NULL &&
+#if OPAL_VIDEO
+        s->m_simulcast == NULL &&
+#endif
+        dynamic_cast<OpalRTPMediaStream *>(&*s->m_stream) != NULL &&
+        IsSameEncodedFormat(s->m_stream->GetMediaFormat(), destinationFormat))
+      return &*s;
+  }
+
+  return NULL;
+}
+
+
+void OpalMediaPatch::Sink::DetachEncoder(std::list<Sink *> & sharers)
+{
+  if (m_encoderOwner != NULL) {
+    PWaitAndSignal lock(m_encoderOwner->m_encoderSharersMutex);
+    m_encoderOwner->m_encoderSharers.remove(this);
+    m_encoderOwner = NULL;
+  }
+
+  PWaitAndSignal lock(m_encoderSharersMutex);
+  for (std::list<Sink *>::iterator it = m_encoderSharers.begin(); it != m_encoderSharers.end(); ++it)
+    (*it)->m_encoderOwner = NULL;
+  sharers.swap(m_encoderSharers);
+}
+
+
+bool OpalMediaPatch::Sink::InternalCreateTranscoders()
+{
+  OpalTranscoderPool::GetInstance().Release(m_primaryCodec);
   m_primaryCodec = NULL;
-  delete m_secondaryCodec;
+  OpalTranscoderPool::GetInstance().Release(m_secondaryCodec);
   m_secondaryCodec = NULL;
 
   // Find the media formats than can be used to get from source to sink
@@ -315,8 +409,22 @@ bool OpalMediaPatch::Sink::CreateTranscoders()
     return true;
   }
 
+  Sink * owner = FindEncoderOwner(destinationFormat);
+  if (owner != NULL) {
+    OpalTranscoder & codec = owner->m_secondaryCodec != NULL ? *owner->m_secondaryCodec : *owner->m_primaryCodec;
+    if (!SetStreamDataSize(*m_stream, codec))
+      return false;
+    m_stream->InternalUpdateMediaFormat(codec.GetOutputFormat());
+
+    PWaitAndSignal lock(owner->m_encoderSharersMutex);
+    owner->m_encoderSharers.push_back(this);
+    m_encoderOwner = owner;
+    PTRACE(3, "Added media stream sink " << *m_stream << " sharing encoder with " << *owner->m_stream);
+    return true;
+  }
+
   PString id = m_stream->GetID();
-  m_primaryCodec = OpalTranscoder::Create(sourceFormat, destinationFormat, (const BYTE *)id, id.GetLength());
+  m_primaryCodec = OpalTranscoderPool::GetInstance().Acquire(sourceFormat, destinationFormat, (const BYTE *)id, id.GetLength());
   if (m_primaryCodec != NULL) {
     PTRACE_CONTEXT_ID_TO(m_primaryCodec);
     PTRACE(4, "Created primary codec " << sourceFormat << "->" << destinationFormat << " with ID " << id);
@@ -326,6 +434,8 @@ bool OpalMediaPatch::Sink::CreateTranscoders()
     m_primaryCodec->SetMaxOutputSize(m_stream->GetDataSize());
     m_primaryCodec->SetSessionID(m_patch.m_source.GetSessionID());
     m_primaryCodec->SetCommandNotifier(PCREATE_NOTIFIER_EXT(&m_patch, OpalMediaPatch, InternalOnMediaCommand1));
+    if (sourceFormat.GetMediaType() == OpalMediaType::Audio() && dynamic_cast<OpalRTPMediaStream *>(&m_patch.m_source) != NULL)
+      m_primaryCodec->SetConcealment(true); // Gaps from the jitter buffer
 
     if (!SetStreamDataSize(m_patch.m_source, *m_primaryCodec))
       return false;
@@ -361,8 +471,8 @@ bool OpalMediaPatch::Sink::CreateTranscoders()
                                   true);
   }
 
-  m_primaryCodec = OpalTranscoder::Create(sourceFormat, intermediateFormat, (const BYTE *)id, id.GetLength());
-  m_secondaryCodec = OpalTranscoder::Create(intermediateFormat, destinationFormat, (const BYTE *)id, id.GetLength());
+  m_primaryCodec = OpalTranscoderPool::GetInstance().Acquire(sourceFormat, intermediateFormat, (const BYTE *)id, id.GetLength());
+  m_secondaryCodec = OpalTranscoderPool::GetInstance().Acquire(intermediateFormat, destinationFormat, (const BYTE *)id, id.GetLength());
   if (m_primaryCodec == NULL || m_secondaryCodec == NULL)
     return false;
 
@@ -374,6 +484,8 @@ bool OpalMediaPatch::Sink::CreateTranscoders()
   m_primaryCodec->SetSessionID(m_patch.m_source.GetSessionID());
   m_primaryCodec->SetCommandNotifier(PCREATE_NOTIFIER_EXT(&m_patch, OpalMediaPatch, InternalOnMediaCommand1));
   m_primaryCodec->UpdateMediaFormats(OpalMediaFormat(), m_secondaryCodec->GetInputFormat());
+  if (sourceFormat.GetMediaType() == OpalMediaType::Audio() && dynamic_cast<OpalRTPMediaStream *>(&m_patch.m_source) != NULL)
+    m_primaryCodec->SetConcealment(true); // Gaps from the jitter buffer
 
   if (!SetStreamDataSize(*m_stream, *m_secondaryCodec))
     return false;
@@ -405,8 +517,14 @@ void OpalMediaPatch::RemoveSink(const OpalMediaStream & stream)
 
     for (PList<Sink>::iterator s = m_sinks.begin(); s != m_sinks.end(); ++s) {
       if (s->m_stream == &stream) {
+        std::list<Sink *> sharers;
+        s->DetachEncoder(sharers);
         m_sinks.erase(s);
         PTRACE(5, "Removed sink " << stream << " from " << *this);
+
+        // Sinks that were sharing the removed encoder need another one
+        for (std::list<Sink *>::iterator it = sharers.begin(); it != sharers.end(); ++it)
+          (*it)->CreateTranscoders();
         break;
       }
     }
@@ -454,7 +572,7 @@ OpalTranscoder * OpalMediaPatch::GetAndLockSinkTranscoder(PINDEX i) const
     return NULL;
   }
 
-  Sink & sink = m_sinks[i];
+  Sink & sink = m_sinks[i].m_encoderOwner != NULL ? *m_sinks[i].m_encoderOwner : m_sinks[i];
   if (sink.m_secondaryCodec != NULL) 
     return sink.m_secondaryCodec;
 
@@ -517,22 +635,224 @@ void OpalMediaPatch::Sink::GetStatistics(OpalMediaStatistics & statistics, bool
 #endif // OPAL_STATISTICS
 
 
+#if OPAL_VIDEO
+/* Encodes raw video on one thread and sends the resulting packets from
+   another, so the patch thread need only queue a copy of each raw frame.
+   If the encoder falls behind, the oldest raw frame is discarded so that
+   latency stays bounded by the queue size. */
+class OpalMediaPatch::Sink::EncodePipeline
+{
+  public:
+    EncodePipeline(Sink & sink, PINDEX queueSize)
+      : m_sink(sink)
+      , m_queueSize(queueSize)
+      , m_running(true)
+      , m_droppedFrames(0)
+    {
+      m_encodeThread = new PThreadObj<EncodePipeline>(*this, &EncodePipeline::EncodeMain, false, "VidEncode", PThread::HighPriority);
+      m_sendThread = new PThreadObj<EncodePipeline>(*this, &EncodePipeline::SendMain, false, "VidSend", PThread::HighPriority);
+      PTRACE(3, "Started pipelined video encoding, queue size " << queueSize << ", on " << sink.m_patch);
+    }
+
+
+    ~EncodePipeline()
+    {
+      m_running = false;
+      m_rawAvailable.Signal();
+      m_encodedAvailable.Signal();
+      m_spaceAvailable.Signal();
+      PThread::WaitAndDelete(m_encodeThread);
+      PThread::WaitAndDelete(m_sendThread);
+
+      while (!m_encodedFrames.empty()) {
+        delete m_encodedFrames.front();
+        m_encodedFrames.pop_front();
+      }
+
+      PTRACE(3, "Stopped pipelined video encoding, dropped " << m_droppedFrames << " frames, on " << m_sink.m_patch);
+    }
+
+
+    void QueueFrame(const RTP_DataFrame & frame)
+    {
+      RTP_DataFrame copy(frame);
+      copy.MakeUnique();
+
+      {
+        PWaitAndSignal lock(m_queueMutex);
+        if (m_rawFrames.size() >= (size_t)m_queueSize) {
+          m_rawFrames.pop_front();
+          ++m_droppedFrames;
+          PTRACE_IF(4, (m_droppedFrames % 100) == 1, "Video encoder behind, dropped " << m_droppedFrames << " frames on " << m_sink.m_patch);
+        }
+        m_rawFrames.push_back(copy);
+      }
+
+      m_rawAvailable.Signal();
+    }
+
+
+  protected:
+    void EncodeMain()
+    {
+      PTRACE(4, "Video encode thread started for " << m_sink.m_patch);
+
+      RTP_DataFrame rawFrame(0);
+      while (m_running) {
+        if (!PopRawFrame(rawFrame)) {
+          m_rawAvailable.Wait(100);
+          continue;
+        }
+
+        RTP_DataFrameList * packets = new RTP_DataFrameList;
+        bool ok;
+        {
+          PWaitAndSignal lock(m_sink.m_encodeMutex);
+          ok = m_sink.m_primaryCodec != NULL && m_sink.TranscodeFrame(rawFrame, packets);
+        }
+
+        if (!ok || packets->IsEmpty() || !PushEncodedFrame(packets))
+          delete packets;
+      }
+
+      PTRACE(4, "Video encode thread ended for " << m_sink.m_patch);
+    }
+
+
+    void SendMain()
+    {
+      PTRACE(4, "Video send thread started for " << m_sink.m_patch);
+
+      while (m_running) {
+        RTP_DataFrameList * packets = NULL;
+        {
+          PWaitAndSignal lock(m_queueMutex);
+          if (!m_encodedFrames.empty()) {
+            packets = m_encodedFrames.front();
+            m_encodedFrames.pop_front();
+          }
+        }
+
+        if (packets == NULL) {
+          m_encodedAvailable.Wait(100);
+          continue;
+        }
+
+        m_spaceAvailable.Signal();
+
+        for (RTP_DataFrameList::iterator packet = packets->begin(); packet != packets->end(); ++packet) {
+          if (!m_sink.FanOutPacket(*packet)) {
+            PTRACE(4, "Video send failed on " << *m_sink.m_stream);
+            break;
+          }
+        }
+
+        delete packets;
+      }
+
+      PTRACE(4, "Video send thread ended for " << m_sink.m_patch);
+    }
+
+
+    bool PopRawFrame(RTP_DataFrame & frame)
+    {
+      PWaitAndSignal lock(m_queueMutex);
+      if (m_rawFrames.empty())
+        return false;
+
+      frame = m_rawFrames.front();
+      m_rawFrames.pop_front();
+      return true;
+    }
+
+
+    bool PushEncodedFrame(RTP_DataFrameList * packets)
+    {
+      // Never discard encoded data, as that would break the decoder at the far end
+      while (m_running) {
+        {
+          PWaitAndSignal lock(m_queueMutex);
+          if (m_encodedFrames.size() < (size_t)m_queueSize) {
+            m_encodedFrames.push_back(packets);
+            m_encodedAvailable.Signal();
+            return true;
+          }
+        }
+        m_spaceAvailable.Wait(100);
+      }
+      return false;
+    }
+
+
+    Sink                          & m_sink;
+    PINDEX                          m_queueSize;
+    atomic<bool>                    m_running;
+    std::list<RTP_DataFrame>        m_rawFrames;
+    std::list<RTP_DataFrameList *>  m_encodedFrames;
+    PDECLARE_MUTEX(                 m_queueMutex);
+    PSyncPoint                      m_rawAvailable;
+    PSyncPoint                      m_encodedAvailable;
+    PSyncPoint                      m_spaceAvailable;
+    unsigned                        m_droppedFrames;
+    PThread                       * m_encodeThread;
+    PThread                       * m_sendThread;
+};
+
+
+bool OpalMediaPatch::Sink::IsVideoEncoder() const
+{
+  if (m_primaryCodec == NULL)
+    return false;
+
+  OpalMediaFormat sourceFormat = m_patch.m_source.GetMediaFormat();
+  OpalMediaFormat destinationFormat = m_stream->GetMediaFormat();
+  return destinationFormat.GetMediaType() == OpalMediaType::Video() &&
+         destinationFormat.IsTransportable() &&
+        !sourceFormat.IsTransportable();
+}
+#endif // OPAL_VIDEO
+
+
 OpalMediaPatch::Sink::Sink(OpalMediaPatch & p, const OpalMediaStreamPtr & s)
   : m_patch(p)
   , m_stream(s)
   , m_primaryCodec(NULL)
   , m_secondaryCodec(NULL)
+  , m_encoderOwner(NULL)
+#if OPAL_VIDEO
+  , m_simulcast(NULL)
+  , m_encodePipeline(NULL)
+#endif
 {
   PTRACE_CONTEXT_ID_FROM(p);
 
+#if OPAL_VIDEO
+  OpalRTPMediaStream * rtpSource = dynamic_cast<OpalRTPMediaStream *>(&p.m_source);
+  if (rtpSource != NULL &&
+      rtpSource->GetMediaFormat().GetMediaType() == OpalMediaType::Video() &&
+      rtpSource->GetRtpSession().IsSimulcast())
+    m_simulcast = new OpalSimulcastSelector(rtpSource->GetMediaFormat());
+#endif
+
   PTRACE(3, "Created Sink for " << p);
 }
 
 
 OpalMediaPatch::Sink::~Sink()
 {
-  delete m_primaryCodec;
-  delete m_secondaryCodec;
+#if OPAL_VIDEO
+  // Must stop the threads before the codecs they use are released
+  delete m_encodePipeline;
+#endif
+
+  std::list<Sink *> sharers;
+  DetachEncoder(sharers);
+
+  OpalTranscoderPool::GetInstance().Release(m_primaryCodec);
+  OpalTranscoderPool::GetInstance().Release(m_secondaryCodec);
+#if OPAL_VIDEO
+  delete m_simulcast;
+#endif
 }
 
 
@@ -550,7 +870,14 @@ void OpalMediaPatch::AddFilter(const PNotifier & filter, const OpalMediaFormat &
       return;
     }
   }
+
+#if OPAL_VIDEO
+  LockEncoders();
+#endif
   m_filters.Append(new Filter(filter, stage));
+#if OPAL_VIDEO
+  UnlockEncoders();
+#endif
 }
 
 
@@ -560,7 +887,13 @@ PBoolean OpalMediaPatch::RemoveFilter(const PNotifier & filter, const OpalMediaF
 
   for (PList<Filter>::iterator f = m_filters.begin(); f != m_filters.end(); ++f) {
     if (f->m_notifier == filter && f->m_stage == stage) {
+#if OPAL_VIDEO
+      LockEncoders();
+#endif
       m_filters.erase(f);
+#if OPAL_VIDEO
+      UnlockEncoders();
+#endif
       return true;
     }
   }
@@ -570,9 +903,30 @@ PBoolean OpalMediaPatch::RemoveFilter(const PNotifier & filter, const OpalMediaF
 }
 
 
+#if OPAL_VIDEO
+void OpalMediaPatch::LockEncoders()
+{
+  // Should already be locked for write
+  for (PList<Sink>::iterator s = m_sinks.begin(); s != m_sinks.end(); ++s) {
+    if (s->m_encodePipeline != NULL)
+      s->m_encodeMutex.Wait();
+  }
+}
+
+
+void OpalMediaPatch::UnlockEncoders()
+{
+  for (PList<Sink>::iterator s = m_sinks.begin(); s != m_sinks.end(); ++s) {
+    if (s->m_encodePipeline != NULL)
+      s->m_encodeMutex.Signal();
+  }
+}
+#endif // OPAL_VIDEO
+
+
 void OpalMediaPatch::FilterFrame(RTP_DataFrame & frame, const OpalMediaFormat & mediaFormat)
 {
-  // Should already be locked for read
+  // Should already be locked for read, or the sinks encode mutex held
 
   for (PList<Filter>::iterator f = m_filters.begin(); f != m_filters.end(); ++f) {
     if (f->m_stage.IsEmpty() || f->m_stage == mediaFormat)
@@ -618,6 +972,23 @@ PBoolean OpalMediaPatch::ExecuteCommand(const OpalMediaCommand & command)
       toPatch = this;
   }
 
+#if OPAL_VIDEO
+  /* When forwarding simulcast, the bandwidth limit of a receiver selects the
+     layer sent to that receiver, it is not passed back to the sender. */
+  const OpalMediaFlowControl * flow = dynamic_cast<const OpalMediaFlowControl *>(&command);
+  if (flow != NULL && toPatch.SetSafetyMode(PSafeReadOnly)) {
+    for (PList<Sink>::iterator s = toPatch->m_sinks.begin(); s != toPatch->m_sinks.end(); ++s) {
+      if (s->SetSimulcastBitRate(*flow))
+        atLeastOne = true;
+    }
+    toPatch.SetSafetyMode(PSafeReference);
+    if (atLeastOne) {
+      PTRACE(4, "Simulcast layer selection by command \"" << command << "\" on " << *this);
+      return true;
+    }
+  }
+#endif
+
   if (fromPatch.SetSafetyMode(PSafeReadOnly)) {
     atLeastOne = fromPatch->m_source.InternalExecuteCommand(command);
     fromPatch.SetSafetyMode(PSafeReference);
@@ -881,7 +1252,7 @@ bool OpalMediaPatch::DispatchFrame(RTP_DataFrame & frame)
     return true;
   }
 
-  FilterFrame(frame, m_source.GetMediaFormat());
+  FilterFrame(frame, m_source.GetFrozenMediaFormat()->GetMediaFormat());
 
   OpalMediaPatchPtr patch = m_bypassToPatch;
   if (patch == NULL) {
@@ -922,6 +1293,10 @@ bool OpalMediaPatch::DispatchFrameLocked(RTP_DataFrame & frame, bool bypassing)
 
 bool OpalMediaPatch::Sink::UpdateMediaFormat(const OpalMediaFormat & mediaFormat)
 {
+  // Sharers have no codec of their own, the owner passes on its encoded format below
+  if (m_encoderOwner != NULL)
+    return false;
+
   bool ok;
 
   if (m_primaryCodec == NULL)
@@ -935,6 +1310,17 @@ bool OpalMediaPatch::Sink::UpdateMediaFormat(const OpalMediaFormat & mediaFormat
          m_stream->InternalUpdateMediaFormat(m_secondaryCodec->GetOutputFormat());
 
   PTRACE(3, "Updated Sink: format=" << mediaFormat << " ok=" << ok);
+
+  if (ok && m_primaryCodec != NULL) {
+    const OpalMediaFormat & encodedFormat = (m_secondaryCodec != NULL ? m_secondaryCodec : m_primaryCodec)->GetOutputFormat();
+    PWaitAndSignal lock(m_encoderSharersMutex);
+    for (std::list<Sink *>::iterator it = m_encoderSharers.begin(); it != m_encoderSharers.end(); ++it) {
+      if (!(*it)->m_stream->InternalUpdateMediaFormat(encodedFormat)) {
+        PTRACE(2, "Could not update sharing sink " << *(*it)->m_stream << " to " << encodedFormat);
+      }
+    }
+  }
+
   return ok;
 }
 
@@ -966,11 +1352,74 @@ bool OpalMediaPatch::Sink::ExecuteCommand(const OpalMediaCommand & command, bool
 }
 
 
+#if OPAL_VIDEO
+bool OpalMediaPatch::Sink::SetSimulcastBitRate(const OpalMediaFlowControl & flow)
+{
+  if (m_simulcast == NULL)
+    return false;
+
+  OpalRTPMediaStream * rtpStream = dynamic_cast<OpalRTPMediaStream *>(&*m_stream);
+  if (rtpStream == NULL)
+    return false;
+
+  const RTP_SyncSourceArray & ssrcs = flow.GetSSRCs();
+  if (std::find(ssrcs.begin(), ssrcs.end(), rtpStream->GetSyncSource()) == ssrcs.end() &&
+      std::find(ssrcs.begin(), ssrcs.end(), 0U) == ssrcs.end())
+    return false;
+
+  m_simulcast->SetAvailableBitRate(flow.GetMaxBitRate());
+  return true;
+}
+#endif // OPAL_VIDEO
+
+
 bool OpalMediaPatch::Sink::WriteFrame(RTP_DataFrame & sourceFrame, bool bypassing)
 {
-  if (m_stream->IsPaused())
-    return true;
+  if (m_encoderOwner != NULL && !bypassing)
+    return true; // Owner of the encoder sends us its output
 
+  if (m_stream->IsPaused()) {
+    if (bypassing)
+      return true;
+
+    // Still need to encode for any sinks sharing our encoder
+    PWaitAndSignal lock(m_encoderSharersMutex);
+    if (m_encoderSharers.empty())
+      return true;
+  }
+
+#if OPAL_VIDEO
+  if (m_simulcast != NULL) {
+    RTP_SequenceNumber sequenceNumber;
+    RTP_Timestamp timestamp;
+    bool selected = m_simulcast->SelectFrame(sourceFrame, sequenceNumber, timestamp);
+
+    RTP_SyncSourceId intraFrameSSRC = m_simulcast->GetIntraFrameRequest();
+    if (intraFrameSSRC != 0) {
+      OpalVideoUpdatePicture updatePicture(m_patch.m_source.GetSessionID(), intraFrameSSRC);
+      m_patch.InternalOnMediaCommand1(updatePicture, 0);
+    }
+
+    if (!selected)
+      return true;
+
+    /* Frame is shared by all sinks, so only copy it, to adjust the sequence
+       number and timestamp for the layer this sink is sending, when it is
+       actually going to be sent. Most frames are from other layers. */
+    RTP_DataFrame layerFrame(sourceFrame);
+    layerFrame.MakeUnique();
+    layerFrame.SetSequenceNumber(sequenceNumber);
+    layerFrame.SetTimestamp(timestamp);
+    return InternalWriteFrame(layerFrame, bypassing);
+  }
+#endif
+
+  return InternalWriteFrame(sourceFrame, bypassing);
+}
+
+
+bool OpalMediaPatch::Sink::InternalWriteFrame(RTP_DataFrame & sourceFrame, bool bypassing)
+{
   if (bypassing || m_primaryCodec == NULL) {
 #if OPAL_STATISTICS
     OpalAudioFormat::FrameType audioFrameType;
@@ -1046,6 +1495,52 @@ bool OpalMediaPatch::Sink::WriteFrame(RTP_DataFrame & sourceFrame, bool bypassin
     return true;
   }
 
+#if OPAL_VIDEO
+  if (m_encodePipeline != NULL) {
+    m_encodePipeline->QueueFrame(sourceFrame);
+    return true;
+  }
+#endif
+
+  return TranscodeFrame(sourceFrame, NULL);
+}
+
+
+bool OpalMediaPatch::Sink::WriteTranscodedFrame(RTP_DataFrame & frame, RTP_DataFrameList * output)
+{
+  if (output == NULL)
+    return FanOutPacket(frame);
+
+  // The codec re-uses its output frames, so need our own copy
+  RTP_DataFrame * packet = new RTP_DataFrame(frame);
+  packet->MakeUnique();
+  output->Append(packet);
+  return true;
+}
+
+
+bool OpalMediaPatch::Sink::FanOutPacket(RTP_DataFrame & packet)
+{
+  {
+    PWaitAndSignal lock(m_encoderSharersMutex);
+    for (std::list<Sink *>::iterator it = m_encoderSharers.begin(); it != m_encoderSharers.end(); ++it) {
+      /* Each receivers RTP session rewrites the SSRC and sequence number,
+         and may add header extensions, which moves the payload, so every
+         sharer needs its own copy of the encoded packet. */
+      if (!(*it)->m_stream->IsPaused()) {
+        RTP_DataFrame shared(packet);
+        shared.MakeUnique();
+        (*it)->m_stream->WritePacket(shared);
+      }
+    }
+  }
+
+  return m_stream->IsPaused() || m_stream->WritePacket(packet);
+}
+
+
+bool OpalMediaPatch::Sink::TranscodeFrame(RTP_DataFrame & sourceFrame, RTP_DataFrameList * output)
+{
   if (!m_primaryCodec->ConvertFrames(sourceFrame, m_intermediateFrames)) {
     PTRACE(1, "Media conversion (primary) failed");
     return false;
@@ -1055,7 +1550,7 @@ bool OpalMediaPatch::Sink::WriteFrame(RTP_DataFrame & sourceFrame, bool bypassin
     m_patch.FilterFrame(*interFrame, m_primaryCodec->GetOutputFormat());
 
     if (m_secondaryCodec == NULL) {
-      if (!m_stream->WritePacket(*interFrame))
+      if (!WriteTranscodedFrame(*interFrame, output))
         return false;
       if (m_primaryCodec == NULL)
         return true;
@@ -1070,7 +1565,7 @@ bool OpalMediaPatch::Sink::WriteFrame(RTP_DataFrame & sourceFrame, bool bypassin
 
     for (RTP_DataFrameList::iterator finalFrame = m_finalFrames.begin(); finalFrame != m_finalFrames.end(); ++finalFrame) {
       m_patch.FilterFrame(*finalFrame, m_secondaryCodec->GetOutputFormat());
-      if (!m_stream->WritePacket(*finalFrame))
+      if (!WriteTranscodedFrame(*finalFrame, output))
         return false;
       if (m_secondaryCodec == NULL)
         return true;
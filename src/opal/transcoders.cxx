@@ -35,6 +35,9 @@
 
 #include <opal/transcoders.h>
 
+#include <set>
+#include <vector>
+
 
 #define new PNEW
 #define PTraceModule() "Transcoder"
@@ -83,7 +86,21 @@ OpalTranscoder::OpalTranscoder(const OpalMediaFormat & inputMediaFormat,
   , m_outClockRate(outputMediaFormat.GetClockRate())
   , m_lastPayloadType(RTP_DataFrame::IllegalPayloadType)
   , m_consecutivePayloadTypeMismatches(0)
+#if OPAL_G711PLC
+  , m_concealment(NULL)
+  , m_concealChannels(1)
+  , m_concealFrameSize(0)
+  , m_concealedSamples(0)
+#endif
+{
+}
+
+
+OpalTranscoder::~OpalTranscoder()
 {
+#if OPAL_G711PLC
+  delete m_concealment;
+#endif
 }
 
 
@@ -103,6 +120,32 @@ bool OpalTranscoder::OnCreated(const OpalMediaFormat & srcFormat,
 }
 
 
+bool OpalTranscoder::Reset()
+{
+  return false;
+}
+
+
+bool OpalTranscoder::OnReused(const OpalMediaFormat & srcFormat,
+                              const OpalMediaFormat & destFormat,
+                              const BYTE * instance, unsigned instanceLen)
+{
+  PWaitAndSignal mutex(updateMutex);
+
+  maxOutputSize = 32768;
+  commandNotifier = PNotifier();
+  m_sessionID = 0;
+  m_lastPayloadType = RTP_DataFrame::IllegalPayloadType;
+  m_consecutivePayloadTypeMismatches = 0;
+#if OPAL_G711PLC
+  delete m_concealment;
+  m_concealment = NULL;
+#endif
+
+  return OpalTranscoder::OnCreated(srcFormat, destFormat, instance, instanceLen);
+}
+
+
 bool OpalTranscoder::UpdateMediaFormats(const OpalMediaFormat & input, const OpalMediaFormat & output)
 {
   PWaitAndSignal mutex(updateMutex);
@@ -206,10 +249,21 @@ PBoolean OpalTranscoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
   // and the input payload directly from the input media format
   outframe.SetPayloadType(GetPayloadType(false));
 
-  // Check for if we handle empty payload packets, if not just return empty payload packet
+  // Check for if we handle empty payload packets, if not return concealed audio, or just an empty payload packet
   if (input.GetPayloadSize() == 0) {
+    // Deliberately removed, not lost, so nothing to decode or conceal
+    if (input.IsSuppressed()) {
+#if OPAL_G711PLC
+      m_concealFrameSize = 0;
+#endif
+      return true;
+    }
+
     if (AcceptEmptyPayload())
       return Convert(input, outframe);
+#if OPAL_G711PLC
+    InternalConceal(outframe);
+#endif
     return true;
   }
 
@@ -225,7 +279,7 @@ PBoolean OpalTranscoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
 
   // Check if we can handle different payload types
   if (AcceptOtherPayloads() || pt == GetPayloadType(true))
-    return Convert(input, outframe);
+    return InternalConvert(input, outframe);
 
   // If not see if we get a lot of consecutive ones
   if (pt != m_lastPayloadType) {
@@ -236,7 +290,7 @@ PBoolean OpalTranscoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
     // OK, we give in, you are really sending this payload type. Hopefully the actual codec is right!
     PTRACE(2, "Consecutive mismatched payload type, expected "  << GetPayloadType(true) << ", now using " << pt);
     inputMediaFormat.SetPayloadType(pt);
-    return Convert(input, outframe);
+    return InternalConvert(input, outframe);
   }
 
   PTRACE(4, "Removing frame with mismatched payload type " << pt << " - should be " << GetPayloadType(true));
@@ -244,6 +298,77 @@ PBoolean OpalTranscoder::ConvertFrames(const RTP_DataFrame & input, RTP_DataFram
 }
 
 
+bool OpalTranscoder::InternalConvert(const RTP_DataFrame & input, RTP_DataFrame & output)
+{
+  if (!Convert(input, output))
+    return false;
+
+#if OPAL_G711PLC
+  if (m_concealment != NULL && output.GetPayloadSize() > 0) {
+    // Remember the decoded audio, this also smooths the join after a concealed gap
+    m_concealFrameSize = output.GetPayloadSize();
+    m_concealedSamples = 0;
+    m_concealment->addtohistory((short *)output.GetPayloadPtr(), m_concealFrameSize/sizeof(short)/m_concealChannels);
+  }
+#endif
+
+  return true;
+}
+
+
+#if OPAL_G711PLC
+void OpalTranscoder::InternalConceal(RTP_DataFrame & output)
+{
+  /* Nothing to extend before the first decoded frame, and after the
+     concealment has faded out, an empty payload is the same silence. */
+  if (m_concealment == NULL || m_concealFrameSize == 0 || m_concealedSamples >= m_outClockRate*60/1000)
+    return;
+
+  if (!output.SetPayloadSize(m_concealFrameSize))
+    return;
+
+  unsigned samples = m_concealFrameSize/sizeof(short)/m_concealChannels;
+  m_concealment->dofe((short *)output.GetPayloadPtr(), samples);
+  m_concealedSamples += samples;
+  PTRACE(5, "Concealed lost frame: ts=" << output.GetTimestamp() << ", concealed=" << m_concealedSamples);
+}
+#endif // OPAL_G711PLC
+
+
+bool OpalTranscoder::SetConcealment(bool enable)
+{
+#if OPAL_G711PLC
+  PWaitAndSignal mutex(updateMutex);
+
+  delete m_concealment;
+  m_concealment = NULL;
+  m_concealFrameSize = 0;
+  m_concealedSamples = 0;
+
+  if (!enable)
+    return true;
+
+  if (AcceptEmptyPayload()) {
+    PTRACE(4, "Concealment not used, codec handles lost packets itself: " << *this);
+    return false;
+  }
+
+  m_concealChannels = outputMediaFormat.GetOptionInteger(OpalAudioFormat::ChannelsOption(), 1);
+  if (outputMediaFormat.GetName() != GetOpalPCM16(m_outClockRate, m_concealChannels).GetName()) {
+    PTRACE(4, "Concealment not used, output is not PCM: " << *this);
+    return false;
+  }
+
+  m_concealment = new OpalG711_PLC(m_outClockRate, m_concealChannels);
+  PTRACE(4, "Concealment of lost packets enabled: " << *this);
+  return true;
+#else
+  return !enable;
+#endif
+}
+
+
+
 OpalTranscoder * OpalTranscoder::Create(const OpalMediaFormat & srcFormat,
                                         const OpalMediaFormat & destFormat,
                                                    const BYTE * instance,
@@ -264,6 +389,185 @@ OpalTranscoder * OpalTranscoder::Create(const OpalMediaFormat & srcFormat,
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+
+OpalTranscoderPool::Statistics::Statistics()
+  : m_created(0)
+  , m_reused(0)
+  , m_returned(0)
+  , m_discarded(0)
+  , m_idle(0)
+{
+}
+
+
+OpalTranscoderPool::Entry::Entry()
+  : m_maxIdle(UINT_MAX)
+{
+}
+
+
+OpalTranscoderPool::OpalTranscoderPool()
+  : m_defaultMaxIdle(DefaultMaxIdle)
+{
+}
+
+
+OpalTranscoderPool::~OpalTranscoderPool()
+{
+  Flush();
+}
+
+
+OpalTranscoderPool & OpalTranscoderPool::GetInstance()
+{
+  static OpalTranscoderPool pool;
+  return pool;
+}
+
+
+void OpalTranscoderPool::PrintOn(ostream & strm) const
+{
+  PWaitAndSignal mutex(m_mutex);
+
+  for (EntryMap::const_iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+    const Statistics & stats = it->second.m_statistics;
+    strm << it->first.first << "->" << it->first.second
+         << ": created=" << stats.m_created
+         << " reused=" << stats.m_reused
+         << " returned=" << stats.m_returned
+         << " discarded=" << stats.m_discarded
+         << " idle=" << stats.m_idle << '/' << GetMaxIdle(it->second)
+         << '\n';
+  }
+}
+
+
+unsigned OpalTranscoderPool::GetMaxIdle(const Entry & entry) const
+{
+  return entry.m_maxIdle != UINT_MAX ? entry.m_maxIdle : m_defaultMaxIdle;
+}
+
+
+OpalTranscoder * OpalTranscoderPool::Acquire(const OpalMediaFormat & srcFormat,
+                                             const OpalMediaFormat & destFormat,
+                                             const BYTE * instance,
+                                             unsigned instanceLen)
+{
+  OpalTranscoderKey key(srcFormat.GetName(), destFormat.GetName());
+
+  for (;;) {
+    OpalTranscoder * transcoder;
+    {
+      PWaitAndSignal mutex(m_mutex);
+      Entry & entry = m_entries[key];
+      if (entry.m_idle.empty())
+        break;
+      transcoder = entry.m_idle.front();
+      entry.m_idle.pop_front();
+      --entry.m_statistics.m_idle;
+      ++entry.m_statistics.m_reused;
+    }
+
+    // Do not hold the pool lock while the codec applies options
+    if (transcoder->OnReused(srcFormat, destFormat, instance, instanceLen)) {
+      PTRACE2(4, transcoder, "Re-using transcoder instance from " << srcFormat << " to " << destFormat);
+      return transcoder;
+    }
+
+    PTRACE2(2, transcoder, "Error re-using transcoder instance from " << srcFormat << " to " << destFormat);
+    delete transcoder;
+  }
+
+  OpalTranscoder * transcoder = OpalTranscoder::Create(srcFormat, destFormat, instance, instanceLen);
+  if (transcoder != NULL) {
+    PWaitAndSignal mutex(m_mutex);
+    ++m_entries[key].m_statistics.m_created;
+  }
+  return transcoder;
+}
+
+
+void OpalTranscoderPool::Release(OpalTranscoder * transcoder)
+{
+  if (transcoder == NULL)
+    return;
+
+  // Whoever set it is going away
+  transcoder->SetCommandNotifier(PNotifier());
+
+  OpalTranscoderKey key(transcoder->GetInputFormat().GetName(), transcoder->GetOutputFormat().GetName());
+
+  bool keep;
+  {
+    PWaitAndSignal mutex(m_mutex);
+    Entry & entry = m_entries[key];
+    keep = entry.m_statistics.m_idle < GetMaxIdle(entry);
+  }
+
+  // Do not hold the pool lock while the codec resets, and re-check the limit after
+  if (keep && transcoder->Reset()) {
+    PWaitAndSignal mutex(m_mutex);
+    Entry & entry = m_entries[key];
+    if (entry.m_statistics.m_idle < GetMaxIdle(entry)) {
+      entry.m_idle.push_back(transcoder);
+      ++entry.m_statistics.m_idle;
+      ++entry.m_statistics.m_returned;
+      PTRACE2(5, transcoder, "Returned transcoder instance to pool: " << *transcoder << ", idle=" << entry.m_statistics.m_idle);
+      return;
+    }
+  }
+
+  {
+    PWaitAndSignal mutex(m_mutex);
+    ++m_entries[key].m_statistics.m_discarded;
+  }
+
+  delete transcoder;
+}
+
+
+void OpalTranscoderPool::SetMaxIdle(unsigned count)
+{
+  PWaitAndSignal mutex(m_mutex);
+  m_defaultMaxIdle = count;
+}
+
+
+void OpalTranscoderPool::SetMaxIdle(const OpalMediaFormat & srcFormat, const OpalMediaFormat & destFormat, unsigned count)
+{
+  PWaitAndSignal mutex(m_mutex);
+  m_entries[OpalTranscoderKey(srcFormat.GetName(), destFormat.GetName())].m_maxIdle = count;
+}
+
+
+void OpalTranscoderPool::Flush()
+{
+  std::list<OpalTranscoder *> idle;
+
+  {
+    PWaitAndSignal mutex(m_mutex);
+    for (EntryMap::iterator it = m_entries.begin(); it != m_entries.end(); ++it) {
+      idle.splice(idle.end(), it->second.m_idle);
+      it->second.m_statistics.m_idle = 0;
+    }
+  }
+
+  PTRACE_IF(3, !idle.empty(), "Deleting " << idle.size() << " idle transcoders");
+  for (std::list<OpalTranscoder *>::iterator it = idle.begin(); it != idle.end(); ++it)
+    delete *it;
+}
+
+
+OpalTranscoderPool::Statistics OpalTranscoderPool::GetStatistics(const OpalMediaFormat & srcFormat,
+                                                                 const OpalMediaFormat & destFormat) const
+{
+  PWaitAndSignal mutex(m_mutex);
+  EntryMap::const_iterator it = m_entries.find(OpalTranscoderKey(srcFormat.GetName(), destFormat.GetName()));
+  return it != m_entries.end() ? it->second.m_statistics : Statistics();
+}
+
+
 static bool MergeFormats(const OpalMediaFormatList & masterFormats,
                          const OpalMediaFormat & srcCapability,
                          const OpalMediaFormat & dstCapability,
@@ -365,48 +669,210 @@ static bool MergeFormats(const OpalMediaFormatList & masterFormats,
 }
 
 
-bool OpalTranscoder::SelectFormats(const OpalMediaType & mediaType,
-                                   const OpalMediaFormatList & srcFormats,
-                                   const OpalMediaFormatList & dstFormats,
-                                   const OpalMediaFormatList & masterFormats,
-                                   OpalMediaFormat & srcFormat,
-                                   OpalMediaFormat & dstFormat)
+/* Cache of the structural part of the searches done by SelectFormats() and
+   FindIntermediateFormat(), that is, what transcoders exist between which
+   named formats. This only changes when transcoders or media formats are
+   registered, while the searches are done for every media session. The
+   merging of media options still happens on every call, on the candidates
+   in the same order as the uncached search would try them, so the results
+   are identical. */
+class OpalTranscoderPathCache
 {
-  OpalMediaFormatList::const_iterator s, d;
+  public:
+    struct Candidate
+    {
+      Candidate(PINDEX src, PINDEX dst, bool intermediate)
+        : m_src(src), m_dst(dst), m_intermediate(intermediate) { }
+      PINDEX m_src;
+      PINDEX m_dst;
+      bool   m_intermediate;
+    };
+    typedef std::vector<Candidate> Candidates;
+
+    // Intermediate format names in search order, empty string is direct
+    typedef std::vector<PString> Intermediates;
+
+    static OpalTranscoderPathCache & GetInstance()
+    {
+      static OpalTranscoderPathCache cache;
+      return cache;
+    }
 
-  // Search through the supported formats to see if can pass data
-  // directly from the given format to a possible one with no transcoders.
-  for (d = dstFormats.begin(); d != dstFormats.end(); ++d) {
-    for (s = srcFormats.begin(); s != srcFormats.end(); ++s) {
-      if (*s == *d && s->GetMediaType() == mediaType && MergeFormats(masterFormats, *s, *d, srcFormat, dstFormat))
-        return true;
+    void Clear()
+    {
+      PWaitAndSignal mutex(m_mutex);
+      ++m_generation;
+      m_transcodersLoaded = false;
+      m_transcoders.clear();
+      m_candidates.clear();
+      m_intermediates.clear();
     }
-  }
 
-  // Search for a single transcoder to get from a to b
-  for (d = dstFormats.begin(); d != dstFormats.end(); ++d) {
-    for (s = srcFormats.begin(); s != srcFormats.end(); ++s) {
-      if (s->GetMediaType() == mediaType || d->GetMediaType() == mediaType) {
-        OpalTranscoderKey search(s->GetName(), d->GetName());
-        OpalTranscoderList availableTranscoders = OpalTranscoderFactory::GetKeyList();
-        for (OpalTranscoderIterator i = availableTranscoders.begin(); i != availableTranscoders.end(); ++i) {
-          if (search == *i && MergeFormats(masterFormats, *s, *d, srcFormat, dstFormat))
-            return true;
+    Candidates GetCandidates(const OpalMediaType & mediaType,
+                             const OpalMediaFormatList & srcFormats,
+                             const OpalMediaFormatList & dstFormats)
+    {
+      PStringStream key;
+      key << mediaType;
+      for (OpalMediaFormatList::const_iterator s = srcFormats.begin(); s != srcFormats.end(); ++s)
+        key << '\t' << s->GetName();
+      key << '\n';
+      for (OpalMediaFormatList::const_iterator d = dstFormats.begin(); d != dstFormats.end(); ++d)
+        key << '\t' << d->GetName();
+
+      unsigned generation;
+      {
+        PWaitAndSignal mutex(m_mutex);
+        CandidateMap::iterator it = m_candidates.find(key);
+        if (it != m_candidates.end())
+          return it->second;
+        generation = m_generation;
+      }
+
+      Candidates candidates;
+      PINDEX si, di;
+      OpalMediaFormatList::const_iterator s, d;
+
+      // Pass data directly from the given format to a possible one with no transcoders.
+      for (d = dstFormats.begin(), di = 0; d != dstFormats.end(); ++d, ++di) {
+        for (s = srcFormats.begin(), si = 0; s != srcFormats.end(); ++s, ++si) {
+          if (*s == *d && s->GetMediaType() == mediaType)
+            candidates.push_back(Candidate(si, di, false));
         }
       }
+
+      // A single transcoder to get from a to b
+      for (d = dstFormats.begin(), di = 0; d != dstFormats.end(); ++d, ++di) {
+        for (s = srcFormats.begin(), si = 0; s != srcFormats.end(); ++s, ++si) {
+          if ((s->GetMediaType() == mediaType || d->GetMediaType() == mediaType) &&
+                          HasTranscoder(OpalTranscoderKey(s->GetName(), d->GetName())))
+            candidates.push_back(Candidate(si, di, false));
+        }
+      }
+
+      // Last gasp, a double transcoder to get from a to b
+      for (d = dstFormats.begin(), di = 0; d != dstFormats.end(); ++d, ++di) {
+        for (s = srcFormats.begin(), si = 0; s != srcFormats.end(); ++s, ++si) {
+          if (s->GetMediaType() == mediaType || d->GetMediaType() == mediaType) {
+            if (!GetIntermediates(s->GetName(), d->GetName()).empty())
+              candidates.push_back(Candidate(si, di, true));
+          }
+        }
+      }
+
+      PWaitAndSignal mutex(m_mutex);
+      if (generation == m_generation) {
+        if (m_candidates.size() >= MaxEntries)
+          m_candidates.clear();
+        m_candidates[key] = candidates;
+      }
+      return candidates;
     }
-  }
 
-  // Last gasp search for a double transcoder to get from a to b
-  for (d = dstFormats.begin(); d != dstFormats.end(); ++d) {
-    for (s = srcFormats.begin(); s != srcFormats.end(); ++s) {
-      if (s->GetMediaType() == mediaType || d->GetMediaType() == mediaType) {
-        OpalMediaFormat intermediateFormat;
-        if (FindIntermediateFormat(*s, *d, intermediateFormat) &&
-            MergeFormats(masterFormats, *s, *d, srcFormat, dstFormat))
-          return true;
+    Intermediates GetIntermediates(const PCaselessString & srcFormat, const PCaselessString & dstFormat)
+    {
+      OpalTranscoderKey key(srcFormat, dstFormat);
+
+      unsigned generation;
+      {
+        PWaitAndSignal mutex(m_mutex);
+        IntermediateMap::iterator it = m_intermediates.find(key);
+        if (it != m_intermediates.end())
+          return it->second;
+        generation = m_generation;
+      }
+
+      Intermediates intermediates;
+
+      OpalTranscoderList availableTranscoders = OpalTranscoderFactory::GetKeyList();
+      for (OpalTranscoderIterator find1 = availableTranscoders.begin(); find1 != availableTranscoders.end(); ++find1) {
+        if (srcFormat == find1->first) {
+          if (dstFormat == find1->second) {
+            intermediates.push_back(PString::Empty());
+            break;
+          }
+          for (OpalTranscoderIterator find2 = availableTranscoders.begin(); find2 != availableTranscoders.end(); ++find2) {
+            if (find2->first == find1->second && dstFormat == find2->second)
+              intermediates.push_back(find1->second);
+          }
+        }
+      }
+
+      PWaitAndSignal mutex(m_mutex);
+      if (generation == m_generation) {
+        if (m_intermediates.size() >= MaxEntries)
+          m_intermediates.clear();
+        m_intermediates[key] = intermediates;
       }
+      return intermediates;
     }
+
+  protected:
+    OpalTranscoderPathCache()
+      : m_generation(0)
+      , m_transcodersLoaded(false)
+    {
+    }
+
+    bool HasTranscoder(const OpalTranscoderKey & key)
+    {
+      PWaitAndSignal mutex(m_mutex);
+
+      if (!m_transcodersLoaded) {
+        OpalTranscoderList availableTranscoders = OpalTranscoderFactory::GetKeyList();
+        m_transcoders.insert(availableTranscoders.begin(), availableTranscoders.end());
+        m_transcodersLoaded = true;
+      }
+
+      return m_transcoders.find(key) != m_transcoders.end();
+    }
+
+    enum { MaxEntries = 1000 };
+
+    typedef std::map<PString, Candidates> CandidateMap;
+    typedef std::map<OpalTranscoderKey, Intermediates> IntermediateMap;
+
+    unsigned                    m_generation;
+    bool                        m_transcodersLoaded;
+    std::set<OpalTranscoderKey> m_transcoders;
+    CandidateMap                m_candidates;
+    IntermediateMap             m_intermediates;
+    PDECLARE_MUTEX(m_mutex);
+};
+
+
+void OpalTranscoder::ClearSelectionCache()
+{
+  OpalTranscoderPathCache::GetInstance().Clear();
+}
+
+
+bool OpalTranscoder::SelectFormats(const OpalMediaType & mediaType,
+                                   const OpalMediaFormatList & srcFormats,
+                                   const OpalMediaFormatList & dstFormats,
+                                   const OpalMediaFormatList & masterFormats,
+                                   OpalMediaFormat & srcFormat,
+                                   OpalMediaFormat & dstFormat)
+{
+  OpalTranscoderPathCache::Candidates candidates =
+                  OpalTranscoderPathCache::GetInstance().GetCandidates(mediaType, srcFormats, dstFormats);
+  if (candidates.empty())
+    return false;
+
+  // Candidates are by index, so get random access to the lists
+  std::vector<OpalMediaFormatList::const_iterator> src, dst;
+  for (OpalMediaFormatList::const_iterator s = srcFormats.begin(); s != srcFormats.end(); ++s)
+    src.push_back(s);
+  for (OpalMediaFormatList::const_iterator d = dstFormats.begin(); d != dstFormats.end(); ++d)
+    dst.push_back(d);
+
+  for (OpalTranscoderPathCache::Candidates::iterator it = candidates.begin(); it != candidates.end(); ++it) {
+    const OpalMediaFormat & s = *src[it->m_src];
+    const OpalMediaFormat & d = *dst[it->m_dst];
+    OpalMediaFormat intermediateFormat;
+    if ((!it->m_intermediate || FindIntermediateFormat(s, d, intermediateFormat)) &&
+                                            MergeFormats(masterFormats, s, d, srcFormat, dstFormat))
+      return true;
   }
 
   return false;
@@ -419,20 +885,16 @@ bool OpalTranscoder::FindIntermediateFormat(const OpalMediaFormat & srcFormat,
 {
   intermediateFormat = OpalMediaFormat();
 
-  OpalTranscoderList availableTranscoders = OpalTranscoderFactory::GetKeyList();
-  for (OpalTranscoderIterator find1 = availableTranscoders.begin(); find1 != availableTranscoders.end(); ++find1) {
-    if (find1->first == srcFormat) {
-      if (find1->second == dstFormat)
-        return true;
-      for (OpalTranscoderIterator find2 = availableTranscoders.begin(); find2 != availableTranscoders.end(); ++find2) {
-        if (find2->first == find1->second && find2->second == dstFormat) {
-          OpalMediaFormat probableFormat = find1->second;
-          if (probableFormat.Merge(srcFormat) && probableFormat.Merge(dstFormat)) {
-            intermediateFormat = probableFormat;
-            return true;
-          }
-        }
-      }
+  OpalTranscoderPathCache::Intermediates intermediates =
+                  OpalTranscoderPathCache::GetInstance().GetIntermediates(srcFormat.GetName(), dstFormat.GetName());
+  for (OpalTranscoderPathCache::Intermediates::iterator it = intermediates.begin(); it != intermediates.end(); ++it) {
+    if (it->IsEmpty())
+      return true;
+
+    OpalMediaFormat probableFormat = *it;
+    if (probableFormat.Merge(srcFormat) && probableFormat.Merge(dstFormat)) {
+      intermediateFormat = probableFormat;
+      return true;
     }
   }
 
@@ -740,13 +1202,8 @@ PBoolean OpalStreamedTranscoder::Convert(const RTP_DataFrame & input,
     case 16 :
       switch (outputBitsPerSample) {
         case 16 :
-          for (i = 0; i < samples; i++)
-            *outputWords++ = (short)ConvertOne(*inputWords++);
-          break;
-
         case 8 :
-          for (i = 0; i < samples; i++)
-            *outputBytes++ = (BYTE)ConvertOne(*inputWords++);
+          ConvertBlock(inputBytes, outputBytes, samples);
           break;
 
         case 4 :
@@ -785,13 +1242,8 @@ PBoolean OpalStreamedTranscoder::Convert(const RTP_DataFrame & input,
     case 8 :
       switch (outputBitsPerSample) {
         case 16 :
-          for (i = 0; i < samples; i++)
-            *outputWords++ = (short)ConvertOne(*inputBytes++);
-          break;
-
         case 8 :
-          for (i = 0; i < samples; i++)
-            *outputBytes++ = (BYTE)ConvertOne(*inputBytes++);
+          ConvertBlock(inputBytes, outputBytes, samples);
           break;
 
         case 4 :
@@ -899,6 +1351,35 @@ PBoolean OpalStreamedTranscoder::Convert(const RTP_DataFrame & input,
 }
 
 
+void OpalStreamedTranscoder::ConvertBlock(const BYTE * input, BYTE * output, PINDEX samples) const
+{
+  const short * inputWords = (const short *)input;
+  short * outputWords = (short *)output;
+  PINDEX i;
+
+  if (inputBitsPerSample == 16) {
+    if (outputBitsPerSample == 16) {
+      for (i = 0; i < samples; i++)
+        *outputWords++ = (short)ConvertOne(*inputWords++);
+    }
+    else {
+      for (i = 0; i < samples; i++)
+        *output++ = (BYTE)ConvertOne(*inputWords++);
+    }
+  }
+  else {
+    if (outputBitsPerSample == 16) {
+      for (i = 0; i < samples; i++)
+        *outputWords++ = (short)ConvertOne(*input++);
+    }
+    else {
+      for (i = 0; i < samples; i++)
+        *output++ = (BYTE)ConvertOne(*input++);
+    }
+  }
+}
+
+
 /////////////////////////////////////////////////////////////////////////////
 
 Opal_Linear16Mono_PCM::Opal_Linear16Mono_PCM()
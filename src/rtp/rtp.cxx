@@ -49,6 +49,9 @@ RTP_DataFrame::MetaData::MetaData()
   , m_transmitTime(0)
   , m_receivedTime(0)
   , m_discontinuity(0)
+  , m_audioLevel(-1)
+  , m_voiceActivity(false)
+  , m_suppressed(false)
 {
 }
 
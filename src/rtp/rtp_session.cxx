@@ -104,6 +104,8 @@ OpalRTPSession::OpalRTPSession(const Init & init)
   , m_toolName(PProcess::Current().GetName())
   , m_absSendTimeHdrExtId(UINT_MAX)
   , m_transportWideSeqNumHdrExtId(UINT_MAX)
+  , m_rtpStreamIdHdrExtId(UINT_MAX)
+  , m_audioLevelHdrExtId(UINT_MAX)
   , m_staleReceiverTimeout(m_manager.GetStaleReceiverTimeout())
   , m_maxOutOfOrderPackets(20)
   , m_waitOutOfOrderTime(GetDefaultOutOfOrderWaitTime(m_isAudio))
@@ -743,6 +745,12 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::SyncSource::OnSendData(RTP_Dat
     frame.SetHeaderExtension(m_session.m_transportWideSeqNumHdrExtId, 2, (const BYTE *)&sn, RTP_DataFrame::RFC5285_OneByte);
   }
 
+  // Audio level as per RFC 6464, the V bit and 7 bits of -dBov
+  if (m_session.m_audioLevelHdrExtId <= RTP_DataFrame::MaxHeaderExtensionIdOneByte && frame.GetAudioLevel() >= 0) {
+    BYTE level = (BYTE)(std::min(frame.GetAudioLevel(), 127) | (frame.GetVoiceActivity() ? 0x80 : 0));
+    frame.SetHeaderExtension(m_session.m_audioLevelHdrExtId, 1, &level, RTP_DataFrame::RFC5285_OneByte);
+  }
+
   CalculateStatistics(frame, now);
 
   PTRACE(m_throttleSendData, &m_session, m_session << "sending packet " << setw(1) << frame << m_throttleSendData);
@@ -967,6 +975,18 @@ OpalRTPSession::SendReceiveStatus OpalRTPSession::SyncSource::OnReceiveData(RTP_
     }
   }
 
+  if ((exthdr = frame.GetHeaderExtension(RTP_DataFrame::RFC5285_OneByte, m_session.m_audioLevelHdrExtId, hdrlen)) != NULL && hdrlen > 0)
+    frame.SetAudioLevel(exthdr[0] & 0x7f, (exthdr[0] & 0x80) != 0);
+
+  // RtpStreamId is usually only sent in the first few packets, so remember it
+  if ((exthdr = frame.GetHeaderExtension(RTP_DataFrame::RFC5285_OneByte, m_session.m_rtpStreamIdHdrExtId, hdrlen)) != NULL) {
+    PString rid((const char *)exthdr, hdrlen);
+    if (m_rtpStreamId != rid) {
+      PTRACE(3, &m_session, *this << "received RtpStreamId \"" << rid << '"');
+      m_rtpStreamId = rid;
+    }
+  }
+
   Data data(frame);
   for (NotifierMap::iterator it = m_notifiers.begin(); it != m_notifiers.end(); ++it) {
     it->second(m_session, data);
@@ -1452,6 +1472,8 @@ RTPHeaderExtensions OpalRTPSession::GetHeaderExtensions() const
 
 const PString & OpalRTPSession::GetAbsSendTimeHdrExtURI() { static const PConstString s("http://www.webrtc.org/experiments/rtp-hdrext/abs-send-time"); return s; }
 const PString & OpalRTPSession::GetTransportWideSeqNumHdrExtURI() { static const PConstString s("http://www.ietf.org/id/draft-holmer-rmcat-transport-wide-cc-extensions-01"); return s; }
+const PString & OpalRTPSession::GetRtpStreamIdHdrExtURI() { static const PConstString s("urn:ietf:params:rtp-hdrext:sdes:rtp-stream-id"); return s; }
+const PString & OpalRTPSession::GetAudioLevelHdrExtURI() { static const PConstString s("urn:ietf:params:rtp-hdrext:ssrc-audio-level"); return s; }
 
 void OpalRTPSession::SetHeaderExtensions(const RTPHeaderExtensions & ext)
 {
@@ -1485,11 +1507,72 @@ bool OpalRTPSession::AddHeaderExtension(const RTPHeaderExtensionInfo & ext)
     return true;
   }
 
+  if (uri == GetRtpStreamIdHdrExtURI() && m_stringOptions.GetBoolean(OPAL_OPT_SIMULCAST)) {
+    if (m_headerExtensions.AddUniqueID(adjustedExt))
+      m_rtpStreamIdHdrExtId = adjustedExt.m_id;
+    return true;
+  }
+
+  if (uri == GetAudioLevelHdrExtURI() && m_isAudio && m_stringOptions.GetBoolean(OPAL_OPT_RTP_AUDIO_LEVEL)) {
+    if (m_headerExtensions.AddUniqueID(adjustedExt))
+      m_audioLevelHdrExtId = adjustedExt.m_id;
+    return true;
+  }
+
   PTRACE(3, *this << "unsupported header extension: " << ext);
   return false;
 }
 
 
+void OpalRTPSession::SetSimulcast(const PStringArray & rids, const RTP_SyncSourceArray & ssrcs)
+{
+  P_INSTRUMENTED_LOCK_READ_WRITE(return);
+
+  m_simulcastRids = rids;
+  m_simulcastRids.MakeUnique();
+  m_simulcastSSRCs = ssrcs;
+  PTRACE_IF(3, !rids.IsEmpty() || !ssrcs.empty(), *this << "simulcast enabled:"
+            " rids=" << setfill(',') << rids << setfill(' ') << ","
+            " SSRCs=" << ssrcs.size());
+}
+
+
+bool OpalRTPSession::IsSimulcast() const
+{
+  P_INSTRUMENTED_LOCK_READ_ONLY(return false);
+  return !m_simulcastRids.IsEmpty() || !m_simulcastSSRCs.empty();
+}
+
+
+PStringArray OpalRTPSession::GetSimulcastStreamIds() const
+{
+  P_INSTRUMENTED_LOCK_READ_ONLY(return PStringArray());
+  PStringArray rids = m_simulcastRids;
+  rids.MakeUnique();
+  return rids;
+}
+
+
+PString OpalRTPSession::GetRtpStreamId(RTP_SyncSourceId ssrc, Direction dir) const
+{
+  P_INSTRUMENTED_LOCK_READ_ONLY(return PString::Empty());
+  return GetSyncSource(ssrc, dir).m_rtpStreamId.GetPointer();
+}
+
+
+RTP_SyncSourceId OpalRTPSession::FindSyncSourceByRtpStreamId(const PString & rid, Direction dir) const
+{
+  P_INSTRUMENTED_LOCK_READ_ONLY(return 0);
+
+  for (SyncSourceMap::const_iterator it = m_SSRC.begin(); it != m_SSRC.end(); ++it) {
+    if (it->second->m_direction == dir && it->second->m_rtpStreamId == rid)
+      return it->first;
+  }
+
+  return 0;
+}
+
+
 void OpalRTPSession::SetAnySyncSource(bool allow)
 {
   P_INSTRUMENTED_LOCK_READ_WRITE();
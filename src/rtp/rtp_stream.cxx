@@ -351,7 +351,7 @@ PBoolean OpalRTPMediaStream::ReadPacket(RTP_DataFrame & packet)
     if (packetTime > 0)
       m_timestamp += packetTime;
     else if (m_frameTime > 0)
-      m_timestamp += ((20*GetMediaFormat().GetTimeUnits() + m_frameTime - 1)/m_frameTime) * m_frameTime;
+      m_timestamp += ((20*GetFrozenMediaFormat()->GetClockRate()/1000 + m_frameTime - 1)/m_frameTime) * m_frameTime;
     packet.SetTimestamp(m_timestamp);
   }
 
@@ -414,7 +414,7 @@ PBoolean OpalRTPMediaStream::WritePacket(RTP_DataFrame & packet)
 
   if (m_rewriteHeaders && packet.GetPayloadSize() == 0
 #if OPAL_VIDEO
-          && (!packet.GetMarker() || GetMediaFormat().GetMediaType() != OpalMediaType::Video())
+          && (!packet.GetMarker() || GetFrozenMediaFormat()->GetMediaType() != OpalMediaType::Video())
 #endif
       )
     return true; // Ignore empty packets, except for video with marker, which can plausibly be empty
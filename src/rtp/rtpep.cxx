@@ -174,7 +174,9 @@ PStringList OpalRTPEndPoint::GetAvailableStringOptions() const
     #endif
     OPAL_OPT_RTP_ALLOW_SSRC,
     OPAL_OPT_RTP_ABS_SEND_TIME,
-    OPAL_OPT_TRANSPORT_WIDE_CONGESTION_CONTROL
+    OPAL_OPT_TRANSPORT_WIDE_CONGESTION_CONTROL,
+    OPAL_OPT_RTP_AUDIO_LEVEL,
+    OPAL_OPT_SIMULCAST
   };
 
   PStringList list = OpalEndPoint::GetAvailableStringOptions();
@@ -0,0 +1,289 @@
+/*
+ * simulcast.cxx
+ *
+ * Simulcast layer selection for forwarded video
+ *
+ * Open Phone Abstraction Library (OPAL)
+ *
+ * Copyright (C) 2026 Vox Lucida Pty. Ltd.
+ *
+ * The contents of this file are subject to the Mozilla Public License
+ * Version 1.0 (the "License"); you may not use this file except in
+ * compliance with the License. You may obtain a copy of the License at
+ * http://www.mozilla.org/MPL/
+ *
+ * Software distributed under the License is distributed on an "AS IS"
+ * basis, WITHOUT WARRANTY OF ANY KIND, either express or implied. See
+ * the License for the specific language governing rights and limitations
+ * under the License.
+ *
+ * The Original Code is Open Phone Abstraction Library.
+ *
+ * The Initial Developer of the Original Code is Vox Lucida Pty. Ltd.
+ *
+ * Contributor(s): ______________________________________.
+ */
+
+#include <ptlib.h>
+
+#ifdef __GNUC__
+#pragma implementation "simulcast.h"
+#endif
+
+#include <opal_config.h>
+
+#include <rtp/simulcast.h>
+
+#if OPAL_VIDEO
+
+#define PTraceModule() "Simulcast"
+
+static const PTimeInterval LayerMeasureWindow(0, 1);
+static const PTimeInterval LayerInactiveTime(0, 2);
+static const PTimeInterval LayerRemoveTime(0, 10);
+static const PTimeInterval TargetUpdateInterval(500);
+static const PTimeInterval IntraFrameRequestInterval(0, 1);
+static const unsigned      UpgradeHeadroomPercent = 85;
+
+
+///////////////////////////////////////////////////////////////////////////////
+
+OpalSimulcastSelector::Layer::Layer()
+  : m_windowOctets(0)
+  , m_bitRate(0)
+  , m_lastPacketTime(0)
+{
+}
+
+
+OpalSimulcastSelector::OpalSimulcastSelector(const OpalVideoFormat & mediaFormat)
+  : m_mediaFormat(mediaFormat)
+  , m_clockRate(mediaFormat.GetClockRate())
+  , m_availableBitRate(0)
+  , m_currentSSRC(0)
+  , m_targetSSRC(0)
+  , m_forwarding(false)
+  , m_sequenceOffset(0)
+  , m_lastSequenceNumber(0)
+  , m_timestampOffset(0)
+  , m_lastTimestamp(0)
+  , m_intraFrameRequestSSRC(0)
+  , m_lastIntraFrameRequest(0)
+{
+  if (m_clockRate == 0)
+    m_clockRate = OpalMediaFormat::VideoClockRate;
+
+  PTRACE(4, "Created simulcast selector for " << m_mediaFormat);
+}
+
+
+OpalSimulcastSelector::~OpalSimulcastSelector()
+{
+  for (LayerMap::iterator it = m_layers.begin(); it != m_layers.end(); ++it)
+    delete it->second;
+}
+
+
+bool OpalSimulcastSelector::SelectFrame(const RTP_DataFrame & frame, RTP_SequenceNumber & sequenceNumber, RTP_Timestamp & timestamp)
+{
+  PTime now;
+  RTP_SyncSourceId ssrc = frame.GetSyncSource();
+
+  PWaitAndSignal lock(m_mutex);
+
+  LayerMap::iterator it = m_layers.find(ssrc);
+  if (it == m_layers.end()) {
+    it = m_layers.insert(LayerMap::value_type(ssrc, new Layer())).first;
+    PTRACE(3, "Added layer SSRC=" << RTP_TRACE_SRC(ssrc) << ", total=" << m_layers.size());
+  }
+
+  Layer & layer = *it->second;
+  layer.m_lastPacketTime = now;
+  layer.m_windowOctets += frame.GetPayloadSize();
+  PTimeInterval elapsed = now - layer.m_windowStart;
+  if (elapsed >= LayerMeasureWindow) {
+    layer.m_bitRate = (OpalBandwidth::int_type)(layer.m_windowOctets*8000LL/elapsed.GetMilliSeconds());
+    layer.m_windowOctets = 0;
+    layer.m_windowStart = now;
+    PTRACE(5, "Layer SSRC=" << RTP_TRACE_SRC(ssrc) << " bit rate " << layer.m_bitRate);
+  }
+
+  // Need to do this for every packet, as detector may need state across packets
+  OpalVideoFormat::FrameType frameType = m_mediaFormat.GetFrameType(frame.GetPayloadPtr(),
+                                                                     frame.GetPayloadSize(),
+                                                                     layer.m_frameDetector);
+
+  if (now >= m_nextTargetUpdate)
+    UpdateTarget(now);
+
+  if (ssrc != m_currentSSRC) {
+    /* Can only move to a new layer at an intra frame. If we have not yet
+       measured any layers, then take whichever one gives us a picture first. */
+    if (frameType != OpalVideoFormat::e_IntraFrame)
+      return false;
+    if (m_targetSSRC != 0 ? (ssrc != m_targetSSRC) : (m_currentSSRC != 0))
+      return false;
+    SwitchLayer(frame, now);
+  }
+
+  sequenceNumber = (RTP_SequenceNumber)(frame.GetSequenceNumber() + m_sequenceOffset);
+  timestamp = frame.GetTimestamp() + m_timestampOffset;
+
+  // Allow for out of order packets
+  if ((RTP_SequenceNumber)(sequenceNumber - m_lastSequenceNumber) < 0x8000) {
+    m_lastSequenceNumber = sequenceNumber;
+    m_lastTimestamp = timestamp;
+    m_lastForwardTime = now;
+  }
+
+  return true;
+}
+
+
+void OpalSimulcastSelector::SwitchLayer(const RTP_DataFrame & frame, const PTime & now)
+{
+  if (m_forwarding) {
+    /* Continue on from the last forwarded packet, advancing the timestamp
+       by however much real time has elapsed, as layers timestamps are
+       completely unrelated to each other. */
+    unsigned delta = (unsigned)((now - m_lastForwardTime).GetMilliSeconds()*m_clockRate/1000);
+    if (delta == 0)
+      delta = 1;
+    m_sequenceOffset = (RTP_SequenceNumber)(m_lastSequenceNumber + 1 - frame.GetSequenceNumber());
+    m_timestampOffset = m_lastTimestamp + delta - frame.GetTimestamp();
+  }
+  else {
+    m_forwarding = true;
+    m_sequenceOffset = 0;
+    m_timestampOffset = 0;
+    m_lastSequenceNumber = (RTP_SequenceNumber)(frame.GetSequenceNumber() - 1);
+  }
+
+  PTRACE(3, "Switching layer from SSRC=" << RTP_TRACE_SRC(m_currentSSRC)
+         << " to SSRC=" << RTP_TRACE_SRC(frame.GetSyncSource())
+         << ", available=" << m_availableBitRate);
+  m_currentSSRC = frame.GetSyncSource();
+}
+
+
+bool OpalSimulcastSelector::IsActive(const Layer & layer, const PTime & now) const
+{
+  return (now - layer.m_lastPacketTime) < LayerInactiveTime;
+}
+
+
+void OpalSimulcastSelector::UpdateTarget(const PTime & now)
+{
+  m_nextTargetUpdate = now + TargetUpdateInterval;
+
+  RTP_SyncSourceId best = 0;
+  OpalBandwidth bestRate = 0;
+  RTP_SyncSourceId lowest = 0;
+  OpalBandwidth lowestRate = UINT_MAX;
+
+  LayerMap::iterator it = m_layers.begin();
+  while (it != m_layers.end()) {
+    Layer & layer = *it->second;
+
+    if (!IsActive(layer, now)) {
+      if ((now - layer.m_lastPacketTime) > LayerRemoveTime) {
+        PTRACE(3, "Removing layer SSRC=" << RTP_TRACE_SRC(it->first));
+        delete it->second;
+        m_layers.erase(it++);
+      }
+      else
+        ++it;
+      continue;
+    }
+
+    if (layer.m_bitRate > 0) { // Not measured yet
+      if (layer.m_bitRate < lowestRate) {
+        lowest = it->first;
+        lowestRate = layer.m_bitRate;
+      }
+
+      // Need some headroom before moving up, or we oscillate between layers
+      OpalBandwidth limit = m_availableBitRate;
+      if (it->first != m_currentSSRC)
+        limit = m_availableBitRate/100*UpgradeHeadroomPercent;
+      if ((m_availableBitRate == 0 || layer.m_bitRate <= limit) && layer.m_bitRate > bestRate) {
+        best = it->first;
+        bestRate = layer.m_bitRate;
+      }
+    }
+
+    ++it;
+  }
+
+  // Nothing fits, so lowest is the best we can do
+  if (best == 0)
+    best = lowest;
+
+  if (m_targetSSRC != best) {
+    PTRACE(3, "Target layer changed from SSRC=" << RTP_TRACE_SRC(m_targetSSRC)
+           << " to SSRC=" << RTP_TRACE_SRC(best) << ", rate=" << bestRate << ", available=" << m_availableBitRate);
+    m_targetSSRC = best;
+  }
+
+  if (m_targetSSRC != 0 && m_targetSSRC != m_currentSSRC && (now - m_lastIntraFrameRequest) > IntraFrameRequestInterval) {
+    m_intraFrameRequestSSRC = m_targetSSRC;
+    m_lastIntraFrameRequest = now;
+  }
+}
+
+
+void OpalSimulcastSelector::SetAvailableBitRate(OpalBandwidth bitRate)
+{
+  PWaitAndSignal lock(m_mutex);
+
+  if (m_availableBitRate == bitRate)
+    return;
+
+  PTRACE(4, "Available bit rate changed from " << m_availableBitRate << " to " << bitRate);
+  m_availableBitRate = bitRate;
+  m_nextTargetUpdate = PTime(0); // Re-evaluate on next packet
+}
+
+
+OpalBandwidth OpalSimulcastSelector::GetAvailableBitRate() const
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_availableBitRate;
+}
+
+
+RTP_SyncSourceId OpalSimulcastSelector::GetIntraFrameRequest()
+{
+  PWaitAndSignal lock(m_mutex);
+  RTP_SyncSourceId ssrc = m_intraFrameRequestSSRC;
+  m_intraFrameRequestSSRC = 0;
+  return ssrc;
+}
+
+
+RTP_SyncSourceId OpalSimulcastSelector::GetCurrentLayer() const
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_currentSSRC;
+}
+
+
+RTP_SyncSourceId OpalSimulcastSelector::GetTargetLayer() const
+{
+  PWaitAndSignal lock(m_mutex);
+  return m_targetSSRC;
+}
+
+
+OpalBandwidth OpalSimulcastSelector::GetLayerBitRate(RTP_SyncSourceId ssrc) const
+{
+  PWaitAndSignal lock(m_mutex);
+  LayerMap::const_iterator it = m_layers.find(ssrc);
+  return it != m_layers.end() ? it->second->m_bitRate : OpalBandwidth(0);
+}
+
+
+#endif // OPAL_VIDEO
+
+
+// End of File ///////////////////////////////////////////////////////////////
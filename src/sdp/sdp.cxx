@@ -1845,6 +1845,20 @@ void SDPRTPAVPMediaDescription::OutputAttributes(ostream & strm) const
     }
   }
 
+  // RFC8851/RFC8853 simulcast
+  for (std::map<PString, PString>::const_iterator it = m_rids.begin(); it != m_rids.end(); ++it)
+    strm << "a=rid:" << it->first << ' ' << it->second << CRLF;
+  if (!m_simulcastSend.IsEmpty() || !m_simulcastRecv.IsEmpty()) {
+    strm << "a=simulcast:";
+    for (PINDEX i = 0; i < m_simulcastSend.GetSize(); ++i)
+      strm << (i == 0 ? "send " : ";") << m_simulcastSend[i];
+    if (!m_simulcastSend.IsEmpty() && !m_simulcastRecv.IsEmpty())
+      strm << ' ';
+    for (PINDEX i = 0; i < m_simulcastRecv.GetSize(); ++i)
+      strm << (i == 0 ? "recv " : ";") << m_simulcastRecv[i];
+    strm << CRLF;
+  }
+
   // m_rtcp_fb is set via SDPRTPAVPMediaDescription::PreEncode according to various options
   OuputRTCP_FB(strm, -1, m_rtcp_fb);
 }
@@ -2027,6 +2041,52 @@ void SDPRTPAVPMediaDescription::SetAttribute(const PString & attr, const PString
       m_flowSSRC.push_back(ssrcs);
       return;
     }
+    if (tokens.GetSize() > 1 && (tokens[0] *= "SIM")) {
+      m_simulcastSSRC.resize(tokens.GetSize() - 1);
+      for (PINDEX i = 1; i < tokens.GetSize(); ++i)
+        m_simulcastSSRC[i - 1] = tokens[i].AsUnsigned();
+      PTRACE(4, "Simulcast SSRC group with " << m_simulcastSSRC.size() << " layers");
+      return;
+    }
+  }
+
+  if (attr *= "rid") {
+    PStringArray tokens = value.Tokenise(' ', false);
+    if (tokens.GetSize() < 2)
+      PTRACE(2, "Cannot decode rid attribute: \"" << value << '"');
+    else
+      m_rids[tokens[0]] = tokens[1];
+    return;
+  }
+
+  if (attr *= "simulcast") {
+    PStringArray tokens = value.Tokenise(' ', false);
+    for (PINDEX i = 0; i+1 < tokens.GetSize(); i += 2) {
+      PStringArray * layers;
+      if (tokens[i] *= "send")
+        layers = &m_simulcastSend;
+      else if (tokens[i] *= "recv")
+        layers = &m_simulcastRecv;
+      else {
+        PTRACE(2, "Cannot decode simulcast attribute: \"" << value << '"');
+        return;
+      }
+
+      PString list = tokens[i+1];
+      if (list.NumCompare("rid=") == EqualTo)
+        list.Delete(0, 4); // Old draft syntax
+
+      // Alternatives are comma separated, we just use the first one, and ignore paused (~) state
+      PStringArray streams = list.Tokenise(';', false);
+      for (PINDEX s = 0; s < streams.GetSize(); ++s) {
+        PString rid = streams[s].Left(streams[s].Find(','));
+        if (rid[(PINDEX)0] == '~')
+          rid.Delete(0, 1);
+        layers->AppendString(rid);
+      }
+    }
+    PTRACE(4, "Simulcast: send=" << setfill(';') << m_simulcastSend << " recv=" << m_simulcastRecv);
+    return;
   }
 
   SDPMediaDescription::SetAttribute(attr, value);
@@ -2045,6 +2105,14 @@ bool SDPRTPAVPMediaDescription::FromSession(OpalMediaSession * session,
     if (offer != NULL) {
       m_headerExtensions = rtpSession->GetHeaderExtensions();
       m_reducedSizeRTCP = rtpSession->UseReducedSizeRTCP();
+
+      // Accept the simulcast layers the remote wishes to send us
+      const SDPRTPAVPMediaDescription * avpOffer = dynamic_cast<const SDPRTPAVPMediaDescription *>(offer);
+      if (avpOffer != NULL && !avpOffer->m_simulcastSend.IsEmpty() && m_stringOptions.GetBoolean(OPAL_OPT_SIMULCAST)) {
+        m_simulcastRecv = avpOffer->m_simulcastSend;
+        for (PINDEX i = 0; i < m_simulcastRecv.GetSize(); ++i)
+          m_rids[m_simulcastRecv[i]] = "recv";
+      }
     }
     else {
       if (m_stringOptions.GetBoolean(OPAL_OPT_RTP_ABS_SEND_TIME)) {
@@ -2057,6 +2125,16 @@ bool SDPRTPAVPMediaDescription::FromSession(OpalMediaSession * session,
         SetHeaderExtension(ext);
       }
 
+      if (m_stringOptions.GetBoolean(OPAL_OPT_SIMULCAST)) {
+        RTPHeaderExtensionInfo ext(OpalRTPSession::GetRtpStreamIdHdrExtURI());
+        SetHeaderExtension(ext);
+      }
+
+      if (rtpSession->IsAudio() && m_stringOptions.GetBoolean(OPAL_OPT_RTP_AUDIO_LEVEL)) {
+        RTPHeaderExtensionInfo ext(OpalRTPSession::GetAudioLevelHdrExtURI(), "vad=on");
+        SetHeaderExtension(ext);
+      }
+
       if (m_stringOptions.GetBoolean(OPAL_OPT_OFFER_REDUCED_SIZE_RTCP, true))
         m_reducedSizeRTCP = true;
     }
@@ -2161,6 +2239,9 @@ bool SDPRTPAVPMediaDescription::ToSession(OpalMediaSession * session, RTP_SyncSo
     rtpSession->SetHeaderExtensions(GetHeaderExtensions());
     rtpSession->SetLabel(m_label);
 
+    if ((!m_simulcastSend.IsEmpty() || m_simulcastSSRC.size() > 1) && m_stringOptions.GetBoolean(OPAL_OPT_SIMULCAST))
+      rtpSession->SetSimulcast(m_simulcastSend, m_simulcastSSRC);
+
     for (SsrcInfo::const_iterator it = m_ssrcInfo.begin(); it != m_ssrcInfo.end(); ++it) {
       RTP_SyncSourceId ssrc = it->first;
       ssrcs.push_back(ssrc);
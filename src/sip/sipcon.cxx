@@ -3484,7 +3484,7 @@ void SIPConnection::OnReceivedINFO(SIP_PDU & request)
   request.SendResponse(status);
 
   if (status == SIP_PDU::Successful_OK) {
-#if OPAL_PTLIB_DTMF
+#if OPAL_DTMF_DETECT
     // Have INFO user input, disable the in-band tone detcetor to avoid double detection
     m_detectInBandDTMF = false;
     OpalMediaStreamPtr stream = GetMediaStream(OpalMediaType::Audio(), true);